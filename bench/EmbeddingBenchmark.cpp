@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "api/ThetaAPI.h"
+
+using namespace std;
+
+/**
+ * Measures the overhead of calling into Theta from a host program through the libtheta C API: compiling a module,
+ * instantiating it, looking up an export, and then calling that export many times. The called function does almost
+ * no work, so the per-call time is dominated by the cost of crossing the host/wasm boundary.
+ *
+ * Usage: theta_embedding_benchmark [iterations]
+ */
+
+static const char* SOURCE = R"(
+  capsule Benchmark {
+    add<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> a + b
+  }
+)";
+
+static double elapsedMicroseconds(chrono::steady_clock::time_point start) {
+  return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+static void check(theta_status status, string step) {
+  if (status == THETA_OK) return;
+
+  cerr << step << " failed: " << theta_status_string(status) << endl;
+  exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+
+  theta_compiler* compiler = theta_compiler_new(0);
+  theta_module* module = nullptr;
+  theta_instance* instance = nullptr;
+  theta_function* add = nullptr;
+
+  auto start = chrono::steady_clock::now();
+  check(theta_compile(compiler, SOURCE, string(SOURCE).size(), "Benchmark.th", &module), "Compiling");
+  double compileTime = elapsedMicroseconds(start);
+
+  start = chrono::steady_clock::now();
+  check(theta_instantiate(module, &instance), "Instantiating");
+  double instantiateTime = elapsedMicroseconds(start);
+
+  start = chrono::steady_clock::now();
+  check(theta_instance_get_function(instance, "add", 2, &add), "Looking up add");
+  double lookupTime = elapsedMicroseconds(start);
+
+  theta_value args[2];
+  args[0].kind = THETA_I64;
+  args[1].kind = THETA_I64;
+  theta_value result;
+  int64_t checksum = 0;
+
+  start = chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) {
+    args[0].of.i64 = i;
+    args[1].of.i64 = 1;
+
+    check(theta_call(add, args, 2, &result), "Calling add");
+
+    checksum += result.of.i64;
+  }
+  double callTime = elapsedMicroseconds(start);
+
+  cout << "compile:      " << compileTime << " us" << endl;
+  cout << "instantiate:  " << instantiateTime << " us" << endl;
+  cout << "lookup:       " << lookupTime << " us" << endl;
+  cout << "calls:        " << iterations << " in " << callTime << " us" << endl;
+  cout << "per call:     " << (callTime * 1000 / iterations) << " ns" << endl;
+  cout << "checksum:     " << checksum << endl;
+
+  theta_instance_free(instance);
+  theta_module_free(module);
+  theta_compiler_free(compiler);
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "lsp/LanguageServer.hpp"
+
+using namespace std;
+using namespace Theta;
+
+/**
+ * Measures how long the language server takes from receiving a keystroke to publishing diagnostics, on a generated
+ * capsule of the given number of lines. Each keystroke is sent as an incremental didChange notification that types or
+ * deletes a digit inside one of the capsule's elements, and is compared against analyzing the whole document again,
+ * which is what every keystroke would cost without incremental analysis.
+ *
+ * Usage: theta_lsp_benchmark [lines] [keystrokes]
+ */
+
+static double elapsedMilliseconds(chrono::steady_clock::time_point start) {
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Alternates between constants and functions that reference them, so that edits have dependents to re-check
+static string generateCapsule(long lines) {
+  string source = "capsule Benchmark {\n";
+
+  for (long i = 0; i < lines / 2; i++) {
+    string index = to_string(i);
+
+    source += "    v" + index + "<Number> = " + index + "\n";
+    source += "    f" + index + "<Function<Number, Number>> = (n<Number>) -> n * v" + index + " + 1\n";
+  }
+
+  return source + "}\n";
+}
+
+static JsonValue makeMessage(string method, JsonValue params) {
+  JsonValue message = JsonValue::object();
+  message.set("jsonrpc", "2.0");
+  message.set("method", method);
+  message.set("params", params);
+
+  return message;
+}
+
+static JsonValue makeChange(string uri, int line, int startCharacter, int endCharacter, string text) {
+  JsonValue start = JsonValue::object();
+  start.set("line", line);
+  start.set("character", startCharacter);
+
+  JsonValue end = JsonValue::object();
+  end.set("line", line);
+  end.set("character", endCharacter);
+
+  JsonValue range = JsonValue::object();
+  range.set("start", start);
+  range.set("end", end);
+
+  JsonValue change = JsonValue::object();
+  change.set("range", range);
+  change.set("text", text);
+
+  JsonValue contentChanges = JsonValue::array();
+  contentChanges.push(change);
+
+  JsonValue textDocument = JsonValue::object();
+  textDocument.set("uri", uri);
+
+  JsonValue params = JsonValue::object();
+  params.set("textDocument", textDocument);
+  params.set("contentChanges", contentChanges);
+
+  return makeMessage("textDocument/didChange", params);
+}
+
+int main(int argc, char* argv[]) {
+  long lines = argc > 1 ? atol(argv[1]) : 10000;
+  long keystrokes = argc > 2 ? atol(argv[2]) : 200;
+
+  string uri = "file:///Benchmark.th";
+  string source = generateCapsule(lines);
+
+  istringstream in;
+  ostringstream out;
+  LanguageServer server(in, out);
+
+  JsonValue textDocument = JsonValue::object();
+  textDocument.set("uri", uri);
+  textDocument.set("text", source);
+
+  JsonValue params = JsonValue::object();
+  params.set("textDocument", textDocument);
+
+  auto start = chrono::steady_clock::now();
+  server.handleMessage(makeMessage("textDocument/didOpen", params));
+  double openTime = elapsedMilliseconds(start);
+
+  // Edit the constant in the middle of the capsule, right after its last digit
+  long middle = lines / 4;
+  int line = 1 + middle * 2;
+  int character = string("    v" + to_string(middle) + "<Number> = " + to_string(middle)).length();
+
+  double slowestKeystroke = 0;
+  size_t published = 0;
+
+  start = chrono::steady_clock::now();
+  for (long i = 0; i < keystrokes; i++) {
+    auto keystrokeStart = chrono::steady_clock::now();
+
+    out.str("");
+
+    // Type a digit, then delete it again on the next keystroke
+    if (i % 2 == 0) {
+      server.handleMessage(makeChange(uri, line, character, character, "7"));
+    } else {
+      server.handleMessage(makeChange(uri, line, character, character + 1, ""));
+    }
+
+    slowestKeystroke = max(slowestKeystroke, elapsedMilliseconds(keystrokeStart));
+    published += out.str().length();
+  }
+  double keystrokeTime = elapsedMilliseconds(start);
+
+  shared_ptr<TextDocument> document = server.getDocument(uri);
+  bool wasIncremental = document->wasLastAnalysisIncremental();
+
+  long fullAnalyses = max(1L, keystrokes / 20);
+  shared_ptr<map<string, string>> filesByCapsuleName = make_shared<map<string, string>>();
+
+  start = chrono::steady_clock::now();
+  for (long i = 0; i < fullAnalyses; i++) {
+    TextDocument full(uri, document->getText(), filesByCapsuleName);
+    published += full.getDiagnostics().size();
+  }
+  double fullTime = elapsedMilliseconds(start);
+
+  cout << "lines:          " << lines << " (" << document->getElementCount() << " elements)" << endl;
+  cout << "open:           " << openTime << " ms" << endl;
+  cout << "keystrokes:     " << keystrokes << " in " << keystrokeTime << " ms" << (wasIncremental ? "" : " (not incremental)") << endl;
+  cout << "per keystroke:  " << (keystrokeTime / keystrokes) << " ms (slowest " << slowestKeystroke << " ms)" << endl;
+  cout << "full analysis:  " << (fullTime / fullAnalyses) << " ms" << endl;
+  cout << "published:      " << published << " bytes" << endl;
+}
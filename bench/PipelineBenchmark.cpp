@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "compiler/Compiler.hpp"
+#include "compiler/CompilationSession.hpp"
+#include "runtime/Runtime.hpp"
+
+using namespace std;
+using namespace Theta;
+
+/**
+ * Measures a pipeline of small stages compiled at -O2 with and without the pipeline-fusion pass. Fused, every stage is
+ * inlined into a single run of arithmetic. Unfused, the stages that use their piped value more than once stay calls,
+ * along with every stage after them that they're piped into.
+ *
+ * Usage: theta_pipeline_benchmark [iterations]
+ */
+
+static const char* SOURCE = R"(
+  capsule Benchmark {
+    scale<Function<Number, Number, Number>> = (n<Number>, factor<Number>) -> n * factor
+    square<Function<Number, Number>> = (n<Number>) -> n * n
+    offset<Function<Number, Number, Number>> = (n<Number>, amount<Number>) -> n + amount
+    wrap<Function<Number, Number>> = (n<Number>) -> n % 1000003
+    transform<Function<Number, Number>> = (x<Number>) -> x => scale(3) => square() => offset(7) => wrap()
+    loop<Function<Number, Number, Number>> = (i<Number>, total<Number>) -> {
+      if (i == 0) {
+        return total
+      }
+
+      loop(i - 1, total + transform(i))
+    }
+    run<Function<Number, Number>> = (iterations<Number>) -> loop(iterations, 0)
+  }
+)";
+
+static double elapsedMilliseconds(chrono::steady_clock::time_point start) {
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static vector<char> compile(bool isFusing) {
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>();
+  session->optimization.level = O2;
+
+  if (!isFusing) session->optimization.parsePassOverrides("-pipeline-fusion");
+
+  vector<char> binary = Compiler::compileDirect(session, SOURCE, "Benchmark.th");
+
+  if (binary.empty()) {
+    cerr << "Compiling " << (isFusing ? "fused" : "unfused") << " pipeline failed" << endl;
+    exit(1);
+  }
+
+  return binary;
+}
+
+int main(int argc, char* argv[]) {
+  string iterations = argc > 1 ? argv[1] : "10000000";
+
+  vector<char> unfused = compile(false);
+  vector<char> fused = compile(true);
+
+  Runtime runtime;
+  double times[2];
+  string checksums[2];
+  vector<char>* binaries[2] = { &unfused, &fused };
+
+  for (int i = 0; i < 2; i++) {
+    auto start = chrono::steady_clock::now();
+    checksums[i] = runtime.execute(*binaries[i], "run", { iterations }).stringifiedResult();
+    times[i] = elapsedMilliseconds(start);
+  }
+
+  cout << "unfused:      " << times[0] << " ms (" << unfused.size() << " bytes)" << endl;
+  cout << "fused:        " << times[1] << " ms (" << fused.size() << " bytes)" << endl;
+  cout << "speedup:      " << (times[0] / times[1]) << "x" << endl;
+  cout << "checksum:     " << checksums[1] << (checksums[0] == checksums[1] ? "" : " (MISMATCH: " + checksums[0] + ")") << endl;
+
+  return checksums[0] == checksums[1] ? 0 : 1;
+}
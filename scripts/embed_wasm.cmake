@@ -0,0 +1,38 @@
+# Turns a binary file into a C++ header containing its bytes as a constexpr array, so it can be compiled into the
+# executable instead of being read from disk at runtime.
+#
+# Usage: cmake -DINPUT_FILE=<file> -DOUTPUT_FILE=<header> -DVARIABLE_NAME=<name> -P embed_wasm.cmake
+
+if (NOT INPUT_FILE OR NOT OUTPUT_FILE OR NOT VARIABLE_NAME)
+    message(FATAL_ERROR "INPUT_FILE, OUTPUT_FILE and VARIABLE_NAME must all be set")
+endif()
+
+file(READ ${INPUT_FILE} HEX_CONTENTS HEX)
+string(LENGTH "${HEX_CONTENTS}" HEX_LENGTH)
+math(EXPR BYTE_COUNT "${HEX_LENGTH} / 2")
+
+# Every two hex characters is one byte. Emit them as 0x.. literals, 16 to a line so the header stays readable
+set(BYTE_LITERALS "")
+set(OFFSET 0)
+while (OFFSET LESS HEX_LENGTH)
+    string(SUBSTRING "${HEX_CONTENTS}" ${OFFSET} 32 HEX_LINE)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, " LINE_LITERALS "${HEX_LINE}")
+    string(APPEND BYTE_LITERALS "    ${LINE_LITERALS}\n")
+    math(EXPR OFFSET "${OFFSET} + 32")
+endwhile()
+
+get_filename_component(INPUT_NAME ${INPUT_FILE} NAME)
+
+file(WRITE ${OUTPUT_FILE}
+"// Generated by scripts/embed_wasm.cmake from ${INPUT_NAME}. Do not edit.
+#pragma once
+
+#include <cstddef>
+
+namespace Theta {
+  constexpr unsigned char ${VARIABLE_NAME}[] = {
+${BYTE_LITERALS}  };
+
+  constexpr size_t ${VARIABLE_NAME}_SIZE = ${BYTE_COUNT};
+}
+")
@@ -0,0 +1,235 @@
+#include "ThetaAPI.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "compiler/Compiler.hpp"
+#include "compiler/CompilationSession.hpp"
+#include "compiler/LinkedCapsuleCache.hpp"
+#include "runtime/Runtime.hpp"
+
+using namespace std;
+using namespace Theta;
+
+struct theta_compiler {
+  shared_ptr<map<string, string>> filesByCapsuleName;
+  shared_ptr<LinkedCapsuleCache> linkedCapsuleCache;
+  bool isFastEmit;
+};
+
+struct theta_module {
+  vector<char> binary;
+};
+
+struct theta_function {
+  wasm::Func* func;
+  vector<theta_value_kind> paramKinds;
+  theta_value_kind resultKind;
+
+  // Reused between calls so that calling a function doesn't allocate
+  vector<wasm::Val> params;
+};
+
+struct theta_instance {
+  Runtime runtime;
+  wasm::own<wasm::Module> module;
+  wasm::own<wasm::Instance> instance;
+  wasm::ownvec<wasm::Extern> exports;
+  vector<string> exportNames;
+  vector<unique_ptr<theta_function>> functions;
+};
+
+namespace {
+  bool toValueKind(wasm::ValKind kind, theta_value_kind &valueKind) {
+    if (kind == wasm::I32) valueKind = THETA_I32;
+    else if (kind == wasm::I64) valueKind = THETA_I64;
+    else return false;
+
+    return true;
+  }
+}
+
+theta_compiler* theta_compiler_new(int fast_emit) {
+  return new theta_compiler {
+    CompilationSession::discoverCapsules(),
+    make_shared<LinkedCapsuleCache>(),
+    fast_emit != 0
+  };
+}
+
+void theta_compiler_free(theta_compiler* compiler) {
+  delete compiler;
+}
+
+theta_status theta_compile(
+  theta_compiler* compiler,
+  const char* source,
+  size_t source_length,
+  const char* file_name,
+  theta_module** out_module
+) {
+  if (!compiler || !source || !out_module) return THETA_ERROR_INVALID_ARGUMENT;
+
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>(
+    compiler->filesByCapsuleName,
+    compiler->linkedCapsuleCache
+  );
+  session->isFastEmit = compiler->isFastEmit;
+
+  vector<char> binary;
+  try {
+    binary = Compiler::compileDirect(session, string(source, source_length), file_name ? file_name : "ith");
+  } catch (const exception &e) {
+    return THETA_ERROR_COMPILATION;
+  }
+
+  if (binary.empty()) return THETA_ERROR_COMPILATION;
+
+  *out_module = new theta_module { std::move(binary) };
+
+  return THETA_OK;
+}
+
+void theta_module_free(theta_module* module) {
+  delete module;
+}
+
+const uint8_t* theta_module_data(const theta_module* module, size_t* out_size) {
+  if (out_size) *out_size = module->binary.size();
+
+  return reinterpret_cast<const uint8_t*>(module->binary.data());
+}
+
+theta_status theta_instantiate(const theta_module* module, theta_instance** out_instance) {
+  if (!module || !out_instance) return THETA_ERROR_INVALID_ARGUMENT;
+
+  unique_ptr<theta_instance> instance = make_unique<theta_instance>();
+
+  auto binary = wasm::vec<byte_t>::make_uninitialized(module->binary.size());
+  memcpy(binary.get(), module->binary.data(), module->binary.size());
+
+  instance->module = wasm::Module::make(instance->runtime.getStore(), binary);
+  if (!instance->module) return THETA_ERROR_INSTANTIATION;
+
+  instance->instance = wasm::Instance::make(instance->runtime.getStore(), instance->module.get(), nullptr);
+  if (!instance->instance) return THETA_ERROR_INSTANTIATION;
+
+  instance->exports = instance->instance->exports();
+
+  wasm::ownvec<wasm::ExportType> exportTypes = instance->module->exports();
+  for (size_t i = 0; i < exportTypes.size(); i++) {
+    instance->exportNames.push_back(string(exportTypes[i]->name().get(), exportTypes[i]->name().size()));
+  }
+
+  *out_instance = instance.release();
+
+  return THETA_OK;
+}
+
+void theta_instance_free(theta_instance* instance) {
+  delete instance;
+}
+
+theta_status theta_instance_get_function(
+  theta_instance* instance,
+  const char* name,
+  size_t param_count,
+  theta_function** out_function
+) {
+  if (!instance || !name || !out_function) return THETA_ERROR_INVALID_ARGUMENT;
+
+  string functionName = name;
+  string qualifiedPrefix = functionName + to_string(param_count);
+  wasm::Func* func = nullptr;
+  wasm::Func* qualifiedFunc = nullptr;
+
+  for (size_t i = 0; i < instance->exportNames.size(); i++) {
+    wasm::Func* exportedFunc = instance->exports[i]->func();
+    if (!exportedFunc) continue;
+
+    if (instance->exportNames[i] == functionName) func = exportedFunc;
+    else if (Runtime::isQualifiedNameOf(instance->exportNames[i], qualifiedPrefix)) qualifiedFunc = exportedFunc;
+  }
+
+  if (!func) func = qualifiedFunc;
+  if (!func) return THETA_ERROR_NOT_FOUND;
+
+  unique_ptr<theta_function> function = make_unique<theta_function>();
+  function->func = func;
+
+  wasm::own<wasm::FuncType> funcType = func->type();
+  const wasm::ownvec<wasm::ValType> &paramTypes = funcType->params();
+  const wasm::ownvec<wasm::ValType> &resultTypes = funcType->results();
+
+  if (paramTypes.size() != param_count || resultTypes.size() != 1) return THETA_ERROR_SIGNATURE_MISMATCH;
+
+  // Only numbers and booleans can cross the API boundary for now
+  for (size_t i = 0; i < paramTypes.size(); i++) {
+    theta_value_kind kind;
+    if (!toValueKind(paramTypes[i]->kind(), kind)) return THETA_ERROR_SIGNATURE_MISMATCH;
+
+    function->paramKinds.push_back(kind);
+  }
+
+  if (!toValueKind(resultTypes[0]->kind(), function->resultKind)) return THETA_ERROR_SIGNATURE_MISMATCH;
+
+  function->params.resize(param_count);
+
+  *out_function = function.get();
+  instance->functions.push_back(std::move(function));
+
+  return THETA_OK;
+}
+
+size_t theta_function_param_count(const theta_function* function) {
+  return function->paramKinds.size();
+}
+
+theta_value_kind theta_function_param_kind(const theta_function* function, size_t index) {
+  return function->paramKinds.at(index);
+}
+
+theta_value_kind theta_function_result_kind(const theta_function* function) {
+  return function->resultKind;
+}
+
+theta_status theta_call(
+  theta_function* function,
+  const theta_value* args,
+  size_t arg_count,
+  theta_value* out_result
+) {
+  if (!function || (arg_count > 0 && !args) || !out_result) return THETA_ERROR_INVALID_ARGUMENT;
+  if (arg_count != function->paramKinds.size()) return THETA_ERROR_SIGNATURE_MISMATCH;
+
+  for (size_t i = 0; i < arg_count; i++) {
+    if (args[i].kind != function->paramKinds[i]) return THETA_ERROR_SIGNATURE_MISMATCH;
+
+    function->params[i] = args[i].kind == THETA_I64 ? wasm::Val(args[i].of.i64) : wasm::Val(args[i].of.i32);
+  }
+
+  wasm::Val results[1];
+  wasm::own<wasm::Trap> trap = function->func->call(function->params.data(), results);
+
+  if (trap) return THETA_ERROR_TRAP;
+
+  out_result->kind = function->resultKind;
+  if (function->resultKind == THETA_I64) out_result->of.i64 = results[0].i64();
+  else out_result->of.i32 = results[0].i32();
+
+  return THETA_OK;
+}
+
+const char* theta_status_string(theta_status status) {
+  switch (status) {
+    case THETA_OK: return "ok";
+    case THETA_ERROR_INVALID_ARGUMENT: return "invalid argument";
+    case THETA_ERROR_COMPILATION: return "compilation failed";
+    case THETA_ERROR_INSTANTIATION: return "module could not be instantiated";
+    case THETA_ERROR_NOT_FOUND: return "exported function not found";
+    case THETA_ERROR_SIGNATURE_MISMATCH: return "arguments do not match the function signature";
+    case THETA_ERROR_TRAP: return "function trapped";
+  }
+
+  return "unknown status";
+}
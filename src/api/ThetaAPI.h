@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The C API for embedding the Theta compiler and runtime in another program, provided by libtheta.
+ *
+ * Every object is created and destroyed explicitly by the caller:
+ *   - theta_compiler: configuration shared by compilations. Capsules linked by more than one compilation are only
+ *     parsed once. A compiler may be used from several threads at once.
+ *   - theta_module: a compiled WASM binary. Independent of the compiler that produced it.
+ *   - theta_instance: an instantiated module with its own store. Must only be used from one thread at a time.
+ *   - theta_function: an exported function, looked up once and then called any number of times. Owned by the
+ *     instance it came from and valid until that instance is freed.
+ *
+ * The WASM engine itself is shared by the whole process, because V8 only supports a single engine per process. It is
+ * created the first time an instance is created and lives until the process exits.
+ */
+
+#if defined(_WIN32) && defined(THETA_BUILDING_SHARED_LIBRARY)
+  #define THETA_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(THETA_USING_SHARED_LIBRARY)
+  #define THETA_API __declspec(dllimport)
+#else
+  #define THETA_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct theta_compiler theta_compiler;
+typedef struct theta_module theta_module;
+typedef struct theta_instance theta_instance;
+typedef struct theta_function theta_function;
+
+typedef enum theta_status {
+  THETA_OK = 0,
+  THETA_ERROR_INVALID_ARGUMENT,
+  THETA_ERROR_COMPILATION,
+  THETA_ERROR_INSTANTIATION,
+  THETA_ERROR_NOT_FOUND,
+  THETA_ERROR_SIGNATURE_MISMATCH,
+  THETA_ERROR_TRAP
+} theta_status;
+
+typedef enum theta_value_kind {
+  THETA_I32 = 0, /* Booleans and function references */
+  THETA_I64      /* Numbers */
+} theta_value_kind;
+
+typedef struct theta_value {
+  theta_value_kind kind;
+  union {
+    int32_t i32;
+    int64_t i64;
+  } of;
+} theta_value;
+
+/**
+ * @brief Creates a compiler. Linked capsules are discovered from the current working directory, the same way the
+ * theta command line does it.
+ * @param fast_emit Nonzero to emit wasm directly instead of going through Binaryen, see --fast-emit
+ * @return The compiler, which must be freed with theta_compiler_free
+ */
+THETA_API theta_compiler* theta_compiler_new(int fast_emit);
+
+THETA_API void theta_compiler_free(theta_compiler* compiler);
+
+/**
+ * @brief Compiles Theta source code into a module. Any diagnostics are printed to stdout.
+ * @param compiler The compiler to use
+ * @param source The source code. Does not need to be null terminated
+ * @param source_length The length of the source code in bytes
+ * @param file_name The name diagnostics should be attributed to. May be NULL
+ * @param out_module Set to the compiled module on success, which must be freed with theta_module_free
+ * @return THETA_OK on success, THETA_ERROR_COMPILATION if the source has errors
+ */
+THETA_API theta_status theta_compile(
+  theta_compiler* compiler,
+  const char* source,
+  size_t source_length,
+  const char* file_name,
+  theta_module** out_module
+);
+
+THETA_API void theta_module_free(theta_module* module);
+
+/**
+ * @brief Returns the encoded WASM binary of a module, for example to write it to disk. The returned pointer is owned
+ * by the module.
+ */
+THETA_API const uint8_t* theta_module_data(const theta_module* module, size_t* out_size);
+
+/**
+ * @brief Instantiates a module. The module may be freed once it has been instantiated.
+ * @param module The module to instantiate
+ * @param out_instance Set to the instance on success, which must be freed with theta_instance_free
+ */
+THETA_API theta_status theta_instantiate(const theta_module* module, theta_instance** out_instance);
+
+/**
+ * @brief Frees an instance, along with every function that was looked up from it
+ */
+THETA_API void theta_instance_free(theta_instance* instance);
+
+/**
+ * @brief Looks up an exported function. The name can either be the exact export name, or the unqualified name of
+ * the Theta function, in which case it is resolved by the given number of parameters.
+ * @param instance The instance to look the function up in
+ * @param name The name of the function
+ * @param param_count The number of parameters the function takes
+ * @param out_function Set to the function on success. Owned by the instance
+ */
+THETA_API theta_status theta_instance_get_function(
+  theta_instance* instance,
+  const char* name,
+  size_t param_count,
+  theta_function** out_function
+);
+
+THETA_API size_t theta_function_param_count(const theta_function* function);
+
+THETA_API theta_value_kind theta_function_param_kind(const theta_function* function, size_t index);
+
+THETA_API theta_value_kind theta_function_result_kind(const theta_function* function);
+
+/**
+ * @brief Calls a function. Arguments must match the kinds of the function's parameters exactly.
+ * @param function The function to call
+ * @param args The arguments to call the function with
+ * @param arg_count The number of arguments
+ * @param out_result Set to the value returned by the function
+ * @return THETA_OK on success, THETA_ERROR_SIGNATURE_MISMATCH if the arguments don't match the parameters, or
+ * THETA_ERROR_TRAP if the function trapped
+ */
+THETA_API theta_status theta_call(
+  theta_function* function,
+  const theta_value* args,
+  size_t arg_count,
+  theta_value* out_result
+);
+
+/**
+ * @brief Returns a human readable description of a status code
+ */
+THETA_API const char* theta_status_string(theta_status status);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,9 +1,15 @@
 #include "CLI.hpp"
 #include <iostream>
 #include <algorithm>
+#include <thread>
+#include <cstdlib>
+#include <future>
 #include "../../version.h"
 #include "../compiler/Compiler.hpp"
+#include "../compiler/optimization/ExecutionProfile.hpp"
 #include "REPL.hpp"
+#include "runtime/Runtime.hpp"
+#include "lsp/LanguageServer.hpp"
 
 using namespace Theta;
 using namespace std;
@@ -12,12 +18,20 @@ void CLI::parseCommand(int argc, char* argv[]) {
   bool isEmitTokens = false;
   bool isEmitAST = false;
   bool isEmitWAT = false;
+  bool isFastEmit = false;
+  OptimizationOptions optimization;
   string sourceFile;
   string outFile;
 
   if (argc == 1) {
     REPL repl = REPL();
     repl.readInput();
+  } else if (string(argv[1]) == "build") {
+    return parseBuildCommand(argc, argv);
+  } else if (string(argv[1]) == "run") {
+    return parseRunCommand(argc, argv);
+  } else if (string(argv[1]) == "lsp") {
+    return runLanguageServer();
   } else if (argc == 2) {
     string arg1 = argv[1];
 
@@ -38,6 +52,7 @@ void CLI::parseCommand(int argc, char* argv[]) {
       else if (arg == "--emitTokens") isEmitTokens = true;
       else if (arg == "--emitAST") isEmitAST = true;
       else if (arg == "--emitWAT") isEmitWAT = true;
+      else if (parseOptimizationOption(arg, optimization, isFastEmit)) {}
       else if (i == argc - 1) sourceFile = arg;
       else validateOption(arg);
 
@@ -47,18 +62,179 @@ void CLI::parseCommand(int argc, char* argv[]) {
 
   if (sourceFile == "") return;
 
-  if (outFile == "") {
-    bool reachedDelimiter = false;
-    for (int i = 0; !reachedDelimiter; i++) {
-      outFile += sourceFile[i];
+  if (outFile == "") outFile = getDefaultOutputFile(sourceFile);
 
-      if (sourceFile[i + 1] == '.') reachedDelimiter = true;
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>();
+  session->isEmitTokens = isEmitTokens;
+  session->isEmitAST = isEmitAST;
+  session->isEmitWAT = isEmitWAT;
+  session->isFastEmit = isFastEmitting(isFastEmit, optimization);
+  session->optimization = optimization;
+
+  Theta::Compiler::compile(session, sourceFile, outFile);
+}
+
+void CLI::parseBuildCommand(int argc, char* argv[]) {
+  bool isEmitTokens = false;
+  bool isEmitAST = false;
+  bool isEmitWAT = false;
+  bool isFastEmit = false;
+  OptimizationOptions optimization;
+  unsigned int jobs = max(1u, thread::hardware_concurrency());
+  vector<pair<string, string>> entrypointsWithOutputs;
+
+  int i = 2;
+
+  while (i < argc) {
+    string arg = argv[i];
+
+    if (arg == "-j" && i + 1 < argc) {
+      jobs = max(1, atoi(argv[i + 1]));
+      i++;
     }
+    else if (arg == "--emitTokens") isEmitTokens = true;
+    else if (arg == "--emitAST") isEmitAST = true;
+    else if (arg == "--emitWAT") isEmitWAT = true;
+    else if (parseOptimizationOption(arg, optimization, isFastEmit)) {}
+    else if (arg.rfind("-", 0) == 0) validateOption(arg);
+    else entrypointsWithOutputs.push_back(make_pair(arg, getDefaultOutputFile(arg)));
+
+    i++;
+  }
+
+  if (entrypointsWithOutputs.empty()) {
+    cout << "No source files given to build" << endl;
+    return;
+  }
+
+  Theta::Compiler::compileBatch(entrypointsWithOutputs, jobs, isEmitTokens, isEmitAST, isEmitWAT, isFastEmitting(isFastEmit, optimization), optimization);
+}
+
+void CLI::parseRunCommand(int argc, char* argv[]) {
+  bool isFastEmit = false;
+  OptimizationOptions optimization;
+  vector<string> positionalArgs;
+
+  // Anything that isn't an optimization option is the source file, the function to run or one of its arguments, which
+  // may well start with a minus sign themselves
+  for (int i = 2; i < argc; i++) {
+    if (!parseOptimizationOption(argv[i], optimization, isFastEmit)) positionalArgs.push_back(argv[i]);
+  }
+
+  if (positionalArgs.empty()) {
+    cout << "No source file given to run" << endl;
+    return;
+  }
+
+  // Starting up the engine is independent of the module we're compiling, so let it happen while we compile
+  future<wasm::Engine*> engineStartup = async(launch::async, Runtime::getEngine);
+
+  string sourceFile = positionalArgs[0];
+  string functionName = positionalArgs.size() > 1 ? positionalArgs[1] : "main";
+  vector<string> args;
+
+  for (int i = 2; i < positionalArgs.size(); i++) {
+    args.push_back(positionalArgs[i]);
+  }
+
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>();
+  session->isFastEmit = isFastEmitting(isFastEmit, optimization);
+  session->optimization = optimization;
+
+  vector<char> wasm = Theta::Compiler::compileToBuffer(session, sourceFile);
+
+  engineStartup.wait();
+
+  if (wasm.empty()) return;
+
+  Runtime runtime;
+
+  try {
+    ExecutionContext context = runtime.execute(wasm, functionName, args);
+
+    cout << context.stringifiedResult() << endl;
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+  }
+}
+
+void CLI::runLanguageServer() {
+  // Protocol messages go out over stdout, so anything else printed along the way (such as compiler warnings) is sent to
+  // stderr instead, where editors show it in the server's log
+  streambuf* stdoutBuffer = cout.rdbuf(cerr.rdbuf());
+  ostream protocolOut(stdoutBuffer);
+
+  LanguageServer server(cin, protocolOut);
+  int exitCode = server.run();
+
+  cout.rdbuf(stdoutBuffer);
+
+  exit(exitCode);
+}
+
+bool CLI::parseOptimizationOption(string arg, OptimizationOptions &optimization, bool &isFastEmit) {
+  if (arg == "--fast-emit") {
+    isFastEmit = true;
+  } else if (OptimizationOptions::parseLevel(arg, optimization.level)) {
+    // -O0 implies --fast-emit, which isFastEmitting works out once every argument has been read
+  } else if (arg.rfind("--passes=", 0) == 0) {
+    optimization.parsePassOverrides(arg.substr(string("--passes=").length()));
+
+    for (auto &override : optimization.passOverrides) {
+      auto registration = find_if(
+        PassManager::getRegisteredPasses().begin(),
+        PassManager::getRegisteredPasses().end(),
+        [&override](const PassRegistration &registration) { return registration.name == override.first; }
+      );
+
+      if (registration == PassManager::getRegisteredPasses().end()) {
+        cout << "Unknown optimization pass: " + override.first << endl;
+      } else if (registration->isRequired && !override.second) {
+        cout << "The " + override.first + " pass is required, and can't be disabled" << endl;
+      }
+    }
+  } else if (arg == "--time-passes") {
+    optimization.isTimingPasses = true;
+  } else if (arg.rfind("--inline-threshold=", 0) == 0) {
+    optimization.inlineThreshold = atoi(arg.substr(string("--inline-threshold=").length()).c_str());
+  } else if (arg == "--stats") {
+    optimization.isShowingStatistics = true;
+  } else if (arg.rfind("--wasm-passes=", 0) == 0) {
+    optimization.parseWasmPasses(arg.substr(string("--wasm-passes=").length()));
+  } else if (arg.rfind("--wasm-threads=", 0) == 0) {
+    optimization.wasmThreads = max(0, atoi(arg.substr(string("--wasm-threads=").length()).c_str()));
+  } else if (arg == "--enable-tail-call") {
+    optimization.isTailCallEnabled = true;
+  } else if (arg.rfind("--profile-use=", 0) == 0) {
+    string profileFile = arg.substr(string("--profile-use=").length());
+
+    // Profiles given more than once are merged, so runs recorded separately can be used together
+    if (!optimization.profile) optimization.profile = make_shared<ExecutionProfile>();
+
+    if (!optimization.profile->load(profileFile)) cout << "Could not read profile: " + profileFile << endl;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+bool CLI::isFastEmitting(bool isFastEmitRequested, const OptimizationOptions &optimization) {
+  // Without any optimizations to run, wasm might as well be written out directly
+  return isFastEmitRequested || optimization.level == O0;
+}
+
+string CLI::getDefaultOutputFile(string sourceFile) {
+  string outFile;
+
+  bool reachedDelimiter = false;
+  for (int i = 0; !reachedDelimiter; i++) {
+    outFile += sourceFile[i];
 
-    outFile += ".wasm";
+    if (sourceFile[i + 1] == '.') reachedDelimiter = true;
   }
 
-  Theta::Compiler::getInstance().compile(sourceFile, outFile, isEmitTokens, isEmitAST, isEmitWAT);
+  return outFile + ".wasm";
 }
 
 string CLI::makeLink(string url, string text) {
@@ -75,12 +251,26 @@ void CLI::printUsageInstructions() {
   cout << endl;
   cout << "Usage:" << endl;
   cout << "  theta [options] <source_file>" << endl;
+  cout << "  theta build [options] <source_file>..." << endl;
+  cout << "  theta run [options] <source_file> [function] [args...]" << endl;
+  cout << "  theta lsp" << endl;
   cout << endl;
   cout << "Options:" << endl;
   cout << "  -o <output_file>               Specify the output file name." << endl;
   cout << "  --emitTokens                   Emit the tokenized representation of the source file produced by the lexer." << endl;
   cout << "  --emitAST                      Emit the Abstract Syntax Tree (AST) representation produced by the parser." << endl;
   cout << "  --emitWAT                      Emit the WebAssembly Text format (WAT) representation produced." << endl;
+  cout << "  -O0, --fast-emit               Emit wasm directly without optimizing it through Binaryen. Faster for debug builds." << endl;
+  cout << "  -O1, -O2, -O3, -Os             Select the optimization passes to run. -O1 is the default." << endl;
+  cout << "  --passes=<pass>,-<pass>        Enable or disable individual optimization passes by name." << endl;
+  cout << "  --inline-threshold=<nodes>     How much bigger inlining a function call may make the code around it." << endl;
+  cout << "  --wasm-passes=<pass>,<pass>    Run these Binaryen passes over the module instead of the level's defaults." << endl;
+  cout << "  --wasm-threads=<threads>       How many threads Binaryen may optimize with. Defaults to one per core." << endl;
+  cout << "  --time-passes                  Print how long each optimization pass, and Binaryen, took." << endl;
+  cout << "  --stats                        Print what each optimization pass did, and the module size." << endl;
+  cout << "  --enable-tail-call             Emit calls in tail position as wasm return calls, which need engine support." << endl;
+  cout << "  --profile-use=<file>           Optimize for the call and branch counts in a profile. May be given more than once." << endl;
+  cout << "  -j <jobs>                      With build, the number of entrypoints to compile in parallel." << endl;
   cout << "  --help                         Display this help message and exit." << endl;
   cout << "  --version                      Display the currently installed Theta language version and exit." << endl;
 }
@@ -92,7 +282,17 @@ bool CLI::validateOption(string option) {
     "--emitTokens",
     "--emitAST",
     "--emitWAT",
-    "-o"
+    "-o",
+    "-j",
+    "-O0",
+    "-O1",
+    "-O2",
+    "-O3",
+    "-Os",
+    "--fast-emit",
+    "--time-passes",
+    "--stats",
+    "--enable-tail-call"
   };
 
   if (find(validOptions.begin(), validOptions.end(), option) == validOptions.end()) {
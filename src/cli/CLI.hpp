@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include "compiler/optimization/OptimizationOptions.hpp"
 
 using namespace std;
 
@@ -17,5 +18,43 @@ namespace Theta {
     static void printUsageInstructions();
 
     static bool validateOption(string option);
+
+    /**
+     * @brief Handles `theta build`, which compiles many entrypoints at once, each to its own .wasm file
+     */
+    static void parseBuildCommand(int argc, char* argv[]);
+
+    /**
+     * @brief Handles `theta run`, which compiles a source file in memory, with the same optimization options as a build,
+     * and calls one of its functions
+     */
+    static void parseRunCommand(int argc, char* argv[]);
+
+    /**
+     * @brief Handles `theta lsp`, which runs the language server over stdin and stdout until the editor exits it
+     */
+    static void runLanguageServer();
+
+    /**
+     * @brief Handles the options that choose how a build is optimized: -O levels, --fast-emit, --passes=,
+     * --inline-threshold=, --wasm-passes=, --wasm-threads=, --enable-tail-call, --profile-use=, and the --time-passes
+     * and --stats reports
+     * @return true If the argument was one of those options
+     */
+    static bool parseOptimizationOption(string arg, OptimizationOptions &optimization, bool &isFastEmit);
+
+    /**
+     * @brief Whether to write wasm directly instead of through Binaryen, once every argument has been read: if
+     * --fast-emit was given, or the level is -O0, in whichever order they came
+     * @param isFastEmitRequested Whether --fast-emit was given
+     */
+    static bool isFastEmitting(bool isFastEmitRequested, const OptimizationOptions &optimization);
+
+    /**
+     * @brief Derives the output file name for a source file by replacing its extension with .wasm
+     * @param sourceFile The source file being compiled
+     * @return The output file name
+     */
+    static string getDefaultOutputFile(string sourceFile);
   };
 }
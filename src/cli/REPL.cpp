@@ -66,15 +66,15 @@ void REPL::readInput() {
 void REPL::execute(string source) {
   add_history(source.c_str());
 
-  vector<char> wasm = Compiler::getInstance().compileDirect(source);
+  vector<char> wasm = Compiler::compileDirect(session, source);
 
   if (wasm.size() > 0) {
-    ExecutionContext context = Runtime::getInstance().execute(wasm, "main0");
+    ExecutionContext context = runtime.execute(wasm, "main0");
     
     cout << "\x1B[33m-----> " << context.stringifiedResult() << "\x1B[0m" << endl << endl;
   }
 
-  Compiler::getInstance().clearExceptions();
+  session->clearExceptions();
 }
 
 void REPL::prefillIndentation() {
@@ -2,6 +2,9 @@
 
 #include <stack>
 #include <string>
+#include <memory>
+#include "compiler/CompilationSession.hpp"
+#include "runtime/Runtime.hpp"
 
 using namespace std;
 
@@ -31,6 +34,9 @@ namespace Theta {
     static stack<char> delimeterStack;
     static int lineNumber;
 
+    shared_ptr<CompilationSession> session = make_shared<CompilationSession>();
+    Runtime runtime;
+
     bool isMatchingDelimeter(char &c, stack<char> delimeterStack);
 
     string getPrompt();
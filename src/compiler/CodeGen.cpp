@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <libgen.h>
 #include <limits.h>
@@ -15,7 +16,7 @@
 #include "compiler/TypeChecker.hpp"
 #include "compiler/WasmClosure.hpp"
 #include "lexer/Lexemes.hpp"
-#include "StandardLibrary.hpp"
+#include "ThetaLangCoreWasm.hpp"
 #include "CodeGen.hpp"
 #include "DataTypes.hpp"
 #include "parser/ast/ASTNodeList.hpp"
@@ -40,6 +41,7 @@ BinaryenModuleRef CodeGen::generateWasmFromAST(shared_ptr<ASTNode> ast) {
 
   generate(ast, module);
 
+  generateClosureDispatchers(module);
   registerModuleFunctions(module);
 
   // Automatically adds drops to unused stack values
@@ -51,7 +53,10 @@ BinaryenModuleRef CodeGen::generateWasmFromAST(shared_ptr<ASTNode> ast) {
 BinaryenModuleRef CodeGen::initializeWasmModule() {
   BinaryenModuleRef module = importCoreLangWasm();
 
-  BinaryenModuleSetFeatures(module, BinaryenFeatureStrings());
+  BinaryenModuleSetFeatures(
+    module,
+    BinaryenFeatureStrings() | (session->optimization.isTailCallEnabled ? BinaryenFeatureTailCall() : 0)
+  );
   BinaryenSetMemory(
     module,
     1, // IMPORTANT: Memory size is dictated in pages, NOT bytes, where each page is 64k
@@ -76,8 +81,6 @@ BinaryenModuleRef CodeGen::initializeWasmModule() {
     BinaryenTypeStringref()
   );
 
-  StandardLibrary::registerFunctions(module);
-
   return module;
 }
 
@@ -132,6 +135,14 @@ void CodeGen::generateCapsule(shared_ptr<CapsuleNode> capsuleNode, BinaryenModul
 
   hoistCapsuleElements(capsuleElements);
 
+  // Functions are added to the module in the order they're generated in. With a profile, the most called ones go first,
+  // after the capsule's values, so the code that runs most sits together
+  if (session->optimization.profile) {
+    stable_sort(capsuleElements.begin(), capsuleElements.end(), [](shared_ptr<ASTNode> first, shared_ptr<ASTNode> second) {
+      return getProfiledLayoutRank(first) > getProfiledLayoutRank(second);
+    });
+  }
+
   for (auto elem : capsuleElements) {
     string elemType = dynamic_pointer_cast<TypeDeclarationNode>(elem->getResolvedType())->getType();
     if (elem->getNodeType() == ASTNode::ASSIGNMENT) {
@@ -157,6 +168,25 @@ void CodeGen::generateCapsule(shared_ptr<CapsuleNode> capsuleNode, BinaryenModul
       }
     }
   }
+
+  // The uncurried functions are generated in the capsule's scope, like the curried functions they come from. Generating
+  // one can specialize more partial applications, which adds to the list
+  for (int i = 0; i < uncurriedFunctions.size(); i++) {
+    generateFunctionDeclaration(uncurriedFunctions.at(i).first, uncurriedFunctions.at(i).second, module);
+  }
+}
+
+long long CodeGen::getProfiledLayoutRank(shared_ptr<ASTNode> capsuleElement) {
+  if (capsuleElement->getNodeType() != ASTNode::ASSIGNMENT) return LLONG_MAX;
+
+  shared_ptr<FunctionDeclarationNode> function = dynamic_pointer_cast<FunctionDeclarationNode>(capsuleElement->getRight());
+  if (!function) return LLONG_MAX;
+
+  // Functions the profile knows nothing about go after the ones it saw called, but before the ones it never saw called
+  optional<long long> callCount = function->getProfiledCallCount();
+  if (!callCount) return 0;
+
+  return *callCount == 0 ? -1 : *callCount;
 }
 
 BinaryenExpressionRef CodeGen::generateAssignment(shared_ptr<AssignmentNode> assignmentNode, BinaryenModuleRef &module) {
@@ -195,6 +225,17 @@ BinaryenExpressionRef CodeGen::generateAssignment(shared_ptr<AssignmentNode> ass
     }
 
     scope.insert(identName, assignmentRhs);
+
+    // A closure that is only ever called in this block doesn't need to be built, its calls go to the uncurried function
+    if (assignmentRhs->getNodeType() == ASTNode::FUNCTION_INVOCATION && rhsResolvedType->getType() == DataTypes::FUNCTION) {
+      optional<string> uncurriedIdentifier = specializePartialApplication(dynamic_pointer_cast<FunctionInvocationNode>(assignmentRhs));
+
+      if (uncurriedIdentifier) {
+        specializedPartialApplications[assignmentRhs] = uncurriedIdentifier.value();
+
+        return BinaryenNop(module);
+      }
+    }
     
     // If the last thing in the block is an assignment, we dont need to actually do the assignment at all,
     // just return the value
@@ -221,7 +262,7 @@ BinaryenExpressionRef CodeGen::generateClosureFunctionDeclaration(
   std::function<BinaryenExpressionRef(const BinaryenExpressionRef&)> returnValueFormatter,
   optional<pair<string, int>> assignmentIdentifierPair
 ) {
-  shared_ptr<FunctionDeclarationNode> simplifiedDeclaration = liftLambda(function, module);
+  shared_ptr<FunctionDeclarationNode> simplifiedDeclaration = liftLambda(function, scope);
 
   // Generating a unique hash for this function is necessary because it will be stored on the module globally,
   // so we need to make sure there are no naming collisions
@@ -259,6 +300,14 @@ BinaryenExpressionRef CodeGen::generateClosureFunctionDeclaration(
     scopeReferences.insert(assignmentIdentifierPair->first, globalQualifiedFunctionName);
   }
 
+  // A function that is only ever called in the block declaring it doesn't need a closure. Its callers pass the values
+  // it captures themselves, so nothing is stored in memory
+  if (assignmentIdentifierPair && !function->isEscaping()) {
+    directlyCalledFunctions.insert(globalQualifiedFunctionName);
+
+    return BinaryenNop(module);
+  }
+
   pair<WasmClosure, vector<BinaryenExpressionRef>> storage = generateAndStoreClosure(
     globalQualifiedFunctionName,
     simplifiedDeclaration,
@@ -298,7 +347,7 @@ pair<WasmClosure, vector<BinaryenExpressionRef>> CodeGen::generateAndStoreClosur
   shared_ptr<FunctionDeclarationNode> originalReference,
   BinaryenModuleRef &module
 ) {
-  Pointer referencePtr = functionNameToClosureTemplateMap.find(qualifiedReferenceFunctionName)->second.getFunctionPointer();
+  Pointer referencePtr = getFunctionTableAddress(qualifiedReferenceFunctionName);
   set<string> originalParameters;
 
   for (auto param : originalReference->getParameters()->getElements()) {
@@ -370,7 +419,7 @@ pair<WasmClosure, vector<BinaryenExpressionRef>> CodeGen::generateAndStoreClosur
 // Transforms nested function declarations and generates an anonymous function in the function table
 shared_ptr<FunctionDeclarationNode> CodeGen::liftLambda(
   shared_ptr<FunctionDeclarationNode> fnDeclNode,
-  BinaryenModuleRef &module
+  SymbolTableStack<shared_ptr<ASTNode>> &scope
 ) {
   // Capture the outer scope
   set<string> requiredScopeIdentifiers;
@@ -515,6 +564,15 @@ void CodeGen::generateFunctionDeclaration(
   BinaryenModuleRef &module,
   bool addToExports
 ) {
+  string functionName = Compiler::getQualifiedFunctionIdentifier(
+    identifier,
+    dynamic_pointer_cast<ASTNode>(fnDeclNode)
+  );
+
+  // Lifted lambdas are named after a hash of their declaration, so one that has already been generated while generating
+  // another function that shares its body, like an uncurried function, is the same function
+  if (BinaryenGetFunction(module, functionName.c_str())) return;
+
   scope.enterScope();
   scopeReferences.enterScope();
   BinaryenType parameterType = BinaryenTypeNone();
@@ -522,9 +580,9 @@ void CodeGen::generateFunctionDeclaration(
 
   scope.insert(LOCAL_IDX_SCOPE_KEY, make_shared<LiteralNode>(ASTNode::NUMBER_LITERAL, to_string(totalParams), nullptr));
 
-  if (totalParams > 0) {
-    BinaryenType* types = new BinaryenType[totalParams];
+  BinaryenType* types = new BinaryenType[totalParams];
 
+  if (totalParams > 0) {
     for (int i = 0; i < totalParams; i++) {
       shared_ptr<IdentifierNode> identNode = dynamic_pointer_cast<IdentifierNode>(fnDeclNode->getParameters()->getElements().at(i));
 
@@ -541,36 +599,48 @@ void CodeGen::generateFunctionDeclaration(
 
   vector<shared_ptr<ASTNode>> localVariables = Compiler::findAllInTree(fnDeclNode->getDefinition(), ASTNode::ASSIGNMENT);
 
-  BinaryenType* localVariableTypes = new BinaryenType[localVariables.size()];
+  // The locals that hold the arguments of tail calls to this same function come after the ones for its variables
+  BinaryenType* localVariableTypes = new BinaryenType[localVariables.size() + totalParams];
   for (int i = 0; i < localVariables.size(); i++) {
     localVariableTypes[i] = getBinaryenTypeFromTypeDeclaration(
       dynamic_pointer_cast<TypeDeclarationNode>(localVariables.at(i)->getResolvedType())
     );
   }
 
-  string functionName = Compiler::getQualifiedFunctionIdentifier(
-    identifier,
-    dynamic_pointer_cast<ASTNode>(fnDeclNode)
-  );
+  copy(types, types + totalParams, localVariableTypes + localVariables.size());
+
+  BinaryenType returnType = getBinaryenTypeFromTypeDeclaration(TypeChecker::getFunctionReturnType(fnDeclNode));
+
+  // Functions declared inside this one are generated while its body is, so the enclosing one is restored afterwards
+  optional<GeneratedFunction> enclosingFunction = currentFunction;
+  currentFunction = GeneratedFunction{ fnDeclNode, returnType, (int) (totalParams + localVariables.size()) };
 
-  BinaryenFunctionRef fn = BinaryenAddFunction(
+  BinaryenExpressionRef body = generate(fnDeclNode->getDefinition(), module);
+  int totalLocals = localVariables.size();
+
+  if (currentFunction->isLooping) {
+    body = BinaryenLoop(module, TAIL_CALL_LOOP_LABEL.c_str(), body);
+    totalLocals += totalParams;
+  }
+
+  currentFunction = enclosingFunction;
+
+  BinaryenAddFunction(
     module,
     functionName.c_str(),
     parameterType,
-    getBinaryenTypeFromTypeDeclaration(TypeChecker::getFunctionReturnType(fnDeclNode)),
+    returnType,
     localVariableTypes,
-    localVariables.size(),
-    generate(fnDeclNode->getDefinition(), module)
+    totalLocals,
+    body
   );
 
-  // Only add to the closure template map if its not already in there. It may have been added during hoisting
+  // Only add to the closure template map if its not already in there. It may have been added during hoisting. Its
+  // function pointer is only filled in once a closure is made of it, see getFunctionTableAddress
   if (functionNameToClosureTemplateMap.find(functionName) == functionNameToClosureTemplateMap.end()) {
     functionNameToClosureTemplateMap.insert(make_pair(
       functionName,
-      WasmClosure(
-        Pointer<PointerType::Function>(functionNameToClosureTemplateMap.size()),
-        totalParams
-      )
+      WasmClosure(Pointer<PointerType::Function>(), totalParams)
     ));
   }
 
@@ -621,6 +691,34 @@ BinaryenExpressionRef CodeGen::generateFunctionInvocation(shared_ptr<FunctionInv
 
   string funcInvName = Compiler::getQualifiedFunctionIdentifier(funcInvIdentifier, funcInvNode);
 
+  if (
+    funcInvNode->isTailCall() &&
+    currentFunction &&
+    foundLocalReference.value() == currentFunction->declaration &&
+    funcInvNode->getParameters()->getElements().size() == currentFunction->declaration->getParameters()->getElements().size()
+  ) {
+    return generateSelfTailCall(funcInvNode, module);
+  }
+
+  auto specializedPartialApplication = specializedPartialApplications.find(foundLocalReference.value());
+  if (specializedPartialApplication != specializedPartialApplications.end()) {
+    return generateSpecializedCall(
+      funcInvNode,
+      dynamic_pointer_cast<FunctionInvocationNode>(foundLocalReference.value()),
+      specializedPartialApplication->second,
+      module
+    );
+  }
+
+  if (directlyCalledFunctions.count(scopeLookupIdentifier)) {
+    return generateDirectClosureCall(
+      funcInvNode,
+      dynamic_pointer_cast<FunctionDeclarationNode>(foundLocalReference.value()),
+      scopeLookupIdentifier,
+      module
+    );
+  }
+
   // If the calculated name isn't the same as the refIdentifier, we know
   // this is a reference to a function and must have a closure already
   // in memory
@@ -631,6 +729,203 @@ BinaryenExpressionRef CodeGen::generateFunctionInvocation(shared_ptr<FunctionInv
   return generateCallIndirectForNewClosure(funcInvNode, foundLocalReference.value(), scopeLookupIdentifier, module);
 }
 
+BinaryenExpressionRef CodeGen::generateSelfTailCall(shared_ptr<FunctionInvocationNode> funcInvNode, BinaryenModuleRef &module) {
+  vector<shared_ptr<ASTNode>> args = funcInvNode->getParameters()->getElements();
+  vector<BinaryenExpressionRef> expressions;
+  vector<int> reassignedParams;
+
+  // Every argument is evaluated before any parameter is reassigned, since the arguments may reference the parameters
+  for (int i = 0; i < args.size(); i++) {
+    shared_ptr<IdentifierNode> arg = dynamic_pointer_cast<IdentifierNode>(args.at(i));
+
+    // Passing a parameter back in the same position leaves it as it is
+    if (arg && scope.lookup(arg->getIdentifier()) == currentFunction->declaration->getParameters()->getElements().at(i)) {
+      continue;
+    }
+
+    expressions.push_back(BinaryenLocalSet(module, currentFunction->firstArgumentLocalIdx + i, generate(args.at(i), module)));
+    reassignedParams.push_back(i);
+  }
+
+  for (int i : reassignedParams) {
+    BinaryenType paramType = getBinaryenTypeFromTypeDeclaration(
+      dynamic_pointer_cast<TypeDeclarationNode>(currentFunction->declaration->getParameters()->getElements().at(i)->getValue())
+    );
+
+    expressions.push_back(
+      BinaryenLocalSet(module, i, BinaryenLocalGet(module, currentFunction->firstArgumentLocalIdx + i, paramType))
+    );
+  }
+
+  expressions.push_back(BinaryenBreak(module, TAIL_CALL_LOOP_LABEL.c_str(), NULL, NULL));
+
+  currentFunction->isLooping = true;
+
+  BinaryenExpressionRef* blockExpressions = new BinaryenExpressionRef[expressions.size()];
+  for (int i = 0; i < expressions.size(); i++) {
+    blockExpressions[i] = expressions.at(i);
+  }
+
+  // The block never completes, it always jumps back to the start of the function
+  return BinaryenBlock(module, NULL, blockExpressions, expressions.size(), BinaryenTypeUnreachable());
+}
+
+BinaryenExpressionRef CodeGen::generateDirectClosureCall(
+  shared_ptr<FunctionInvocationNode> funcInvNode,
+  shared_ptr<FunctionDeclarationNode> simplifiedDeclaration,
+  string globalQualifiedFunctionName,
+  BinaryenModuleRef &module
+) {
+  vector<shared_ptr<ASTNode>> params = simplifiedDeclaration->getParameters()->getElements();
+  vector<shared_ptr<ASTNode>> args = funcInvNode->getParameters()->getElements();
+  int capturedParamCount = params.size() - args.size();
+
+  BinaryenExpressionRef* operands = new BinaryenExpressionRef[params.size()];
+
+  // The captured values are looked up the same way they would have been when storing them in the closure, which works
+  // because the call is made from the same function body the closure would have been created in
+  for (int i = 0; i < capturedParamCount; i++) {
+    string paramName = dynamic_pointer_cast<IdentifierNode>(params.at(i))->getIdentifier();
+
+    operands[i] = generate(scope.lookup(paramName).value(), module);
+  }
+
+  for (int i = 0; i < args.size(); i++) {
+    operands[capturedParamCount + i] = generate(args.at(i), module);
+  }
+
+  FunctionMetaData functionMetaData = getFunctionMetaData(simplifiedDeclaration);
+
+  return (canReturnCall(funcInvNode, functionMetaData.getReturnType()) ? BinaryenReturnCall : BinaryenCall)(
+    module,
+    globalQualifiedFunctionName.c_str(),
+    operands,
+    params.size(),
+    functionMetaData.getReturnType()
+  );
+}
+
+optional<string> CodeGen::specializePartialApplication(shared_ptr<FunctionInvocationNode> partialApplication) {
+  if (partialApplication->isEscaping()) return nullopt;
+
+  string identifier = dynamic_pointer_cast<IdentifierNode>(partialApplication->getIdentifier())->getIdentifier();
+  string qualifiedIdentifier = Compiler::getQualifiedFunctionIdentifier(identifier, partialApplication);
+
+  // Functions declared in other functions are only in scope through a reference to their global name, which capsule
+  // functions don't need
+  if (scopeReferences.lookup(qualifiedIdentifier)) return nullopt;
+
+  auto reference = scope.lookup(qualifiedIdentifier);
+  if (!reference || reference.value()->getNodeType() != ASTNode::FUNCTION_DECLARATION) return nullopt;
+
+  shared_ptr<FunctionDeclarationNode> curriedFunction = dynamic_pointer_cast<FunctionDeclarationNode>(reference.value());
+  vector<shared_ptr<ASTNode>> curriedBody = dynamic_pointer_cast<ASTNodeList>(curriedFunction->getDefinition())->getElements();
+
+  if (curriedBody.size() != 1) return nullopt;
+
+  shared_ptr<ASTNode> returnedFunction = curriedBody.at(0)->getNodeType() == ASTNode::RETURN
+    ? curriedBody.at(0)->getValue()
+    : curriedBody.at(0);
+
+  if (returnedFunction->getNodeType() != ASTNode::FUNCTION_DECLARATION) return nullopt;
+
+  // Specializing adds a function to the module, which isn't worth it for a closure the profiled runs never called
+  optional<long long> callCount = dynamic_pointer_cast<FunctionDeclarationNode>(returnedFunction)->getProfiledCallCount();
+  if (session->optimization.profile && callCount && *callCount == 0) return nullopt;
+
+  // The arguments are evaluated again for every call to the closure, which only leaves their values the same if they
+  // are literals or names, since names can't be bound again
+  for (auto arg : partialApplication->getParameters()->getElements()) {
+    shared_ptr<TypeDeclarationNode> argType = dynamic_pointer_cast<TypeDeclarationNode>(arg->getResolvedType());
+
+    bool isReevaluable = (
+      arg->getNodeType() == ASTNode::NUMBER_LITERAL ||
+      arg->getNodeType() == ASTNode::STRING_LITERAL ||
+      arg->getNodeType() == ASTNode::BOOLEAN_LITERAL ||
+      (arg->getNodeType() == ASTNode::IDENTIFIER && !arg->getValue())
+    );
+
+    if (!isReevaluable || !argType || argType->getType() == DataTypes::FUNCTION) return nullopt;
+  }
+
+  string uncurriedIdentifier = "ThetaLang.internal.uncurried." + qualifiedIdentifier;
+
+  for (auto &uncurriedFunction : uncurriedFunctions) {
+    if (uncurriedFunction.first == uncurriedIdentifier) return uncurriedIdentifier;
+  }
+
+  shared_ptr<FunctionDeclarationNode> lambda = dynamic_pointer_cast<FunctionDeclarationNode>(returnedFunction);
+
+  // Like a lifted lambda, the uncurried function shares its parameters and body with the functions it's made from
+  shared_ptr<FunctionDeclarationNode> uncurried = make_shared<FunctionDeclarationNode>(nullptr);
+  uncurried->setResolvedType(Compiler::deepCopyTypeDeclaration(
+    dynamic_pointer_cast<TypeDeclarationNode>(lambda->getResolvedType()),
+    uncurried
+  ));
+
+  vector<shared_ptr<ASTNode>> uncurriedParameters = curriedFunction->getParameters()->getElements();
+  uncurriedParameters.insert(
+    uncurriedParameters.end(),
+    lambda->getParameters()->getElements().begin(),
+    lambda->getParameters()->getElements().end()
+  );
+
+  shared_ptr<ASTNodeList> parametersNode = make_shared<ASTNodeList>(uncurried);
+  parametersNode->setElements(uncurriedParameters);
+  uncurried->setParameters(parametersNode);
+
+  shared_ptr<BlockNode> uncurriedBody = make_shared<BlockNode>(uncurried);
+  uncurriedBody->setElements(dynamic_pointer_cast<ASTNodeList>(lambda->getDefinition())->getElements());
+  uncurried->setDefinition(uncurriedBody);
+
+  uncurriedFunctions.push_back(make_pair(uncurriedIdentifier, uncurried));
+
+  return uncurriedIdentifier;
+}
+
+BinaryenExpressionRef CodeGen::generateSpecializedCall(
+  shared_ptr<FunctionInvocationNode> funcInvNode,
+  shared_ptr<FunctionInvocationNode> partialApplication,
+  string uncurriedIdentifier,
+  BinaryenModuleRef &module
+) {
+  shared_ptr<FunctionDeclarationNode> uncurried;
+  for (auto &uncurriedFunction : uncurriedFunctions) {
+    if (uncurriedFunction.first == uncurriedIdentifier) uncurried = uncurriedFunction.second;
+  }
+
+  vector<shared_ptr<ASTNode>> args = partialApplication->getParameters()->getElements();
+  args.insert(
+    args.end(),
+    funcInvNode->getParameters()->getElements().begin(),
+    funcInvNode->getParameters()->getElements().end()
+  );
+
+  BinaryenExpressionRef* operands = new BinaryenExpressionRef[args.size()];
+  for (int i = 0; i < args.size(); i++) {
+    operands[i] = generate(args.at(i), module);
+  }
+
+  FunctionMetaData functionMetaData = getFunctionMetaData(uncurried);
+  string functionName = Compiler::getQualifiedFunctionIdentifier(uncurriedIdentifier, uncurried);
+
+  return (canReturnCall(funcInvNode, functionMetaData.getReturnType()) ? BinaryenReturnCall : BinaryenCall)(
+    module,
+    functionName.c_str(),
+    operands,
+    args.size(),
+    functionMetaData.getReturnType()
+  );
+}
+
+bool CodeGen::canReturnCall(shared_ptr<FunctionInvocationNode> funcInvNode, BinaryenType returnType) {
+  // A return call hands the callee's result straight to the caller's caller, so the result types have to match exactly
+  return session->optimization.isTailCallEnabled &&
+    funcInvNode->isTailCall() &&
+    currentFunction &&
+    currentFunction->returnType == returnType;
+}
+
 vector<Pointer<PointerType::Data>> CodeGen::generateFunctionInvocationArgMemoryInsertions(
   shared_ptr<FunctionInvocationNode> funcInvNode,
   vector<BinaryenExpressionRef> &expressions,
@@ -766,6 +1061,25 @@ BinaryenExpressionRef CodeGen::generateCallIndirectForExistingClosure(
     loadArgsExpressions[functionMetaData.getArity() - 1 - i] = loadArgExpression;
   }
 
+  // The dispatcher takes the closure's index in the function table, followed by the arguments loaded from the closure
+  BinaryenExpressionRef* dispatchOperands = new BinaryenExpressionRef[functionMetaData.getArity() + 1];
+  dispatchOperands[0] = BinaryenLoad(
+    module,
+    4,
+    false,
+    0,
+    0,
+    BinaryenTypeInt32(),
+    BinaryenLocalGet(
+      module,
+      scope.lookup(refIdentifier).value()->getMappedBinaryenIndex(),
+      BinaryenTypeInt32()
+    ),
+    MEMORY_NAME.c_str()
+  );
+
+  copy(loadArgsExpressions, loadArgsExpressions + functionMetaData.getArity(), dispatchOperands + 1);
+
   // In order for if statements to return a value in WASM, both branches must return the same concrete type.
   // This is the value that will be returned by the else branch, should the if fail
   BinaryenExpressionRef defaultReturnValue;
@@ -799,28 +1113,15 @@ BinaryenExpressionRef CodeGen::generateCallIndirectForExistingClosure(
           MEMORY_NAME.c_str()
         )
       ),
-      BinaryenCallIndirect( // If the above check is true, execute_indirect
-        module, 
-        FN_TABLE_NAME.c_str(), 
-        BinaryenLoad(
-          module,
-          4,
-          false,
-          0,
-          0,
-          BinaryenTypeInt32(),
-          BinaryenLocalGet(
-            module,
-            scope.lookup(refIdentifier).value()->getMappedBinaryenIndex(),
-            BinaryenTypeInt32()
-          ),
-          MEMORY_NAME.c_str()
-        ),
-        loadArgsExpressions,
-        functionMetaData.getArity(),
-        functionMetaData.getParamType(),
+      // If the above check is true, call the function the closure points to through the dispatcher for its signature,
+      // as a return call if it's in tail position
+      (canReturnCall(funcInvNode, functionMetaData.getReturnType()) ? BinaryenReturnCall : BinaryenCall)(
+        module,
+        getClosureDispatcher(functionMetaData).c_str(),
+        dispatchOperands,
+        functionMetaData.getArity() + 1,
         functionMetaData.getReturnType()
-      ),   
+      ),
       defaultReturnValue
     )
   );
@@ -842,15 +1143,12 @@ BinaryenExpressionRef CodeGen::generateCallIndirectForNewClosure(
   WasmClosure closureTemplate = functionNameToClosureTemplateMap.find(refIdentifier)->second;
   vector<BinaryenExpressionRef> expressions;
 
-  // If we're at 0 arity we can go ahead and execute the function call
+  // If we're at 0 arity we can go ahead and execute the function call. The function being called is known, so it's
+  // called by name rather than through the function table, which lets the engine inline it
   if (funcInvNode->getParameters()->getElements().size() == closureTemplate.getArity()) {
     BinaryenExpressionRef* operands = new BinaryenExpressionRef[closureTemplate.getArity()];
 
     for (int i = 0; i < closureTemplate.getArity(); i++) {
-      shared_ptr<TypeDeclarationNode> argType = dynamic_pointer_cast<TypeDeclarationNode>(
-        funcInvNode->getParameters()->getElements().at(i)->getResolvedType()
-      );
-
       operands[i] = generate(funcInvNode->getParameters()->getElements().at(i), module);
     }
 
@@ -859,18 +1157,16 @@ BinaryenExpressionRef CodeGen::generateCallIndirectForNewClosure(
     );
 
     expressions.push_back(
-      BinaryenCallIndirect(
+      (canReturnCall(funcInvNode, functionMetaData.getReturnType()) ? BinaryenReturnCall : BinaryenCall)(
         module,
-        FN_TABLE_NAME.c_str(),
-        BinaryenConst(module, BinaryenLiteralInt32(closureTemplate.getFunctionPointer().getAddress())),
+        refIdentifier.c_str(),
         operands,
         functionMetaData.getArity(),
-        functionMetaData.getParamType(),
         functionMetaData.getReturnType()
       )
     );
   } else {
-    WasmClosure closure = WasmClosure::clone(closureTemplate);
+    WasmClosure closure(getFunctionTableAddress(refIdentifier), closureTemplate.getArity());
     vector<Pointer<PointerType::Data>> paramMemPointers = generateFunctionInvocationArgMemoryInsertions(
       funcInvNode,
       expressions,
@@ -894,7 +1190,29 @@ BinaryenExpressionRef CodeGen::generateCallIndirectForNewClosure(
 }
 
 BinaryenExpressionRef CodeGen::generateControlFlow(shared_ptr<ControlFlowNode> controlFlowNode, BinaryenModuleRef &module) {
-  controlFlowNode->getConditionExpressionPairs();
+  BinaryenExpressionRef switchExpr = generateSwitch(controlFlowNode, module);
+  if (switchExpr) return switchExpr;
+
+  vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> pairs = controlFlowNode->getConditionExpressionPairs();
+
+  // Locals are numbered in the order they're generated in, which has to be the order they appear in, whatever order
+  // the branches end up tested in
+  vector<BinaryenExpressionRef> conditions;
+  vector<BinaryenExpressionRef> branches;
+
+  for (auto &cndExprPair : pairs) {
+    conditions.push_back(cndExprPair.first ? generate(cndExprPair.first, module) : NULL);
+    branches.push_back(generate(cndExprPair.second, module));
+  }
+
+  vector<long long> counts = controlFlowNode->getProfiledBranchCounts();
+
+  // An if with an else that's taken more often is tested the other way around, so the hot branch comes first
+  if (pairs.size() == 2 && !conditions.at(1) && counts.size() == 2 && counts.at(1) > counts.at(0)) {
+    return BinaryenIf(module, BinaryenUnary(module, BinaryenEqZInt32(), conditions.at(0)), branches.at(1), branches.at(0));
+  }
+
+  vector<int> order = getBranchTestOrder(controlFlowNode);
 
   BinaryenExpressionRef expr = NULL;
 
@@ -916,24 +1234,266 @@ BinaryenExpressionRef CodeGen::generateControlFlow(shared_ptr<ControlFlowNode> c
   //     }
   //   }
   // }
-  for (int i = controlFlowNode->getConditionExpressionPairs().size() - 1; i >= 0; i--) {
-    pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>> cndExprPair = controlFlowNode->getConditionExpressionPairs().at(i);
+  for (int i = order.size() - 1; i >= 0; i--) {
+    int branchIdx = order.at(i);
 
     // Handle the else case
-    if (cndExprPair.first == nullptr) {
-      expr = generate(cndExprPair.second, module);
+    if (conditions.at(branchIdx) == NULL) {
+      expr = branches.at(branchIdx);
       continue;
     }
 
-    expr = BinaryenIf(
+    expr = BinaryenIf(module, conditions.at(branchIdx), branches.at(branchIdx), expr);
+  }
+
+  return expr;
+}
+
+vector<int> CodeGen::getBranchTestOrder(shared_ptr<ControlFlowNode> controlFlowNode) {
+  vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> pairs = controlFlowNode->getConditionExpressionPairs();
+  vector<long long> counts = controlFlowNode->getProfiledBranchCounts();
+
+  vector<int> order;
+  for (int i = 0; i < pairs.size(); i++) order.push_back(i);
+
+  if (counts.size() != pairs.size()) return order;
+
+  // Conditions can only be tested in another order when at most one of them can hold, which is the case when each
+  // compares the same name to a different literal
+  string compared;
+  set<string> literals;
+
+  for (auto &cndExprPair : pairs) {
+    if (!cndExprPair.first) continue;
+
+    shared_ptr<BinaryOperationNode> condition = dynamic_pointer_cast<BinaryOperationNode>(cndExprPair.first);
+    if (!condition || condition->getOperator() != Lexemes::EQUALITY) return order;
+
+    shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(condition->getLeft());
+    shared_ptr<LiteralNode> literal = dynamic_pointer_cast<LiteralNode>(condition->getRight());
+
+    if (!identifier) {
+      identifier = dynamic_pointer_cast<IdentifierNode>(condition->getRight());
+      literal = dynamic_pointer_cast<LiteralNode>(condition->getLeft());
+    }
+
+    if (!identifier || !literal || (!compared.empty() && identifier->getIdentifier() != compared)) return order;
+
+    compared = identifier->getIdentifier();
+
+    // Number literals are truncated to integers, so 1 and 1.5 are the same case
+    string value = literal->getNodeType() == ASTNode::NUMBER_LITERAL
+      ? to_string(strtoll(literal->getLiteralValue().c_str(), nullptr, 10))
+      : literal->getLiteralValue();
+
+    if (!literals.insert(to_string(literal->getNodeType()) + ":" + value).second) return order;
+  }
+
+  // The else stays last, since it's only taken when none of the others are
+  stable_sort(order.begin(), order.end(), [&pairs, &counts](int first, int second) {
+    if (!pairs.at(first).first) return false;
+    if (!pairs.at(second).first) return true;
+
+    return counts.at(first) > counts.at(second);
+  });
+
+  return order;
+}
+
+BinaryenExpressionRef CodeGen::generateSwitch(shared_ptr<ControlFlowNode> controlFlowNode, BinaryenModuleRef &module) {
+  vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> pairs = controlFlowNode->getConditionExpressionPairs();
+
+  // Without an else, the chain has no value to produce when none of the cases match
+  if (pairs.size() < SWITCH_MIN_CASES + 1 || pairs.back().first) return nullptr;
+
+  shared_ptr<IdentifierNode> scrutinee;
+  vector<pair<long long, shared_ptr<ASTNode>>> cases;
+
+  for (int i = 0; i < pairs.size() - 1; i++) {
+    shared_ptr<BinaryOperationNode> condition = dynamic_pointer_cast<BinaryOperationNode>(pairs.at(i).first);
+    if (!condition || condition->getOperator() != Lexemes::EQUALITY) return nullptr;
+
+    shared_ptr<ASTNode> compared = condition->getLeft();
+    shared_ptr<ASTNode> literal = condition->getRight();
+    if (compared->getNodeType() == ASTNode::NUMBER_LITERAL) swap(compared, literal);
+
+    shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(compared);
+    shared_ptr<TypeDeclarationNode> identifierType = dynamic_pointer_cast<TypeDeclarationNode>(compared->getResolvedType());
+
+    if (
+      !identifier ||
+      identifier->getValue() ||
+      !identifierType ||
+      identifierType->getType() != DataTypes::NUMBER ||
+      literal->getNodeType() != ASTNode::NUMBER_LITERAL ||
+      (scrutinee && scrutinee->getIdentifier() != identifier->getIdentifier())
+    ) {
+      return nullptr;
+    }
+
+    scrutinee = identifier;
+
+    string literalValue = dynamic_pointer_cast<LiteralNode>(literal)->getLiteralValue();
+    size_t parsedLength = 0;
+    long long key;
+
+    try {
+      key = stoll(literalValue, &parsedLength);
+    } catch (const exception &e) {
+      return nullptr;
+    }
+
+    if (parsedLength != literalValue.size()) return nullptr;
+
+    // A case whose key repeats an earlier one's can never be taken, but its branch still declares locals, which were
+    // counted along with everyone else's. The if chain generates every branch, so it keeps them numbered right
+    for (auto &existingCase : cases) {
+      if (existingCase.first == key) return nullptr;
+    }
+
+    cases.push_back(make_pair(key, pairs.at(i).second));
+  }
+
+  if (cases.size() < SWITCH_MIN_CASES) return nullptr;
+
+  string labelPrefix = SWITCH_LABEL_PREFIX + to_string(switchCount++);
+  string endLabel = labelPrefix + ".end";
+  string defaultLabel = labelPrefix + ".default";
+
+  vector<string> caseLabels;
+  vector<pair<long long, string>> sortedCases;
+  for (int i = 0; i < cases.size(); i++) {
+    caseLabels.push_back(labelPrefix + ".case" + to_string(i));
+    sortedCases.push_back(make_pair(cases.at(i).first, caseLabels.back()));
+  }
+
+  sort(sortedCases.begin(), sortedCases.end());
+
+  long long minKey = sortedCases.front().first;
+
+  // Keys from one end of the 64 bit range to the other span more numbers than fit in one, so the span leaves out the
+  // key it starts from, which keeps it from wrapping around to 0
+  unsigned long long keySpan = (unsigned long long) sortedCases.back().first - (unsigned long long) minKey;
+
+  BinaryenExpressionRef dispatch;
+
+  if (keySpan < cases.size() * SWITCH_MAX_SPARSENESS) {
+    unsigned long long keyRange = keySpan + 1;
+
+    vector<const char*> targets(keyRange, defaultLabel.c_str());
+    for (auto &sortedCase : sortedCases) {
+      targets[sortedCase.first - minKey] = sortedCase.second.c_str();
+    }
+
+    // Subtracting the smallest key puts every key in the table's range, and anything below it out of range as an
+    // unsigned number, along with anything above
+    auto generateOffset = [&]() {
+      return BinaryenBinary(
+        module,
+        BinaryenSubInt64(),
+        generate(scrutinee, module),
+        BinaryenConst(module, BinaryenLiteralInt64(minKey))
+      );
+    };
+
+    dispatch = BinaryenIf(
       module,
-      generate(cndExprPair.first, module),
-      generate(cndExprPair.second, module),
-      expr
+      BinaryenBinary(
+        module,
+        BinaryenLtUInt64(),
+        generateOffset(),
+        BinaryenConst(module, BinaryenLiteralInt64(keyRange))
+      ),
+      BinaryenSwitch(
+        module,
+        targets.data(),
+        targets.size(),
+        defaultLabel.c_str(),
+        BinaryenUnary(module, BinaryenWrapInt64(), generateOffset()),
+        NULL
+      ),
+      BinaryenBreak(module, defaultLabel.c_str(), NULL, NULL)
     );
+  } else {
+    dispatch = generateSwitchDecisionTree(scrutinee, sortedCases, 0, sortedCases.size() - 1, defaultLabel, module);
   }
 
-  return expr;
+  // Each case's block is nested in the next one's, so jumping out of a case's block lands on the code for its branch,
+  // which then jumps to the end of the chain:
+  // (block $end
+  //   (block $default
+  //     (block $case1
+  //       (block $case0 dispatch)
+  //       (br $end case0Branch))
+  //     (br $end case1Branch))
+  //   elseBranch)
+  //
+  // The branches are generated in the order they appear in, which is the order their locals were counted in
+  vector<BinaryenExpressionRef> content = { dispatch };
+
+  for (int i = 0; i < cases.size(); i++) {
+    BinaryenExpressionRef caseBlock = BinaryenBlock(module, caseLabels.at(i).c_str(), content.data(), content.size(), BinaryenTypeNone());
+    BinaryenExpressionRef branch = generate(cases.at(i).second, module);
+
+    if (BinaryenExpressionGetType(branch) == BinaryenTypeNone()) {
+      content = { caseBlock, branch, BinaryenBreak(module, endLabel.c_str(), NULL, NULL) };
+    } else {
+      content = { caseBlock, BinaryenBreak(module, endLabel.c_str(), NULL, branch) };
+    }
+  }
+
+  BinaryenExpressionRef chainExpressions[2] = {
+    BinaryenBlock(module, defaultLabel.c_str(), content.data(), content.size(), BinaryenTypeNone()),
+    generate(pairs.back().second, module)
+  };
+
+  return BinaryenBlock(module, endLabel.c_str(), chainExpressions, 2, BinaryenTypeAuto());
+}
+
+BinaryenExpressionRef CodeGen::generateSwitchDecisionTree(
+  shared_ptr<IdentifierNode> scrutinee,
+  vector<pair<long long, string>> &sortedCases,
+  int first,
+  int last,
+  string defaultLabel,
+  BinaryenModuleRef &module
+) {
+  // A few keys are cheaper to compare one at a time than to keep splitting
+  if (last - first < 3) {
+    vector<BinaryenExpressionRef> expressions;
+
+    for (int i = first; i <= last; i++) {
+      expressions.push_back(BinaryenBreak(
+        module,
+        sortedCases.at(i).second.c_str(),
+        BinaryenBinary(
+          module,
+          BinaryenEqInt64(),
+          generate(scrutinee, module),
+          BinaryenConst(module, BinaryenLiteralInt64(sortedCases.at(i).first))
+        ),
+        NULL
+      ));
+    }
+
+    expressions.push_back(BinaryenBreak(module, defaultLabel.c_str(), NULL, NULL));
+
+    return BinaryenBlock(module, NULL, expressions.data(), expressions.size(), BinaryenTypeNone());
+  }
+
+  int middle = (first + last + 1) / 2;
+
+  return BinaryenIf(
+    module,
+    BinaryenBinary(
+      module,
+      BinaryenLtSInt64(),
+      generate(scrutinee, module),
+      BinaryenConst(module, BinaryenLiteralInt64(sortedCases.at(middle).first))
+    ),
+    generateSwitchDecisionTree(scrutinee, sortedCases, first, middle - 1, defaultLabel, module),
+    generateSwitchDecisionTree(scrutinee, sortedCases, middle, last, defaultLabel, module)
+  );
 }
 
 BinaryenExpressionRef CodeGen::generateIdentifier(shared_ptr<IdentifierNode> identNode, BinaryenModuleRef &module) {
@@ -1023,7 +1583,7 @@ BinaryenExpressionRef CodeGen::generateUnaryOperation(shared_ptr<UnaryOperationN
   }
 
   if (unaryOpNode->getOperator() == Lexemes::NOT) {
-    return BinaryenUnary(module, BinaryenEqZInt64(), binaryenVal);
+    return BinaryenUnary(module, BinaryenEqZInt32(), binaryenVal);
   }
 
   // Must be a negative. Multiply by negative 1
@@ -1038,12 +1598,23 @@ BinaryenExpressionRef CodeGen::generateUnaryOperation(shared_ptr<UnaryOperationN
 BinaryenExpressionRef CodeGen::generateNumberLiteral(shared_ptr<LiteralNode> literalNode, BinaryenModuleRef &module) {
   return BinaryenConst(
     module,
-    BinaryenLiteralInt64(stoi(literalNode->getLiteralValue()))
+    BinaryenLiteralInt64(stoll(literalNode->getLiteralValue()))
   );
 }
 
 BinaryenExpressionRef CodeGen::generateStringLiteral(shared_ptr<LiteralNode> literalNode, BinaryenModuleRef &module) {
-  return BinaryenStringConst(module, literalNode->getLiteralValue().c_str());
+  string value = literalNode->getLiteralValue();
+  auto pooledString = stringPool.find(value);
+
+  if (pooledString == stringPool.end()) {
+    string globalName = STRING_POOL_PREFIX + to_string(stringPool.size());
+
+    BinaryenAddGlobal(module, globalName.c_str(), BinaryenTypeStringref(), false, BinaryenStringConst(module, value.c_str()));
+
+    pooledString = stringPool.insert(make_pair(value, globalName)).first;
+  }
+
+  return BinaryenGlobalGet(module, pooledString->second.c_str(), BinaryenTypeStringref());
 }
 
 BinaryenExpressionRef CodeGen::generateBooleanLiteral(shared_ptr<LiteralNode> literalNode, BinaryenModuleRef &module) {
@@ -1150,7 +1721,7 @@ BinaryenOp CodeGen::getBinaryenOpFromBinOpNode(shared_ptr<BinaryOperationNode> b
   if (op == Lexemes::EQUALITY && dataType == DataTypes::NUMBER) return BinaryenEqInt64();
   if (op == Lexemes::EQUALITY && dataType == DataTypes::BOOLEAN) return BinaryenEqInt32();
   if (op == Lexemes::INEQUALITY && dataType == DataTypes::NUMBER) return BinaryenNeInt64();
-  if (op == Lexemes::INEQUALITY && dataType == DataTypes::BOOLEAN) return BinaryenEqInt32();
+  if (op == Lexemes::INEQUALITY && dataType == DataTypes::BOOLEAN) return BinaryenNeInt32();
   if (op == Lexemes::LT && dataType == DataTypes::NUMBER) return BinaryenLtSInt64();
   if (op == Lexemes::GT && dataType == DataTypes::NUMBER) return BinaryenGtSInt64();
   if (op == Lexemes::LTEQ && dataType == DataTypes::NUMBER) return BinaryenLeSInt64();
@@ -1273,26 +1844,175 @@ void CodeGen::bindIdentifierToScope(shared_ptr<ASTNode> ast) {
 
     functionNameToClosureTemplateMap.insert(make_pair(
       identifier,
-      WasmClosure(functionNameToClosureTemplateMap.size(), totalParams)
+      WasmClosure(Pointer<PointerType::Function>(), totalParams)
     ));
   } 
 
   scope.insert(identifier, ast->getRight());
 }
 
+Pointer<PointerType::Function> CodeGen::getFunctionTableAddress(string functionName) {
+  auto tableIndex = functionTableIndexes.find(functionName);
+
+  if (tableIndex != functionTableIndexes.end()) return Pointer<PointerType::Function>(tableIndex->second);
+
+  int address = functionTableIndexes.size();
+  functionTableIndexes.insert(make_pair(functionName, address));
+
+  return Pointer<PointerType::Function>(address);
+}
+
+string CodeGen::getClosureDispatcher(FunctionMetaData &functionMetaData) {
+  pair<BinaryenType, BinaryenType> signature = make_pair(functionMetaData.getParamType(), functionMetaData.getReturnType());
+
+  for (auto &dispatcher : closureDispatchers) {
+    if (dispatcher.signature == signature) return dispatcher.name;
+  }
+
+  closureDispatchers.push_back(ClosureDispatcher{
+    CLOSURE_DISPATCHER_PREFIX + to_string(closureDispatchers.size()),
+    signature,
+    vector<BinaryenType>(functionMetaData.getParams(), functionMetaData.getParams() + functionMetaData.getArity())
+  });
+
+  return closureDispatchers.back().name;
+}
+
+void CodeGen::generateClosureDispatchers(BinaryenModuleRef &module) {
+  for (auto &dispatcher : closureDispatchers) {
+    BinaryenType paramType = dispatcher.signature.first;
+    BinaryenType returnType = dispatcher.signature.second;
+    int arity = dispatcher.params.size();
+
+    // The table only ever holds the functions closures are made of in this module, so the ones with the dispatcher's
+    // signature are every function a call through it can reach
+    vector<pair<int, string>> targets;
+    for (auto &[fnName, tableIndex] : functionTableIndexes) {
+      BinaryenFunctionRef function = BinaryenGetFunction(module, fnName.c_str());
+
+      if (function && BinaryenFunctionGetParams(function) == paramType && BinaryenFunctionGetResults(function) == returnType) {
+        targets.push_back(make_pair(tableIndex, fnName));
+      }
+    }
+
+    sort(targets.begin(), targets.end());
+
+    // The arguments are the dispatcher's parameters after the table index, so each call reads them from locals
+    auto generateArguments = [&]() {
+      BinaryenExpressionRef* operands = new BinaryenExpressionRef[arity];
+      for (int i = 0; i < arity; i++) operands[i] = BinaryenLocalGet(module, i + 1, dispatcher.params.at(i));
+
+      return operands;
+    };
+
+    BinaryenExpressionRef body = BinaryenCallIndirect(
+      module,
+      FN_TABLE_NAME.c_str(),
+      BinaryenLocalGet(module, 0, BinaryenTypeInt32()),
+      generateArguments(),
+      arity,
+      paramType,
+      returnType
+    );
+
+    if (!targets.empty() && targets.size() <= CLOSURE_DISPATCH_MAX_TARGETS) {
+      string defaultLabel = dispatcher.name + ".default";
+      vector<string> caseLabels;
+      for (int i = 0; i < targets.size(); i++) caseLabels.push_back(dispatcher.name + ".case" + to_string(i));
+
+      int lowestIndex = targets.front().first;
+      int range = targets.back().first - lowestIndex + 1;
+      BinaryenExpressionRef selector;
+
+      if (range <= targets.size() * SWITCH_MAX_SPARSENESS) {
+        // Indices outside the table's range, wrapped around or past its end, go to the default
+        vector<const char*> labels(range, defaultLabel.c_str());
+        for (int i = 0; i < targets.size(); i++) labels[targets.at(i).first - lowestIndex] = caseLabels.at(i).c_str();
+
+        selector = BinaryenSwitch(
+          module,
+          labels.data(),
+          labels.size(),
+          defaultLabel.c_str(),
+          BinaryenBinary(
+            module,
+            BinaryenSubInt32(),
+            BinaryenLocalGet(module, 0, BinaryenTypeInt32()),
+            BinaryenConst(module, BinaryenLiteralInt32(lowestIndex))
+          ),
+          NULL
+        );
+      } else {
+        vector<BinaryenExpressionRef> branches;
+        for (int i = 0; i < targets.size(); i++) {
+          branches.push_back(BinaryenBreak(
+            module,
+            caseLabels.at(i).c_str(),
+            BinaryenBinary(
+              module,
+              BinaryenEqInt32(),
+              BinaryenLocalGet(module, 0, BinaryenTypeInt32()),
+              BinaryenConst(module, BinaryenLiteralInt32(targets.at(i).first))
+            ),
+            NULL
+          ));
+        }
+
+        branches.push_back(BinaryenBreak(module, defaultLabel.c_str(), NULL, NULL));
+
+        selector = BinaryenBlock(module, NULL, branches.data(), branches.size(), BinaryenTypeNone());
+      }
+
+      // Each case is a block ending where its direct call begins, nested inside the next case's block
+      BinaryenExpressionRef cases = selector;
+      for (int i = 0; i < targets.size(); i++) {
+        BinaryenExpressionRef caseExpressions[2] = {
+          BinaryenBlock(module, caseLabels.at(i).c_str(), &cases, 1, BinaryenTypeNone()),
+          BinaryenReturn(
+            module,
+            BinaryenCall(module, targets.at(i).second.c_str(), generateArguments(), arity, returnType)
+          )
+        };
+
+        cases = BinaryenBlock(module, NULL, caseExpressions, 2, BinaryenTypeNone());
+      }
+
+      BinaryenExpressionRef dispatchExpressions[2] = {
+        BinaryenBlock(module, defaultLabel.c_str(), &cases, 1, BinaryenTypeNone()),
+        body
+      };
+
+      body = BinaryenBlock(module, NULL, dispatchExpressions, 2, returnType);
+    }
+
+    vector<BinaryenType> dispatchParams = { BinaryenTypeInt32() };
+    dispatchParams.insert(dispatchParams.end(), dispatcher.params.begin(), dispatcher.params.end());
+
+    BinaryenAddFunction(
+      module,
+      dispatcher.name.c_str(),
+      BinaryenTypeCreate(dispatchParams.data(), dispatchParams.size()),
+      returnType,
+      NULL,
+      0,
+      body
+    );
+  }
+}
+
 void CodeGen::registerModuleFunctions(BinaryenModuleRef &module) {
   BinaryenAddTable(
     module,
     FN_TABLE_NAME.c_str(),
-    functionNameToClosureTemplateMap.size(),
-    functionNameToClosureTemplateMap.size(),
+    functionTableIndexes.size(),
+    functionTableIndexes.size(),
     BinaryenTypeFuncref()
   );
 
-  const char** fnNames = new const char*[functionNameToClosureTemplateMap.size()];
+  const char** fnNames = new const char*[functionTableIndexes.size()];
 
-  for (auto& [fnName, fnRef] : functionNameToClosureTemplateMap) {
-    fnNames[fnRef.getFunctionPointer().getAddress()] = fnName.c_str();
+  for (auto& [fnName, tableIndex] : functionTableIndexes) {
+    fnNames[tableIndex] = fnName.c_str();
   }
 
   BinaryenAddActiveElementSegment(
@@ -1300,7 +2020,7 @@ void CodeGen::registerModuleFunctions(BinaryenModuleRef &module) {
     FN_TABLE_NAME.c_str(),
     "0",
     fnNames,
-    functionNameToClosureTemplateMap.size(),
+    functionTableIndexes.size(),
     BinaryenConst(module, BinaryenLiteralInt32(0))
   );
 }
@@ -1332,27 +2052,10 @@ int CodeGen::getByteSizeForType(BinaryenType type) {
 }
 
 BinaryenModuleRef CodeGen::importCoreLangWasm() {
-  ifstream file(Compiler::resolveAbsolutePath("wasm/ThetaLangCore.wat"), ios::binary);
-  if (!file.is_open()) {
-    cerr << "Failed to open the file." << endl;
-    return nullptr;
-  }
-
-  vector<char> buffer(istreambuf_iterator<char>(file), {});
-
-  if (buffer.empty()) {
-    cerr << "Failed to read the file or the file is empty." << endl;
-    return nullptr;
-  }
-
-  // Add a null terminator at the end
-  buffer.push_back('\0');
-
-  BinaryenModuleRef module = BinaryenModuleParse(buffer.data());
+  // BinaryenModuleRead wants a mutable buffer, so copy the embedded bytes out first
+  vector<char> buffer(THETA_LANG_CORE_WASM, THETA_LANG_CORE_WASM + THETA_LANG_CORE_WASM_SIZE);
 
-  file.close();
-
-  return module;
+  return BinaryenModuleRead(buffer.data(), buffer.size());
 }
 
 string CodeGen::generateFunctionHash(shared_ptr<FunctionDeclarationNode> function) {
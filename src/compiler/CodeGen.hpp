@@ -19,6 +19,7 @@
 #include "parser/ast/FunctionInvocationNode.hpp"
 #include "parser/ast/ControlFlowNode.hpp"
 #include "compiler/FunctionMetaData.hpp"
+#include "compiler/CompilationSession.hpp"
 #include <binaryen-c.h>
 #include <set>
 #include <unordered_map>
@@ -29,6 +30,8 @@ using namespace std;
 namespace Theta {
   class CodeGen {
   public:
+    CodeGen(shared_ptr<CompilationSession> compilationSession) : session(compilationSession) {}
+
     BinaryenModuleRef generateWasmFromAST(shared_ptr<ASTNode> ast);
     BinaryenExpressionRef generate(shared_ptr<ASTNode> node, BinaryenModuleRef &module);
     void generateCapsule(shared_ptr<CapsuleNode> node, BinaryenModuleRef &module);
@@ -58,12 +61,26 @@ namespace Theta {
     BinaryenExpressionRef generateExponentOperation(shared_ptr<BinaryOperationNode> node, BinaryenModuleRef &module);
     void generateSource(shared_ptr<SourceNode> node, BinaryenModuleRef &module);
 
-    shared_ptr<FunctionDeclarationNode> liftLambda(
+    static shared_ptr<FunctionDeclarationNode> liftLambda(
       shared_ptr<FunctionDeclarationNode> node,
-      BinaryenModuleRef &module
+      SymbolTableStack<shared_ptr<ASTNode>> &scope
+    );
+
+    static void collectClosureScope(
+      shared_ptr<ASTNode> node,
+      set<string> &identifiersToFind,
+      vector<shared_ptr<ASTNode>> &parameters,
+      vector<shared_ptr<ASTNode>> &bodyExpression
     );
 
+    static string generateFunctionHash(shared_ptr<FunctionDeclarationNode> function);
+
+    static bool checkIsLastInBlock(shared_ptr<ASTNode> node);
+
+    static int getByteSizeForType(shared_ptr<TypeDeclarationNode> type);
+
   private:
+    shared_ptr<CompilationSession> session;
     SymbolTableStack<shared_ptr<ASTNode>> scope;          
     SymbolTableStack<string> scopeReferences;
     string FN_TABLE_NAME = "ThetaFunctionRefs";
@@ -72,7 +89,99 @@ namespace Theta {
     int memoryOffset = 0;
     int stringRefOffset = 1;
     unordered_map<string, WasmClosure> functionNameToClosureTemplateMap;
+
+    /**
+     * @brief The index in the function table of each function a closure has been made of. Functions that are only ever
+     * called by name are left out of the table
+     */
+    unordered_map<string, int> functionTableIndexes;
     string LOCAL_IDX_SCOPE_KEY = "ThetaLang.internal.localIdxCounter";
+    string TAIL_CALL_LOOP_LABEL = "ThetaLang.internal.tailCallLoop";
+    string SWITCH_LABEL_PREFIX = "ThetaLang.internal.switch";
+    string STRING_POOL_PREFIX = "ThetaLang.internal.string";
+
+    /**
+     * @brief The immutable global holding each string literal the module uses, by the literal's value. Every use of a
+     * literal reads the same global, so each distinct string is only created once
+     */
+    unordered_map<string, string> stringPool;
+
+    /**
+     * @brief Else-if chains with fewer cases than this are left as nested ifs, which are as fast for so few compares
+     */
+    int SWITCH_MIN_CASES = 4;
+
+    /**
+     * @brief A chain becomes a br_table when its keys cover at least one in this many of the integers between its
+     * smallest and largest key. Sparser chains get a binary search over their keys instead, to keep the table small
+     */
+    int SWITCH_MAX_SPARSENESS = 3;
+
+    /**
+     * @brief How many chains have been generated as switches, which keeps their labels unique
+     */
+    int switchCount = 0;
+
+    string CLOSURE_DISPATCHER_PREFIX = "ThetaLang.internal.dispatch";
+
+    /**
+     * @brief A call through a closure whose signature more functions in the table share than this goes straight to
+     * call_indirect, rather than testing for each of them
+     */
+    int CLOSURE_DISPATCH_MAX_TARGETS = 8;
+
+    /**
+     * @brief A function that calls through closures of one signature go through. It's given the closure's index in the
+     * function table and its arguments, and once every closure in the module is known, it jumps on the index to a direct
+     * call to each function in the table with the signature, which the engine can inline. Any other index still goes
+     * through call_indirect
+     */
+    struct ClosureDispatcher {
+      string name;
+      pair<BinaryenType, BinaryenType> signature;
+      vector<BinaryenType> params;
+    };
+
+    vector<ClosureDispatcher> closureDispatchers;
+
+    /**
+     * @brief The function whose body is currently being generated, which calls in tail position need to know about
+     */
+    struct GeneratedFunction {
+      shared_ptr<FunctionDeclarationNode> declaration;
+      BinaryenType returnType;
+
+      /**
+       * @brief The index of the first of the extra locals that hold the arguments of a call the function makes to
+       * itself in tail position, while they are evaluated, before they are assigned to the parameters
+       */
+      int firstArgumentLocalIdx;
+
+      /**
+       * @brief Whether the body calls the function itself in tail position, and so needs to be wrapped in a loop
+       */
+      bool isLooping = false;
+    };
+
+    optional<GeneratedFunction> currentFunction;
+
+    /**
+     * @brief The global names of the functions that don't escape the block declaring them, which are called directly
+     * rather than through a closure
+     */
+    set<string> directlyCalledFunctions;
+
+    /**
+     * @brief The calls to curried capsule functions whose closures don't escape the block binding them, with the
+     * identifier of the uncurried function that calls to the closure are made to instead
+     */
+    unordered_map<shared_ptr<ASTNode>, string> specializedPartialApplications;
+
+    /**
+     * @brief The uncurried versions of the curried capsule functions, by identifier, in the order they were needed. They
+     * take the curried function's parameters followed by those of the function it returns
+     */
+    vector<pair<string, shared_ptr<FunctionDeclarationNode>>> uncurriedFunctions;
 
     BinaryenModuleRef initializeWasmModule();
 
@@ -83,6 +192,76 @@ namespace Theta {
       BinaryenModuleRef &modul
     );
 
+    /**
+     * @brief The order to test the branches of a control flow in. With a profile, the conditions of a chain that compares
+     * one name to different literals are tested most taken first, since only one of them can hold. Otherwise they're
+     * tested in the order they're written in
+     * @return The indices of the control flow's branches, in the order to test them
+     */
+    vector<int> getBranchTestOrder(shared_ptr<ControlFlowNode> controlFlowNode);
+
+    /**
+     * @brief Generates an else-if chain whose conditions all compare the same name to an integer literal, like a match
+     * on an enum, as a jump straight to the branch that's taken
+     * @return The generated chain, or nullptr if the control flow isn't such a chain, or is too short to be worth it
+     */
+    BinaryenExpressionRef generateSwitch(shared_ptr<ControlFlowNode> controlFlowNode, BinaryenModuleRef &module);
+
+    /**
+     * @brief Generates a binary search over the sorted keys of a switch, which jumps to the label of the key that equals
+     * the scrutinee, or to the default label if none does
+     */
+    BinaryenExpressionRef generateSwitchDecisionTree(
+      shared_ptr<IdentifierNode> scrutinee,
+      vector<pair<long long, string>> &sortedCases,
+      int first,
+      int last,
+      string defaultLabel,
+      BinaryenModuleRef &module
+    );
+
+    /**
+     * @brief Generates a call a function makes to itself in tail position as an assignment of the arguments to its
+     * parameters, followed by a jump back to the start of its body
+     */
+    BinaryenExpressionRef generateSelfTailCall(shared_ptr<FunctionInvocationNode> funcInvNode, BinaryenModuleRef &module);
+
+    /**
+     * @brief Generates a call to a function that doesn't escape the block declaring it. The values it captures are
+     * passed as the leading arguments its lifted declaration takes, ahead of the call's own arguments
+     */
+    BinaryenExpressionRef generateDirectClosureCall(
+      shared_ptr<FunctionInvocationNode> funcInvNode,
+      shared_ptr<FunctionDeclarationNode> simplifiedDeclaration,
+      string globalQualifiedFunctionName,
+      BinaryenModuleRef &module
+    );
+
+    /**
+     * @brief Finds the uncurried function that calls to the closure returned by a partial application can be made to
+     * directly, declaring it if it hasn't been yet. That's possible when the call is to a capsule function whose body is
+     * the function it returns, the closure doesn't escape, and the call's arguments can be evaluated again at each call
+     * to the closure without changing its result
+     * @return The identifier of the uncurried function, if the partial application can be specialized
+     */
+    optional<string> specializePartialApplication(shared_ptr<FunctionInvocationNode> partialApplication);
+
+    /**
+     * @brief Generates a call to the closure returned by a specialized partial application as a direct call to the
+     * uncurried function, passing the arguments of both calls
+     */
+    BinaryenExpressionRef generateSpecializedCall(
+      shared_ptr<FunctionInvocationNode> funcInvNode,
+      shared_ptr<FunctionInvocationNode> partialApplication,
+      string uncurriedIdentifier,
+      BinaryenModuleRef &module
+    );
+
+    /**
+     * @brief Whether a call returning the given type can be emitted as a return call, reusing the caller's frame
+     */
+    bool canReturnCall(shared_ptr<FunctionInvocationNode> funcInvNode, BinaryenType returnType);
+
     vector<Pointer<PointerType::Data>> generateFunctionInvocationArgMemoryInsertions(
       shared_ptr<FunctionInvocationNode> funcInvNode,
       vector<BinaryenExpressionRef> &expressions,
@@ -119,10 +298,34 @@ namespace Theta {
     );
 
     void hoistCapsuleElements(vector<shared_ptr<ASTNode>> ielements);
+
+    /**
+     * @brief Where a capsule element goes when the capsule is laid out by a profile: values first, then functions from
+     * the most called to those never called
+     * @return A rank that sorts the element before every element of lower rank
+     */
+    static long long getProfiledLayoutRank(shared_ptr<ASTNode> capsuleElement);
     void bindIdentifierToScope(shared_ptr<ASTNode> ast);
     void registerModuleFunctions(BinaryenModuleRef &module);
 
-    bool checkIsLastInBlock(shared_ptr<ASTNode> node);
+    /**
+     * @brief Returns the name of the dispatcher for calls through closures of the given signature, declaring it the first
+     * time it's needed. Its body is generated by generateClosureDispatchers
+     */
+    string getClosureDispatcher(FunctionMetaData &functionMetaData);
+
+    /**
+     * @brief Adds the closure dispatchers to the module, once generating the rest of it has put every function closures
+     * are made of in the function table
+     */
+    void generateClosureDispatchers(BinaryenModuleRef &module);
+
+    /**
+     * @brief Returns the index of a function in the function table, adding it to the table the first time its address
+     * is taken to make a closure of it
+     */
+    Pointer<PointerType::Function> getFunctionTableAddress(string functionName);
+
 
     pair<WasmClosure, vector<BinaryenExpressionRef>> generateAndStoreClosure(
       string qualifiedReferenceFunctionName,
@@ -133,17 +336,7 @@ namespace Theta {
 
     vector<BinaryenExpressionRef> generateClosureMemoryStore(WasmClosure &closure, BinaryenModuleRef &module);
 
-    void collectClosureScope(
-      shared_ptr<ASTNode> node,
-      set<string> &identifiersToFind,
-      vector<shared_ptr<ASTNode>> &parameters,
-      vector<shared_ptr<ASTNode>> &bodyExpression
-    );
-
-    string generateFunctionHash(shared_ptr<FunctionDeclarationNode> function);
-
-    int getByteSizeForType(shared_ptr<TypeDeclarationNode> type);
-    int getByteSizeForType(BinaryenType type);
+    static int getByteSizeForType(BinaryenType type);
 
     BinaryenModuleRef importCoreLangWasm();
   };
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <functional>
+#include "exceptions/Error.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "LinkedCapsuleCache.hpp"
+#include "optimization/OptimizationOptions.hpp"
+
+using namespace std;
+
+/**
+ * @brief Holds all of the mutable state belonging to a single compilation: the errors encountered along the way,
+ * the capsules that have already been parsed for linking, and the output options requested by the caller.
+ *
+ * Every stage of the pipeline (parser, optimization passes, type checker and code generator) receives the session
+ * explicitly instead of reaching for global state, so independent sessions can be run side by side on separate
+ * threads. A session itself is not meant to be shared between threads.
+ */
+namespace Theta {
+  class CompilationSession {
+  public:
+    /**
+     * @brief Creates a session, discovering all capsules reachable from the current working directory.
+     */
+    CompilationSession() : filesByCapsuleName(discoverCapsules()) {}
+
+    /**
+     * @brief Creates a session that reuses an already discovered capsule map. Useful when many sessions are created
+     * for the same project, since capsule discovery has to walk the whole directory tree.
+     * @param capsuleFiles A map of capsule names to the files that contain them
+     * @param linkCache An optional cache of linked capsules shared with other sessions, so that capsules linked by
+     * several entrypoints are only parsed once
+     */
+    CompilationSession(
+      shared_ptr<map<string, string>> capsuleFiles,
+      shared_ptr<LinkedCapsuleCache> linkCache = nullptr
+    ) : filesByCapsuleName(capsuleFiles), linkedCapsuleCache(linkCache) {}
+
+    CompilationSession(const CompilationSession&) = delete;
+    CompilationSession& operator=(const CompilationSession&) = delete;
+
+    shared_ptr<map<string, string>> filesByCapsuleName;
+
+    bool isEmitTokens = false;
+    bool isEmitAST = false;
+    bool isEmitWAT = false;
+
+    /**
+     * @brief Whether to write the wasm binary directly from the AST instead of going through Binaryen. Produces an
+     * unoptimized but behaviorally identical module much faster, for debug builds.
+     */
+    bool isFastEmit = false;
+
+    /**
+     * @brief Which optimization passes to run over the AST, and how
+     */
+    OptimizationOptions optimization;
+
+    /**
+     * @brief Adds an encountered exception to the list of exceptions to display later
+     * @param e The exception to add
+     */
+    void addException(shared_ptr<Error> e) { encounteredExceptions.push_back(e); }
+
+    /**
+     * @brief Returns all the exceptions we encountered during the compilation process
+     * @return A vector of compilation errors
+     */
+    vector<shared_ptr<Error>> getEncounteredExceptions() { return encounteredExceptions; }
+
+    /**
+     * @brief Clears the list of compilation errors
+     */
+    void clearExceptions() { encounteredExceptions.clear(); }
+
+    /**
+     * @brief Returns the parsed AST of a linked capsule, if it exists
+     * @param capsuleName The name of the capsule
+     * @return A shared pointer to the parsed AST
+     */
+    shared_ptr<ASTNode> getIfExistsParsedLinkAST(string capsuleName) {
+      auto it = parsedLinkASTs.find(capsuleName);
+
+      if (it != parsedLinkASTs.end()) return it->second;
+
+      return nullptr;
+    }
+
+    /**
+     * @brief Adds a linked capsule's AST to the map of parsed capsule ASTs
+     * @param capsuleName The name of the capsule
+     * @param linkedAST A shared pointer to the AST to add
+     */
+    void addParsedLinkAST(string capsuleName, shared_ptr<ASTNode> linkedAST) {
+      parsedLinkASTs.insert(make_pair(capsuleName, linkedAST));
+    }
+
+    /**
+     * @brief Returns the parsed AST of a linked capsule, building it with the given function if it has not been parsed
+     * yet. If this session shares a LinkedCapsuleCache, the capsule may have been parsed by another session, in which
+     * case any errors encountered while parsing it are added to this session as well. The AST may be shared with
+     * other sessions, so it must not be modified.
+     * @param capsuleName The name of the capsule
+     * @param build The function used to parse the capsule if it has not been parsed yet
+     * @return A shared pointer to the parsed AST, or nullptr if the capsule is still being parsed, because it links
+     * itself through the capsules it links
+     */
+    shared_ptr<ASTNode> resolveParsedLinkAST(string capsuleName, function<shared_ptr<ASTNode>()> build) {
+      shared_ptr<ASTNode> linkedAST = getIfExistsParsedLinkAST(capsuleName);
+
+      if (linkedAST) return linkedAST;
+
+      if (!linkedCapsuleCache) {
+        if (!linksInProgress.insert(capsuleName).second) return nullptr;
+
+        linkedAST = build();
+        linksInProgress.erase(capsuleName);
+        addParsedLinkAST(capsuleName, linkedAST);
+
+        return linkedAST;
+      }
+
+      LinkedCapsuleCache::Resolution resolution;
+      LinkedCapsuleCache::Entry entry = linkedCapsuleCache->getOrBuild(capsuleName, [this, &build]() {
+        int errorCountBefore = encounteredExceptions.size();
+
+        shared_ptr<ASTNode> builtAST = build();
+
+        return LinkedCapsuleCache::Entry{
+          builtAST,
+          vector<shared_ptr<Error>>(encounteredExceptions.begin() + errorCountBefore, encounteredExceptions.end())
+        };
+      }, resolution);
+
+      if (resolution == LinkedCapsuleCache::CYCLIC) return nullptr;
+
+      if (resolution == LinkedCapsuleCache::CACHED) {
+        encounteredExceptions.insert(encounteredExceptions.end(), entry.errors.begin(), entry.errors.end());
+      }
+
+      addParsedLinkAST(capsuleName, entry.linkedAST);
+
+      return entry.linkedAST;
+    }
+
+    /**
+     * @brief Discovers all capsules in the Theta source code.
+     *
+     * Scans the given directory and its subdirectories to find all `.th` files and extracts capsule names.
+     *
+     * @param rootDirectory The directory to scan. Defaults to the current working directory
+     * @return A map of capsule names to the files that contain them
+     */
+    static shared_ptr<map<string, string>> discoverCapsules(string rootDirectory = ".") {
+      shared_ptr<map<string, string>> capsules = make_shared<map<string, string>>();
+
+      for (const auto& entry : std::filesystem::recursive_directory_iterator(rootDirectory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".th") {
+          string capsuleName = findCapsuleName(entry.path().string());
+
+          capsules->insert(make_pair(capsuleName, entry.path().string()));
+        }
+      }
+
+      return capsules;
+    }
+
+  private:
+    shared_ptr<LinkedCapsuleCache> linkedCapsuleCache;
+    vector<shared_ptr<Error>> encounteredExceptions;
+    map<string, shared_ptr<ASTNode>> parsedLinkASTs;
+
+    /**
+     * @brief The capsules being parsed for linking, when there's no LinkedCapsuleCache to keep track of them
+     */
+    set<string> linksInProgress;
+
+    /**
+     * @brief Finds the capsule name associated with the given file.
+     *
+     * Reads the content of the file and searches for the `capsule` keyword to identify the capsule name.
+     *
+     * @param file The file for which to find the capsule name.
+     * @return The capsule name corresponding to the file.
+     */
+    static string findCapsuleName(string file) {
+      std::ifstream t(file);
+      std::stringstream buffer;
+
+      buffer << t.rdbuf();
+
+      string source = buffer.str();
+
+      int i = 0;
+      bool capsuleNameFound = false;
+      string capsuleName;
+
+      // TODO: This is probably better suited to live in the lexer as a callable function
+      // Iterate over the source but stop once we find a capsule
+      while (i + 6 < source.length() && !capsuleNameFound) {
+        if (source[i] == 'c' && source[i + 1] == 'a' && source[i + 2] == 'p' && source[i + 3] == 's' && source[i + 4] == 'u' && source[i + 5] == 'l' && source[i + 6] == 'e') {
+          capsuleNameFound = true;
+          i += 7;
+        }
+
+        i++;
+      }
+
+      if (capsuleNameFound) {
+        while (source[i] != '\n' && !isspace(source[i]) && source[i] != '{') {
+          capsuleName.push_back(source[i]);
+
+          i++;
+        }
+      }
+
+      return capsuleName;
+    }
+  };
+}
@@ -2,212 +2,292 @@
 #include "../lexer/Lexer.cpp"
 #include "../parser/Parser.cpp"
 #include "compiler/TypeChecker.hpp"
-#include <limits.h>
-#include <cstring>
-#include <unistd.h>
-
-#ifdef __APPLE__
-#include <mach-o/dyld.h>
-#endif
+#include "compiler/optimization/ExecutionProfile.hpp"
+#include <cstdlib>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
 
 using namespace std;
 using namespace Theta;
 
-Compiler& Compiler::getInstance() {
-  static Compiler instance;
-  return instance;
-}
-
-void Compiler::compile(string entrypoint, string outputFile, bool emitTokens, bool emitAST, bool emitWAT) {
-  isEmitTokens = emitTokens;
-  isEmitAST = emitAST;
-  isEmitWAT = emitWAT;
+mutex Compiler::outputMutex;
+mutex Compiler::binaryenOptionsMutex;
 
-  shared_ptr<ASTNode> programAST = buildAST(entrypoint);
+bool Compiler::compile(shared_ptr<CompilationSession> session, string entrypoint, string outputFile) {
+  shared_ptr<ASTNode> programAST = buildAST(session, entrypoint);
 
-  if (!optimizeAST(programAST)) return;
+  if (!optimizeAST(session, programAST)) return false;
 
-  outputAST(programAST, entrypoint);
+  outputAST(session, programAST, entrypoint);
 
-  TypeChecker typeChecker;
+  TypeChecker typeChecker(session);
   bool isTypeValid = typeChecker.checkAST(programAST);
 
-  for (int i = 0; i < encounteredExceptions.size(); i++) {
-    encounteredExceptions[i]->display();
+  {
+    lock_guard<mutex> lock(outputMutex);
+
+    Error::displayAll(session->getEncounteredExceptions());
   }
 
-  if (!isTypeValid) return;
+  if (!isTypeValid || !optimizeTypedAST(session, programAST)) return false;
 
-  CodeGen codeGen;
-  BinaryenModuleRef module = codeGen.generateWasmFromAST(programAST);
+  vector<char> buffer = generateWasm(session, programAST, entrypoint);
 
-  if (isEmitWAT) {
-    cout << "Generated WAT for \"" + entrypoint + "\":" << endl;
-    BinaryenModulePrint(module);
+  writeBufferToFile(buffer, outputFile);
+
+  return true;
+}
+
+bool Compiler::compileBatch(
+  vector<pair<string, string>> entrypointsWithOutputs,
+  unsigned int jobs,
+  bool isEmitTokens,
+  bool isEmitAST,
+  bool isEmitWAT,
+  bool isFastEmit,
+  OptimizationOptions optimization
+) {
+  shared_ptr<map<string, string>> filesByCapsuleName = CompilationSession::discoverCapsules();
+  shared_ptr<LinkedCapsuleCache> linkedCapsuleCache = make_shared<LinkedCapsuleCache>();
+
+  atomic<size_t> nextEntrypoint(0);
+  atomic<bool> allSucceeded(true);
+
+  auto worker = [&]() {
+    size_t i;
+
+    while ((i = nextEntrypoint++) < entrypointsWithOutputs.size()) {
+      shared_ptr<CompilationSession> session = make_shared<CompilationSession>(filesByCapsuleName, linkedCapsuleCache);
+      session->isEmitTokens = isEmitTokens;
+      session->isEmitAST = isEmitAST;
+      session->isEmitWAT = isEmitWAT;
+      session->isFastEmit = isFastEmit;
+      session->optimization = optimization;
+
+      try {
+        if (!compile(session, entrypointsWithOutputs[i].first, entrypointsWithOutputs[i].second)) allSucceeded = false;
+      } catch (const exception &e) {
+        lock_guard<mutex> lock(outputMutex);
+
+        cerr << "Failed to compile " + entrypointsWithOutputs[i].first + ": " + e.what() << endl;
+        allSucceeded = false;
+      }
+    }
+  };
+
+  unsigned int threadCount = max(1u, min(jobs, (unsigned int) entrypointsWithOutputs.size()));
+
+  vector<thread> threads;
+  for (unsigned int t = 1; t < threadCount; t++) {
+    threads.emplace_back(worker);
   }
 
-  writeModuleToFile(module, outputFile);
+  // The calling thread does its share of the work too, rather than sitting idle
+  worker();
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  return allSucceeded;
 }
 
-vector<char> Compiler::compileDirect(string source) {
-  shared_ptr<ASTNode> ast = buildAST(source, "ith");
+vector<char> Compiler::compileDirect(shared_ptr<CompilationSession> session, string source, string fileName) {
+  shared_ptr<ASTNode> ast = buildAST(session, source, fileName);
 
-  if (!optimizeAST(ast)) return {};
+  if (!optimizeAST(session, ast)) return {};
   
-  outputAST(ast, "ith");
+  outputAST(session, ast, fileName);
 
-  TypeChecker typeChecker;
+  TypeChecker typeChecker(session);
   bool isTypeValid = typeChecker.checkAST(ast);
 
-  for (int i = 0; i < encounteredExceptions.size(); i++) {
-    encounteredExceptions[i]->display();
+  {
+    lock_guard<mutex> lock(outputMutex);
+
+    Error::displayAll(session->getEncounteredExceptions());
   }
 
-  if (!isTypeValid) return {};
+  if (!isTypeValid || !optimizeTypedAST(session, ast)) return {};
 
-  CodeGen codeGen;
-  BinaryenModuleRef module = codeGen.generateWasmFromAST(ast);
-
-  return writeModuleToBuffer(module);
+  return generateWasm(session, ast, fileName);
 }
 
-shared_ptr<ASTNode> Compiler::buildAST(string file) {
-  std::ifstream t(file);
-  std::stringstream buffer;
-  buffer << t.rdbuf();
+vector<char> Compiler::generateWasm(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> ast, string fileName) {
+  if (session->isFastEmit) {
+    DirectCodeGen directCodeGen(session);
+    vector<char> buffer = directCodeGen.generateWasmFromAST(ast);
 
-  string fileSource = buffer.str();
+    if (session->isEmitWAT) {
+      // The direct emitter never builds a Binaryen module, so read the bytes back in just to print them
+      BinaryenModuleRef module = BinaryenModuleReadWithFeatures(buffer.data(), buffer.size(), BinaryenFeatureAll());
 
-  return buildAST(fileSource, file);
-}
+      lock_guard<mutex> lock(outputMutex);
 
-shared_ptr<ASTNode> Compiler::buildAST(string source, string fileName) {
-  Theta::Lexer lexer;
-  lexer.lex(source);
+      cout << "Generated WAT for \"" + fileName + "\":" << endl;
+      BinaryenModulePrint(module);
 
-  if (isEmitTokens) {
-    cout << "Lexed Tokens for \"" + fileName + "\":" << endl;
-    for (int i = 0; i < lexer.tokens.size(); i++) {
-      cout << lexer.tokens[i].toJSON() << endl;
+      BinaryenModuleDispose(module);
     }
-    cout << endl;
+
+    return buffer;
   }
 
-  Theta::Parser parser;
-  shared_ptr<Theta::ASTNode> parsedAST = parser.parse(lexer.tokens, source, fileName, filesByCapsuleName);
+  CodeGen codeGen(session);
+  BinaryenModuleRef module = codeGen.generateWasmFromAST(ast);
 
-  return parsedAST;
-}
+  bool isReportingOptimization = session->optimization.isTimingPasses || session->optimization.isShowingStatistics;
 
-void Compiler::addException(shared_ptr<Theta::Error> e) {
-  encounteredExceptions.push_back(e);
-}
+  // Only serialized up front when it's going to be reported, since writing the module out isn't free
+  size_t unoptimizedSize = isReportingOptimization ? writeModuleToBuffer(module).size() : 0;
+  double optimizeMilliseconds = optimizeModule(session, module);
 
-vector<shared_ptr<Theta::Error>> Compiler::getEncounteredExceptions() {
-  return encounteredExceptions;
-}
+  if (session->isEmitWAT) {
+    lock_guard<mutex> lock(outputMutex);
 
-void Compiler::clearExceptions() {
-  encounteredExceptions.clear();
-}
+    cout << "Generated WAT for \"" + fileName + "\":" << endl;
+    BinaryenModulePrint(module);
+  }
 
-shared_ptr<Theta::LinkNode> Compiler::getIfExistsParsedLinkAST(string capsuleName) {
-  auto it = parsedLinkASTs.find(capsuleName);
+  vector<char> buffer = writeModuleToBuffer(module);
 
-  if (it != parsedLinkASTs.end()) return it->second;
+  BinaryenModuleDispose(module);
 
-  return nullptr;
-}
+  if (isReportingOptimization) {
+    lock_guard<mutex> lock(outputMutex);
+
+    cout << "Binaryen optimization for \"" + fileName + "\":\n";
+
+    if (session->optimization.isTimingPasses) {
+      cout << "  " << left << setw(24) << "time" << right << fixed << setprecision(3) << setw(10) << optimizeMilliseconds
+        << " ms\n" << defaultfloat;
+    }
+
+    cout << "  " << left << setw(24) << "module size" << right << setw(10) << buffer.size() << " bytes, from "
+      << unoptimizedSize << "\n";
+  }
 
-void Compiler::addParsedLinkAST(string capsuleName, shared_ptr<Theta::LinkNode> linkNode) {
-  parsedLinkASTs.insert(make_pair(capsuleName, linkNode));
+  return buffer;
 }
 
-void Compiler::discoverCapsules() {
-  for (const auto& entry : std::filesystem::recursive_directory_iterator(".")) {
-    if (entry.is_regular_file() && entry.path().extension() == ".th") {
-      string capsuleName = findCapsuleName(entry.path().string());
+double Compiler::optimizeModule(shared_ptr<CompilationSession> session, BinaryenModuleRef &module) {
+  OptimizationOptions &optimization = session->optimization;
 
-      filesByCapsuleName->insert(make_pair(capsuleName, entry.path().string()));
-    }
+  if (optimization.level == O0 && optimization.wasmPasses.empty()) return 0;
+
+  // Entrypoints compiled in parallel all share Binaryen's settings, so they take turns optimizing. Binaryen spreads
+  // the work of each module across its own threads anyway
+  lock_guard<mutex> lock(binaryenOptionsMutex);
+
+  auto start = chrono::steady_clock::now();
+
+  // Binaryen only reads this when it starts its thread pool, on the first module it optimizes
+  if (optimization.wasmThreads > 0) setenv("BINARYEN_CORES", to_string(optimization.wasmThreads).c_str(), 1);
+
+  BinaryenSetOptimizeLevel(optimization.getWasmOptimizeLevel());
+  BinaryenSetShrinkLevel(optimization.getWasmShrinkLevel());
+
+  if (optimization.wasmPasses.empty()) {
+    BinaryenModuleOptimize(module);
+  } else {
+    vector<const char*> passNames;
+    for (auto &pass : optimization.wasmPasses) passNames.push_back(pass.c_str());
+
+    BinaryenModuleRunPasses(module, passNames.data(), passNames.size());
   }
+
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 }
 
-string Compiler::findCapsuleName(string file) {
-  std::ifstream t(file);
+vector<char> Compiler::compileToBuffer(shared_ptr<CompilationSession> session, string entrypoint) {
+  std::ifstream t(entrypoint);
   std::stringstream buffer;
-
   buffer << t.rdbuf();
 
-  string source = buffer.str();
+  return compileDirect(session, buffer.str(), entrypoint);
+}
 
-  int i = 0;
-  bool capsuleNameFound = false;
-  string capsuleName;
+shared_ptr<ASTNode> Compiler::buildAST(shared_ptr<CompilationSession> session, string file) {
+  std::ifstream t(file);
+  std::stringstream buffer;
+  buffer << t.rdbuf();
 
-  // TODO: This is probably better suited to live in the lexer as a callable function
-  // Iterate over the source but stop once we find a capsule
-  while (i + 6 < source.length() && !capsuleNameFound) {
-    if (source[i] == 'c' && source[i + 1] == 'a' && source[i + 2] == 'p' && source[i + 3] == 's' && source[i + 4] == 'u' && source[i + 5] == 'l' && source[i + 6] == 'e') {
-      capsuleNameFound = true;
-      i += 7;
-    }
+  string fileSource = buffer.str();
 
-    i++;
-  }
+  return buildAST(session, fileSource, file);
+}
 
-  if (capsuleNameFound) {
-    while (source[i] != '\n' && !isspace(source[i]) && source[i] != '{') {
-      capsuleName.push_back(source[i]);
+shared_ptr<ASTNode> Compiler::buildAST(shared_ptr<CompilationSession> session, string source, string fileName) {
+  Theta::Lexer lexer;
+  lexer.lex(source);
 
-      i++;
+  if (session->isEmitTokens) {
+    lock_guard<mutex> lock(outputMutex);
+
+    cout << "Lexed Tokens for \"" + fileName + "\":" << endl;
+    for (int i = 0; i < lexer.tokens.size(); i++) {
+      cout << lexer.tokens[i].toJSON() << endl;
     }
+    cout << endl;
   }
 
-  return capsuleName;
+  Theta::Parser parser;
+  shared_ptr<Theta::ASTNode> parsedAST = parser.parse(lexer.tokens, source, fileName, session);
+
+  return parsedAST;
 }
 
-bool Compiler::optimizeAST(shared_ptr<ASTNode> &ast, bool silenceErrors) {
-  for (auto &pass : optimizationPasses) {
-    pass->optimize(ast);
+bool Compiler::optimizeAST(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> &ast, bool silenceErrors) {
+  // Functions are matched to their profiled counts by hash, so the counts have to be recorded while the AST is still
+  // the one that was profiled
+  if (session->optimization.profile) session->optimization.profile->apply(ast);
 
-    if (encounteredExceptions.size() > 0) {
-      if (!silenceErrors) {
-        for (int i = 0; i < encounteredExceptions.size(); i++) {
-          encounteredExceptions[i]->display();
-        }
-      }
+  return runPasses(session, ast, BEFORE_TYPE_CHECKING, silenceErrors);
+}
 
-      pass->cleanup();
-      return false;
-    }
+bool Compiler::optimizeTypedAST(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> &ast) {
+  return runPasses(session, ast, AFTER_TYPE_CHECKING, false);
+}
+
+bool Compiler::runPasses(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> &ast, PassStage stage, bool silenceErrors) {
+  PassManager passManager(session, stage);
+
+  // -O0 has nothing to run after type checking, and there's no point reporting on an empty pipeline
+  if (passManager.getPipeline().empty()) return true;
+
+  bool isOptimized = passManager.run(ast);
 
-    pass->cleanup();
+  if (session->optimization.isTimingPasses || session->optimization.isShowingStatistics) {
+    lock_guard<mutex> lock(outputMutex);
+
+    if (session->optimization.isTimingPasses) passManager.displayTimings(cout);
+    if (session->optimization.isShowingStatistics) passManager.displayStatistics(cout);
   }
 
-  return true;
+  if (!isOptimized && !silenceErrors) {
+    lock_guard<mutex> lock(outputMutex);
+
+    Error::displayAll(session->getEncounteredExceptions());
+  }
+
+  return isOptimized;
 }
 
 vector<char> Compiler::writeModuleToBuffer(BinaryenModuleRef &module) {
-  vector<char> buffer(1024); // Start with 1KB buffer
-
-  size_t written = BinaryenModuleWrite(module, buffer.data(), buffer.size());
+  // Let Binaryen size the output itself, so the module only ever gets serialized once
+  BinaryenModuleAllocateAndWriteResult result = BinaryenModuleAllocateAndWrite(module, NULL);
 
-  // If the written size is equal to the buffer size, resize the buffer and try again
-  while (written == buffer.size()) {
-    buffer.resize(buffer.size() * 2);
-    
-    written = BinaryenModuleWrite(module, buffer.data(), buffer.size());
-  }
+  char* binary = static_cast<char*>(result.binary);
+  vector<char> buffer(binary, binary + result.binaryBytes);
 
-  buffer.resize(written);
+  free(result.binary);
 
   return buffer;
 }
 
-void Compiler::writeModuleToFile(BinaryenModuleRef &module, string fileName) {
-  vector<char> buffer = writeModuleToBuffer(module);
-
+void Compiler::writeBufferToFile(vector<char> &buffer, string fileName) {
   ofstream outFile(fileName, std::ios::binary);
   if (!outFile) {
     throw std::runtime_error("Failed to open file for writing: " + fileName);
@@ -220,11 +300,15 @@ void Compiler::writeModuleToFile(BinaryenModuleRef &module, string fileName) {
     throw std::runtime_error("Failed to write module to file: " + fileName);
   }
 
+  lock_guard<mutex> lock(outputMutex);
+
   cout << "Compilation successful. Output: " + fileName << endl;
 }
 
-void Compiler::outputAST(shared_ptr<ASTNode> ast, string fileName) {
-  if (ast && isEmitAST) {
+void Compiler::outputAST(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> ast, string fileName) {
+  lock_guard<mutex> lock(outputMutex);
+
+  if (ast && session->isEmitAST) {
     cout << "Generated AST for \"" + fileName + "\":" << endl;
     cout << ast->toJSON() << endl;
     cout << endl;
@@ -251,10 +335,11 @@ string Compiler::getQualifiedFunctionIdentifier(string variableName, shared_ptr<
   for (int i = 0; i < params.size(); i++) {
     if (node->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
       shared_ptr<TypeDeclarationNode> paramType = dynamic_pointer_cast<TypeDeclarationNode>(params.at(i)->getValue());
-      functionIdentifier += paramType->getType();
+      functionIdentifier += paramType ? paramType->getType() : DataTypes::UNKNOWN;
     } else {
+      // An argument can be left without a type by incomplete code, in which case no function will match it
       shared_ptr<TypeDeclarationNode> paramType = dynamic_pointer_cast<TypeDeclarationNode>(params.at(i)->getResolvedType());
-      functionIdentifier += paramType->getType();
+      functionIdentifier += paramType ? paramType->getType() : DataTypes::UNKNOWN;
     }
   }
 
@@ -342,40 +427,3 @@ shared_ptr<TypeDeclarationNode> Compiler::deepCopyTypeDeclaration(shared_ptr<Typ
 
   return copy;
 }
-
-string Compiler::resolveAbsolutePath(string relativePath) {
-  char path[PATH_MAX];
-
-  #ifdef __APPLE__
-    uint32_t size = sizeof(path);
-    if (_NSGetExecutablePath(path, &size) != 0) {
-      cerr << "Buffer too small; should be resized to " << size << " bytes\n" << endl;
-      return "";
-    }
-  #else
-    ssize_t count = readlink("/proc/self/exe", path, PATH_MAX);
-    if (count <= 0) {
-      cerr << "Failed to read the path of the executable." << endl;
-      return "";
-    }
-    path[count] = '\0'; // Ensure null termination
-  #endif
-
-  char realPath[PATH_MAX];
-  if (realpath(path, realPath) == NULL) {
-    cerr << "Error resolving symlink for " << path << endl;
-    return "";
-  }
-      
-  string exePath = string(realPath);
-  if (exePath.empty()) return "";
-
-  char *pathCStr = new char[exePath.size() + 1];
-  strcpy(pathCStr, exePath.c_str());
-
-  string dirPath = dirname(pathCStr); // Use dirname to get the directory part
-
-  delete[] pathCStr;
-
-  return dirPath + "/" + relativePath;
-}
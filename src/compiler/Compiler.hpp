@@ -9,101 +9,113 @@
 #include <iostream>
 #include <memory>
 #include <filesystem>
-#include <libgen.h>
+#include <mutex>
 #include <binaryen-c.h>
 #include "../parser/ast/ASTNode.hpp"
 #include "../parser/ast/LinkNode.hpp"
 #include "exceptions/Error.hpp"
+#include "CompilationSession.hpp"
 #include "TypeChecker.hpp"
 #include "CodeGen.hpp"
+#include "DirectCodeGen.hpp"
 #include "compiler/optimization/OptimizationPass.hpp"
 #include "compiler/optimization/LiteralInlinerPass.hpp"
+#include "compiler/optimization/PassManager.hpp"
 #include "parser/ast/TypeDeclarationNode.hpp"
 
 using namespace std;
 
 /**
- * @brief Singleton class responsible for compiling Theta source code into an Abstract Syntax Tree (AST).
+ * @brief Drives the compilation of Theta source code: building the AST, optimizing it, typechecking it, and generating
+ * WebAssembly from it. All per-compilation state lives in the CompilationSession that is passed in, so the compiler
+ * itself holds no state and independent compilations can safely run on separate threads.
  */
 namespace Theta {
   class Compiler {
   public:
     /**
-     * @brief Compiles the Theta source code starting from the specified entry point.
+     * @brief Compiles the Theta source code starting from the specified entry point. Output options such as whether
+     * tokens, the AST, or the generated WAT should be emitted are read from the session.
+     * @param session The compilation session to record state into
      * @param entrypoint The entry point file name or identifier.
      * @param outputFile The output file which will be the result of the compilation
+     * @return true If the compilation succeeded and the output file was written
+     */
+    static bool compile(shared_ptr<CompilationSession> session, string entrypoint, string outputFile);
+
+    /**
+     * @brief Compiles many entrypoints at once, each to its own output file. Capsules linked by more than one
+     * entrypoint are only parsed once and shared between them, and entrypoints are compiled in parallel.
+     * @param entrypointsWithOutputs Pairs of entry point file names and the output files they should be written to
+     * @param jobs The maximum number of entrypoints to compile at the same time
      * @param isEmitTokens Toggles whether or not the lexer tokens should be output to the console
      * @param isEmitAST Toggles whether or not the AST should be output to the console
-     */
-    void compile(string entrypoint, string outputFile, bool isEmitTokens = false, bool isEmitAST = false, bool isEmitWAT = false);
+     * @param isEmitWAT Toggles whether or not the generated WAT should be output to the console
+     * @param isFastEmit Toggles whether wasm should be emitted directly, skipping Binaryen
+     * @param optimization The optimization options every entrypoint is compiled with
+     * @return true If every entrypoint compiled successfully
+     */
+    static bool compileBatch(
+      vector<pair<string, string>> entrypointsWithOutputs,
+      unsigned int jobs,
+      bool isEmitTokens = false,
+      bool isEmitAST = false,
+      bool isEmitWAT = false,
+      bool isFastEmit = false,
+      OptimizationOptions optimization = OptimizationOptions()
+    );
 
     /**
      * @brief Compiles the Theta source code starting from the specified entry point.
+     * @param session The compilation session to record state into
      * @param source The source code to compile.
-     * @return A buffer containing the compiled WASM module
+     * @param fileName The file name that errors and emitted output should be attributed to
+     * @return A buffer containing the compiled WASM module, or an empty buffer if compilation failed
      */
-    vector<char> compileDirect(string source);
+    static vector<char> compileDirect(shared_ptr<CompilationSession> session, string source, string fileName = "ith");
+
+    /**
+     * @brief Compiles the Theta source code in the given entry point file into an in-memory buffer, without writing
+     * anything to disk.
+     * @param session The compilation session to record state into
+     * @param entrypoint The entry point file name
+     * @return A buffer containing the compiled WASM module, or an empty buffer if compilation failed
+     */
+    static vector<char> compileToBuffer(shared_ptr<CompilationSession> session, string entrypoint);
 
     /**
      * @brief Builds the Abstract Syntax Tree (AST) for the Theta source code starting from the specified file.
+     * @param session The compilation session to record state into
      * @param fileName The file name of the Theta source code.
      * @return A shared pointer to the root node of the constructed AST.
      */
-    shared_ptr<Theta::ASTNode> buildAST(string fileName);
+    static shared_ptr<Theta::ASTNode> buildAST(shared_ptr<CompilationSession> session, string fileName);
 
     /**
      * @brief Builds the Abstract Syntax Tree (AST) for the Theta source code provided.
+     * @param session The compilation session to record state into
      * @param source The source code to compile.
      * @param fileName The file name of the Theta source code.
      * @return A shared pointer to the root node of the constructed AST.
      */
-    shared_ptr<Theta::ASTNode> buildAST(string source, string fileName);
+    static shared_ptr<Theta::ASTNode> buildAST(shared_ptr<CompilationSession> session, string source, string fileName);
 
     /**
-     * @brief Gets the singleton instance of the Compiler.
-     * @return Reference to the singleton instance of Compiler.
-     */
-    static Compiler& getInstance();
-
-    /**
-     * @brief Adds an encountered exception to the list of exceptions to display later
-     * @param e The exception to add
-     */
-    void addException(shared_ptr<Theta::Error> e);
-
-    /**
-     * @brief Returns all the exceptions we encountered during the compilation process
-     * @return A vector of compilation errors
-     */
-    vector<shared_ptr<Theta::Error>> getEncounteredExceptions();
-
-    /**
-     * @brief Clears the list of compilation errors
-     */
-    void clearExceptions();
-
-    /**
-     * @brief Returns a LinkNode for a given capsule name, if it exists
-     * @param capsuleName The name of the capsule
-     * @return A shared pointer to the LinkNode containing the parsed AST
+     * @brief Runs the optimization passes selected by the session's optimization options on the AST (in-place)
+     * @param session The compilation session to record errors into
+     * @param The AST to optimize
+     * @return true If all optimization passes succeeded
      */
-    shared_ptr<Theta::LinkNode> getIfExistsParsedLinkAST(string capsuleName);
+    static bool optimizeAST(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> &ast, bool silenceErrors = false);
 
     /**
-     * @brief Adds a LinkNode to the map of parsed capsule ASTs
-     * @param capsuleName The name of the capsule
-     * @param linkNode A shared pointer to the LinkNode to add
-     */
-    void addParsedLinkAST(string capsuleName, shared_ptr<Theta::LinkNode> linkNode);
-    
-    /**
-     * @brief Runs optimization passes on the AST (in-place)
-     * @param The AST to optimize
+     * @brief Runs the optimization passes that need a type checked AST on it (in-place), just before code generation
+     * @param session The compilation session to record errors into
+     * @param The type checked AST to optimize
      * @return true If all optimization passes succeeded
      */
-    bool optimizeAST(shared_ptr<ASTNode> &ast, bool silenceErrors = false);
+    static bool optimizeTypedAST(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> &ast);
 
-    
     /**
      * @brief Generates a unique function identifier based on the function's name and its parameters to handle overloading.
      * 
@@ -142,64 +154,56 @@ namespace Theta {
 
     static vector<char> writeModuleToBuffer(BinaryenModuleRef &module);
 
-    shared_ptr<map<string, string>> filesByCapsuleName;
-
-    static string resolveAbsolutePath(string relativePath);
   private:
+    Compiler() = delete;
+
     /**
-     * @brief Private constructor for Compiler. Initializes the compiler and discovers all capsules in the source files.
+     * @brief Guards console output so that messages from entrypoints compiled in parallel don't interleave
      */
-    Compiler() {
-      filesByCapsuleName = make_shared<map<string, string>>();
-      discoverCapsules();
-
-      optimizationPasses = {
-        make_shared<LiteralInlinerPass>()
-      };
-    }
+    static mutex outputMutex;
 
-    // Delete copy constructor and assignment operator to enforce singleton pattern
-    Compiler(const Compiler&) = delete;
-    Compiler& operator=(const Compiler&) = delete;
-
-
-    bool isEmitTokens = false;
-    bool isEmitAST = false;
-    bool isEmitWAT = false;
-    vector<shared_ptr<Theta::Error>> encounteredExceptions;
-    map<string, shared_ptr<Theta::LinkNode>> parsedLinkASTs;
+    /**
+     * @brief Generates the WASM binary for a typechecked AST, using the direct emitter if the session asks for fast
+     * emission and Binaryen otherwise. Prints the generated WAT if the session asks for it.
+     * @param session The compilation session, which determines the backend and whether WAT should be emitted
+     * @param ast The typechecked AST to generate code for
+     * @param fileName The filename the AST came from, used when printing the WAT
+     * @return The encoded WASM module
+     */
+    static vector<char> generateWasm(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> ast, string fileName);
 
-    vector<shared_ptr<OptimizationPass>> optimizationPasses; 
+    /**
+     * @brief Guards Binaryen's optimization settings, which it keeps in globals rather than per module
+     */
+    static mutex binaryenOptionsMutex;
 
     /**
-     * @brief Outputs the contents of a given WASM module to the given file
-     * @param module The module to write
-     * @param file The filename to write the module to
+     * @brief Runs Binaryen's optimizer over a generated module, with the pipeline the session's optimization level
+     * picks, or the passes given to --wasm-passes=
+     * @return How long Binaryen took, in milliseconds
      */
-    void writeModuleToFile(BinaryenModuleRef &module, string file);
+    static double optimizeModule(shared_ptr<CompilationSession> session, BinaryenModuleRef &module);
 
     /**
-     * @brief Discovers all capsules in the Theta source code.
-     *
-     * Scans the current directory and subdirectories to find all `.th` files and extracts capsule names.
+     * @brief Runs the pipeline of passes for one stage of compilation, and prints the timings and statistics the
+     * session asks for
+     * @return true If all optimization passes succeeded
      */
-    void discoverCapsules();
+    static bool runPasses(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> &ast, PassStage stage, bool silenceErrors);
 
     /**
-     * @brief Finds the capsule name associated with the given file.
-     *
-     * Reads the content of the file and searches for the `capsule` keyword to identify the capsule name.
-     *
-     * @param file The file for which to find the capsule name.
-     * @return The capsule name corresponding to the file.
+     * @brief Outputs an encoded WASM module to the given file
+     * @param buffer The encoded module to write
+     * @param file The filename to write the module to
      */
-    string findCapsuleName(string file);
+    static void writeBufferToFile(vector<char> &buffer, string file);
 
     /**
      * @brief Outputs a given AST to STDOUT
+     * @param session The compilation session, which determines whether the AST should be emitted
      * @param ast The AST to output
      * @param fileName The filename that appears as the "Source file" for the ast
      */
-    void outputAST(shared_ptr<ASTNode> ast, string fileName);
+    static void outputAST(shared_ptr<CompilationSession> session, shared_ptr<ASTNode> ast, string fileName);
   };
 }
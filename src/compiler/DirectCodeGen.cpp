@@ -0,0 +1,1219 @@
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "compiler/Compiler.hpp"
+#include "compiler/TypeChecker.hpp"
+#include "compiler/CodeGen.hpp"
+#include "lexer/Lexemes.hpp"
+#include "DirectCodeGen.hpp"
+#include "DataTypes.hpp"
+#include "ThetaLangCoreWasm.hpp"
+
+#pragma push_macro("RETURN")
+#undef RETURN
+
+using namespace Theta;
+
+namespace {
+  // Opcodes from the WebAssembly binary format, only the ones we actually emit
+  enum Opcode : uint8_t {
+    UNREACHABLE = 0x00,
+    IF = 0x04,
+    ELSE = 0x05,
+    END = 0x0B,
+    RETURN = 0x0F,
+    CALL = 0x10,
+    CALL_INDIRECT = 0x11,
+    DROP = 0x1A,
+    LOCAL_GET = 0x20,
+    LOCAL_SET = 0x21,
+    TABLE_GET = 0x25,
+    TABLE_SET = 0x26,
+    I32_LOAD = 0x28,
+    I64_LOAD = 0x29,
+    I32_STORE = 0x36,
+    I64_STORE = 0x37,
+    I32_CONST = 0x41,
+    I64_CONST = 0x42,
+    I32_EQZ = 0x45,
+    I32_EQ = 0x46,
+    I32_NE = 0x47,
+    I64_EQZ = 0x50,
+    I64_EQ = 0x51,
+    I64_NE = 0x52,
+    I64_LT_S = 0x53,
+    I64_GT_S = 0x55,
+    I64_LE_S = 0x57,
+    I64_GE_S = 0x59,
+    I64_ADD = 0x7C,
+    I64_SUB = 0x7D,
+    I64_MUL = 0x7E,
+    I64_DIV_S = 0x7F,
+    I64_REM_S = 0x81,
+    GC_PREFIX = 0xFB
+  };
+
+  // Stringref instructions live behind the GC prefix, followed by a LEB encoded sub-opcode
+  enum StringOpcode : uint32_t {
+    STRING_CONST = 0x82,
+    STRING_CONCAT = 0x88,
+    STRING_EQ = 0x89
+  };
+
+  enum Section : uint8_t {
+    TYPE_SECTION = 1,
+    FUNCTION_SECTION = 3,
+    TABLE_SECTION = 4,
+    MEMORY_SECTION = 5,
+    EXPORT_SECTION = 7,
+    ELEMENT_SECTION = 9,
+    CODE_SECTION = 10,
+    STRINGS_SECTION = 14
+  };
+
+  const uint8_t FUNC_TYPE = 0x60;
+  const uint8_t FUNCREF_TYPE = 0x70;
+  const uint8_t EMPTY_BLOCK_TYPE = 0x40;
+  const uint8_t EXPORT_KIND_FUNC = 0x00;
+  const uint8_t EXPORT_KIND_MEMORY = 0x02;
+
+  /**
+   * @brief Reads an unsigned LEB128 encoded integer, advancing the offset past it
+   */
+  uint32_t readU32(const unsigned char* bytes, size_t &offset) {
+    uint32_t value = 0;
+    int shift = 0;
+
+    while (true) {
+      uint8_t byte = bytes[offset++];
+      value |= (uint32_t) (byte & 0x7f) << shift;
+
+      if ((byte & 0x80) == 0) return value;
+
+      shift += 7;
+    }
+  }
+}
+
+vector<char> DirectCodeGen::generateWasmFromAST(shared_ptr<ASTNode> ast) {
+  generate(ast);
+
+  return serializeModule();
+}
+
+DirectCodeGen::Expression DirectCodeGen::generate(shared_ptr<ASTNode> node) {
+  if (node->hasOwnScope()) {
+    scope.enterScope();
+    scopeReferences.enterScope();
+  }
+
+  // Scopes are entered and exited in exactly the same places as in CodeGen, so that identifiers and local indices
+  // resolve identically between the two
+  if (node->getNodeType() == ASTNode::SOURCE) {
+    generateSource(dynamic_pointer_cast<SourceNode>(node));
+  } else if (node->getNodeType() == ASTNode::CAPSULE) {
+    generateCapsule(dynamic_pointer_cast<CapsuleNode>(node));
+  } else if (node->getNodeType() == ASTNode::ASSIGNMENT) {
+    return generateAssignment(dynamic_pointer_cast<AssignmentNode>(node));
+  } else if (node->getNodeType() == ASTNode::BLOCK) {
+    return generateBlock(dynamic_pointer_cast<ASTNodeList>(node));
+  } else if (node->getNodeType() == ASTNode::RETURN) {
+    return generateReturn(dynamic_pointer_cast<ReturnNode>(node));
+  } else if (node->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+    return generateClosureFunctionDeclaration(dynamic_pointer_cast<FunctionDeclarationNode>(node));
+  } else if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+    return generateFunctionInvocation(dynamic_pointer_cast<FunctionInvocationNode>(node));
+  } else if (node->getNodeType() == ASTNode::CONTROL_FLOW) {
+    return generateControlFlow(dynamic_pointer_cast<ControlFlowNode>(node));
+  } else if (node->getNodeType() == ASTNode::IDENTIFIER) {
+    return generateIdentifier(dynamic_pointer_cast<IdentifierNode>(node));
+  } else if (node->getNodeType() == ASTNode::BINARY_OPERATION) {
+    return generateBinaryOperation(dynamic_pointer_cast<BinaryOperationNode>(node));
+  } else if (node->getNodeType() == ASTNode::UNARY_OPERATION) {
+    return generateUnaryOperation(dynamic_pointer_cast<UnaryOperationNode>(node));
+  } else if (node->getNodeType() == ASTNode::NUMBER_LITERAL) {
+    return generateNumberLiteral(dynamic_pointer_cast<LiteralNode>(node));
+  } else if (node->getNodeType() == ASTNode::STRING_LITERAL) {
+    return generateStringLiteral(dynamic_pointer_cast<LiteralNode>(node));
+  } else if (node->getNodeType() == ASTNode::BOOLEAN_LITERAL) {
+    return generateBooleanLiteral(dynamic_pointer_cast<LiteralNode>(node));
+  }
+
+  if (node->hasOwnScope()) {
+    scope.exitScope();
+    scopeReferences.exitScope();
+  }
+
+  return Expression();
+}
+
+void DirectCodeGen::generateCapsule(shared_ptr<CapsuleNode> capsuleNode) {
+  vector<shared_ptr<ASTNode>> capsuleElements = dynamic_pointer_cast<ASTNodeList>(capsuleNode->getValue())->getElements();
+
+  hoistCapsuleElements(capsuleElements);
+
+  for (auto elem : capsuleElements) {
+    string elemType = dynamic_pointer_cast<TypeDeclarationNode>(elem->getResolvedType())->getType();
+    if (elem->getNodeType() != ASTNode::ASSIGNMENT) continue;
+
+    string identifier = dynamic_pointer_cast<IdentifierNode>(elem->getLeft())->getIdentifier();
+
+    if (elemType == DataTypes::FUNCTION) {
+      generateFunctionDeclaration(identifier, dynamic_pointer_cast<FunctionDeclarationNode>(elem->getRight()), true);
+    } else {
+      shared_ptr<ASTNode> assignmentRhs = elem->getRight();
+      assignmentRhs->setMappedBinaryenIndex(-1); //Index of -1 means its a global
+      scope.insert(identifier, assignmentRhs);
+
+      // Capsule level values have no module globals to live in, so there is nothing to store the value into
+      generate(assignmentRhs);
+    }
+  }
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateAssignment(shared_ptr<AssignmentNode> assignmentNode) {
+  string assignmentIdentifier = dynamic_pointer_cast<IdentifierNode>(assignmentNode->getLeft())->getIdentifier();
+
+  shared_ptr<LiteralNode> currentIdentIdx = dynamic_pointer_cast<LiteralNode>(scope.lookup(LOCAL_IDX_SCOPE_KEY).value());
+  int idxOfAssignment = stoi(currentIdentIdx->getLiteralValue());
+
+  currentIdentIdx->setLiteralValue(to_string(idxOfAssignment + 1));
+  scope.insert(LOCAL_IDX_SCOPE_KEY, currentIdentIdx);
+
+  bool isLastInBlock = CodeGen::checkIsLastInBlock(assignmentNode);
+
+  if (assignmentNode->getRight()->getNodeType() != ASTNode::FUNCTION_DECLARATION) {
+    shared_ptr<ASTNode> assignmentRhs = assignmentNode->getRight();
+    assignmentRhs->setMappedBinaryenIndex(idxOfAssignment);
+
+    string identName = assignmentIdentifier;
+    shared_ptr<TypeDeclarationNode> rhsResolvedType = dynamic_pointer_cast<TypeDeclarationNode>(assignmentNode->getRight()->getResolvedType());
+
+    if (
+      assignmentNode->getRight()->getNodeType() == ASTNode::FUNCTION_INVOCATION &&
+      rhsResolvedType->getType() == DataTypes::FUNCTION
+    ) {
+      identName = Compiler::getQualifiedFunctionIdentifier(identName, rhsResolvedType);
+    }
+
+    scope.insert(identName, assignmentRhs);
+
+    if (isLastInBlock) return generate(assignmentRhs);
+
+    Expression value = generate(assignmentRhs);
+    value.code.writeByte(LOCAL_SET);
+    value.code.writeU32(idxOfAssignment);
+    value.type = value.type == WasmType::Unreachable ? WasmType::Unreachable : WasmType::None;
+
+    return value;
+  }
+
+  return generateClosureFunctionDeclaration(
+    dynamic_pointer_cast<FunctionDeclarationNode>(assignmentNode->getRight()),
+    [idxOfAssignment, isLastInBlock](Expression addressRefExpression) {
+      if (isLastInBlock) return addressRefExpression;
+
+      addressRefExpression.code.writeByte(LOCAL_SET);
+      addressRefExpression.code.writeU32(idxOfAssignment);
+      addressRefExpression.type = WasmType::None;
+
+      return addressRefExpression;
+    },
+    make_optional(make_pair(assignmentIdentifier, idxOfAssignment))
+  );
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateClosureFunctionDeclaration(
+  shared_ptr<FunctionDeclarationNode> function,
+  std::function<Expression(Expression)> returnValueFormatter,
+  optional<pair<string, int>> assignmentIdentifierPair
+) {
+  shared_ptr<FunctionDeclarationNode> simplifiedDeclaration = CodeGen::liftLambda(function, scope);
+
+  string simplifiedDeclarationHash = CodeGen::generateFunctionHash(simplifiedDeclaration);
+
+  generateFunctionDeclaration(simplifiedDeclarationHash, simplifiedDeclaration);
+
+  string globalQualifiedFunctionName = Compiler::getQualifiedFunctionIdentifier(
+    simplifiedDeclarationHash,
+    simplifiedDeclaration
+  );
+
+  if (assignmentIdentifierPair) {
+    simplifiedDeclaration->setMappedBinaryenIndex(assignmentIdentifierPair->second);
+
+    string localQualifiedFunctionName = Compiler::getQualifiedFunctionIdentifier(
+      assignmentIdentifierPair->first,
+      function
+    );
+
+    scope.insert(globalQualifiedFunctionName, simplifiedDeclaration);
+    scopeReferences.insert(localQualifiedFunctionName, globalQualifiedFunctionName);
+    scopeReferences.insert(assignmentIdentifierPair->first, globalQualifiedFunctionName);
+  }
+
+  pair<WasmClosure, vector<Expression>> storage = generateAndStoreClosure(
+    globalQualifiedFunctionName,
+    simplifiedDeclaration,
+    function
+  );
+
+  vector<Expression> expressions = storage.second;
+
+  // Returns a reference to the closure memory address
+  expressions.push_back(returnValueFormatter(makeConstInt32(storage.first.getPointer().getAddress())));
+
+  return makeBlock(expressions);
+}
+
+pair<WasmClosure, vector<DirectCodeGen::Expression>> DirectCodeGen::generateAndStoreClosure(
+  string qualifiedReferenceFunctionName,
+  shared_ptr<FunctionDeclarationNode> simplifiedReference,
+  shared_ptr<FunctionDeclarationNode> originalReference
+) {
+  Pointer referencePtr = functionNameToClosureTemplateMap.find(qualifiedReferenceFunctionName)->second.getFunctionPointer();
+  set<string> originalParameters;
+
+  for (auto param : originalReference->getParameters()->getElements()) {
+    originalParameters.insert(dynamic_pointer_cast<IdentifierNode>(param)->getIdentifier());
+  }
+
+  vector<Expression> expressions;
+  vector<Pointer<PointerType::Data>> argPointers;
+
+  for (auto param : simplifiedReference->getParameters()->getElements()) {
+    string paramName = dynamic_pointer_cast<IdentifierNode>(param)->getIdentifier();
+
+    if (originalParameters.find(paramName) != originalParameters.end()) continue;
+
+    shared_ptr<ASTNode> paramValue = scope.lookup(paramName).value();
+    shared_ptr<TypeDeclarationNode> paramType = dynamic_pointer_cast<TypeDeclarationNode>(param->getValue());
+
+    Expression generatedValue = generate(paramValue);
+    if (paramType->getType() == DataTypes::STRING) {
+      Expression tableSet = makeConstInt32(stringRefOffset);
+      tableSet.code.append(generatedValue.code);
+      tableSet.code.writeByte(TABLE_SET);
+      tableSet.code.writeU32(STRINGREF_TABLE_IDX);
+      tableSet.type = WasmType::None;
+
+      expressions.push_back(tableSet);
+
+      argPointers.push_back(Pointer<PointerType::Data>(stringRefOffset));
+
+      stringRefOffset += 1;
+    } else {
+      int byteSize = CodeGen::getByteSizeForType(paramType);
+
+      expressions.push_back(makeStore(
+        0,
+        getWasmStorageTypeFromTypeDeclaration(paramType),
+        makeConstInt32(memoryOffset),
+        generatedValue
+      ));
+
+      argPointers.push_back(Pointer<PointerType::Data>(memoryOffset));
+
+      memoryOffset += byteSize;
+    }
+  }
+
+  WasmClosure closure = WasmClosure(
+    referencePtr,
+    simplifiedReference->getParameters()->getElements().size(),
+    argPointers
+  );
+
+  vector<Expression> storageExpressions = generateClosureMemoryStore(closure);
+
+  copy(storageExpressions.begin(), storageExpressions.end(), back_inserter(expressions));
+
+  return make_pair(closure, expressions);
+}
+
+void DirectCodeGen::generateFunctionDeclaration(
+  string identifier,
+  shared_ptr<FunctionDeclarationNode> fnDeclNode,
+  bool addToExports
+) {
+  scope.enterScope();
+  scopeReferences.enterScope();
+  int totalParams = fnDeclNode->getParameters()->getElements().size();
+
+  scope.insert(LOCAL_IDX_SCOPE_KEY, make_shared<LiteralNode>(ASTNode::NUMBER_LITERAL, to_string(totalParams), nullptr));
+
+  FunctionSignature signature;
+
+  for (int i = 0; i < totalParams; i++) {
+    shared_ptr<IdentifierNode> identNode = dynamic_pointer_cast<IdentifierNode>(fnDeclNode->getParameters()->getElements().at(i));
+
+    identNode->setMappedBinaryenIndex(i);
+
+    scope.insert(identNode->getIdentifier(), identNode);
+    signature.params.push_back(getWasmTypeFromTypeDeclaration(
+      dynamic_pointer_cast<TypeDeclarationNode>(fnDeclNode->getParameters()->getElements().at(i)->getValue())
+    ));
+  }
+
+  signature.result = getWasmTypeFromTypeDeclaration(TypeChecker::getFunctionReturnType(fnDeclNode));
+
+  vector<WasmType> localVariableTypes;
+  for (auto localVariable : Compiler::findAllInTree(fnDeclNode->getDefinition(), ASTNode::ASSIGNMENT)) {
+    localVariableTypes.push_back(getWasmTypeFromTypeDeclaration(
+      dynamic_pointer_cast<TypeDeclarationNode>(localVariable->getResolvedType())
+    ));
+  }
+
+  string functionName = Compiler::getQualifiedFunctionIdentifier(identifier, dynamic_pointer_cast<ASTNode>(fnDeclNode));
+
+  addFunction(functionName, signature, localVariableTypes, generate(fnDeclNode->getDefinition()));
+
+  // Only add to the closure template map if its not already in there. It may have been added during hoisting
+  if (functionNameToClosureTemplateMap.find(functionName) == functionNameToClosureTemplateMap.end()) {
+    functionNameToClosureTemplateMap.insert(make_pair(
+      functionName,
+      WasmClosure(
+        Pointer<PointerType::Function>(functionNameToClosureTemplateMap.size()),
+        totalParams
+      )
+    ));
+  }
+
+  if (addToExports) exportedFunctions.push_back(functionName);
+
+  scope.exitScope();
+  scopeReferences.exitScope();
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateBlock(shared_ptr<ASTNodeList> blockNode) {
+  vector<Expression> expressions;
+
+  for (auto elem : blockNode->getElements()) {
+    expressions.push_back(generate(elem));
+  }
+
+  return makeBlock(expressions);
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateReturn(shared_ptr<ReturnNode> returnNode) {
+  Expression returnExpr = generate(returnNode->getValue());
+  returnExpr.code.writeByte(RETURN);
+  returnExpr.type = WasmType::Unreachable;
+
+  return returnExpr;
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateFunctionInvocation(shared_ptr<FunctionInvocationNode> funcInvNode) {
+  string funcInvIdentifier = dynamic_pointer_cast<IdentifierNode>(funcInvNode->getIdentifier())->getIdentifier();
+
+  string scopeLookupIdentifier = Compiler::getQualifiedFunctionIdentifier(funcInvIdentifier, funcInvNode);
+
+  auto localReference = scopeReferences.lookup(scopeLookupIdentifier);
+  if (localReference) {
+    scopeLookupIdentifier = localReference.value();
+  }
+
+  auto foundLocalReference = scope.lookup(scopeLookupIdentifier);
+
+  if (!foundLocalReference) {
+    throw runtime_error("Could not find reference for function invocation: " + scopeLookupIdentifier);
+  }
+
+  string funcInvName = Compiler::getQualifiedFunctionIdentifier(funcInvIdentifier, funcInvNode);
+
+  if (foundLocalReference.value()->getNodeType() == ASTNode::FUNCTION_INVOCATION || funcInvName != scopeLookupIdentifier) {
+    return generateCallIndirectForExistingClosure(funcInvNode, foundLocalReference.value(), scopeLookupIdentifier);
+  }
+
+  return generateCallIndirectForNewClosure(funcInvNode, foundLocalReference.value(), scopeLookupIdentifier);
+}
+
+vector<Pointer<PointerType::Data>> DirectCodeGen::generateFunctionInvocationArgMemoryInsertions(
+  shared_ptr<FunctionInvocationNode> funcInvNode,
+  vector<Expression> &expressions,
+  string refIdentifier
+) {
+  vector<Pointer<PointerType::Data>> paramMemPointers;
+
+  for (shared_ptr<ASTNode> arg : funcInvNode->getParameters()->getElements()) {
+    shared_ptr<TypeDeclarationNode> argType = dynamic_pointer_cast<TypeDeclarationNode>(arg->getResolvedType());
+
+    Expression generatedValue = generate(arg);
+    Pointer<PointerType::Data> addressToPopulate;
+    if (argType->getType() == DataTypes::STRING) {
+      addressToPopulate = Pointer<PointerType::Data>(stringRefOffset);
+
+      stringRefOffset += 1;
+
+      Expression tableSet = makeConstInt32(addressToPopulate.getAddress());
+      tableSet.code.append(generatedValue.code);
+      tableSet.code.writeByte(TABLE_SET);
+      tableSet.code.writeU32(STRINGREF_TABLE_IDX);
+      tableSet.type = WasmType::None;
+
+      expressions.push_back(tableSet);
+    } else {
+      addressToPopulate = Pointer<PointerType::Data>(memoryOffset);
+      int argByteSize = CodeGen::getByteSizeForType(argType);
+
+      memoryOffset += argByteSize;
+
+      expressions.push_back(makeStore(
+        0,
+        getWasmStorageTypeFromTypeDeclaration(argType),
+        makeConstInt32(addressToPopulate.getAddress()),
+        generatedValue
+      ));
+    }
+
+    paramMemPointers.push_back(addressToPopulate);
+
+    // If a refIdentifier was passed, that means we have an existing closure in memory that we want to populate.
+    if (refIdentifier != "") {
+      Expression populateCall = makeLocalGet(scope.lookup(refIdentifier).value()->getMappedBinaryenIndex(), WasmType::I32);
+      populateCall.code.append(makeConstInt32(addressToPopulate.getAddress()).code);
+      populateCall.code.writeByte(CALL);
+      populateCall.code.writeU32(POPULATE_CLOSURE_FN_IDX);
+      populateCall.type = WasmType::None;
+
+      expressions.push_back(populateCall);
+    }
+  }
+
+  return paramMemPointers;
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateCallIndirectForExistingClosure(
+  shared_ptr<FunctionInvocationNode> funcInvNode,
+  shared_ptr<ASTNode> reference,
+  string refIdentifier
+) {
+  vector<Expression> expressions;
+
+  generateFunctionInvocationArgMemoryInsertions(funcInvNode, expressions, refIdentifier);
+
+  FunctionSignature signature = (reference->getNodeType() == ASTNode::FUNCTION_INVOCATION
+    ? getDerivedFunctionSignature(funcInvNode, dynamic_pointer_cast<FunctionInvocationNode>(reference))
+    : getFunctionSignature(dynamic_pointer_cast<FunctionDeclarationNode>(reference))
+  );
+
+  int closureLocalIdx = scope.lookup(refIdentifier).value()->getMappedBinaryenIndex();
+  int arity = signature.params.size();
+
+  // Loads every argument out of the closure, last parameter first, the same order CodeGen uses
+  vector<Expression> loadArgsExpressions(arity);
+  for (int i = arity - 1; i >= 0; i--) {
+    WasmType argType = signature.params[i];
+
+    Expression loadArgPointerExpr = makeLoad(4, 8 + i * 4, WasmType::I32, makeLocalGet(closureLocalIdx, WasmType::I32));
+
+    Expression loadArgExpression;
+    if (argType == WasmType::Stringref) {
+      loadArgExpression = loadArgPointerExpr;
+      loadArgExpression.code.writeByte(TABLE_GET);
+      loadArgExpression.code.writeU32(STRINGREF_TABLE_IDX);
+      loadArgExpression.type = WasmType::Stringref;
+    } else {
+      loadArgExpression = makeLoad(getByteSizeForType(argType), 0, argType, loadArgPointerExpr);
+    }
+
+    loadArgsExpressions[arity - 1 - i] = loadArgExpression;
+  }
+
+  Expression defaultReturnValue;
+  if (signature.result == WasmType::I32) {
+    defaultReturnValue = makeConstInt32(-1);
+  } else if (signature.result == WasmType::I64) {
+    defaultReturnValue = makeConstInt64(-1);
+  } else {
+    defaultReturnValue = makeStringConst("");
+  }
+
+  // If the closure's remaining arity has hit 0, we can call_indirect
+  Expression arityCheck = makeLoad(4, 4, WasmType::I32, makeLocalGet(closureLocalIdx, WasmType::I32));
+  arityCheck.code.writeByte(I32_EQZ);
+
+  expressions.push_back(makeIf(
+    arityCheck,
+    makeCallIndirect(
+      makeLoad(4, 0, WasmType::I32, makeLocalGet(closureLocalIdx, WasmType::I32)),
+      loadArgsExpressions,
+      signature
+    ),
+    defaultReturnValue
+  ));
+
+  return makeBlock(expressions);
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateCallIndirectForNewClosure(
+  shared_ptr<FunctionInvocationNode> funcInvNode,
+  shared_ptr<ASTNode> ref,
+  string refIdentifier
+) {
+  WasmClosure closureTemplate = functionNameToClosureTemplateMap.find(refIdentifier)->second;
+  vector<Expression> expressions;
+
+  if (funcInvNode->getParameters()->getElements().size() == closureTemplate.getArity()) {
+    vector<Expression> operands;
+
+    for (int i = 0; i < closureTemplate.getArity(); i++) {
+      operands.push_back(generate(funcInvNode->getParameters()->getElements().at(i)));
+    }
+
+    expressions.push_back(makeCallIndirect(
+      makeConstInt32(closureTemplate.getFunctionPointer().getAddress()),
+      operands,
+      getFunctionSignature(dynamic_pointer_cast<FunctionDeclarationNode>(ref))
+    ));
+  } else {
+    WasmClosure closure = WasmClosure::clone(closureTemplate);
+    vector<Pointer<PointerType::Data>> paramMemPointers = generateFunctionInvocationArgMemoryInsertions(
+      funcInvNode,
+      expressions
+    );
+
+    closure.addArgs(paramMemPointers);
+
+    vector<Expression> storageExpressions = generateClosureMemoryStore(closure);
+    copy(storageExpressions.begin(), storageExpressions.end(), back_inserter(expressions));
+
+    expressions.push_back(makeConstInt32(closure.getPointer().getAddress()));
+  }
+
+  return makeBlock(expressions);
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateControlFlow(shared_ptr<ControlFlowNode> controlFlowNode) {
+  optional<Expression> expr;
+
+  // Else-ifs are merged into nested else blocks that have ifs inside of them, see CodeGen::generateControlFlow
+  for (int i = controlFlowNode->getConditionExpressionPairs().size() - 1; i >= 0; i--) {
+    pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>> cndExprPair = controlFlowNode->getConditionExpressionPairs().at(i);
+
+    if (cndExprPair.first == nullptr) {
+      expr = generate(cndExprPair.second);
+      continue;
+    }
+
+    Expression condition = generate(cndExprPair.first);
+    Expression body = generate(cndExprPair.second);
+
+    expr = makeIf(condition, body, expr);
+  }
+
+  return expr.value_or(Expression());
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateIdentifier(shared_ptr<IdentifierNode> identNode) {
+  string identName = identNode->getIdentifier();
+  optional<string> scopeRef = scopeReferences.lookup(identName);
+
+  if (scopeRef) {
+    identName = scopeRef.value();
+  }
+
+  shared_ptr<ASTNode> identInScope = scope.lookup(identName).value();
+
+  // The ident in this case may refer to a parameter to a function, which may not have a resolvedType
+  shared_ptr<TypeDeclarationNode> type = dynamic_pointer_cast<TypeDeclarationNode>(
+    identInScope->getResolvedType()
+      ? identInScope->getResolvedType()
+      : identInScope->getValue()
+  );
+
+  if (identInScope->getMappedBinaryenIndex() == -1) {
+    throw runtime_error("Capsule level values are not supported by the fast emitter: " + identName);
+  }
+
+  return makeLocalGet(identInScope->getMappedBinaryenIndex(), getWasmTypeFromTypeDeclaration(type));
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateBinaryOperation(shared_ptr<BinaryOperationNode> binOpNode) {
+  if (binOpNode->getOperator() == Lexemes::EXPONENT) {
+    return generateExponentOperation(binOpNode);
+  }
+
+  Expression left = generate(binOpNode->getLeft());
+  Expression right = generate(binOpNode->getRight());
+
+  if (left.code.empty() || right.code.empty()) {
+    throw runtime_error("Invalid operand types for binary operation");
+  }
+
+  if (dynamic_pointer_cast<TypeDeclarationNode>(binOpNode->getLeft()->getResolvedType())->getType() == DataTypes::STRING) {
+    return generateStringBinaryOperation(binOpNode->getOperator(), left, right);
+  }
+
+  uint8_t op = getOpcodeFromBinOpNode(binOpNode);
+
+  Expression binOp = left;
+  binOp.code.append(right.code);
+  binOp.code.writeByte(op);
+  binOp.type = (op == I64_ADD || op == I64_SUB || op == I64_MUL || op == I64_DIV_S || op == I64_REM_S)
+    ? WasmType::I64
+    : WasmType::I32;
+
+  return binOp;
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateStringBinaryOperation(string op, Expression left, Expression right) {
+  Expression stringOp = left;
+  stringOp.code.append(right.code);
+  stringOp.code.writeByte(GC_PREFIX);
+
+  if (op == Lexemes::PLUS) {
+    stringOp.code.writeU32(STRING_CONCAT);
+    stringOp.type = WasmType::Stringref;
+
+    return stringOp;
+  }
+
+  stringOp.code.writeU32(STRING_EQ);
+  stringOp.type = WasmType::I32;
+
+  // There is no string inequality instruction, so inequality is a negated equality check
+  if (op == Lexemes::INEQUALITY) stringOp.code.writeByte(I32_EQZ);
+
+  return stringOp;
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateUnaryOperation(shared_ptr<UnaryOperationNode> unaryOpNode) {
+  Expression value = generate(unaryOpNode->getValue());
+
+  if (value.code.empty()) {
+    throw runtime_error("Invalid operand type for unary operation");
+  }
+
+  if (unaryOpNode->getOperator() == Lexemes::NOT) {
+    value.code.writeByte(I32_EQZ);
+    value.type = WasmType::I32;
+
+    return value;
+  }
+
+  // Must be a negative. Multiply by negative 1
+  value.code.append(makeConstInt64(-1).code);
+  value.code.writeByte(I64_MUL);
+  value.type = WasmType::I64;
+
+  return value;
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateNumberLiteral(shared_ptr<LiteralNode> literalNode) {
+  return makeConstInt64(stoll(literalNode->getLiteralValue()));
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateStringLiteral(shared_ptr<LiteralNode> literalNode) {
+  return makeStringConst(literalNode->getLiteralValue());
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateBooleanLiteral(shared_ptr<LiteralNode> literalNode) {
+  return makeConstInt32(literalNode->getLiteralValue() == "true" ? 1 : 0);
+}
+
+DirectCodeGen::Expression DirectCodeGen::generateExponentOperation(shared_ptr<BinaryOperationNode> binOpNode) {
+  Expression left = generate(binOpNode->getLeft());
+  Expression right = generate(binOpNode->getRight());
+
+  if (left.code.empty() || right.code.empty()) {
+    throw runtime_error("Invalid operand types for binary operation");
+  }
+
+  Expression call = left;
+  call.code.append(right.code);
+  call.code.writeByte(CALL);
+  call.code.writeU32(MATH_POW_FN_IDX);
+  call.type = WasmType::I64;
+
+  return call;
+}
+
+void DirectCodeGen::generateSource(shared_ptr<SourceNode> sourceNode) {
+  if (sourceNode->getValue()->getNodeType() == ASTNode::CAPSULE) {
+    generate(sourceNode->getValue());
+    return;
+  }
+
+  Expression body = generate(sourceNode->getValue());
+
+  if (body.code.empty()) {
+    throw runtime_error("Invalid body type for source node");
+  }
+
+  shared_ptr<TypeDeclarationNode> returnType = dynamic_pointer_cast<TypeDeclarationNode>(sourceNode->getValue()->getResolvedType());
+
+  addFunction("main", { {}, getWasmTypeFromTypeDeclaration(returnType) }, {}, body);
+
+  exportedFunctions.push_back("main");
+}
+
+vector<DirectCodeGen::Expression> DirectCodeGen::generateClosureMemoryStore(WasmClosure &closure) {
+  // At least 4 bytes for the fn_idx and 4 bytes for the arity. Then 4 bytes for each parameter the closure takes.
+  // We also multiply the remaining arity, since not all parameters may have been applied to the function
+  int totalMemSize = 8 + (closure.getArgPointers().size() * 4) + (closure.getArity() * 4);
+  int memLocation = memoryOffset;
+
+  memoryOffset += totalMemSize;
+
+  vector<int> closureDataSegments = { closure.getFunctionPointer().getAddress(), closure.getArity() };
+  for (int i = 0; i < closure.getArgPointers().size(); i++) {
+    closureDataSegments.push_back(closure.getArgPointers().at(i).getAddress());
+  }
+
+  vector<Expression> expressions;
+
+  for (int i = 0; i < closureDataSegments.size(); i++) {
+    // Don't store uninitialized pointers
+    if (closureDataSegments.at(i) == -1) continue;
+
+    expressions.push_back(makeStore(
+      i * 4,
+      WasmType::I32,
+      makeConstInt32(memLocation),
+      makeConstInt32(closureDataSegments.at(i))
+    ));
+  }
+
+  closure.setAddress(memLocation);
+
+  return expressions;
+}
+
+void DirectCodeGen::hoistCapsuleElements(vector<shared_ptr<ASTNode>> elements) {
+  scope.enterScope();
+  scopeReferences.enterScope();
+
+  for (auto ast : elements) bindIdentifierToScope(ast);
+}
+
+void DirectCodeGen::bindIdentifierToScope(shared_ptr<ASTNode> ast) {
+  string identifier = dynamic_pointer_cast<IdentifierNode>(ast->getLeft())->getIdentifier();
+
+  if (ast->getRight()->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+    identifier = Compiler::getQualifiedFunctionIdentifier(identifier, ast->getRight());
+
+    int totalParams = dynamic_pointer_cast<FunctionDeclarationNode>(ast->getRight())->getParameters()->getElements().size();
+
+    functionNameToClosureTemplateMap.insert(make_pair(
+      identifier,
+      WasmClosure(functionNameToClosureTemplateMap.size(), totalParams)
+    ));
+  }
+
+  scope.insert(identifier, ast->getRight());
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeBlock(vector<Expression> &expressions) {
+  Expression block;
+  bool hasUnreachableChild = false;
+
+  for (int i = 0; i < expressions.size(); i++) {
+    block.code.append(expressions.at(i).code);
+
+    if (expressions.at(i).type == WasmType::Unreachable) hasUnreachableChild = true;
+
+    // Values of anything but the last expression in a sequence are never used
+    if (i < expressions.size() - 1 && isConcrete(expressions.at(i).type)) block.code.writeByte(DROP);
+  }
+
+  if (expressions.empty()) return block;
+
+  block.type = expressions.back().type;
+
+  if (block.type == WasmType::None && hasUnreachableChild) block.type = WasmType::Unreachable;
+
+  return block;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeIf(Expression condition, Expression ifTrue, optional<Expression> ifFalse) {
+  Expression ifExpr;
+
+  if (ifFalse) {
+    if (ifTrue.type == ifFalse->type) ifExpr.type = ifTrue.type;
+    else if (ifTrue.type == WasmType::Unreachable) ifExpr.type = ifFalse->type;
+    else if (ifFalse->type == WasmType::Unreachable) ifExpr.type = ifTrue.type;
+    else ifExpr.type = WasmType::None;
+  }
+
+  if (condition.type == WasmType::Unreachable && !isConcrete(ifExpr.type)) ifExpr.type = WasmType::Unreachable;
+
+  ifExpr.code = condition.code;
+  ifExpr.code.writeByte(IF);
+  ifExpr.code.writeByte(isConcrete(ifExpr.type) ? getValueTypeCode(ifExpr.type) : EMPTY_BLOCK_TYPE);
+
+  ifExpr.code.append(ifTrue.code);
+  if (isConcrete(ifTrue.type) && !isConcrete(ifExpr.type)) ifExpr.code.writeByte(DROP);
+
+  if (ifFalse) {
+    ifExpr.code.writeByte(ELSE);
+    ifExpr.code.append(ifFalse->code);
+    if (isConcrete(ifFalse->type) && !isConcrete(ifExpr.type)) ifExpr.code.writeByte(DROP);
+  }
+
+  ifExpr.code.writeByte(END);
+
+  // An if whose arms both exit can't produce a value, so nothing after it is reachable either
+  if (ifExpr.type == WasmType::Unreachable) ifExpr.code.writeByte(UNREACHABLE);
+
+  return ifExpr;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeConstInt32(int32_t value) {
+  Expression constExpr;
+  constExpr.code.writeByte(I32_CONST);
+  constExpr.code.writeS32(value);
+  constExpr.type = WasmType::I32;
+
+  return constExpr;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeConstInt64(int64_t value) {
+  Expression constExpr;
+  constExpr.code.writeByte(I64_CONST);
+  constExpr.code.writeS64(value);
+  constExpr.type = WasmType::I64;
+
+  return constExpr;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeLocalGet(int idx, WasmType type) {
+  Expression localGet;
+  localGet.code.writeByte(LOCAL_GET);
+  localGet.code.writeU32(idx);
+  localGet.type = type;
+
+  return localGet;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeLoad(int bytes, uint32_t offset, WasmType type, Expression ptr) {
+  Expression load = ptr;
+
+  // Alignment is encoded as a power of two, and we always load at the natural alignment of the type
+  load.code.writeByte(bytes == 8 ? I64_LOAD : I32_LOAD);
+  load.code.writeU32(bytes == 8 ? 3 : 2);
+  load.code.writeU32(offset);
+  load.type = type;
+
+  return load;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeStore(uint32_t offset, WasmType type, Expression ptr, Expression value) {
+  Expression store = ptr;
+  store.code.append(value.code);
+  store.code.writeByte(type == WasmType::I64 ? I64_STORE : I32_STORE);
+  store.code.writeU32(type == WasmType::I64 ? 3 : 2);
+  store.code.writeU32(offset);
+  store.type = WasmType::None;
+
+  return store;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeStringConst(string value) {
+  auto existing = stringLiteralIndices.find(value);
+  uint32_t idx;
+
+  if (existing != stringLiteralIndices.end()) {
+    idx = existing->second;
+  } else {
+    idx = stringLiterals.size();
+    stringLiterals.push_back(value);
+    stringLiteralIndices.insert(make_pair(value, idx));
+  }
+
+  Expression stringConst;
+  stringConst.code.writeByte(GC_PREFIX);
+  stringConst.code.writeU32(STRING_CONST);
+  stringConst.code.writeU32(idx);
+  stringConst.type = WasmType::Stringref;
+
+  return stringConst;
+}
+
+DirectCodeGen::Expression DirectCodeGen::makeCallIndirect(
+  Expression target,
+  vector<Expression> &operands,
+  FunctionSignature signature
+) {
+  Expression call;
+
+  for (auto &operand : operands) call.code.append(operand.code);
+
+  call.code.append(target.code);
+  call.code.writeByte(CALL_INDIRECT);
+  call.code.writeU32(getSignatureIndex(signature));
+  call.code.writeU32(FN_TABLE_IDX);
+  call.type = signature.result;
+
+  return call;
+}
+
+bool DirectCodeGen::isConcrete(WasmType type) {
+  return type != WasmType::None && type != WasmType::Unreachable;
+}
+
+uint8_t DirectCodeGen::getValueTypeCode(WasmType type) {
+  if (type == WasmType::I32) return 0x7F;
+  if (type == WasmType::I64) return 0x7E;
+  if (type == WasmType::Stringref) return 0x64;
+
+  throw runtime_error("No value type encoding for a non-concrete type");
+}
+
+DirectCodeGen::WasmType DirectCodeGen::getWasmTypeFromTypeDeclaration(shared_ptr<TypeDeclarationNode> typeDeclaration) {
+  if (typeDeclaration->getType() == DataTypes::NUMBER) return WasmType::I64;
+  if (typeDeclaration->getType() == DataTypes::STRING) return WasmType::Stringref;
+  if (typeDeclaration->getType() == DataTypes::BOOLEAN) return WasmType::I32;
+
+  // Function references are returned as i32 pointers to a closure in the function table
+  if (typeDeclaration->getType() == DataTypes::FUNCTION) return WasmType::I32;
+
+  throw runtime_error("No matching WASM type for TypeDeclaration: " + typeDeclaration->getType());
+}
+
+DirectCodeGen::WasmType DirectCodeGen::getWasmStorageTypeFromTypeDeclaration(shared_ptr<TypeDeclarationNode> typeDeclaration) {
+  if (typeDeclaration->getType() == DataTypes::STRING) return WasmType::I32;
+
+  return getWasmTypeFromTypeDeclaration(typeDeclaration);
+}
+
+uint8_t DirectCodeGen::getOpcodeFromBinOpNode(shared_ptr<BinaryOperationNode> binOpNode) {
+  string op = binOpNode->getOperator();
+
+  if (op == Lexemes::PLUS) return I64_ADD;
+  if (op == Lexemes::MINUS) return I64_SUB;
+  if (op == Lexemes::DIVISION) return I64_DIV_S;
+  if (op == Lexemes::TIMES) return I64_MUL;
+  if (op == Lexemes::MODULO) return I64_REM_S;
+
+  string dataType = dynamic_pointer_cast<TypeDeclarationNode>(binOpNode->getLeft()->getResolvedType())->getType();
+
+  if (op == Lexemes::EQUALITY && dataType == DataTypes::NUMBER) return I64_EQ;
+  if (op == Lexemes::EQUALITY && dataType == DataTypes::BOOLEAN) return I32_EQ;
+  if (op == Lexemes::INEQUALITY && dataType == DataTypes::NUMBER) return I64_NE;
+  if (op == Lexemes::INEQUALITY && dataType == DataTypes::BOOLEAN) return I32_NE;
+  if (op == Lexemes::LT && dataType == DataTypes::NUMBER) return I64_LT_S;
+  if (op == Lexemes::GT && dataType == DataTypes::NUMBER) return I64_GT_S;
+  if (op == Lexemes::LTEQ && dataType == DataTypes::NUMBER) return I64_LE_S;
+  if (op == Lexemes::GTEQ && dataType == DataTypes::NUMBER) return I64_GE_S;
+
+  throw runtime_error("No matching WASM opcode for binary operation: " + binOpNode->getOperator());
+}
+
+int DirectCodeGen::getByteSizeForType(WasmType type) {
+  if (type == WasmType::I64) return 8;
+
+  return 4;
+}
+
+template<typename Function>
+DirectCodeGen::FunctionSignature DirectCodeGen::getFunctionSignature(shared_ptr<Function> functionNode) {
+  FunctionSignature signature;
+
+  for (auto param : functionNode->getParameters()->getElements()) {
+    signature.params.push_back(getWasmTypeFromTypeDeclaration(
+      dynamic_pointer_cast<TypeDeclarationNode>(
+        functionNode->getNodeType() == ASTNode::FUNCTION_INVOCATION ? param->getResolvedType() : param->getValue()
+      )
+    ));
+  }
+
+  signature.result = getWasmTypeFromTypeDeclaration(TypeChecker::getFunctionReturnType(functionNode));
+
+  return signature;
+}
+
+// The signature of the function that gets generated as a result of currying
+DirectCodeGen::FunctionSignature DirectCodeGen::getDerivedFunctionSignature(
+  shared_ptr<FunctionInvocationNode> invocation,
+  shared_ptr<FunctionInvocationNode> reference
+) {
+  FunctionSignature invocationSignature = getFunctionSignature(invocation);
+  FunctionSignature signature = getFunctionSignature(reference);
+
+  signature.params.insert(signature.params.end(), invocationSignature.params.begin(), invocationSignature.params.end());
+  signature.result = invocationSignature.result;
+
+  return signature;
+}
+
+uint32_t DirectCodeGen::getSignatureIndex(FunctionSignature signature) {
+  for (int i = 0; i < signatures.size(); i++) {
+    if (signatures.at(i).params == signature.params && signatures.at(i).result == signature.result) return i;
+  }
+
+  signatures.push_back(signature);
+
+  return signatures.size() - 1;
+}
+
+uint32_t DirectCodeGen::getFunctionIndex(string name) {
+  for (int i = 0; i < functions.size(); i++) {
+    if (functions.at(i).name == name) return CORE_FUNCTION_COUNT + i;
+  }
+
+  throw runtime_error("Referenced function was never generated: " + name);
+}
+
+void DirectCodeGen::addFunction(string name, FunctionSignature signature, vector<WasmType> locals, Expression body) {
+  // A function with no result can't leave a value on the stack
+  if (signature.result == WasmType::None && isConcrete(body.type)) body.code.writeByte(DROP);
+
+  functions.push_back({ name, getSignatureIndex(signature), locals, body.code });
+}
+
+vector<char> DirectCodeGen::serializeModule() {
+  uint32_t populateClosureTypeIdx = getSignatureIndex({ { WasmType::I32, WasmType::I32 }, WasmType::None });
+  uint32_t mathPowTypeIdx = getSignatureIndex({ { WasmType::I64, WasmType::I64 }, WasmType::I64 });
+
+  WasmBuffer module;
+  for (uint8_t byte : { 0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00 }) module.writeByte(byte);
+
+  WasmBuffer types;
+  types.writeU32(signatures.size());
+  for (auto &signature : signatures) {
+    types.writeByte(FUNC_TYPE);
+    types.writeU32(signature.params.size());
+    for (WasmType param : signature.params) types.writeByte(getValueTypeCode(param));
+
+    if (isConcrete(signature.result)) {
+      types.writeU32(1);
+      types.writeByte(getValueTypeCode(signature.result));
+    } else {
+      types.writeU32(0);
+    }
+  }
+  module.writeSection(TYPE_SECTION, types);
+
+  WasmBuffer functionDecls;
+  functionDecls.writeU32(CORE_FUNCTION_COUNT + functions.size());
+  functionDecls.writeU32(populateClosureTypeIdx);
+  functionDecls.writeU32(mathPowTypeIdx);
+  for (auto &fn : functions) functionDecls.writeU32(fn.typeIndex);
+  module.writeSection(FUNCTION_SECTION, functionDecls);
+
+  // The stringref table comes first, followed by the function table, which holds exactly one entry per closure template
+  WasmBuffer tables;
+  tables.writeU32(2);
+  tables.writeByte(getValueTypeCode(WasmType::Stringref));
+  tables.writeByte(0x01);
+  tables.writeU32(1000);
+  tables.writeU32(100000000);
+  tables.writeByte(FUNCREF_TYPE);
+  tables.writeByte(0x01);
+  tables.writeU32(functionNameToClosureTemplateMap.size());
+  tables.writeU32(functionNameToClosureTemplateMap.size());
+  module.writeSection(TABLE_SECTION, tables);
+
+  // IMPORTANT: Memory size is dictated in pages, NOT bytes, where each page is 64k
+  WasmBuffer memory;
+  memory.writeU32(1);
+  memory.writeByte(0x01);
+  memory.writeU32(1);
+  memory.writeU32(10);
+  module.writeSection(MEMORY_SECTION, memory);
+
+  if (!stringLiterals.empty()) {
+    WasmBuffer strings;
+    strings.writeU32(0); // Deferred string count, not used
+    strings.writeU32(stringLiterals.size());
+    for (auto &str : stringLiterals) strings.writeName(str);
+    module.writeSection(STRINGS_SECTION, strings);
+  }
+
+  WasmBuffer exports;
+  exports.writeU32(1 + exportedFunctions.size());
+  exports.writeName("memory");
+  exports.writeByte(EXPORT_KIND_MEMORY);
+  exports.writeU32(0);
+  for (auto &fnName : exportedFunctions) {
+    exports.writeName(fnName);
+    exports.writeByte(EXPORT_KIND_FUNC);
+    exports.writeU32(getFunctionIndex(fnName));
+  }
+  module.writeSection(EXPORT_SECTION, exports);
+
+  vector<uint32_t> tableEntries(functionNameToClosureTemplateMap.size());
+  for (auto& [fnName, fnRef] : functionNameToClosureTemplateMap) {
+    tableEntries[fnRef.getFunctionPointer().getAddress()] = getFunctionIndex(fnName);
+  }
+
+  // A single active segment for the function table, starting at offset 0
+  WasmBuffer elements;
+  elements.writeU32(1);
+  elements.writeU32(0x02);
+  elements.writeU32(FN_TABLE_IDX);
+  elements.append(makeConstInt32(0).code);
+  elements.writeByte(END);
+  elements.writeByte(0x00); // Element kind: funcref
+  elements.writeU32(tableEntries.size());
+  for (uint32_t fnIdx : tableEntries) elements.writeU32(fnIdx);
+  module.writeSection(ELEMENT_SECTION, elements);
+
+  WasmBuffer code;
+  code.writeU32(CORE_FUNCTION_COUNT + functions.size());
+  writeCoreFunctionBodies(code);
+  for (auto &fn : functions) writeFunctionBody(code, fn.locals, fn.body);
+  module.writeSection(CODE_SECTION, code);
+
+  return vector<char>(module.getBytes().begin(), module.getBytes().end());
+}
+
+void DirectCodeGen::writeCoreFunctionBodies(WasmBuffer &code) {
+  // The core functions are copied out of the same module CodeGen imports, so both backends run the same code. Their
+  // bodies only reference their own locals and memory, which makes them valid wherever they end up in the index space
+  size_t offset = 8;
+
+  while (offset < THETA_LANG_CORE_WASM_SIZE) {
+    uint8_t sectionId = THETA_LANG_CORE_WASM[offset++];
+    uint32_t sectionSize = readU32(THETA_LANG_CORE_WASM, offset);
+
+    if (sectionId != CODE_SECTION) {
+      offset += sectionSize;
+      continue;
+    }
+
+    if (readU32(THETA_LANG_CORE_WASM, offset) != CORE_FUNCTION_COUNT) {
+      throw runtime_error("The core language module doesn't define the functions the direct emitter expects");
+    }
+
+    for (int i = 0; i < CORE_FUNCTION_COUNT; i++) {
+      size_t bodyStart = offset;
+      uint32_t bodySize = readU32(THETA_LANG_CORE_WASM, offset);
+
+      offset += bodySize;
+
+      for (size_t j = bodyStart; j < offset; j++) code.writeByte(THETA_LANG_CORE_WASM[j]);
+    }
+
+    return;
+  }
+
+  throw runtime_error("The core language module has no code section");
+}
+
+void DirectCodeGen::writeFunctionBody(WasmBuffer &code, vector<WasmType> locals, const WasmBuffer &body) {
+  // Locals are declared as runs of the same type
+  vector<pair<uint32_t, WasmType>> localRuns;
+  for (WasmType local : locals) {
+    if (!localRuns.empty() && localRuns.back().second == local) localRuns.back().first++;
+    else localRuns.push_back(make_pair(1, local));
+  }
+
+  WasmBuffer function;
+  function.writeU32(localRuns.size());
+  for (auto &[count, type] : localRuns) {
+    function.writeU32(count);
+    function.writeByte(getValueTypeCode(type));
+  }
+  function.append(body);
+  function.writeByte(END);
+
+  code.writeU32(function.size());
+  code.append(function);
+}
+
+#pragma pop_macro("RETURN")
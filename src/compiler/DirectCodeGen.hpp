@@ -0,0 +1,186 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <optional>
+#include "../parser/ast/ASTNode.hpp"
+#include "../parser/ast/BinaryOperationNode.hpp"
+#include "../parser/ast/UnaryOperationNode.hpp"
+#include "../parser/ast/LiteralNode.hpp"
+#include "../parser/ast/SourceNode.hpp"
+#include "compiler/SymbolTableStack.hpp"
+#include "compiler/WasmClosure.hpp"
+#include "compiler/WasmBuffer.hpp"
+#include "compiler/CompilationSession.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include "parser/ast/AssignmentNode.hpp"
+#include "parser/ast/CapsuleNode.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/ReturnNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
+
+using namespace std;
+
+/**
+ * @brief A lightweight alternative to CodeGen that writes the WebAssembly binary format directly from the type-checked
+ * AST, without building any Binaryen IR. It makes exactly the same code generation decisions as CodeGen -- the same
+ * closure layout, memory offsets, function table and local indices -- so modules behave identically, but skips
+ * Binaryen's IR construction, validation and serialization entirely. Used for -O0 / --fast-emit builds.
+ *
+ * Each generate function returns the encoded instructions for its node along with the type they leave on the stack.
+ * Parents splice these together, inserting drops for unused values the same way BinaryenModuleAutoDrop would.
+ */
+namespace Theta {
+  class DirectCodeGen {
+  public:
+    DirectCodeGen(shared_ptr<CompilationSession> compilationSession) : session(compilationSession) {}
+
+    /**
+     * @brief Generates a complete WASM module from the given AST
+     * @param ast The type-checked AST to generate code for
+     * @return The encoded WASM module
+     */
+    vector<char> generateWasmFromAST(shared_ptr<ASTNode> ast);
+
+  private:
+    enum class WasmType { None, I32, I64, Stringref, Unreachable };
+
+    struct Expression {
+      WasmBuffer code;
+      WasmType type = WasmType::None;
+    };
+
+    struct FunctionSignature {
+      vector<WasmType> params;
+      WasmType result;
+    };
+
+    struct GeneratedFunction {
+      string name;
+      uint32_t typeIndex;
+      vector<WasmType> locals;
+      WasmBuffer body;
+    };
+
+    shared_ptr<CompilationSession> session;
+    SymbolTableStack<shared_ptr<ASTNode>> scope;
+    SymbolTableStack<string> scopeReferences;
+    int memoryOffset = 0;
+    int stringRefOffset = 1;
+    unordered_map<string, WasmClosure> functionNameToClosureTemplateMap;
+    string LOCAL_IDX_SCOPE_KEY = "ThetaLang.internal.localIdxCounter";
+
+    vector<FunctionSignature> signatures;
+    vector<GeneratedFunction> functions;
+    vector<string> exportedFunctions;
+    vector<string> stringLiterals;
+    map<string, uint32_t> stringLiteralIndices;
+
+    // The core language functions always come first in the function index space, followed by generated functions
+    static constexpr uint32_t POPULATE_CLOSURE_FN_IDX = 0;
+    static constexpr uint32_t MATH_POW_FN_IDX = 1;
+    static constexpr uint32_t CORE_FUNCTION_COUNT = 2;
+    static constexpr uint32_t STRINGREF_TABLE_IDX = 0;
+    static constexpr uint32_t FN_TABLE_IDX = 1;
+
+    Expression generate(shared_ptr<ASTNode> node);
+    void generateSource(shared_ptr<SourceNode> node);
+    void generateCapsule(shared_ptr<CapsuleNode> node);
+    Expression generateAssignment(shared_ptr<AssignmentNode> node);
+    Expression generateBlock(shared_ptr<ASTNodeList> node);
+    Expression generateReturn(shared_ptr<ReturnNode> node);
+    void generateFunctionDeclaration(string identifier, shared_ptr<FunctionDeclarationNode> node, bool addToExports = false);
+    Expression generateClosureFunctionDeclaration(
+      shared_ptr<FunctionDeclarationNode> node,
+      std::function<Expression(Expression)> returnValueFormatter = [](Expression addrExpr) { return addrExpr; },
+      optional<pair<string, int>> assignmentIdentifierPair = nullopt
+    );
+    Expression generateFunctionInvocation(shared_ptr<FunctionInvocationNode> node);
+    Expression generateControlFlow(shared_ptr<ControlFlowNode> node);
+    Expression generateIdentifier(shared_ptr<IdentifierNode> node);
+    Expression generateBinaryOperation(shared_ptr<BinaryOperationNode> node);
+    Expression generateStringBinaryOperation(string op, Expression left, Expression right);
+    Expression generateUnaryOperation(shared_ptr<UnaryOperationNode> node);
+    Expression generateNumberLiteral(shared_ptr<LiteralNode> node);
+    Expression generateStringLiteral(shared_ptr<LiteralNode> node);
+    Expression generateBooleanLiteral(shared_ptr<LiteralNode> node);
+    Expression generateExponentOperation(shared_ptr<BinaryOperationNode> node);
+
+    vector<Pointer<PointerType::Data>> generateFunctionInvocationArgMemoryInsertions(
+      shared_ptr<FunctionInvocationNode> funcInvNode,
+      vector<Expression> &expressions,
+      string refIdentifier = ""
+    );
+
+    Expression generateCallIndirectForNewClosure(
+      shared_ptr<FunctionInvocationNode> funcInvNode,
+      shared_ptr<ASTNode> ref,
+      string refIdentifier
+    );
+
+    Expression generateCallIndirectForExistingClosure(
+      shared_ptr<FunctionInvocationNode> funcInvNode,
+      shared_ptr<ASTNode> ref,
+      string refIdentifier
+    );
+
+    pair<WasmClosure, vector<Expression>> generateAndStoreClosure(
+      string qualifiedReferenceFunctionName,
+      shared_ptr<FunctionDeclarationNode> simplifiedReference,
+      shared_ptr<FunctionDeclarationNode> originalReference
+    );
+
+    vector<Expression> generateClosureMemoryStore(WasmClosure &closure);
+
+    void hoistCapsuleElements(vector<shared_ptr<ASTNode>> elements);
+    void bindIdentifierToScope(shared_ptr<ASTNode> ast);
+
+    /**
+     * @brief Combines expressions into a sequence, dropping the values of all but the last one. The type of the
+     * sequence follows the same rules as a Binaryen block.
+     */
+    static Expression makeBlock(vector<Expression> &expressions);
+
+    /**
+     * @brief Creates an if/else, dropping the value of any arm that can't be returned from the if
+     */
+    static Expression makeIf(Expression condition, Expression ifTrue, optional<Expression> ifFalse);
+
+    static Expression makeConstInt32(int32_t value);
+    static Expression makeConstInt64(int64_t value);
+    static Expression makeLocalGet(int idx, WasmType type);
+    static Expression makeLoad(int bytes, uint32_t offset, WasmType type, Expression ptr);
+    static Expression makeStore(uint32_t offset, WasmType type, Expression ptr, Expression value);
+    Expression makeStringConst(string value);
+    Expression makeCallIndirect(Expression target, vector<Expression> &operands, FunctionSignature signature);
+
+    static bool isConcrete(WasmType type);
+    static uint8_t getValueTypeCode(WasmType type);
+    static WasmType getWasmTypeFromTypeDeclaration(shared_ptr<TypeDeclarationNode> node);
+    static WasmType getWasmStorageTypeFromTypeDeclaration(shared_ptr<TypeDeclarationNode> node);
+    static uint8_t getOpcodeFromBinOpNode(shared_ptr<BinaryOperationNode> node);
+    static int getByteSizeForType(WasmType type);
+
+    template<typename Node>
+    static FunctionSignature getFunctionSignature(shared_ptr<Node> node);
+
+    static FunctionSignature getDerivedFunctionSignature(
+      shared_ptr<FunctionInvocationNode> inv,
+      shared_ptr<FunctionInvocationNode> ref
+    );
+
+    uint32_t getSignatureIndex(FunctionSignature signature);
+    uint32_t getFunctionIndex(string name);
+
+    void addFunction(string name, FunctionSignature signature, vector<WasmType> locals, Expression body);
+
+    vector<char> serializeModule();
+    void writeCoreFunctionBodies(WasmBuffer &code);
+    static void writeFunctionBody(WasmBuffer &code, vector<WasmType> locals, const WasmBuffer &body);
+  };
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
+#include "exceptions/Error.hpp"
+#include "parser/ast/ASTNode.hpp"
+
+using namespace std;
+
+/**
+ * @brief A thread-safe cache of linked capsule ASTs that can be shared between many CompilationSessions. This allows
+ * a batch of entrypoints that link the same capsules to parse each of those capsules only once, even when the
+ * entrypoints are being compiled on different threads.
+ */
+namespace Theta {
+  class LinkedCapsuleCache {
+  public:
+    /**
+     * @brief A linked capsule AST, along with any errors that were encountered while building it. The errors are
+     * kept so they can be reported by every session that links the capsule, not just the one that built it. They are
+     * all located in the linked capsule's own file, or the files it links in turn.
+     */
+    struct Entry {
+      shared_ptr<ASTNode> linkedAST;
+      vector<shared_ptr<Error>> errors;
+    };
+
+    /**
+     * @brief How getOrBuild came by the entry it returned
+     */
+    enum Resolution { BUILT, CACHED, CYCLIC };
+
+    /**
+     * @brief Returns the cached entry for a capsule, building it if this is the first time the capsule has been
+     * requested. If another thread is already building the capsule, this waits for that build to finish rather than
+     * building it a second time, unless that build is itself waiting on the capsule this thread is building. The links
+     * then form a cycle, and nothing is waited for.
+     * @param capsuleName The name of the capsule to look up
+     * @param build The function used to build the entry if it does not exist yet
+     * @param resolution Set to whether the entry was built by this call or came from the cache. If it is CYCLIC, the
+     * capsule links back to itself, and the returned entry is empty
+     * @return The entry for the capsule
+     */
+    Entry getOrBuild(string capsuleName, function<Entry()> build, Resolution &resolution) {
+      promise<Entry> pendingEntry;
+      shared_future<Entry> entry;
+      thread::id currentThread = this_thread::get_id();
+
+      {
+        lock_guard<mutex> lock(entriesMutex);
+
+        auto it = entries.find(capsuleName);
+
+        if (it == entries.end()) {
+          resolution = BUILT;
+          entry = pendingEntry.get_future().share();
+          entries.insert(make_pair(capsuleName, entry));
+          builders.insert(make_pair(capsuleName, currentThread));
+        } else if (isAwaitedBy(capsuleName, currentThread)) {
+          resolution = CYCLIC;
+
+          return Entry();
+        } else {
+          resolution = CACHED;
+          entry = it->second;
+          awaitedCapsules[currentThread] = capsuleName;
+        }
+      }
+
+      if (resolution == CACHED) {
+        try {
+          Entry cachedEntry = entry.get();
+          stopAwaiting(currentThread);
+
+          return cachedEntry;
+        } catch (...) {
+          stopAwaiting(currentThread);
+          throw;
+        }
+      }
+
+      try {
+        Entry builtEntry = build();
+        finishBuilding(capsuleName);
+        pendingEntry.set_value(builtEntry);
+
+        return builtEntry;
+      } catch (...) {
+        finishBuilding(capsuleName);
+        pendingEntry.set_exception(current_exception());
+        throw;
+      }
+    }
+
+  private:
+    mutex entriesMutex;
+    map<string, shared_future<Entry>> entries;
+
+    /**
+     * @brief The threads building the capsules that aren't built yet, by capsule name
+     */
+    map<string, thread::id> builders;
+
+    /**
+     * @brief The capsule each thread is waiting for another thread to finish building
+     */
+    map<thread::id, string> awaitedCapsules;
+
+    /**
+     * @brief Whether waiting for the capsule would wait on the given thread, because the thread is building it or a
+     * capsule its builder is waiting for, and so on. Must be called holding entriesMutex
+     */
+    bool isAwaitedBy(string capsuleName, thread::id waitingThread) {
+      for (auto builder = builders.find(capsuleName); builder != builders.end();) {
+        if (builder->second == waitingThread) return true;
+
+        auto awaited = awaitedCapsules.find(builder->second);
+        if (awaited == awaitedCapsules.end()) return false;
+
+        builder = builders.find(awaited->second);
+      }
+
+      return false;
+    }
+
+    void stopAwaiting(thread::id waitingThread) {
+      lock_guard<mutex> lock(entriesMutex);
+
+      awaitedCapsules.erase(waitingThread);
+    }
+
+    void finishBuilding(string capsuleName) {
+      lock_guard<mutex> lock(entriesMutex);
+
+      builders.erase(capsuleName);
+    }
+  };
+}
@@ -65,6 +65,33 @@ bool TypeChecker::checkAST(shared_ptr<ASTNode> ast, vector<pair<string, shared_p
   return checkNode(ast);
 }
 
+void TypeChecker::enterCapsule(shared_ptr<CapsuleNode> capsule) {
+  // Mirror the scopes checkAST would have entered by the time it reaches the capsule's elements: one for the capsule
+  // itself and one for its block
+  identifierTable.enterScope();
+  hoistCapsuleDeclarations(capsule);
+  identifierTable.enterScope();
+}
+
+bool TypeChecker::checkCapsuleElement(shared_ptr<ASTNode> element) {
+  // checkAST returns early on failure without exiting the scopes it entered, so restore them ourselves
+  SymbolTableStack<shared_ptr<ASTNode>> scopesBeforeElement = identifierTable;
+
+  bool isValid = checkAST(element);
+
+  identifierTable = scopesBeforeElement;
+
+  return isValid;
+}
+
+void TypeChecker::declareCapsuleElement(shared_ptr<ASTNode> element) {
+  if (element->getNodeType() == ASTNode::ASSIGNMENT) {
+    declareAssignment(dynamic_pointer_cast<AssignmentNode>(element));
+  } else if (element->getNodeType() == ASTNode::STRUCT_DEFINITION) {
+    declareStructDefinition(dynamic_pointer_cast<StructDefinitionNode>(element));
+  }
+}
+
 bool TypeChecker::checkNode(shared_ptr<ASTNode> node) {
   if (node->getNodeType() == ASTNode::AST_NODE_LIST) {
     return true;
@@ -128,7 +155,7 @@ bool TypeChecker::checkTypeDeclarationNode(shared_ptr<TypeDeclarationNode> node)
   shared_ptr<ASTNode> customDataTypeInScope = lookupInScope(node->getType());
   
   if (!customDataTypeInScope) {
-    Compiler::getInstance().addException(make_shared<ReferenceError>(node->getType()));
+    session->addException(make_shared<ReferenceError>(node->getType()));
     return false;
   }
 
@@ -141,10 +168,14 @@ bool TypeChecker::checkAssignmentNode(shared_ptr<AssignmentNode> node) {
   shared_ptr<IdentifierNode> ident = dynamic_pointer_cast<IdentifierNode>(node->getLeft());
 
   if (!typesMatch) {
-    string leftTypeString = dynamic_pointer_cast<TypeDeclarationNode>(node->getLeft()->getValue())->toString();
-    string rightTypeString = dynamic_pointer_cast<TypeDeclarationNode>(node->getRight()->getResolvedType())->toString();
+    shared_ptr<TypeDeclarationNode> leftType = dynamic_pointer_cast<TypeDeclarationNode>(node->getLeft()->getValue());
+    shared_ptr<TypeDeclarationNode> rightType = dynamic_pointer_cast<TypeDeclarationNode>(node->getRight()->getResolvedType());
+
+    // Either side can be missing its type in incomplete code, like a declaration that hasn't been given a type yet
+    string leftTypeString = leftType ? leftType->toString() : "<Nothing>";
+    string rightTypeString = rightType ? rightType->toString() : "<Nothing>";
 
-    Compiler::getInstance().addException(
+    session->addException(
       make_shared<TypeError>(
         rightTypeString + " is not assignable to " + leftTypeString,
         node->getLeft()->getValue(),
@@ -157,6 +188,12 @@ bool TypeChecker::checkAssignmentNode(shared_ptr<AssignmentNode> node) {
 
   node->setResolvedType(node->getLeft()->getValue());
 
+  return declareAssignment(node);
+}
+
+bool TypeChecker::declareAssignment(shared_ptr<AssignmentNode> node) {
+  shared_ptr<IdentifierNode> ident = dynamic_pointer_cast<IdentifierNode>(node->getLeft());
+
   string rhsType = dynamic_pointer_cast<TypeDeclarationNode>(node->getRight()->getResolvedType())->getType();
   
   // Function names can be overloaded, so functions don't need this check
@@ -173,7 +210,7 @@ bool TypeChecker::checkAssignmentNode(shared_ptr<AssignmentNode> node) {
     auto existingFuncIdentifierInScope = identifierTable.lookup(uniqueFuncIdentifier);
 
     if (existingFuncIdentifierInScope.has_value()) {
-      Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(ident->getIdentifier()));
+      session->addException(make_shared<IllegalReassignmentError>(ident->getIdentifier()));
       return false;
     }
 
@@ -188,7 +225,7 @@ bool TypeChecker::checkAssignmentNode(shared_ptr<AssignmentNode> node) {
     auto existingIdentifierInScope = identifierTable.lookup(ident->getIdentifier());
 
     if (existingIdentifierInScope.has_value()) {
-      Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(ident->getIdentifier()));
+      session->addException(make_shared<IllegalReassignmentError>(ident->getIdentifier()));
       return false;
     }
 
@@ -205,7 +242,7 @@ bool TypeChecker::checkIdentifierNode(shared_ptr<IdentifierNode> node) {
   shared_ptr<ASTNode> foundReferencedIdentifier = lookupInScope(node->getIdentifier());
 
   if (!foundReferencedIdentifier) {
-    Compiler::getInstance().addException(make_shared<ReferenceError>(node->getIdentifier()));
+    session->addException(make_shared<ReferenceError>(node->getIdentifier()));
     return false;
   }
 
@@ -217,7 +254,7 @@ bool TypeChecker::checkBinaryOperationNode(shared_ptr<BinaryOperationNode> node)
   bool typesMatch = isSameType(node->getLeft()->getResolvedType(), node->getRight()->getResolvedType());
 
   if (!typesMatch) {
-    Compiler::getInstance().addException(
+    session->addException(
       make_shared<TypeError>(
         "Binary Expression is not homogenous",
         node->getLeft()->getResolvedType(),
@@ -246,7 +283,7 @@ bool TypeChecker::checkUnaryOperationNode(shared_ptr<UnaryOperationNode> node) {
   shared_ptr<TypeDeclarationNode> numType = make_shared<TypeDeclarationNode>(DataTypes::NUMBER, nullptr);
 
   if (isSameType(node->getValue()->getResolvedType(), boolType) && node->getOperator() != Lexemes::NOT) {
-    Compiler::getInstance().addException(
+    session->addException(
       make_shared<TypeError>(
         "Boolean expression may only have boolean unary operator",
         node->getValue()->getResolvedType(),
@@ -258,7 +295,7 @@ bool TypeChecker::checkUnaryOperationNode(shared_ptr<UnaryOperationNode> node) {
   }
 
   if (isSameType(node->getValue()->getResolvedType(), numType) && node->getOperator() != Lexemes::MINUS) {
-    Compiler::getInstance().addException(
+    session->addException(
       make_shared<TypeError>(
         "Numerical expression may only have numerical unary operator",
         node->getValue()->getResolvedType(),
@@ -359,14 +396,16 @@ bool TypeChecker::checkFunctionInvocationNode(shared_ptr<FunctionInvocationNode>
     for (int i = 0; i < node->getParameters()->getElements().size(); i++) {
       if (i > 0) paramTypes += ", ";
 
-      paramTypes += dynamic_pointer_cast<TypeDeclarationNode>(
+      shared_ptr<TypeDeclarationNode> paramType = dynamic_pointer_cast<TypeDeclarationNode>(
         node->getParameters()->getElements().at(i)->getResolvedType()
-      )->toString();  
+      );
+
+      paramTypes += paramType ? paramType->toString() : "<Nothing>";
     }
 
     paramTypes += ")";
 
-    Compiler::getInstance().addException(make_shared<ReferenceError>(funcIdentifier + paramTypes));
+    session->addException(make_shared<ReferenceError>(funcIdentifier + paramTypes));
     return false;
   }
 
@@ -401,7 +440,7 @@ bool TypeChecker::checkControlFlowNode(shared_ptr<ControlFlowNode> node) {
       };
 
       if (!validCondition || !isOneOfTypes(pair.first->getResolvedType(), typesThatCanBeInterpretedAsBooleans)) {
-        Compiler::getInstance().addException(
+        session->addException(
           make_shared<TypeError>(
             "Non-boolean expression in control flow condition",
             pair.first->getResolvedType(),
@@ -452,7 +491,7 @@ bool TypeChecker::checkListNode(shared_ptr<ListNode> node) {
   if (!isHomogenous(returnTypes)) {
     for (auto type : returnTypes) {
       if (!isSameType(type, returnTypes.at(0))) {
-        Compiler::getInstance().addException(
+        session->addException(
           make_shared<TypeError>(
             "Lists must be homogenous",
             returnTypes.at(0),
@@ -513,13 +552,15 @@ bool TypeChecker::checkDictionaryNode(shared_ptr<DictionaryNode> node) {
     shared_ptr<TypeDeclarationNode> symbolType = make_shared<TypeDeclarationNode>(DataTypes::SYMBOL, nullptr);
 
     if (!isSameType(kvTuple->getLeft()->getResolvedType(), symbolType)) {
-      Compiler::getInstance().addException(
+      session->addException(
         make_shared<TypeError>(
           "Dictionary key must be a <Symbol>",
           kvTuple->getLeft()->getResolvedType(),
           symbolType
         )
       );
+
+      return false;
     }
 
     keyTypes.push_back(dynamic_pointer_cast<TypeDeclarationNode>(kvTuple->getLeft()->getResolvedType()));
@@ -527,7 +568,7 @@ bool TypeChecker::checkDictionaryNode(shared_ptr<DictionaryNode> node) {
   }
 
   if (!isHomogenous(valueTypes)) {
-    Compiler::getInstance().addException(
+    session->addException(
       make_shared<TypeError>(
         "Dictionary values must be homogenous",
         valueTypes.at(0),
@@ -562,10 +603,14 @@ bool TypeChecker::checkStructDefinitionNode(shared_ptr<StructDefinitionNode> nod
 
   structNode->setResolvedType(make_shared<TypeDeclarationNode>(node->getName(), structNode));
 
+  return declareStructDefinition(node);
+}
+
+bool TypeChecker::declareStructDefinition(shared_ptr<StructDefinitionNode> node) {
   auto existingIdentifierInScope = identifierTable.lookup(node->getName());
 
   if (existingIdentifierInScope.has_value()) {
-    Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(node->getName()));
+    session->addException(make_shared<IllegalReassignmentError>(node->getName()));
     return false;
   }
 
@@ -577,8 +622,9 @@ bool TypeChecker::checkStructDefinitionNode(shared_ptr<StructDefinitionNode> nod
 bool TypeChecker::checkStructDeclarationNode(shared_ptr<StructDeclarationNode> node) {
   shared_ptr<ASTNode> foundDefinition = lookupInScope(node->getStructType());
 
-  if (!foundDefinition) {
-    Compiler::getInstance().addException(make_shared<ReferenceError>(node->getStructType()));
+  // Only a struct definition can be instantiated, not any other identifier that happens to share its name
+  if (!foundDefinition || foundDefinition->getNodeType() != ASTNode::STRUCT_DEFINITION) {
+    session->addException(make_shared<ReferenceError>(node->getStructType()));
     return false;
   }
 
@@ -600,7 +646,7 @@ bool TypeChecker::checkStructDeclarationNode(shared_ptr<StructDeclarationNode> n
     auto it = requiredStructFields.find(key->getSymbol()); 
 
     if (it == requiredStructFields.end()) {
-      Compiler::getInstance().addException(
+      session->addException(
         make_shared<IntegrityError>(
           "Struct declaration can't contain keys that are not in its definition. ",
           key->getSymbol() + " is not defined in struct " + node->getStructType()
@@ -611,7 +657,7 @@ bool TypeChecker::checkStructDeclarationNode(shared_ptr<StructDeclarationNode> n
     }
 
     if (!isSameType(it->second, structDeclarationNode->getElements().at(i)->getRight()->getResolvedType())) {
-      Compiler::getInstance().addException(
+      session->addException(
         make_shared<TypeError>(
           "Struct key type mismatch",
           it->second,
@@ -634,7 +680,7 @@ bool TypeChecker::checkStructDeclarationNode(shared_ptr<StructDeclarationNode> n
       missingFields += field.first;
     }
 
-    Compiler::getInstance().addException(
+    session->addException(
       make_shared<IntegrityError>(
         "Struct declaration is missing required field(s) from definition",
         missingFields + " " + (requiredStructFields.size() == 1 ? "is" : "are") + " required in " + node->getStructType() + " but missing in declaration."
@@ -678,7 +724,7 @@ void TypeChecker::hoistFunction(shared_ptr<ASTNode> node) {
   auto existingFuncIdentifierInScope = capsuleDeclarationsTable.lookup(uniqueFuncIdentifier);
 
   if (existingFuncIdentifierInScope.has_value()) {
-    Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(ident->getIdentifier()));
+    session->addException(make_shared<IllegalReassignmentError>(ident->getIdentifier()));
     return;
   }
 
@@ -696,7 +742,7 @@ void TypeChecker::hoistStructDefinition(shared_ptr<ASTNode> node) {
   auto existingStructDefinitionInScope = capsuleDeclarationsTable.lookup(structNode->getName());
   
   if (existingStructDefinitionInScope.has_value()) {
-    Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(structNode->getName()));
+    session->addException(make_shared<IllegalReassignmentError>(structNode->getName()));
     return;
   }
 
@@ -711,7 +757,7 @@ void TypeChecker::hoistIdentifier(shared_ptr<ASTNode> node) {
   auto existingHoistedIdentifier = capsuleDeclarationsTable.lookup(identNode->getIdentifier());
 
   if (existingHoistedIdentifier.has_value()) {
-    Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(identNode->getIdentifier()));
+    session->addException(make_shared<IllegalReassignmentError>(identNode->getIdentifier()));
     return;
   }
 
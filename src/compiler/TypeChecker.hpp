@@ -19,6 +19,7 @@
 #include "parser/ast/StructDefinitionNode.hpp"
 #include "parser/ast/TupleNode.hpp"
 #include "SymbolTableStack.hpp"
+#include "CompilationSession.hpp"
 
 using namespace std;
 
@@ -31,6 +32,11 @@ namespace Theta {
 
   class TypeChecker {
   public:
+    /**
+     * @param compilationSession The compilation session that any type errors encountered are reported to
+     */
+    TypeChecker(shared_ptr<CompilationSession> compilationSession) : session(compilationSession) {}
+
     /**
      * @brief Checks the types of all nodes within an AST recursively
      * 
@@ -41,6 +47,31 @@ namespace Theta {
      */
     bool checkAST(shared_ptr<ASTNode> ast, vector<pair<string, shared_ptr<ASTNode>>> bindToScope = {});
 
+    /**
+     * @brief Prepares the type checker to check the top-level elements of a capsule one at a time with
+     * checkCapsuleElement, instead of checking the whole capsule at once. The declarations of every element are
+     * hoisted, so elements can still reference each other.
+     * @param capsule The capsule whose elements will be checked
+     */
+    void enterCapsule(shared_ptr<CapsuleNode> capsule);
+
+    /**
+     * @brief Checks a single top-level element of the capsule passed to enterCapsule. Unlike checkAST, a failing element
+     * does not prevent the elements checked after it from being checked, which lets the language server re-check only
+     * the elements of a capsule that changed and report errors for each of them.
+     * @param element The element to check
+     * @return true If the element is correctly typed
+     */
+    bool checkCapsuleElement(shared_ptr<ASTNode> element);
+
+    /**
+     * @brief Declares an element of the capsule passed to enterCapsule without checking it again, the same way checking
+     * it did. Elements checked after it see its declaration in scope, exactly as they would if it had been checked with
+     * them, so only the elements that changed need to be re-checked.
+     * @param element An element that was previously checked successfully with checkCapsuleElement
+     */
+    void declareCapsuleElement(shared_ptr<ASTNode> element);
+
     /**
      * @brief Determines if two AST nodes represent the same type.
      * 
@@ -64,6 +95,7 @@ namespace Theta {
     static shared_ptr<TypeDeclarationNode> getFunctionReturnType(shared_ptr<ASTNode> fn);
 
   private:
+    shared_ptr<CompilationSession> session;
     SymbolTableStack<shared_ptr<ASTNode>> identifierTable;
     SymbolTableStack<shared_ptr<ASTNode>> capsuleDeclarationsTable;
     
@@ -94,6 +126,15 @@ namespace Theta {
      */
     bool checkAssignmentNode(shared_ptr<AssignmentNode> node);
 
+    /**
+     * @brief Adds a checked assignment to the current scope, under its qualified identifier as well if it's a function.
+     *
+     * @param node The assignment node to declare.
+     * @return true If the identifier was declared.
+     * @return false If the identifier was already declared in scope.
+     */
+    bool declareAssignment(shared_ptr<AssignmentNode> node);
+
     /**
      * @brief Checks an identifier node to ensure it is defined within the current scope.
      * 
@@ -196,6 +237,15 @@ namespace Theta {
      */
     bool checkStructDefinitionNode(shared_ptr<StructDefinitionNode> node);
 
+    /**
+     * @brief Adds a checked struct definition to the current scope.
+     *
+     * @param node The struct definition node to declare.
+     * @return true If the struct was declared.
+     * @return false If the struct was already defined in scope.
+     */
+    bool declareStructDefinition(shared_ptr<StructDefinitionNode> node);
+
     /**
      * @brief Checks a struct declaration node to ensure all required fields are present and correctly typed.
      * 
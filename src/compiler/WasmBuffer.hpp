@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief A growable byte buffer that knows how to encode the primitives of the WebAssembly binary format, such as
+ * LEB128 integers and length-prefixed names and sections.
+ */
+namespace Theta {
+  class WasmBuffer {
+  public:
+    void writeByte(uint8_t byte) { bytes.push_back(byte); }
+
+    /**
+     * @brief Writes an unsigned LEB128 encoded integer
+     * @param value The value to write
+     */
+    void writeU32(uint32_t value) {
+      do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+
+        if (value != 0) byte |= 0x80;
+
+        bytes.push_back(byte);
+      } while (value != 0);
+    }
+
+    /**
+     * @brief Writes a signed LEB128 encoded integer. Used for both 32 and 64 bit integers, since the encoding only
+     * differs in how many bytes it may take up.
+     * @param value The value to write
+     */
+    void writeS64(int64_t value) {
+      bool more = true;
+
+      while (more) {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+
+        // Stop once the remaining bits are just the sign extension of the byte we're writing
+        if ((value == 0 && (byte & 0x40) == 0) || (value == -1 && (byte & 0x40) != 0)) {
+          more = false;
+        } else {
+          byte |= 0x80;
+        }
+
+        bytes.push_back(byte);
+      }
+    }
+
+    void writeS32(int32_t value) { writeS64(value); }
+
+    /**
+     * @brief Writes a length-prefixed UTF-8 name, as used for export names and string literals
+     * @param name The name to write
+     */
+    void writeName(const string &name) {
+      writeU32(name.size());
+      bytes.insert(bytes.end(), name.begin(), name.end());
+    }
+
+    /**
+     * @brief Appends the contents of another buffer to this one
+     * @param other The buffer to append
+     */
+    void append(const WasmBuffer &other) {
+      bytes.insert(bytes.end(), other.bytes.begin(), other.bytes.end());
+    }
+
+    /**
+     * @brief Writes a section with the given id, prefixed with the size of its contents
+     * @param id The section id
+     * @param contents The contents of the section
+     */
+    void writeSection(uint8_t id, const WasmBuffer &contents) {
+      writeByte(id);
+      writeU32(contents.size());
+      append(contents);
+    }
+
+    size_t size() const { return bytes.size(); }
+
+    bool empty() const { return bytes.empty(); }
+
+    const vector<uint8_t>& getBytes() const { return bytes; }
+
+  private:
+    vector<uint8_t> bytes;
+  };
+}
@@ -0,0 +1,90 @@
+#include "ClosureEscapeAnalysisPass.hpp"
+#include "compiler/DataTypes.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+#include <set>
+
+using namespace Theta;
+
+void ClosureEscapeAnalysisPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() != ASTNode::BLOCK) return;
+
+  shared_ptr<ASTNodeList> block = dynamic_pointer_cast<ASTNodeList>(ast);
+  vector<shared_ptr<ASTNode>> elements = block->getElements();
+
+  for (int i = 0; i < elements.size(); i++) {
+    if (elements[i]->getNodeType() != ASTNode::ASSIGNMENT) continue;
+
+    shared_ptr<ASTNode> value = elements[i]->getRight();
+    shared_ptr<TypeDeclarationNode> type = dynamic_pointer_cast<TypeDeclarationNode>(value->getResolvedType());
+
+    if (value->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+      shared_ptr<FunctionDeclarationNode> function = dynamic_pointer_cast<FunctionDeclarationNode>(value);
+      bool isEscaping = ClosureEscapeAnalysisPass::isEscaping(block, i, function->getParameters()->getElements().size());
+
+      if (!isEscaping && function->isEscaping()) addToStatistic("closures kept out of memory");
+
+      function->setEscaping(isEscaping);
+    } else if (value->getNodeType() == ASTNode::FUNCTION_INVOCATION && type && type->getType() == DataTypes::FUNCTION) {
+      // The closure a call returns takes the parameters of its type, which has no separate return type without them
+      int parameterCount = type->getValue() ? 0 : type->getElements().size() - 1;
+      shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(value);
+      bool isEscaping = ClosureEscapeAnalysisPass::isEscaping(block, i, parameterCount);
+
+      if (!isEscaping && invocation->isEscaping()) addToStatistic("closures kept out of memory");
+
+      invocation->setEscaping(isEscaping);
+    }
+  }
+}
+
+bool ClosureEscapeAnalysisPass::isEscaping(shared_ptr<ASTNodeList> block, int statementIdx, int parameterCount) {
+  vector<shared_ptr<ASTNode>> elements = block->getElements();
+
+  // The last statement is the value of the block, so the function is handed to whatever uses it
+  if (statementIdx == elements.size() - 1) return true;
+
+  string name = dynamic_pointer_cast<IdentifierNode>(elements[statementIdx]->getLeft())->getIdentifier();
+
+  bool isEscaping = false;
+  set<shared_ptr<ASTNode>> callees;
+
+  for (int i = 0; i < elements.size() && !isEscaping; i++) {
+    if (i == statementIdx) continue;
+
+    forEachNode(elements[i], [&name, parameterCount, &isEscaping, &callees](shared_ptr<ASTNode> node) {
+      if (isEscaping) return false;
+
+      if (node->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+        // A function declared here that mentions the name captures it, which needs the closure
+        forEachNode(node, [&name, &isEscaping](shared_ptr<ASTNode> descendant) {
+          shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(descendant);
+
+          if (identifier && identifier->getIdentifier() == name) isEscaping = true;
+
+          return !isEscaping;
+        });
+
+        return false;
+      }
+
+      if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+        shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(node);
+        shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(invocation->getIdentifier());
+
+        if (identifier && identifier->getIdentifier() == name && invocation->getParameters()->getElements().size() == parameterCount) {
+          callees.insert(identifier);
+        }
+      } else if (node->getNodeType() == ASTNode::IDENTIFIER && !callees.count(node)) {
+        // Any other mention of the name, including binding it again, is treated as the function escaping
+        isEscaping = dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier() == name;
+      }
+
+      return !isEscaping;
+    });
+  }
+
+  return isEscaping;
+}
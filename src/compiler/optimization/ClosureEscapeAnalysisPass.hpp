@@ -0,0 +1,36 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include <memory>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that finds the functions bound inside other functions that never escape the block
+ * binding them, and marks them so code generation can skip building a closure for them. A function escapes when
+ * anything other than a call passing all of its arguments refers to it: it's returned, passed to another function,
+ * partially applied, or used by a function declared after it, which would need to capture it.
+ *
+ * Code generation calls a function declared in the block that doesn't escape directly, passing the values it would
+ * have captured as its leading arguments, instead of storing them in memory and calling it through the closure. The
+ * closures returned by calls to curried functions are marked too, so calls to them can be specialized the same way.
+ */
+namespace Theta {
+  class ClosureEscapeAnalysisPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Whether the function bound to a name by the statement at the given index of a block escapes it
+     * @param parameterCount How many arguments a call has to pass for the function to be called rather than partially
+     * applied
+     */
+    static bool isEscaping(shared_ptr<ASTNodeList> block, int statementIdx, int parameterCount);
+  };
+}
@@ -0,0 +1,196 @@
+#include "CommonSubexpressionEliminationPass.hpp"
+#include "compiler/Compiler.hpp"
+#include "compiler/DataTypes.hpp"
+#include "parser/ast/AssignmentNode.hpp"
+#include "parser/ast/BinaryOperationNode.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/LiteralNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+#include "parser/ast/UnaryOperationNode.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+
+using namespace Theta;
+
+void CommonSubexpressionEliminationPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() != ASTNode::BLOCK) return;
+
+  eliminateCommonSubexpressions(dynamic_pointer_cast<ASTNodeList>(ast));
+}
+
+void CommonSubexpressionEliminationPass::hoistNecessary(shared_ptr<ASTNode> &ast) {
+  vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<ASTNodeList>(ast->getValue())->getElements();
+
+  pureFunctions = findPureFunctions(elements);
+}
+
+void CommonSubexpressionEliminationPass::eliminateCommonSubexpressions(shared_ptr<ASTNodeList> block) {
+  bool isEliminated = true;
+
+  while (isEliminated) {
+    vector<shared_ptr<ASTNode>> elements = block->getElements();
+    map<string, vector<pair<int, shared_ptr<ASTNode>>>> occurrencesByKey;
+
+    for (int i = 0; i < elements.size(); i++) {
+      rewriteEvaluatedExpressions(elements[i], [this, &occurrencesByKey, i](shared_ptr<ASTNode> node) {
+        ASTNode::Types nodeType = node->getNodeType();
+
+        if (
+          nodeType != ASTNode::BINARY_OPERATION &&
+          nodeType != ASTNode::UNARY_OPERATION &&
+          nodeType != ASTNode::FUNCTION_INVOCATION
+        ) return shared_ptr<ASTNode>();
+
+        shared_ptr<TypeDeclarationNode> type = dynamic_pointer_cast<TypeDeclarationNode>(node->getResolvedType());
+
+        // A function value is a closure, which code generation keeps track of by the name it's bound to
+        if (!type || type->getType() == DataTypes::FUNCTION || !isPure(node, pureFunctions)) return shared_ptr<ASTNode>();
+
+        string key = expressionKey(node);
+        if (!key.empty()) occurrencesByKey[key].push_back(make_pair(i, node));
+
+        return shared_ptr<ASTNode>();
+      });
+    }
+
+    vector<vector<pair<int, shared_ptr<ASTNode>>>> repeatedExpressions;
+    for (auto &[key, occurrences] : occurrencesByKey) {
+      if (occurrences.size() > 1) repeatedExpressions.push_back(occurrences);
+    }
+
+    stable_sort(
+      repeatedExpressions.begin(),
+      repeatedExpressions.end(),
+      [](const vector<pair<int, shared_ptr<ASTNode>>> &a, const vector<pair<int, shared_ptr<ASTNode>>> &b) {
+        return countNodes(a.front().second) > countNodes(b.front().second);
+      }
+    );
+
+    isEliminated = false;
+    for (int i = 0; i < repeatedExpressions.size() && !isEliminated; i++) {
+      isEliminated = eliminateRepeats(block, repeatedExpressions[i]);
+    }
+  }
+}
+
+bool CommonSubexpressionEliminationPass::eliminateRepeats(
+  shared_ptr<ASTNodeList> block,
+  vector<pair<int, shared_ptr<ASTNode>>> &occurrences
+) {
+  vector<shared_ptr<ASTNode>> elements = block->getElements();
+  int firstStatement = occurrences.front().first;
+  shared_ptr<ASTNode> expression = occurrences.front().second;
+
+  set<string> names;
+  forEachNode(expression, [&names](shared_ptr<ASTNode> node) {
+    if (node->getNodeType() == ASTNode::IDENTIFIER) names.insert(dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier());
+
+    return true;
+  });
+
+  // Every occurrence has to see the same values for the names in the expression as the first one does
+  for (int i = firstStatement; i < elements.size(); i++) {
+    if (elements[i]->getNodeType() != ASTNode::ASSIGNMENT) continue;
+
+    if (names.count(dynamic_pointer_cast<IdentifierNode>(elements[i]->getLeft())->getIdentifier())) return false;
+  }
+
+  set<shared_ptr<ASTNode>> occurrenceNodes;
+  for (auto &occurrence : occurrences) occurrenceNodes.insert(occurrence.second);
+
+  // A statement that binds nothing but the expression already holds its value in a local
+  bool isReusingBinding = elements[firstStatement]->getNodeType() == ASTNode::ASSIGNMENT &&
+    elements[firstStatement]->getRight() == expression;
+
+  string localName = isReusingBinding
+    ? dynamic_pointer_cast<IdentifierNode>(elements[firstStatement]->getLeft())->getIdentifier()
+    : "ThetaLang.internal.cse" + to_string(introducedLocalCount++);
+
+  for (int i = firstStatement; i < elements.size(); i++) {
+    if (isReusingBinding && i == firstStatement) continue;
+
+    elements[i] = rewriteEvaluatedExpressions(elements[i], [&occurrenceNodes, &localName](shared_ptr<ASTNode> node) {
+      if (!occurrenceNodes.count(node)) return shared_ptr<ASTNode>();
+
+      shared_ptr<IdentifierNode> reference = make_shared<IdentifierNode>(localName, node->getParent());
+      reference->setResolvedType(node->getResolvedType());
+
+      return dynamic_pointer_cast<ASTNode>(reference);
+    });
+  }
+
+  if (!isReusingBinding) {
+    shared_ptr<AssignmentNode> assignment = make_shared<AssignmentNode>(block);
+    shared_ptr<IdentifierNode> local = make_shared<IdentifierNode>(localName, assignment);
+
+    local->setValue(expression->getResolvedType());
+    assignment->setLeft(local);
+    assignment->setRight(expression);
+    assignment->setResolvedType(expression->getResolvedType());
+    expression->setParent(assignment);
+
+    elements.insert(elements.begin() + firstStatement, assignment);
+
+    addToStatistic("locals introduced");
+  }
+
+  block->setElements(elements);
+
+  addToStatistic("expressions eliminated", occurrences.size() - 1);
+  markChanged();
+
+  return true;
+}
+
+string CommonSubexpressionEliminationPass::expressionKey(shared_ptr<ASTNode> node) {
+  if (!node) return "";
+
+  switch (node->getNodeType()) {
+    case ASTNode::IDENTIFIER:
+      return dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier();
+    case ASTNode::NUMBER_LITERAL:
+    case ASTNode::BOOLEAN_LITERAL:
+      return dynamic_pointer_cast<LiteralNode>(node)->getLiteralValue();
+    case ASTNode::STRING_LITERAL:
+      return "'" + dynamic_pointer_cast<LiteralNode>(node)->getLiteralValue() + "'";
+    case ASTNode::BINARY_OPERATION: {
+      string left = expressionKey(node->getLeft());
+      string right = expressionKey(node->getRight());
+
+      if (left.empty() || right.empty()) return "";
+
+      return "(" + dynamic_pointer_cast<BinaryOperationNode>(node)->getOperator() + " " + left + " " + right + ")";
+    }
+    case ASTNode::UNARY_OPERATION: {
+      string operand = expressionKey(node->getValue());
+
+      if (operand.empty()) return "";
+
+      return "(" + dynamic_pointer_cast<UnaryOperationNode>(node)->getOperator() + " " + operand + ")";
+    }
+    case ASTNode::FUNCTION_INVOCATION: {
+      shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(node);
+      string function = expressionKey(invocation->getIdentifier());
+
+      if (function.empty()) return "";
+
+      string key = "(call " + function;
+
+      for (auto &argument : invocation->getParameters()->getElements()) {
+        string argumentKey = expressionKey(argument);
+
+        if (argumentKey.empty()) return "";
+
+        key += " " + argumentKey;
+      }
+
+      return key + ")";
+    }
+    default:
+      return "";
+  }
+}
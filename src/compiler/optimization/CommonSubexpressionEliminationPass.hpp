@@ -0,0 +1,69 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that computes an expression a block evaluates more than once only the first time, and
+ * reuses its value after that. Values in Theta never change once they are bound, so a pure expression always has the
+ * same value within a block, as long as the names in it are bound the same way at every repeat.
+ *
+ * The value is kept in a local the pass introduces just before the statement that first evaluates the expression, or
+ * in the binding the statement already makes, when the expression is all it assigns. Only expressions the block always
+ * evaluates are considered, so an expression inside one branch of a control flow is never moved out of it. Calls count
+ * as pure when they call a capsule function that always returns without trapping, which is worked out from the bodies
+ * of the capsule's functions.
+ */
+namespace Theta {
+  class CommonSubexpressionEliminationPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    /**
+     * @brief The capsule functions whose calls are pure, by qualified function identifier
+     */
+    set<string> pureFunctions;
+
+    /**
+     * @brief How many locals the pass has introduced, which keeps their names unique
+     */
+    int introducedLocalCount = 0;
+
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Finds the capsule functions whose calls are pure, before its elements are traversed
+     */
+    void hoistNecessary(shared_ptr<ASTNode> &ast) override;
+
+    /**
+     * @brief Eliminates the repeats of every pure expression the block evaluates more than once, starting with the
+     * largest, since the expressions nested in it are eliminated along with it
+     */
+    void eliminateCommonSubexpressions(shared_ptr<ASTNodeList> block);
+
+    /**
+     * @brief Replaces the occurrences of an expression in a block with a reference to a local holding its value
+     * @param occurrences Each occurrence, with the index of the statement it's in, in the order they are evaluated
+     * @return Whether the occurrences could be replaced, which they can't if a name in the expression is bound again
+     * in the block after its first occurrence
+     */
+    bool eliminateRepeats(shared_ptr<ASTNodeList> block, vector<pair<int, shared_ptr<ASTNode>>> &occurrences);
+
+    /**
+     * @brief Builds a key that two expressions share exactly when they are made of the same operations on the same
+     * names and literals
+     * @return The key, or an empty string if the expression contains nodes the pass doesn't compare
+     */
+    static string expressionKey(shared_ptr<ASTNode> node);
+  };
+}
@@ -0,0 +1,260 @@
+#include "CompileTimeEvaluationPass.hpp"
+#include "ConstantFoldingPass.hpp"
+#include "compiler/Compiler.hpp"
+#include "compiler/DataTypes.hpp"
+#include "lexer/Lexemes.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include "parser/ast/BinaryOperationNode.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+#include "parser/ast/UnaryOperationNode.hpp"
+#include <memory>
+
+using namespace Theta;
+
+void CompileTimeEvaluationPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() != ASTNode::FUNCTION_INVOCATION) return;
+
+  shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(ast);
+  shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(invocation->getIdentifier());
+  shared_ptr<TypeDeclarationNode> type = dynamic_pointer_cast<TypeDeclarationNode>(invocation->getResolvedType());
+
+  if (!identifier || !type || isShadowed(identifier->getIdentifier(), invocation)) return;
+
+  ASTNode::Types literalType;
+  if (type->getType() == DataTypes::NUMBER) {
+    literalType = ASTNode::NUMBER_LITERAL;
+  } else if (type->getType() == DataTypes::STRING) {
+    literalType = ASTNode::STRING_LITERAL;
+  } else if (type->getType() == DataTypes::BOOLEAN) {
+    literalType = ASTNode::BOOLEAN_LITERAL;
+  } else {
+    return;
+  }
+
+  vector<shared_ptr<LiteralNode>> arguments;
+  for (auto &argument : invocation->getParameters()->getElements()) {
+    if (!isValueLiteral(argument)) return;
+
+    arguments.push_back(dynamic_pointer_cast<LiteralNode>(argument));
+  }
+
+  remainingSteps = EVALUATION_STEP_LIMIT;
+  depth = 0;
+
+  shared_ptr<LiteralNode> result = evaluateCall(
+    Compiler::getQualifiedFunctionIdentifier(identifier->getIdentifier(), invocation),
+    arguments
+  );
+
+  if (!result || result->getNodeType() != literalType) return;
+
+  shared_ptr<LiteralNode> literal = make_shared<LiteralNode>(literalType, result->getLiteralValue(), invocation->getParent());
+  literal->setResolvedType(type);
+
+  ast = literal;
+
+  addToStatistic("calls evaluated");
+  markChanged();
+}
+
+void CompileTimeEvaluationPass::hoistNecessary(shared_ptr<ASTNode> &ast) {
+  functions.clear();
+
+  for (auto &element : dynamic_pointer_cast<ASTNodeList>(ast->getValue())->getElements()) {
+    if (element->getNodeType() != ASTNode::ASSIGNMENT || element->getRight()->getNodeType() != ASTNode::FUNCTION_DECLARATION) {
+      continue;
+    }
+
+    string identifier = dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier();
+    shared_ptr<FunctionDeclarationNode> function = dynamic_pointer_cast<FunctionDeclarationNode>(element->getRight());
+
+    functions[Compiler::getQualifiedFunctionIdentifier(identifier, function)] = function;
+  }
+}
+
+shared_ptr<LiteralNode> CompileTimeEvaluationPass::evaluateCall(string qualifiedIdentifier, vector<shared_ptr<LiteralNode>> &arguments) {
+  auto function = functions.find(qualifiedIdentifier);
+  if (function == functions.end()) return nullptr;
+
+  string key = qualifiedIdentifier;
+  for (auto &argument : arguments) key += "|" + to_string(argument->getNodeType()) + ":" + argument->getLiteralValue();
+
+  auto evaluatedCall = evaluatedCalls.find(key);
+  if (evaluatedCall != evaluatedCalls.end()) return evaluatedCall->second;
+
+  vector<shared_ptr<ASTNode>> parameters = function->second->getParameters()->getElements();
+  if (parameters.size() != arguments.size() || depth >= EVALUATION_DEPTH_LIMIT) return nullptr;
+
+  map<string, shared_ptr<LiteralNode>> bindings;
+  for (int i = 0; i < parameters.size(); i++) {
+    bindings[dynamic_pointer_cast<IdentifierNode>(parameters.at(i))->getIdentifier()] = arguments.at(i);
+  }
+
+  bool isReturning = false;
+
+  depth++;
+  shared_ptr<LiteralNode> result = evaluate(function->second->getDefinition(), bindings, isReturning);
+  depth--;
+
+  if (result) evaluatedCalls[key] = result;
+
+  return result;
+}
+
+shared_ptr<LiteralNode> CompileTimeEvaluationPass::evaluate(
+  shared_ptr<ASTNode> node,
+  map<string, shared_ptr<LiteralNode>> &bindings,
+  bool &isReturning
+) {
+  if (!node || --remainingSteps < 0) return nullptr;
+
+  switch (node->getNodeType()) {
+    case ASTNode::NUMBER_LITERAL:
+    case ASTNode::STRING_LITERAL:
+    case ASTNode::BOOLEAN_LITERAL:
+      return dynamic_pointer_cast<LiteralNode>(node);
+    case ASTNode::IDENTIFIER: {
+      auto binding = bindings.find(dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier());
+
+      return binding != bindings.end() ? binding->second : nullptr;
+    }
+    case ASTNode::BINARY_OPERATION: {
+      shared_ptr<LiteralNode> left = evaluate(node->getLeft(), bindings, isReturning);
+      if (!left || isReturning) return left;
+
+      shared_ptr<LiteralNode> right = evaluate(node->getRight(), bindings, isReturning);
+      if (!right || isReturning) return right;
+
+      return dynamic_pointer_cast<LiteralNode>(ConstantFoldingPass::evaluateBinaryOperation(
+        dynamic_pointer_cast<BinaryOperationNode>(node)->getOperator(),
+        left,
+        right,
+        nullptr
+      ));
+    }
+    case ASTNode::UNARY_OPERATION: {
+      shared_ptr<LiteralNode> operand = evaluate(node->getValue(), bindings, isReturning);
+      if (!operand || isReturning) return operand;
+
+      // Negation is subtraction from 0, and not is comparison to false, which evaluate the same way they do at runtime
+      string op = dynamic_pointer_cast<UnaryOperationNode>(node)->getOperator();
+
+      if (op == Lexemes::MINUS && operand->getNodeType() == ASTNode::NUMBER_LITERAL) {
+        return dynamic_pointer_cast<LiteralNode>(ConstantFoldingPass::evaluateBinaryOperation(
+          Lexemes::MINUS,
+          make_shared<LiteralNode>(ASTNode::NUMBER_LITERAL, "0", nullptr),
+          operand,
+          nullptr
+        ));
+      }
+
+      if (op == Lexemes::NOT && operand->getNodeType() == ASTNode::BOOLEAN_LITERAL) {
+        return dynamic_pointer_cast<LiteralNode>(ConstantFoldingPass::evaluateBinaryOperation(
+          Lexemes::EQUALITY,
+          make_shared<LiteralNode>(ASTNode::BOOLEAN_LITERAL, Lexemes::FALSE, nullptr),
+          operand,
+          nullptr
+        ));
+      }
+
+      return nullptr;
+    }
+    case ASTNode::BLOCK: {
+      // Names bound in the block go out of scope at its end
+      map<string, shared_ptr<LiteralNode>> blockBindings = bindings;
+      shared_ptr<LiteralNode> value;
+
+      vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<ASTNodeList>(node)->getElements();
+
+      for (int i = 0; i < elements.size(); i++) {
+        if (elements.at(i)->getNodeType() == ASTNode::CONTROL_FLOW) {
+          bool isSkipped = false;
+          value = evaluateControlFlow(dynamic_pointer_cast<ControlFlowNode>(elements.at(i)), blockBindings, isReturning, isSkipped);
+
+          // A control flow that isn't the block's value can take none of its branches, like an early return
+          if (isSkipped && i < elements.size() - 1) continue;
+        } else {
+          value = evaluate(elements.at(i), blockBindings, isReturning);
+        }
+
+        if (!value || isReturning) return value;
+      }
+
+      return value;
+    }
+    case ASTNode::ASSIGNMENT: {
+      shared_ptr<LiteralNode> value = evaluate(node->getRight(), bindings, isReturning);
+      if (!value || isReturning) return value;
+
+      bindings[dynamic_pointer_cast<IdentifierNode>(node->getLeft())->getIdentifier()] = value;
+
+      return value;
+    }
+    case ASTNode::RETURN: {
+      shared_ptr<LiteralNode> value = evaluate(node->getValue(), bindings, isReturning);
+
+      isReturning = true;
+
+      return value;
+    }
+    case ASTNode::CONTROL_FLOW: {
+      bool isSkipped = false;
+
+      return evaluateControlFlow(dynamic_pointer_cast<ControlFlowNode>(node), bindings, isReturning, isSkipped);
+    }
+    case ASTNode::FUNCTION_INVOCATION: {
+      shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(node);
+      shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(invocation->getIdentifier());
+
+      // Only literals are ever bound, so a name that's bound here can't be a function
+      if (!identifier || bindings.count(identifier->getIdentifier())) return nullptr;
+
+      vector<shared_ptr<LiteralNode>> arguments;
+      for (auto &argument : invocation->getParameters()->getElements()) {
+        shared_ptr<LiteralNode> value = evaluate(argument, bindings, isReturning);
+        if (!value || isReturning) return value;
+
+        arguments.push_back(value);
+      }
+
+      return evaluateCall(Compiler::getQualifiedFunctionIdentifier(identifier->getIdentifier(), invocation), arguments);
+    }
+    default:
+      return nullptr;
+  }
+}
+
+shared_ptr<LiteralNode> CompileTimeEvaluationPass::evaluateControlFlow(
+  shared_ptr<ControlFlowNode> node,
+  map<string, shared_ptr<LiteralNode>> &bindings,
+  bool &isReturning,
+  bool &isSkipped
+) {
+  for (auto &conditionExpressionPair : node->getConditionExpressionPairs()) {
+    if (!conditionExpressionPair.first) return evaluate(conditionExpressionPair.second, bindings, isReturning);
+
+    shared_ptr<LiteralNode> condition = evaluate(conditionExpressionPair.first, bindings, isReturning);
+    if (!condition || isReturning) return condition;
+
+    if (condition->getNodeType() != ASTNode::BOOLEAN_LITERAL) return nullptr;
+
+    if (condition->getLiteralValue() == Lexemes::TRUE) {
+      return evaluate(conditionExpressionPair.second, bindings, isReturning);
+    }
+  }
+
+  isSkipped = true;
+
+  return nullptr;
+}
+
+bool CompileTimeEvaluationPass::isValueLiteral(shared_ptr<ASTNode> node) {
+  return (
+    node->getNodeType() == ASTNode::NUMBER_LITERAL ||
+    node->getNodeType() == ASTNode::STRING_LITERAL ||
+    node->getNodeType() == ASTNode::BOOLEAN_LITERAL
+  );
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/LiteralNode.hpp"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that evaluates calls to capsule functions at compile time when every argument is a
+ * literal, replacing the call with the literal it returns. Lookup tables and configuration derived from literals, like
+ * `daysInYear<Number> = daysIn(2024)`, are then computed once by the compiler instead of on every run.
+ *
+ * Calls are evaluated by interpreting the bodies of the functions they call. Theta has no side effects other than
+ * those of the functions it links, so a function is pure exactly when the interpreter can evaluate it: its body only
+ * binds, compares and computes Numbers, Booleans and Strings, and only calls other capsule functions. Anything else,
+ * like a closure, a call into another capsule, or an operation that would trap at runtime, leaves the call for the
+ * runtime. Evaluation gives up after a fixed number of steps, so a call that recurses too deeply or never returns
+ * doesn't hang the compiler, and results are cached by the function called and its arguments.
+ */
+namespace Theta {
+  class CompileTimeEvaluationPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    /**
+     * @brief How many nodes a call may evaluate, including those of the calls it makes, before it's left for the runtime
+     */
+    int EVALUATION_STEP_LIMIT = 100000;
+
+    /**
+     * @brief How deeply calls may nest while a call is evaluated, which keeps the interpreter's own stack in bounds
+     */
+    int EVALUATION_DEPTH_LIMIT = 500;
+
+    int remainingSteps = 0;
+    int depth = 0;
+
+    /**
+     * @brief The capsule's functions, by qualified function identifier
+     */
+    map<string, shared_ptr<FunctionDeclarationNode>> functions;
+
+    /**
+     * @brief The literal each call evaluated so far returned, by the qualified identifier of the function called and
+     * its arguments
+     */
+    map<string, shared_ptr<LiteralNode>> evaluatedCalls;
+
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Collects the capsule's functions, before its elements are traversed
+     */
+    void hoistNecessary(shared_ptr<ASTNode> &ast) override;
+
+    /**
+     * @brief Evaluates a call to a capsule function with the given arguments
+     * @return The literal the call returns, or nullptr if it can't be evaluated at compile time
+     */
+    shared_ptr<LiteralNode> evaluateCall(string qualifiedIdentifier, vector<shared_ptr<LiteralNode>> &arguments);
+
+    /**
+     * @brief Evaluates an expression, with the given literals bound to the names in scope
+     * @param isReturning Set when the expression returns from the function being evaluated
+     * @return The literal the expression evaluates to, or nullptr if it can't be evaluated at compile time
+     */
+    shared_ptr<LiteralNode> evaluate(shared_ptr<ASTNode> node, map<string, shared_ptr<LiteralNode>> &bindings, bool &isReturning);
+
+    /**
+     * @brief Evaluates the branch of a control flow whose condition holds
+     * @param isSkipped Set when no condition holds and there is no else, in which case the control flow has no value
+     * @return The literal the branch evaluates to, or nullptr if it can't be evaluated at compile time or was skipped
+     */
+    shared_ptr<LiteralNode> evaluateControlFlow(
+      shared_ptr<ControlFlowNode> node,
+      map<string, shared_ptr<LiteralNode>> &bindings,
+      bool &isReturning,
+      bool &isSkipped
+    );
+
+    /**
+     * @brief Whether the node is a literal the interpreter works with
+     */
+    static bool isValueLiteral(shared_ptr<ASTNode> node);
+  };
+}
@@ -0,0 +1,407 @@
+#include "ConstantFoldingPass.hpp"
+#include "compiler/DataTypes.hpp"
+#include "lexer/Lexemes.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <memory>
+
+using namespace Theta;
+
+void ConstantFoldingPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  shared_ptr<ASTNode> replacement;
+
+  if (ast->getNodeType() == ASTNode::BINARY_OPERATION) {
+    replacement = foldBinaryOperation(dynamic_pointer_cast<BinaryOperationNode>(ast));
+  } else if (ast->getNodeType() == ASTNode::UNARY_OPERATION) {
+    replacement = foldUnaryOperation(dynamic_pointer_cast<UnaryOperationNode>(ast));
+  } else if (ast->getNodeType() == ASTNode::CONTROL_FLOW) {
+    replacement = removeUntakenBranches(dynamic_pointer_cast<ControlFlowNode>(ast));
+  }
+
+  if (!replacement) return;
+
+  ast = replacement;
+  markChanged();
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::foldBinaryOperation(shared_ptr<BinaryOperationNode> node) {
+  if (!node->getLeft() || !node->getRight()) return nullptr;
+
+  if (isLiteral(node->getLeft()) && isLiteral(node->getRight())) {
+    return evaluateBinaryOperation(
+      node->getOperator(),
+      dynamic_pointer_cast<LiteralNode>(node->getLeft()),
+      dynamic_pointer_cast<LiteralNode>(node->getRight()),
+      node->getParent()
+    );
+  }
+
+  return simplifyBinaryOperation(node);
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::evaluateBinaryOperation(
+  string op,
+  shared_ptr<LiteralNode> left,
+  shared_ptr<LiteralNode> right,
+  shared_ptr<ASTNode> parent
+) {
+  if (left->getNodeType() != right->getNodeType()) return nullptr;
+
+  if (left->getNodeType() == ASTNode::NUMBER_LITERAL) {
+    int64_t l;
+    int64_t r;
+
+    if (!parseInteger(left, l) || !parseInteger(right, r)) return nullptr;
+
+    // Numbers are i64s at runtime, which wrap around on overflow instead of being undefined like they are in C++
+    uint64_t ul = l;
+    uint64_t ur = r;
+
+    if (op == Lexemes::PLUS) return makeNumber(ul + ur, parent);
+    if (op == Lexemes::MINUS) return makeNumber(ul - ur, parent);
+    if (op == Lexemes::TIMES) return makeNumber(ul * ur, parent);
+
+    // These trap at runtime, so they have to stay there
+    bool isTrapping = r == 0 || (l == numeric_limits<int64_t>::min() && r == -1);
+
+    if (op == Lexemes::DIVISION && !isTrapping) return makeNumber(l / r, parent);
+    if (op == Lexemes::MODULO && !isTrapping) return makeNumber(l % r, parent);
+
+    if (op == Lexemes::EXPONENT && r >= 0) {
+      uint64_t result = 1;
+
+      for (uint64_t base = ul, exponent = ur; exponent > 0; exponent >>= 1) {
+        if (exponent & 1) result *= base;
+        base *= base;
+      }
+
+      return makeNumber(result, parent);
+    }
+
+    if (op == Lexemes::EQUALITY) return makeBoolean(l == r, parent);
+    if (op == Lexemes::INEQUALITY) return makeBoolean(l != r, parent);
+    if (op == Lexemes::LT) return makeBoolean(l < r, parent);
+    if (op == Lexemes::GT) return makeBoolean(l > r, parent);
+    if (op == Lexemes::LTEQ) return makeBoolean(l <= r, parent);
+    if (op == Lexemes::GTEQ) return makeBoolean(l >= r, parent);
+  } else if (left->getNodeType() == ASTNode::STRING_LITERAL) {
+    string l = left->getLiteralValue();
+    string r = right->getLiteralValue();
+
+    if (op == Lexemes::PLUS) return make_shared<LiteralNode>(ASTNode::STRING_LITERAL, l + r, parent);
+    if (op == Lexemes::EQUALITY) return makeBoolean(l == r, parent);
+    if (op == Lexemes::INEQUALITY) return makeBoolean(l != r, parent);
+  } else if (left->getNodeType() == ASTNode::BOOLEAN_LITERAL) {
+    bool l = left->getLiteralValue() == Lexemes::TRUE;
+    bool r = right->getLiteralValue() == Lexemes::TRUE;
+
+    if (op == Lexemes::AND) return makeBoolean(l && r, parent);
+    if (op == Lexemes::OR) return makeBoolean(l || r, parent);
+    if (op == Lexemes::EQUALITY) return makeBoolean(l == r, parent);
+    if (op == Lexemes::INEQUALITY) return makeBoolean(l != r, parent);
+  }
+
+  return nullptr;
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::simplifyBinaryOperation(shared_ptr<BinaryOperationNode> node) {
+  string op = node->getOperator();
+  shared_ptr<ASTNode> left = node->getLeft();
+  shared_ptr<ASTNode> right = node->getRight();
+
+  auto isNumber = [](shared_ptr<ASTNode> operand, int64_t value) {
+    int64_t literalValue;
+
+    return (
+      operand->getNodeType() == ASTNode::NUMBER_LITERAL &&
+      parseInteger(dynamic_pointer_cast<LiteralNode>(operand), literalValue) &&
+      literalValue == value
+    );
+  };
+
+  auto isBoolean = [](shared_ptr<ASTNode> operand, bool value) {
+    return (
+      operand->getNodeType() == ASTNode::BOOLEAN_LITERAL &&
+      dynamic_pointer_cast<LiteralNode>(operand)->getLiteralValue() == (value ? Lexemes::TRUE : Lexemes::FALSE)
+    );
+  };
+
+  auto isEmptyString = [](shared_ptr<ASTNode> operand) {
+    return operand->getNodeType() == ASTNode::STRING_LITERAL && dynamic_pointer_cast<LiteralNode>(operand)->getLiteralValue() == "";
+  };
+
+  if (op == Lexemes::PLUS) {
+    if (isNumber(right, 0) && getStaticType(left) == DataTypes::NUMBER) return replaceWith(node, left);
+    if (isNumber(left, 0) && getStaticType(right) == DataTypes::NUMBER) return replaceWith(node, right);
+    if (isEmptyString(right) && getStaticType(left) == DataTypes::STRING) return replaceWith(node, left);
+    if (isEmptyString(left) && getStaticType(right) == DataTypes::STRING) return replaceWith(node, right);
+
+    return joinAdjacentStrings(node);
+  } else if (op == Lexemes::MINUS) {
+    if (isNumber(right, 0) && getStaticType(left) == DataTypes::NUMBER) return replaceWith(node, left);
+  } else if (op == Lexemes::TIMES) {
+    if (isNumber(right, 1) && getStaticType(left) == DataTypes::NUMBER) return replaceWith(node, left);
+    if (isNumber(left, 1) && getStaticType(right) == DataTypes::NUMBER) return replaceWith(node, right);
+
+    if (isNumber(right, 0) && isTrivial(left) && getStaticType(left) == DataTypes::NUMBER) return makeNumber(0, node->getParent());
+    if (isNumber(left, 0) && isTrivial(right) && getStaticType(right) == DataTypes::NUMBER) return makeNumber(0, node->getParent());
+  } else if (op == Lexemes::DIVISION) {
+    if (isNumber(right, 1) && getStaticType(left) == DataTypes::NUMBER) return replaceWith(node, left);
+  } else if (op == Lexemes::EXPONENT) {
+    if (getStaticType(left) != DataTypes::NUMBER) return nullptr;
+
+    if (isNumber(right, 1)) return replaceWith(node, left);
+    if (isNumber(right, 0) && isTrivial(left)) return makeNumber(1, node->getParent());
+
+    // Squaring is a single multiplication, which is much cheaper than a call to Theta.Math.pow. The base is only
+    // repeated if it's an identifier, so nothing gets evaluated twice
+    if (isNumber(right, 2) && left->getNodeType() == ASTNode::IDENTIFIER) {
+      shared_ptr<BinaryOperationNode> square = make_shared<BinaryOperationNode>(Lexemes::TIMES, node->getParent());
+
+      left->setParent(square);
+      square->setLeft(left);
+      square->setRight(make_shared<IdentifierNode>(dynamic_pointer_cast<IdentifierNode>(left)->getIdentifier(), square));
+
+      return square;
+    }
+  } else if (op == Lexemes::AND) {
+    if (isBoolean(left, true) && getStaticType(right) == DataTypes::BOOLEAN) return replaceWith(node, right);
+    if (isBoolean(right, true) && getStaticType(left) == DataTypes::BOOLEAN) return replaceWith(node, left);
+
+    // The right operand is never evaluated when the left is false
+    if (isBoolean(left, false) && getStaticType(right) == DataTypes::BOOLEAN) return makeBoolean(false, node->getParent());
+    if (isBoolean(right, false) && isTrivial(left) && getStaticType(left) == DataTypes::BOOLEAN) return makeBoolean(false, node->getParent());
+  } else if (op == Lexemes::OR) {
+    if (isBoolean(left, false) && getStaticType(right) == DataTypes::BOOLEAN) return replaceWith(node, right);
+    if (isBoolean(right, false) && getStaticType(left) == DataTypes::BOOLEAN) return replaceWith(node, left);
+
+    // The right operand is never evaluated when the left is true
+    if (isBoolean(left, true) && getStaticType(right) == DataTypes::BOOLEAN) return makeBoolean(true, node->getParent());
+    if (isBoolean(right, true) && isTrivial(left) && getStaticType(left) == DataTypes::BOOLEAN) return makeBoolean(true, node->getParent());
+  }
+
+  return nullptr;
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::joinAdjacentStrings(shared_ptr<BinaryOperationNode> node) {
+  auto isConcatenation = [](shared_ptr<ASTNode> operand) {
+    return (
+      operand->getNodeType() == ASTNode::BINARY_OPERATION &&
+      dynamic_pointer_cast<BinaryOperationNode>(operand)->getOperator() == Lexemes::PLUS
+    );
+  };
+
+  shared_ptr<ASTNode> left = node->getLeft();
+  shared_ptr<ASTNode> right = node->getRight();
+
+  // The literal each side meets the other with, and whatever comes before or after it on that side
+  shared_ptr<ASTNode> leftLiteral = left;
+  shared_ptr<ASTNode> leftRest;
+  shared_ptr<ASTNode> rightLiteral = right;
+  shared_ptr<ASTNode> rightRest;
+
+  if (isConcatenation(left)) {
+    leftLiteral = left->getRight();
+    leftRest = left->getLeft();
+  }
+
+  if (isConcatenation(right)) {
+    rightLiteral = right->getLeft();
+    rightRest = right->getRight();
+  }
+
+  if (
+    (!leftRest && !rightRest) ||
+    leftLiteral->getNodeType() != ASTNode::STRING_LITERAL ||
+    rightLiteral->getNodeType() != ASTNode::STRING_LITERAL
+  ) {
+    return nullptr;
+  }
+
+  shared_ptr<ASTNode> joined = make_shared<LiteralNode>(
+    ASTNode::STRING_LITERAL,
+    dynamic_pointer_cast<LiteralNode>(leftLiteral)->getLiteralValue() + dynamic_pointer_cast<LiteralNode>(rightLiteral)->getLiteralValue(),
+    nullptr
+  );
+
+  if (leftRest) joined = makeConcatenation(leftRest, joined);
+  if (rightRest) joined = makeConcatenation(joined, rightRest);
+
+  addToStatistic("string literals joined");
+
+  return replaceWith(node, joined);
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::foldUnaryOperation(shared_ptr<UnaryOperationNode> node) {
+  shared_ptr<ASTNode> value = node->getValue();
+
+  if (!value) return nullptr;
+
+  string op = node->getOperator();
+
+  if (op == Lexemes::MINUS && value->getNodeType() == ASTNode::NUMBER_LITERAL) {
+    int64_t number;
+
+    if (!parseInteger(dynamic_pointer_cast<LiteralNode>(value), number)) return nullptr;
+
+    return makeNumber(0 - (uint64_t) number, node->getParent());
+  }
+
+  if (op == Lexemes::NOT && value->getNodeType() == ASTNode::BOOLEAN_LITERAL) {
+    return makeBoolean(dynamic_pointer_cast<LiteralNode>(value)->getLiteralValue() != Lexemes::TRUE, node->getParent());
+  }
+
+  // Negating twice gives back the original value
+  shared_ptr<UnaryOperationNode> inner = dynamic_pointer_cast<UnaryOperationNode>(value);
+
+  if (!inner || inner->getOperator() != op || !inner->getValue()) return nullptr;
+
+  string innerType = getStaticType(inner->getValue());
+
+  if ((op == Lexemes::MINUS && innerType == DataTypes::NUMBER) || (op == Lexemes::NOT && innerType == DataTypes::BOOLEAN)) {
+    return replaceWith(node, inner->getValue());
+  }
+
+  return nullptr;
+}
+
+string ConstantFoldingPass::getStaticType(shared_ptr<ASTNode> node) {
+  if (!node) return "";
+
+  if (node->getNodeType() == ASTNode::NUMBER_LITERAL) return DataTypes::NUMBER;
+  if (node->getNodeType() == ASTNode::STRING_LITERAL) return DataTypes::STRING;
+  if (node->getNodeType() == ASTNode::BOOLEAN_LITERAL) return DataTypes::BOOLEAN;
+
+  if (node->getNodeType() == ASTNode::IDENTIFIER) {
+    // A declaration, rather than a reference
+    if (node->getValue()) return "";
+
+    return getDeclaredType(dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier(), node);
+  }
+
+  if (node->getNodeType() == ASTNode::UNARY_OPERATION) {
+    string op = dynamic_pointer_cast<UnaryOperationNode>(node)->getOperator();
+    string valueType = getStaticType(node->getValue());
+
+    if (op == Lexemes::MINUS && valueType == DataTypes::NUMBER) return DataTypes::NUMBER;
+    if (op == Lexemes::NOT && valueType == DataTypes::BOOLEAN) return DataTypes::BOOLEAN;
+
+    return "";
+  }
+
+  if (node->getNodeType() == ASTNode::BINARY_OPERATION) {
+    string op = dynamic_pointer_cast<BinaryOperationNode>(node)->getOperator();
+    string leftType = getStaticType(node->getLeft());
+    string rightType = getStaticType(node->getRight());
+
+    if (leftType == "" || leftType != rightType) return "";
+
+    if (op == Lexemes::PLUS && (leftType == DataTypes::NUMBER || leftType == DataTypes::STRING)) return leftType;
+
+    if (
+      (op == Lexemes::MINUS || op == Lexemes::TIMES || op == Lexemes::DIVISION || op == Lexemes::MODULO || op == Lexemes::EXPONENT) &&
+      leftType == DataTypes::NUMBER
+    ) return DataTypes::NUMBER;
+
+    if ((op == Lexemes::AND || op == Lexemes::OR) && leftType == DataTypes::BOOLEAN) return DataTypes::BOOLEAN;
+
+    if (op == Lexemes::EQUALITY || op == Lexemes::INEQUALITY) return DataTypes::BOOLEAN;
+
+    if (
+      (op == Lexemes::LT || op == Lexemes::GT || op == Lexemes::LTEQ || op == Lexemes::GTEQ) &&
+      leftType == DataTypes::NUMBER
+    ) return DataTypes::BOOLEAN;
+  }
+
+  return "";
+}
+
+string ConstantFoldingPass::getDeclaredType(string identifier, shared_ptr<ASTNode> node) {
+  auto getSimpleType = [](shared_ptr<ASTNode> typeNode) -> string {
+    shared_ptr<TypeDeclarationNode> type = dynamic_pointer_cast<TypeDeclarationNode>(typeNode);
+
+    if (!type || type->getValue() || type->getLeft()) return "";
+
+    return type->getType();
+  };
+
+  for (shared_ptr<ASTNode> scope = node->getParent(); scope; scope = scope->getParent()) {
+    if (scope->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+      shared_ptr<ASTNodeList> parameters = dynamic_pointer_cast<FunctionDeclarationNode>(scope)->getParameters();
+
+      for (auto &parameter : parameters ? parameters->getElements() : vector<shared_ptr<ASTNode>>()) {
+        shared_ptr<IdentifierNode> parameterIdentifier = dynamic_pointer_cast<IdentifierNode>(parameter);
+
+        if (parameterIdentifier && parameterIdentifier->getIdentifier() == identifier) {
+          return getSimpleType(parameterIdentifier->getValue());
+        }
+      }
+    } else if (scope->getNodeType() == ASTNode::BLOCK) {
+      for (auto &element : dynamic_pointer_cast<ASTNodeList>(scope)->getElements()) {
+        if (!element || element->getNodeType() != ASTNode::ASSIGNMENT) continue;
+
+        shared_ptr<IdentifierNode> declared = dynamic_pointer_cast<IdentifierNode>(element->getLeft());
+
+        if (declared && declared->getIdentifier() == identifier) return getSimpleType(declared->getValue());
+      }
+    }
+  }
+
+  return "";
+}
+
+bool ConstantFoldingPass::isTrivial(shared_ptr<ASTNode> node) {
+  return isLiteral(node) || (node->getNodeType() == ASTNode::IDENTIFIER && !node->getValue());
+}
+
+bool ConstantFoldingPass::parseInteger(shared_ptr<LiteralNode> literal, int64_t &value) {
+  string digits = literal->getLiteralValue();
+  size_t parsedLength;
+
+  try {
+    value = stoll(digits, &parsedLength);
+  } catch (const logic_error&) {
+    return false;
+  }
+
+  // Decimals aren't folded, since they'd lose their fractional part
+  return parsedLength == digits.length();
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::replaceWith(shared_ptr<ASTNode> node, shared_ptr<ASTNode> replacement) {
+  replacement->setParent(node->getParent());
+
+  return replacement;
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::makeNumber(int64_t value, shared_ptr<ASTNode> parent) {
+  return make_shared<LiteralNode>(ASTNode::NUMBER_LITERAL, to_string(value), parent);
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::makeBoolean(bool value, shared_ptr<ASTNode> parent) {
+  return make_shared<LiteralNode>(ASTNode::BOOLEAN_LITERAL, value ? Lexemes::TRUE : Lexemes::FALSE, parent);
+}
+
+shared_ptr<ASTNode> ConstantFoldingPass::makeConcatenation(shared_ptr<ASTNode> left, shared_ptr<ASTNode> right) {
+  shared_ptr<BinaryOperationNode> concatenation = make_shared<BinaryOperationNode>(Lexemes::PLUS, nullptr);
+
+  left->setParent(concatenation);
+  right->setParent(concatenation);
+  concatenation->setLeft(left);
+  concatenation->setRight(right);
+
+  return concatenation;
+}
+
+bool ConstantFoldingPass::isLiteral(shared_ptr<ASTNode> node) {
+  return (
+    node->getNodeType() == ASTNode::NUMBER_LITERAL ||
+    node->getNodeType() == ASTNode::STRING_LITERAL ||
+    node->getNodeType() == ASTNode::BOOLEAN_LITERAL
+  );
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/BinaryOperationNode.hpp"
+#include "parser/ast/UnaryOperationNode.hpp"
+#include "parser/ast/LiteralNode.hpp"
+#include <memory>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that evaluates operations on literals at compile time, so that an expression like
+ * `x * 4 + 1`, once the literal inliner has replaced x with 3, becomes the literal 13 instead of a multiplication and an
+ * addition at runtime. Arithmetic (including exponents), comparisons, boolean logic and string concatenation are
+ * folded, along with algebraic identities such as x * 1, x + 0 and x ** 2, and branches of control flow whose
+ * conditions fold to a constant. Concatenation is associative, so string literals that end up next to each other in a
+ * chain of `+` with other strings between them, like `name + ', ' + 'welcome'`, are joined too.
+ *
+ * Folding happens before type checking, so identities are only applied when the type of the operand they keep is known
+ * to be the type the identity holds for. Otherwise `'a' + 0` would become `'a'`, hiding a type error. Operations whose
+ * runtime result isn't well defined, like dividing by zero, are left for the runtime.
+ */
+namespace Theta {
+  class ConstantFoldingPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+    /**
+     * @brief Evaluates a binary operation whose operands are both literals, the way it would be evaluated at runtime
+     * @return The resulting literal, or nullptr if it can't be evaluated at compile time
+     */
+    static shared_ptr<ASTNode> evaluateBinaryOperation(string op, shared_ptr<LiteralNode> left, shared_ptr<LiteralNode> right, shared_ptr<ASTNode> parent);
+
+  private:
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Folds a binary operation on two literals, or simplifies it with an algebraic identity
+     * @return The node to replace the operation with, or nullptr to leave it as is
+     */
+    shared_ptr<ASTNode> foldBinaryOperation(shared_ptr<BinaryOperationNode> node);
+
+    /**
+     * @brief Applies algebraic identities to a binary operation with at most one literal operand
+     * @return The node to replace the operation with, or nullptr if no identity applies
+     */
+    shared_ptr<ASTNode> simplifyBinaryOperation(shared_ptr<BinaryOperationNode> node);
+
+    /**
+     * @brief Joins the string literal at the end of one side of a concatenation with the one at the start of the
+     * other, when either side is itself a concatenation: `(a + 'b') + ('c' + d)` becomes `(a + 'bc') + d`
+     * @return The regrouped concatenation, or nullptr if the sides don't meet in two string literals
+     */
+    shared_ptr<ASTNode> joinAdjacentStrings(shared_ptr<BinaryOperationNode> node);
+
+    /**
+     * @brief Folds a unary operation on a literal, or removes a double negation
+     * @return The node to replace the operation with, or nullptr to leave it as is
+     */
+    shared_ptr<ASTNode> foldUnaryOperation(shared_ptr<UnaryOperationNode> node);
+
+    /**
+     * @brief Works out the type of an expression without type checking it, from literals, operators, and the declared
+     * types of the identifiers it references
+     * @return The name of the type, or an empty string if it can't be known before type checking
+     */
+    static string getStaticType(shared_ptr<ASTNode> node);
+
+    /**
+     * @brief Finds the declared type of the identifier an expression references, by walking up its enclosing blocks and
+     * functions to the assignment or parameter that declares it
+     * @return The name of the type, or an empty string if no declaration with a simple type was found
+     */
+    static string getDeclaredType(string identifier, shared_ptr<ASTNode> node);
+
+    /**
+     * @brief Whether the node can be evaluated any number of times, or not at all, without changing the program
+     */
+    static bool isTrivial(shared_ptr<ASTNode> node);
+
+    /**
+     * @brief Parses the value of a number literal, if it's a whole number that fits in the i64 Numbers compile to
+     */
+    static bool parseInteger(shared_ptr<LiteralNode> literal, int64_t &value);
+
+    /**
+     * @brief Replaces a node with another, taking over its place in the tree
+     */
+    static shared_ptr<ASTNode> replaceWith(shared_ptr<ASTNode> node, shared_ptr<ASTNode> replacement);
+
+    static shared_ptr<ASTNode> makeNumber(int64_t value, shared_ptr<ASTNode> parent);
+
+    static shared_ptr<ASTNode> makeBoolean(bool value, shared_ptr<ASTNode> parent);
+
+    static shared_ptr<ASTNode> makeConcatenation(shared_ptr<ASTNode> left, shared_ptr<ASTNode> right);
+
+    static bool isLiteral(shared_ptr<ASTNode> node);
+  };
+}
@@ -0,0 +1,155 @@
+#include "DeadCodeEliminationPass.hpp"
+#include "lexer/Lexemes.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/LiteralNode.hpp"
+#include <memory>
+
+using namespace Theta;
+
+void DeadCodeEliminationPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() == ASTNode::BLOCK) {
+    removeDeadStatements(dynamic_pointer_cast<ASTNodeList>(ast));
+  } else if (ast->getNodeType() == ASTNode::CONTROL_FLOW) {
+    shared_ptr<ControlFlowNode> controlFlow = dynamic_pointer_cast<ControlFlowNode>(ast);
+    int branchCount = controlFlow->getConditionExpressionPairs().size();
+
+    bool hasLiteralCondition = false;
+    for (auto &conditionExpressionPair : controlFlow->getConditionExpressionPairs()) {
+      if (conditionExpressionPair.first && conditionExpressionPair.first->getNodeType() == ASTNode::BOOLEAN_LITERAL) {
+        hasLiteralCondition = true;
+      }
+    }
+
+    if (!hasLiteralCondition) return;
+
+    int nodeCount = countNodes(ast);
+    shared_ptr<ASTNode> replacement = removeUntakenBranches(controlFlow);
+
+    if (replacement) {
+      ast = replacement;
+      markChanged();
+    }
+
+    int remainingBranchCount = replacement ? 1 : controlFlow->getConditionExpressionPairs().size();
+
+    if (remainingBranchCount < branchCount) {
+      addToStatistic("untaken branches removed", branchCount - remainingBranchCount);
+      addToStatistic("nodes removed", nodeCount - countNodes(ast));
+    }
+  }
+}
+
+void DeadCodeEliminationPass::hoistNecessary(shared_ptr<ASTNode> &ast) {
+  shared_ptr<ASTNodeList> capsuleBlock = dynamic_pointer_cast<ASTNodeList>(ast->getValue());
+  vector<shared_ptr<ASTNode>> elements = capsuleBlock->getElements();
+
+  removeUnusedBindings(elements, elements.size(), true);
+
+  if (elements.size() != capsuleBlock->getElements().size()) {
+    capsuleBlock->setElements(elements);
+    markChanged();
+  }
+}
+
+void DeadCodeEliminationPass::removeDeadStatements(shared_ptr<ASTNodeList> block) {
+  vector<shared_ptr<ASTNode>> elements = block->getElements();
+
+  for (int i = 0; i < elements.size(); i++) {
+    if (elements[i]->getNodeType() != ASTNode::RETURN) continue;
+
+    for (int j = i + 1; j < elements.size(); j++) {
+      countRemoval(elements[j], "unreachable statements removed");
+    }
+
+    elements.resize(i + 1);
+  }
+
+  vector<shared_ptr<ASTNode>> reachableElements;
+
+  for (int i = 0; i < elements.size(); i++) {
+    if (i < elements.size() - 1 && isUntakenControlFlow(elements[i])) {
+      int branchCount = dynamic_pointer_cast<ControlFlowNode>(elements[i])->getConditionExpressionPairs().size();
+
+      countRemoval(elements[i], "untaken branches removed", branchCount);
+      continue;
+    }
+
+    reachableElements.push_back(elements[i]);
+  }
+
+  if (!reachableElements.empty()) removeUnusedBindings(reachableElements, reachableElements.size() - 1, false);
+
+  if (reachableElements.size() != block->getElements().size()) {
+    block->setElements(reachableElements);
+    markChanged();
+  }
+}
+
+void DeadCodeEliminationPass::removeUnusedBindings(vector<shared_ptr<ASTNode>> &elements, int removableCount, bool isCapsuleLevel) {
+  map<string, int> referenceCounts;
+
+  for (auto &element : elements) {
+    countReferences(element, referenceCounts);
+  }
+
+  vector<bool> isRemoved(elements.size(), false);
+
+  for (int i = removableCount - 1; i >= 0; i--) {
+    shared_ptr<ASTNode> element = elements[i];
+
+    if (element->getNodeType() != ASTNode::ASSIGNMENT) continue;
+
+    // Every function in a capsule is exported, so something outside the module could call it
+    if (isCapsuleLevel && element->getRight()->getNodeType() == ASTNode::FUNCTION_DECLARATION) continue;
+
+    string identifier = dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier();
+
+    if (referenceCounts[identifier] > 0 || !isPure(element->getRight())) continue;
+
+    // Whatever this binding referenced is one reference closer to being unused itself
+    countReferences(element, referenceCounts, -1);
+    countRemoval(element, "unused bindings removed");
+
+    isRemoved[i] = true;
+  }
+
+  vector<shared_ptr<ASTNode>> usedElements;
+
+  for (int i = 0; i < elements.size(); i++) {
+    if (!isRemoved[i]) usedElements.push_back(elements[i]);
+  }
+
+  elements = usedElements;
+}
+
+void DeadCodeEliminationPass::countRemoval(shared_ptr<ASTNode> node, string kind, int amount) {
+  addToStatistic(kind, amount);
+  addToStatistic("nodes removed", countNodes(node));
+}
+
+void DeadCodeEliminationPass::countReferences(shared_ptr<ASTNode> node, map<string, int> &referenceCounts, int direction) {
+  forEachNode(node, [&referenceCounts, direction](shared_ptr<ASTNode> descendant) {
+    // Identifiers with a type are declarations, not references
+    if (descendant->getNodeType() == ASTNode::IDENTIFIER && !descendant->getValue()) {
+      referenceCounts[dynamic_pointer_cast<IdentifierNode>(descendant)->getIdentifier()] += direction;
+    }
+
+    return true;
+  });
+}
+
+bool DeadCodeEliminationPass::isUntakenControlFlow(shared_ptr<ASTNode> node) {
+  if (node->getNodeType() != ASTNode::CONTROL_FLOW) return false;
+
+  for (auto &conditionExpressionPair : dynamic_pointer_cast<ControlFlowNode>(node)->getConditionExpressionPairs()) {
+    shared_ptr<ASTNode> condition = conditionExpressionPair.first;
+
+    if (
+      !condition ||
+      condition->getNodeType() != ASTNode::BOOLEAN_LITERAL ||
+      dynamic_pointer_cast<LiteralNode>(condition)->getLiteralValue() == Lexemes::TRUE
+    ) return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that removes code which can't affect the result of the program, so that code generation
+ * doesn't spend time on it, and the module doesn't carry it: statements after a return, branches of control flow that
+ * can't be taken, and bindings that are never referenced and whose values can be computed without side effects. That
+ * includes values declared directly in a capsule. Functions declared directly in a capsule are kept, since every one of
+ * them is exported from the module.
+ *
+ * The pass runs after type checking, so that removing code never hides a type error in it.
+ */
+namespace Theta {
+  class DeadCodeEliminationPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Removes the values declared in the capsule that nothing references, before its elements are traversed
+     */
+    void hoistNecessary(shared_ptr<ASTNode> &ast) override;
+
+    /**
+     * @brief Removes the statements of a block that come after a return, the control flow statements none of whose
+     * branches can be taken, and the bindings that nothing references. The last element is never removed, since it's
+     * the value of the block
+     */
+    void removeDeadStatements(shared_ptr<ASTNodeList> block);
+
+    /**
+     * @brief Removes the bindings in the list that nothing references, starting from the end of the list so that a
+     * binding only referenced by bindings that get removed is removed as well
+     * @param elements The elements to remove unused bindings from
+     * @param removableCount How many of the elements, from the start of the list, can be removed
+     * @param isCapsuleLevel Whether the elements are declared directly in a capsule, in which case functions are kept
+     */
+    void removeUnusedBindings(vector<shared_ptr<ASTNode>> &elements, int removableCount, bool isCapsuleLevel);
+
+    /**
+     * @brief Records that a subtree was removed from the AST, in the statistic for its kind and in the total node count
+     */
+    void countRemoval(shared_ptr<ASTNode> node, string kind, int amount = 1);
+
+    /**
+     * @brief Counts the references to each identifier in the tree rooted at the given node
+     */
+    static void countReferences(shared_ptr<ASTNode> node, map<string, int> &referenceCounts, int direction = 1);
+
+    /**
+     * @brief Whether the node is a control flow with no branch that can ever be taken
+     */
+    static bool isUntakenControlFlow(shared_ptr<ASTNode> node);
+  };
+}
@@ -0,0 +1,95 @@
+#include "ExecutionProfile.hpp"
+#include "OptimizationPass.hpp"
+#include "compiler/CodeGen.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace Theta;
+
+bool ExecutionProfile::load(string fileName) {
+  ifstream profile(fileName);
+  if (!profile) return false;
+
+  parse(profile);
+
+  return true;
+}
+
+void ExecutionProfile::parse(istream &profile) {
+  string line;
+
+  while (getline(profile, line)) {
+    istringstream entry(line);
+    string kind;
+    string hash;
+
+    if (!(entry >> kind >> hash) || kind[0] == '#') continue;
+
+    if (kind == "function") {
+      long long calls;
+      if (!(entry >> calls) || calls < 0) continue;
+
+      callCounts[hash] += calls;
+      hottestCallCount = max(hottestCallCount, callCounts[hash]);
+    } else if (kind == "branch") {
+      int controlFlowIdx;
+      int branchIdx;
+      long long taken;
+      if (!(entry >> controlFlowIdx >> branchIdx >> taken) || controlFlowIdx < 0 || branchIdx < 0 || taken < 0) continue;
+
+      branchCounts[hash][make_pair(controlFlowIdx, branchIdx)] += taken;
+    }
+  }
+}
+
+void ExecutionProfile::apply(shared_ptr<ASTNode> ast) const {
+  OptimizationPass::forEachNode(ast, [this](shared_ptr<ASTNode> node) {
+    if (node->getNodeType() != ASTNode::FUNCTION_DECLARATION) return true;
+
+    shared_ptr<FunctionDeclarationNode> function = dynamic_pointer_cast<FunctionDeclarationNode>(node);
+    string hash = CodeGen::generateFunctionHash(function);
+
+    auto calls = callCounts.find(hash);
+    if (calls != callCounts.end()) function->setProfiledCallCount(calls->second);
+
+    auto branches = branchCounts.find(hash);
+    if (branches == branchCounts.end()) return true;
+
+    int controlFlowIdx = 0;
+
+    // The functions declared in this one are numbered on their own, when the walk above reaches them
+    OptimizationPass::forEachNode(function->getDefinition(), [&](shared_ptr<ASTNode> descendant) {
+      if (descendant->getNodeType() == ASTNode::FUNCTION_DECLARATION) return false;
+      if (descendant->getNodeType() != ASTNode::CONTROL_FLOW) return true;
+
+      shared_ptr<ControlFlowNode> controlFlow = dynamic_pointer_cast<ControlFlowNode>(descendant);
+      vector<long long> counts(controlFlow->getConditionExpressionPairs().size(), 0);
+      bool isProfiled = false;
+
+      for (int i = 0; i < counts.size(); i++) {
+        auto taken = branches->second.find(make_pair(controlFlowIdx, i));
+        if (taken == branches->second.end()) continue;
+
+        counts[i] = taken->second;
+        isProfiled = true;
+      }
+
+      if (isProfiled) controlFlow->setProfiledBranchCounts(counts);
+
+      controlFlowIdx++;
+
+      return true;
+    });
+
+    return true;
+  });
+}
+
+long long ExecutionProfile::getCallCount(string hash) const {
+  auto calls = callCounts.find(hash);
+
+  return calls != callCounts.end() ? calls->second : -1;
+}
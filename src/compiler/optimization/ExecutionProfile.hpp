@@ -0,0 +1,69 @@
+#pragma once
+
+#include "parser/ast/ASTNode.hpp"
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+/**
+ * @brief The call and branch counts recorded by running a build of a program, read from the text files given to
+ * --profile-use=. Each line of a profile records one count:
+ *
+ *   function <hash> <calls>
+ *   branch <hash> <control flow> <branch> <times taken>
+ *
+ * where <hash> is the structural hash of a function as it was parsed, the same one code generation names lifted
+ * functions by. <control flow> numbers the control flows in the function's body in the order they appear in, leaving
+ * out those of the functions declared in it, and <branch> numbers the branches of that control flow, else last. Lines
+ * starting with # are comments.
+ *
+ * Counts recorded for the same function or branch are added together, so the profiles of several runs merge by
+ * concatenating them. Lines that can't be read are skipped, and counts for functions that no longer exist, or that
+ * changed since the profile was recorded and so hash differently, are never matched to anything.
+ */
+namespace Theta {
+  class ExecutionProfile {
+  public:
+    /**
+     * @brief Adds the counts in a profile file to the ones already read
+     * @return false If the file couldn't be opened
+     */
+    bool load(string fileName);
+
+    /**
+     * @brief Adds the counts in a profile to the ones already read
+     */
+    void parse(istream &profile);
+
+    /**
+     * @brief Records the counts of the functions and control flows in the AST on their nodes. This has to happen before
+     * the AST is optimized, since optimizations change what functions hash to
+     */
+    void apply(shared_ptr<ASTNode> ast) const;
+
+    /**
+     * @brief Whether a function called this many times is among the hottest in the profile, being called at least a
+     * tenth as often as the function called most
+     */
+    bool isHot(long long callCount) const { return hottestCallCount > 0 && callCount * 10 >= hottestCallCount; }
+
+    /**
+     * @brief How many times the function with the given hash was called, or -1 if the profile has no count for it
+     */
+    long long getCallCount(string hash) const;
+
+  private:
+    map<string, long long> callCounts;
+
+    /**
+     * @brief The times each branch was taken, by function hash, then control flow and branch index
+     */
+    map<string, map<pair<int, int>, long long>> branchCounts;
+
+    long long hottestCallCount = 0;
+  };
+}
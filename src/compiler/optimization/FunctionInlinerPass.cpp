@@ -0,0 +1,372 @@
+#include "FunctionInlinerPass.hpp"
+#include "compiler/Compiler.hpp"
+#include "compiler/DataTypes.hpp"
+#include "compiler/TypeChecker.hpp"
+#include "compiler/optimization/ExecutionProfile.hpp"
+#include "lexer/Lexemes.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include "parser/ast/BinaryOperationNode.hpp"
+#include "parser/ast/BlockNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/LiteralNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+#include "parser/ast/UnaryOperationNode.hpp"
+#include <memory>
+
+using namespace Theta;
+
+void FunctionInlinerPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() != ASTNode::FUNCTION_INVOCATION) return;
+
+  shared_ptr<ASTNode> inlined = inlineInvocation(dynamic_pointer_cast<FunctionInvocationNode>(ast));
+
+  if (!inlined) return;
+
+  ast = inlined;
+  markChanged();
+  addToStatistic("calls inlined");
+}
+
+void FunctionInlinerPass::hoistNecessary(shared_ptr<ASTNode> &ast) {
+  vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<ASTNodeList>(ast->getValue())->getElements();
+  set<string> recursiveFunctions = findRecursiveFunctions(elements);
+
+  inlinableFunctions.clear();
+
+  for (auto &element : elements) {
+    if (element->getNodeType() != ASTNode::ASSIGNMENT || element->getRight()->getNodeType() != ASTNode::FUNCTION_DECLARATION) {
+      continue;
+    }
+
+    string identifier = dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier();
+    shared_ptr<FunctionDeclarationNode> function = dynamic_pointer_cast<FunctionDeclarationNode>(element->getRight());
+
+    if (recursiveFunctions.count(identifier) || !getInlinableBody(function)) continue;
+
+    // A call to a function that returns a function is a closure, not a value the body could stand in for
+    if (TypeChecker::getFunctionReturnType(function)->getType() == DataTypes::FUNCTION) continue;
+
+    inlinableFunctions[Compiler::getQualifiedFunctionIdentifier(identifier, function)] = function;
+  }
+}
+
+shared_ptr<ASTNode> FunctionInlinerPass::inlineInvocation(shared_ptr<FunctionInvocationNode> invocation) {
+  shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(invocation->getIdentifier());
+
+  if (!identifier) return nullptr;
+
+  auto found = inlinableFunctions.find(Compiler::getQualifiedFunctionIdentifier(identifier->getIdentifier(), invocation));
+
+  if (found == inlinableFunctions.end()) return nullptr;
+
+  shared_ptr<FunctionDeclarationNode> function = found->second;
+  vector<shared_ptr<ASTNode>> parameters = function->getParameters()->getElements();
+  vector<shared_ptr<ASTNode>> argumentNodes = invocation->getParameters()->getElements();
+
+  // Anything short of every argument is a partial application, which makes a closure
+  if (argumentNodes.size() != parameters.size() || isShadowed(identifier->getIdentifier(), invocation)) return nullptr;
+
+  shared_ptr<ASTNode> body = getInlinableBody(function);
+
+  map<string, int> uses;
+  map<string, int> conditionalUses;
+  countParameterUses(body, uses, conditionalUses);
+
+  map<string, shared_ptr<ASTNode>> arguments;
+  set<string> copiedArguments;
+
+  for (int i = 0; i < parameters.size(); i++) {
+    string parameter = dynamic_pointer_cast<IdentifierNode>(parameters[i])->getIdentifier();
+    shared_ptr<ASTNode> argument = argumentNodes[i];
+
+    bool isTrivial = (
+      argument->getNodeType() == ASTNode::NUMBER_LITERAL ||
+      argument->getNodeType() == ASTNode::STRING_LITERAL ||
+      argument->getNodeType() == ASTNode::BOOLEAN_LITERAL ||
+      (argument->getNodeType() == ASTNode::IDENTIFIER && !argument->getValue())
+    );
+
+    if (isTrivial) {
+      copiedArguments.insert(parameter);
+    } else if (uses[parameter] == 0) {
+      // The argument won't be evaluated at all once the call is gone
+      if (!isPure(argument)) return nullptr;
+    } else if (uses[parameter] > 1 || (conditionalUses[parameter] > 0 && !isPure(argument))) {
+      // Copying the argument to every use would evaluate it more than once, or not at all
+      return nullptr;
+    }
+
+    arguments[parameter] = argument;
+  }
+
+  // The body is moved out of the function it was declared in, so the other capsule values it references have to mean
+  // the same thing where the call is
+  bool isCaptured = false;
+  forEachNode(body, [&](shared_ptr<ASTNode> node) {
+    if (node->getNodeType() == ASTNode::IDENTIFIER && !arguments.count(dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier())) {
+      isCaptured = isCaptured || isShadowed(dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier(), invocation);
+    }
+
+    return !isCaptured;
+  });
+
+  if (isCaptured) return nullptr;
+
+  int callSize = countNodes(invocation);
+
+  // Count what the body would become, without detaching the arguments from the call in case it's kept after all
+  int inlinedSize = countNodes(body);
+  for (auto &argument : arguments) {
+    inlinedSize += uses[argument.first] * (countNodes(argument.second) - 1);
+  }
+
+  if (inlinedSize - callSize > getInlineThreshold(function)) return nullptr;
+
+  return substituteArguments(body, arguments, copiedArguments, invocation->getParent());
+}
+
+int FunctionInlinerPass::getInlineThreshold(shared_ptr<FunctionDeclarationNode> function) {
+  int threshold = session->optimization.getInlineThreshold();
+  optional<long long> callCount = function->getProfiledCallCount();
+
+  if (!session->optimization.profile || !callCount) return threshold;
+
+  // Growing the code is only worth it where the time goes, and never for a function the profiled runs didn't call
+  if (*callCount == 0) return 0;
+  if (session->optimization.profile->isHot(*callCount)) return threshold * HOT_INLINE_THRESHOLD_FACTOR;
+
+  return threshold;
+}
+
+shared_ptr<ASTNode> FunctionInlinerPass::substituteArguments(
+  shared_ptr<ASTNode> node,
+  map<string, shared_ptr<ASTNode>> &arguments,
+  set<string> &copiedArguments,
+  shared_ptr<ASTNode> parent
+) {
+  if (!node) return nullptr;
+
+  if (node->getNodeType() == ASTNode::IDENTIFIER) {
+    string identifier = dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier();
+    auto argument = arguments.find(identifier);
+
+    if (argument != arguments.end()) {
+      if (copiedArguments.count(identifier)) return copyExpression(argument->second, parent);
+
+      argument->second->setParent(parent);
+
+      return argument->second;
+    }
+  }
+
+  shared_ptr<ASTNode> copy;
+
+  if (
+    node->getNodeType() == ASTNode::NUMBER_LITERAL ||
+    node->getNodeType() == ASTNode::STRING_LITERAL ||
+    node->getNodeType() == ASTNode::BOOLEAN_LITERAL
+  ) {
+    copy = make_shared<LiteralNode>(node->getNodeType(), dynamic_pointer_cast<LiteralNode>(node)->getLiteralValue(), parent);
+  } else if (node->getNodeType() == ASTNode::IDENTIFIER) {
+    copy = make_shared<IdentifierNode>(dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier(), parent);
+  } else if (node->getNodeType() == ASTNode::BINARY_OPERATION) {
+    copy = make_shared<BinaryOperationNode>(dynamic_pointer_cast<BinaryOperationNode>(node)->getOperator(), parent);
+    copy->setLeft(substituteArguments(node->getLeft(), arguments, copiedArguments, copy));
+    copy->setRight(substituteArguments(node->getRight(), arguments, copiedArguments, copy));
+  } else if (node->getNodeType() == ASTNode::UNARY_OPERATION) {
+    copy = make_shared<UnaryOperationNode>(dynamic_pointer_cast<UnaryOperationNode>(node)->getOperator(), parent);
+    copy->setValue(substituteArguments(node->getValue(), arguments, copiedArguments, copy));
+  } else if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+    shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(node);
+    shared_ptr<FunctionInvocationNode> invocationCopy = make_shared<FunctionInvocationNode>(parent);
+
+    invocationCopy->setIdentifier(substituteArguments(invocation->getIdentifier(), arguments, copiedArguments, invocationCopy));
+    invocationCopy->setParameters(dynamic_pointer_cast<ASTNodeList>(
+      substituteArguments(invocation->getParameters(), arguments, copiedArguments, invocationCopy)
+    ));
+
+    copy = invocationCopy;
+  } else if (node->getNodeType() == ASTNode::CONTROL_FLOW) {
+    shared_ptr<ControlFlowNode> controlFlowCopy = make_shared<ControlFlowNode>(parent);
+    vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> pairs;
+
+    for (auto &conditionExpressionPair : dynamic_pointer_cast<ControlFlowNode>(node)->getConditionExpressionPairs()) {
+      pairs.push_back(make_pair(
+        substituteArguments(conditionExpressionPair.first, arguments, copiedArguments, controlFlowCopy),
+        substituteArguments(conditionExpressionPair.second, arguments, copiedArguments, controlFlowCopy)
+      ));
+    }
+
+    controlFlowCopy->setConditionExpressionPairs(pairs);
+
+    copy = controlFlowCopy;
+  } else {
+    shared_ptr<ASTNodeList> listCopy = node->getNodeType() == ASTNode::BLOCK
+      ? make_shared<BlockNode>(parent)
+      : make_shared<ASTNodeList>(parent);
+    vector<shared_ptr<ASTNode>> elements;
+
+    for (auto &element : dynamic_pointer_cast<ASTNodeList>(node)->getElements()) {
+      elements.push_back(substituteArguments(element, arguments, copiedArguments, listCopy));
+    }
+
+    listCopy->setElements(elements);
+
+    copy = listCopy;
+  }
+
+  copy->setResolvedType(node->getResolvedType());
+
+  return copy;
+}
+
+shared_ptr<ASTNode> FunctionInlinerPass::getInlinableBody(shared_ptr<FunctionDeclarationNode> function) {
+  shared_ptr<ASTNode> body = function->getDefinition();
+
+  if (body->getNodeType() == ASTNode::BLOCK) {
+    vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<ASTNodeList>(body)->getElements();
+
+    if (elements.size() != 1) return nullptr;
+
+    body = elements[0];
+  }
+
+  if (body->getNodeType() == ASTNode::RETURN) body = body->getValue();
+
+  if (!body) return nullptr;
+
+  set<string> parameters;
+  for (auto &parameter : function->getParameters()->getElements()) {
+    parameters.insert(dynamic_pointer_cast<IdentifierNode>(parameter)->getIdentifier());
+  }
+
+  bool isCopyable = true;
+
+  forEachNode(body, [&](shared_ptr<ASTNode> node) {
+    switch (node->getNodeType()) {
+      case ASTNode::NUMBER_LITERAL:
+      case ASTNode::STRING_LITERAL:
+      case ASTNode::BOOLEAN_LITERAL:
+      case ASTNode::BINARY_OPERATION:
+      case ASTNode::UNARY_OPERATION:
+      case ASTNode::CONTROL_FLOW:
+      case ASTNode::AST_NODE_LIST:
+        break;
+      case ASTNode::BLOCK:
+        // Blocks that only group a single expression, like the branches of an if, don't declare anything
+        isCopyable = dynamic_pointer_cast<ASTNodeList>(node)->getElements().size() == 1;
+        break;
+      case ASTNode::IDENTIFIER:
+        isCopyable = !node->getValue();
+        break;
+      case ASTNode::FUNCTION_INVOCATION: {
+        // Calling a parameter would put the argument in place of the function being called, which has to be a name
+        shared_ptr<IdentifierNode> callee = dynamic_pointer_cast<IdentifierNode>(
+          dynamic_pointer_cast<FunctionInvocationNode>(node)->getIdentifier()
+        );
+
+        isCopyable = callee && !parameters.count(callee->getIdentifier());
+        break;
+      }
+      default:
+        isCopyable = false;
+    }
+
+    return isCopyable;
+  });
+
+  return isCopyable ? body : nullptr;
+}
+
+set<string> FunctionInlinerPass::findRecursiveFunctions(vector<shared_ptr<ASTNode>> &capsuleElements) {
+  map<string, set<string>> calledFunctions;
+
+  for (auto &element : capsuleElements) {
+    if (element->getNodeType() != ASTNode::ASSIGNMENT || element->getRight()->getNodeType() != ASTNode::FUNCTION_DECLARATION) {
+      continue;
+    }
+
+    set<string> &called = calledFunctions[dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier()];
+
+    forEachNode(element->getRight(), [&called](shared_ptr<ASTNode> node) {
+      if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+        shared_ptr<IdentifierNode> callee = dynamic_pointer_cast<IdentifierNode>(
+          dynamic_pointer_cast<FunctionInvocationNode>(node)->getIdentifier()
+        );
+
+        if (callee) called.insert(callee->getIdentifier());
+      }
+
+      return true;
+    });
+  }
+
+  set<string> recursiveFunctions;
+
+  for (auto &function : calledFunctions) {
+    vector<string> toVisit(function.second.begin(), function.second.end());
+    set<string> visited;
+
+    while (!toVisit.empty()) {
+      string name = toVisit.back();
+      toVisit.pop_back();
+
+      if (name == function.first) {
+        recursiveFunctions.insert(name);
+        break;
+      }
+
+      if (!visited.insert(name).second) continue;
+
+      auto called = calledFunctions.find(name);
+      if (called != calledFunctions.end()) toVisit.insert(toVisit.end(), called->second.begin(), called->second.end());
+    }
+  }
+
+  return recursiveFunctions;
+}
+
+void FunctionInlinerPass::countParameterUses(
+  shared_ptr<ASTNode> node,
+  map<string, int> &uses,
+  map<string, int> &conditionalUses,
+  bool isConditional
+) {
+  if (!node) return;
+
+  if (node->getNodeType() == ASTNode::IDENTIFIER) {
+    string identifier = dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier();
+
+    uses[identifier]++;
+    if (isConditional) conditionalUses[identifier]++;
+  } else if (node->getNodeType() == ASTNode::CONTROL_FLOW) {
+    vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> pairs = dynamic_pointer_cast<ControlFlowNode>(node)->getConditionExpressionPairs();
+
+    // Only the first condition is always evaluated
+    for (int i = 0; i < pairs.size(); i++) {
+      countParameterUses(pairs[i].first, uses, conditionalUses, isConditional || i > 0);
+      countParameterUses(pairs[i].second, uses, conditionalUses, true);
+    }
+  } else if (node->getNodeType() == ASTNode::BINARY_OPERATION) {
+    string op = dynamic_pointer_cast<BinaryOperationNode>(node)->getOperator();
+
+    // The right operand of && and || is only evaluated when the left doesn't decide the result
+    countParameterUses(node->getLeft(), uses, conditionalUses, isConditional);
+    countParameterUses(node->getRight(), uses, conditionalUses, isConditional || op == Lexemes::AND || op == Lexemes::OR);
+  } else if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+    countParameterUses(dynamic_pointer_cast<FunctionInvocationNode>(node)->getParameters(), uses, conditionalUses, isConditional);
+  } else if (node->getValue()) {
+    countParameterUses(node->getValue(), uses, conditionalUses, isConditional);
+  } else if (node->hasMany()) {
+    for (auto &element : dynamic_pointer_cast<ASTNodeList>(node)->getElements()) {
+      countParameterUses(element, uses, conditionalUses, isConditional);
+    }
+  }
+}
+
+shared_ptr<ASTNode> FunctionInlinerPass::copyExpression(shared_ptr<ASTNode> node, shared_ptr<ASTNode> parent) {
+  map<string, shared_ptr<ASTNode>> noArguments;
+  set<string> noCopiedArguments;
+
+  return substituteArguments(node, noArguments, noCopiedArguments, parent);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that replaces calls to small capsule functions with the functions' bodies. Every call
+ * otherwise goes through an indirect call on the function table, with its arguments stored to memory first, which is
+ * far more expensive than the one line helpers it often calls, and which Binaryen can't see through to inline itself.
+ *
+ * A function can be inlined when it isn't recursive, its body is a single expression without any declarations of its
+ * own, and it returns a value rather than another function. A call to it is inlined when it passes every argument, and
+ * inlining it doesn't grow the code around it by more than the session's inline threshold, which a profile given to
+ * --profile-use= raises for hot functions and lowers for cold ones.
+ *
+ * Arguments are substituted for the parameters directly, since the inlined body has no bindings of its own that they
+ * could be captured by. An argument is only copied to each use of its parameter if it's a literal or an identifier,
+ * and only dropped, when its parameter is unused, if evaluating it has no effects. The body can still reference other
+ * values declared in the capsule, so a call isn't inlined where one of those names is declared again around it.
+ */
+namespace Theta {
+  class FunctionInlinerPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    /**
+     * @brief How many times the session's inline threshold a hot function gets, as told by the profile
+     */
+    int HOT_INLINE_THRESHOLD_FACTOR = 4;
+
+    /**
+     * @brief The capsule functions whose calls can be inlined, by qualified function identifier
+     */
+    map<string, shared_ptr<FunctionDeclarationNode>> inlinableFunctions;
+
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Finds the functions in the capsule whose calls can be inlined, before its elements are traversed
+     */
+    void hoistNecessary(shared_ptr<ASTNode> &ast) override;
+
+    /**
+     * @brief Builds the expression that replaces a call, if the call can be inlined within the session's threshold
+     * @return The inlined body of the function, or nullptr to keep the call
+     */
+    shared_ptr<ASTNode> inlineInvocation(shared_ptr<FunctionInvocationNode> invocation);
+
+    /**
+     * @brief How many nodes inlining a call to the function may add. With a profile, the hottest functions get more than
+     * the session's threshold, and functions the profiled runs never called get none
+     */
+    int getInlineThreshold(shared_ptr<FunctionDeclarationNode> function);
+
+    /**
+     * @brief Copies the body of a function for a call to it, replacing references to the function's parameters with
+     * the arguments of the call
+     * @param arguments The argument for each parameter, by parameter name
+     * @param copiedArguments The parameters whose arguments are copied to each use, rather than moved to the only one
+     */
+    static shared_ptr<ASTNode> substituteArguments(
+      shared_ptr<ASTNode> node,
+      map<string, shared_ptr<ASTNode>> &arguments,
+      set<string> &copiedArguments,
+      shared_ptr<ASTNode> parent
+    );
+
+    /**
+     * @brief Returns the expression a function evaluates to, if its body is a single expression that can be copied
+     * into the functions that call it, or nullptr if it isn't
+     */
+    static shared_ptr<ASTNode> getInlinableBody(shared_ptr<FunctionDeclarationNode> function);
+
+    /**
+     * @brief Finds the capsule functions that call themselves, directly or through other functions in the capsule.
+     * Functions are told apart by name only, so an overload of a recursive function counts as recursive too
+     */
+    static set<string> findRecursiveFunctions(vector<shared_ptr<ASTNode>> &capsuleElements);
+
+    /**
+     * @brief Counts the references to each parameter in an expression, and how many of those are inside a branch of
+     * control flow, where they might not be evaluated at all
+     */
+    static void countParameterUses(
+      shared_ptr<ASTNode> node,
+      map<string, int> &uses,
+      map<string, int> &conditionalUses,
+      bool isConditional = false
+    );
+
+    /**
+     * @brief Copies an expression that is made only of the kinds of nodes getInlinableBody allows, keeping their
+     * resolved types
+     */
+    static shared_ptr<ASTNode> copyExpression(shared_ptr<ASTNode> node, shared_ptr<ASTNode> parent);
+  };
+}
@@ -23,6 +23,7 @@ void LiteralInlinerPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDir
     unpackEnumElementsInScope(ast, localScope);
 
     ast = nullptr;
+    markChanged();
   } else if (ast->getNodeType() == ASTNode::ASSIGNMENT && !isCapsuleDirectChild) {
     bindIdentifierToScope(ast, localScope);
 
@@ -35,6 +36,7 @@ void LiteralInlinerPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDir
       )
     ) {
       ast = nullptr;
+      markChanged();
     }
   }
 }
@@ -66,6 +68,7 @@ void LiteralInlinerPass::substituteIdentifiers(shared_ptr<ASTNode> &ast) {
   shared_ptr<LiteralNode> literal = dynamic_pointer_cast<LiteralNode>(foundIdentifier.value());
 
   ast = make_shared<LiteralNode>(literal->getNodeType(), literal->getLiteralValue(), ast);
+  markChanged();
 }
 
 // When we have a variable assigned to a literal, we can safely just add that to the scope
@@ -79,7 +82,7 @@ void LiteralInlinerPass::bindIdentifierToScope(shared_ptr<ASTNode> &ast, SymbolT
     auto existingFuncIdentifierInScope = scope.lookup(uniqueFuncIdentifier);
 
     if (existingFuncIdentifierInScope.has_value()) {
-      Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(identifier));
+      session->addException(make_shared<IllegalReassignmentError>(identifier));
       return;
     }
 
@@ -88,7 +91,7 @@ void LiteralInlinerPass::bindIdentifierToScope(shared_ptr<ASTNode> &ast, SymbolT
     auto foundIdentInScope = scope.lookup(identifier);
 
     if (foundIdentInScope.has_value()) {
-      Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(identifier));
+      session->addException(make_shared<IllegalReassignmentError>(identifier));
       return;
     }
 
@@ -124,6 +127,8 @@ void LiteralInlinerPass::hoistNecessary(shared_ptr<ASTNode> &ast) {
 
   // Set the modified vector back
   nodeList->setElements(topLevelElements);
+
+  if (!removeAtIndices.empty()) markChanged();
 }
 
 void LiteralInlinerPass::unpackEnumElementsInScope(shared_ptr<ASTNode> node, SymbolTableStack<shared_ptr<ASTNode>> &scope) {
@@ -138,7 +143,7 @@ void LiteralInlinerPass::unpackEnumElementsInScope(shared_ptr<ASTNode> node, Sym
     
     auto foundScopeIdentifier = scope.lookup(enumElIdentifier);
     if (foundScopeIdentifier) {
-      Compiler::getInstance().addException(make_shared<IllegalReassignmentError>(enumElIdentifier));
+      session->addException(make_shared<IllegalReassignmentError>(enumElIdentifier));
       return;
     }
 
@@ -154,11 +159,15 @@ void LiteralInlinerPass::remapEnumTypeReferences(shared_ptr<ASTNode> &ast) {
   
   shared_ptr<ASTNode> remappedType = lookupInScope(typeDef->getType());
 
-  if (!remappedType) return;
-
   shared_ptr<TypeDeclarationNode> remappedTypeDecl = dynamic_pointer_cast<TypeDeclarationNode>(remappedType);
 
+  // A variable can share its name with a type. Only names that map to a type, like enums do, get remapped
+  if (!remappedTypeDecl) return;
+
+  if (typeDef->getType() == remappedTypeDecl->getType()) return;
+
   typeDef->setType(remappedTypeDecl->getType());
+  markChanged();
 }
 
 bool LiteralInlinerPass::isLiteralAssignment(shared_ptr<ASTNode> ast) {
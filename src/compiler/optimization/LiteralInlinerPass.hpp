@@ -17,6 +17,9 @@ using namespace std;
  */
 namespace Theta {
   class LiteralInlinerPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
   private:
     /**
      * @brief Processes different types of nodes such as identifiers, enums, and assignments,
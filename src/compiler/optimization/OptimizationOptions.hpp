@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+using namespace std;
+
+namespace Theta {
+  class ExecutionProfile;
+
+  /**
+   * @brief The optimization levels selectable with -O0 through -O3 and -Os. Each level picks a pipeline of AST passes
+   * from the ones registered with the PassManager. -O0 only runs the passes the rest of the compiler relies on.
+   */
+  enum OptimizationLevel { O0, O1, O2, O3, Os };
+
+  /**
+   * @brief The optimization settings requested for a compilation, shared by every session of a build
+   */
+  struct OptimizationOptions {
+    OptimizationLevel level = O1;
+
+    /**
+     * @brief Passes explicitly enabled (true) or disabled (false) with --passes=, overriding the level's pipeline
+     */
+    map<string, bool> passOverrides;
+
+    /**
+     * @brief Whether to print how long each pass took once the pipeline finishes, requested with --time-passes
+     */
+    bool isTimingPasses = false;
+
+    /**
+     * @brief Whether to print the counters passes keep, like how many nodes they removed, requested with --stats
+     */
+    bool isShowingStatistics = false;
+
+    /**
+     * @brief How many AST nodes the function inliner may add to a call site by inlining the call, set with
+     * --inline-threshold=. Calls to functions no bigger than the call itself are inlined even at 0. Without a threshold
+     * of its own, the level picks one
+     */
+    optional<int> inlineThreshold;
+
+    /**
+     * @brief Whether the generated module may use the wasm tail call feature, enabled with --enable-tail-call. Calls in
+     * tail position are then emitted as return calls, which don't grow the stack. Calls a function makes to itself in
+     * tail position become loops either way
+     */
+    bool isTailCallEnabled = false;
+
+    /**
+     * @brief The Binaryen passes to run over the generated module instead of the level's default pipeline, given to
+     * --wasm-passes= by the names wasm-opt knows them by
+     */
+    vector<string> wasmPasses;
+
+    /**
+     * @brief How many threads Binaryen may optimize a module with, set with --wasm-threads=. 0 leaves it to Binaryen,
+     * which uses one per core
+     */
+    unsigned int wasmThreads = 0;
+
+    /**
+     * @brief The call and branch counts read from the profiles given to --profile-use=, which steer inlining, the order
+     * branches are tested in and where functions go in the module. Without one, every function is treated alike
+     */
+    shared_ptr<ExecutionProfile> profile;
+
+    int getInlineThreshold() const {
+      if (inlineThreshold) return *inlineThreshold;
+
+      if (level == O3) return 40;
+      if (level == O2) return 12;
+
+      // Inlining at -Os is only worth it when it makes the module smaller
+      return 0;
+    }
+
+    /**
+     * @brief The level Binaryen optimizes the generated module at, which trades compile time for speed the way wasm-opt's
+     * -O levels do
+     */
+    int getWasmOptimizeLevel() const {
+      if (level == O0) return 0;
+      if (level == O1) return 1;
+      if (level == O3) return 3;
+
+      return 2;
+    }
+
+    /**
+     * @brief How hard Binaryen tries to make the generated module smaller, at the expense of speed. Only -Os does
+     */
+    int getWasmShrinkLevel() const { return level == Os ? 1 : 0; }
+
+    /**
+     * @brief Parses a level flag like -O2
+     * @param flag The flag to parse
+     * @param level Receives the level, if the flag is one
+     * @return true If the flag names an optimization level
+     */
+    static bool parseLevel(string flag, OptimizationLevel &level) {
+      static const map<string, OptimizationLevel> levelsByFlag = {
+        { "-O0", O0 }, { "-O1", O1 }, { "-O2", O2 }, { "-O3", O3 }, { "-Os", Os }
+      };
+
+      auto it = levelsByFlag.find(flag);
+      if (it == levelsByFlag.end()) return false;
+
+      level = it->second;
+
+      return true;
+    }
+
+    /**
+     * @brief Parses the comma separated pass names given to --passes=. A name enables its pass, and a name prefixed with
+     * a minus sign disables it, as in --passes=-literal-inliner,constant-folding
+     * @param list The pass names to parse
+     */
+    void parsePassOverrides(string list) {
+      for (auto &name : splitPassList(list)) {
+        if (name.length() > 1 && name[0] == '-') {
+          passOverrides[name.substr(1)] = false;
+        } else {
+          passOverrides[name] = true;
+        }
+      }
+    }
+
+    /**
+     * @brief Parses the comma separated Binaryen pass names given to --wasm-passes=, which run in the order given
+     * @param list The pass names to parse
+     */
+    void parseWasmPasses(string list) { wasmPasses = splitPassList(list); }
+
+  private:
+    static vector<string> splitPassList(string list) {
+      vector<string> names;
+      size_t start = 0;
+
+      while (start <= list.length()) {
+        size_t end = list.find(',', start);
+        if (end == string::npos) end = list.length();
+
+        string name = list.substr(start, end - start);
+        if (!name.empty()) names.push_back(name);
+
+        start = end + 1;
+      }
+
+      return names;
+    }
+  };
+}
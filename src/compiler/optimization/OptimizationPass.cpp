@@ -1,7 +1,16 @@
 #include "OptimizationPass.hpp"
+#include "compiler/Compiler.hpp"
+#include "compiler/DataTypes.hpp"
+#include "compiler/TypeChecker.hpp"
+#include "parser/ast/ASTNodeList.hpp"
 #include "parser/ast/ControlFlowNode.hpp"
 #include "parser/ast/FunctionDeclarationNode.hpp"
 #include "parser/ast/FunctionInvocationNode.hpp"
+#include "parser/ast/BinaryOperationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/LiteralNode.hpp"
+#include "lexer/Lexemes.hpp"
+#include <cstdlib>
 #include <memory>
 #include <iostream>
 #include <utility>
@@ -95,3 +104,222 @@ shared_ptr<ASTNode> OptimizationPass::lookupInScope(string identifierName) {
 
   return nullptr;
 }
+
+shared_ptr<ASTNode> OptimizationPass::removeUntakenBranches(shared_ptr<ControlFlowNode> node) {
+  vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> pairs = node->getConditionExpressionPairs();
+  vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> newPairs;
+
+  bool hasElse = false;
+  for (auto &conditionExpressionPair : pairs) {
+    if (!conditionExpressionPair.first) hasElse = true;
+  }
+
+  for (int i = 0; i < pairs.size(); i++) {
+    shared_ptr<ASTNode> condition = pairs[i].first;
+
+    if (!condition || condition->getNodeType() != ASTNode::BOOLEAN_LITERAL) {
+      newPairs.push_back(pairs[i]);
+      continue;
+    }
+
+    // A branch that can never be taken
+    if (dynamic_pointer_cast<LiteralNode>(condition)->getLiteralValue() != Lexemes::TRUE) continue;
+
+    // A branch that is always taken means none of the branches after it can be
+    newPairs.push_back(make_pair(hasElse ? nullptr : condition, pairs[i].second));
+    break;
+  }
+
+  // Every branch is dead, but the control flow has no else to stand in for it
+  if (newPairs.empty()) return nullptr;
+
+  if (newPairs.size() == 1 && !newPairs[0].first) {
+    newPairs[0].second->setParent(node->getParent());
+
+    return newPairs[0].second;
+  }
+
+  bool isChanged = newPairs.size() != pairs.size();
+  for (int i = 0; i < newPairs.size() && !isChanged; i++) {
+    isChanged = newPairs[i].first != pairs[i].first;
+  }
+
+  if (isChanged) {
+    node->setConditionExpressionPairs(newPairs);
+    markChanged();
+  }
+
+  return nullptr;
+}
+
+void OptimizationPass::forEachNode(shared_ptr<ASTNode> node, const function<bool(shared_ptr<ASTNode>)> &visit) {
+  if (!node || !visit(node)) return;
+
+  if (node->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+    shared_ptr<FunctionDeclarationNode> funcDecNode = dynamic_pointer_cast<FunctionDeclarationNode>(node);
+
+    forEachNode(funcDecNode->getParameters(), visit);
+    forEachNode(funcDecNode->getDefinition(), visit);
+  } else if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+    shared_ptr<FunctionInvocationNode> funcInvNode = dynamic_pointer_cast<FunctionInvocationNode>(node);
+
+    forEachNode(funcInvNode->getIdentifier(), visit);
+    forEachNode(funcInvNode->getParameters(), visit);
+  } else if (node->getNodeType() == ASTNode::CONTROL_FLOW) {
+    for (auto &conditionExpressionPair : dynamic_pointer_cast<ControlFlowNode>(node)->getConditionExpressionPairs()) {
+      forEachNode(conditionExpressionPair.first, visit);
+      forEachNode(conditionExpressionPair.second, visit);
+    }
+  }
+
+  forEachNode(node->getValue(), visit);
+  forEachNode(node->getLeft(), visit);
+  forEachNode(node->getRight(), visit);
+
+  if (node->hasMany()) {
+    for (auto &element : dynamic_pointer_cast<ASTNodeList>(node)->getElements()) {
+      forEachNode(element, visit);
+    }
+  }
+}
+
+int OptimizationPass::countNodes(shared_ptr<ASTNode> node) {
+  int count = 0;
+
+  forEachNode(node, [&count](shared_ptr<ASTNode>) {
+    count++;
+    return true;
+  });
+
+  return count;
+}
+
+bool OptimizationPass::isPure(shared_ptr<ASTNode> node, const set<string> &pureFunctions) {
+  bool hasNoEffects = true;
+
+  forEachNode(node, [&hasNoEffects, &pureFunctions](shared_ptr<ASTNode> descendant) {
+    // Declaring a function doesn't run anything in its body
+    if (!hasNoEffects || descendant->getNodeType() == ASTNode::FUNCTION_DECLARATION) return false;
+
+    if (descendant->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+      shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(
+        dynamic_pointer_cast<FunctionInvocationNode>(descendant)->getIdentifier()
+      );
+
+      // Partial applications have a qualified identifier of their own, so only calls passing every argument are found
+      hasNoEffects = !pureFunctions.empty() &&
+        identifier &&
+        pureFunctions.count(Compiler::getQualifiedFunctionIdentifier(identifier->getIdentifier(), descendant)) &&
+        !isShadowed(identifier->getIdentifier(), descendant);
+    } else if (descendant->getNodeType() == ASTNode::BINARY_OPERATION) {
+      string op = dynamic_pointer_cast<BinaryOperationNode>(descendant)->getOperator();
+      shared_ptr<ASTNode> divisor = descendant->getRight();
+
+      if (op == Lexemes::DIVISION || op == Lexemes::MODULO) {
+        // Number literals are truncated to integers by code generation, so a divisor like 0.5 is a division by zero
+        long long divisorValue = divisor->getNodeType() == ASTNode::NUMBER_LITERAL
+          ? strtoll(dynamic_pointer_cast<LiteralNode>(divisor)->getLiteralValue().c_str(), nullptr, 10)
+          : 0;
+
+        if (divisorValue == 0 || divisorValue == -1) hasNoEffects = false;
+      }
+    }
+
+    return hasNoEffects;
+  });
+
+  return hasNoEffects;
+}
+
+set<string> OptimizationPass::findPureFunctions(vector<shared_ptr<ASTNode>> &capsuleElements) {
+  map<string, shared_ptr<FunctionDeclarationNode>> functions;
+
+  for (auto &element : capsuleElements) {
+    if (element->getNodeType() != ASTNode::ASSIGNMENT || element->getRight()->getNodeType() != ASTNode::FUNCTION_DECLARATION) {
+      continue;
+    }
+
+    shared_ptr<FunctionDeclarationNode> function = dynamic_pointer_cast<FunctionDeclarationNode>(element->getRight());
+
+    if (TypeChecker::getFunctionReturnType(function)->getType() == DataTypes::FUNCTION) continue;
+
+    string identifier = dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier();
+    functions[Compiler::getQualifiedFunctionIdentifier(identifier, function)] = function;
+  }
+
+  // A function is only found pure once every function it calls has been, so a function that calls itself, directly
+  // or through others, never is
+  set<string> pureFunctions;
+  bool isChanged = true;
+
+  while (isChanged) {
+    isChanged = false;
+
+    for (auto &[identifier, function] : functions) {
+      if (pureFunctions.count(identifier) || !isPure(function->getDefinition(), pureFunctions)) continue;
+
+      pureFunctions.insert(identifier);
+      isChanged = true;
+    }
+  }
+
+  return pureFunctions;
+}
+
+shared_ptr<ASTNode> OptimizationPass::rewriteEvaluatedExpressions(
+  shared_ptr<ASTNode> node,
+  const function<shared_ptr<ASTNode>(shared_ptr<ASTNode>)> &rewrite
+) {
+  shared_ptr<ASTNode> replacement = rewrite(node);
+  if (replacement) return replacement;
+
+  if (node->getNodeType() == ASTNode::BINARY_OPERATION) {
+    node->setLeft(rewriteEvaluatedExpressions(node->getLeft(), rewrite));
+    node->setRight(rewriteEvaluatedExpressions(node->getRight(), rewrite));
+  } else if (node->getNodeType() == ASTNode::UNARY_OPERATION || node->getNodeType() == ASTNode::RETURN) {
+    node->setValue(rewriteEvaluatedExpressions(node->getValue(), rewrite));
+  } else if (node->getNodeType() == ASTNode::ASSIGNMENT) {
+    if (node->getRight()->getNodeType() != ASTNode::FUNCTION_DECLARATION) {
+      node->setRight(rewriteEvaluatedExpressions(node->getRight(), rewrite));
+    }
+  } else if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+    shared_ptr<ASTNodeList> arguments = dynamic_pointer_cast<FunctionInvocationNode>(node)->getParameters();
+    vector<shared_ptr<ASTNode>> elements = arguments->getElements();
+
+    for (auto &element : elements) element = rewriteEvaluatedExpressions(element, rewrite);
+
+    arguments->setElements(elements);
+  } else if (node->getNodeType() == ASTNode::CONTROL_FLOW) {
+    // Only the first condition is always evaluated. Everything else depends on which branch is taken
+    shared_ptr<ControlFlowNode> controlFlow = dynamic_pointer_cast<ControlFlowNode>(node);
+    vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> pairs = controlFlow->getConditionExpressionPairs();
+
+    if (!pairs.empty() && pairs[0].first) {
+      pairs[0].first = rewriteEvaluatedExpressions(pairs[0].first, rewrite);
+      controlFlow->setConditionExpressionPairs(pairs);
+    }
+  }
+
+  return node;
+}
+
+bool OptimizationPass::isShadowed(string identifier, shared_ptr<ASTNode> node) {
+  for (shared_ptr<ASTNode> scope = node->getParent(); scope; scope = scope->getParent()) {
+    // The capsule's own declarations are the ones that could be shadowed
+    if (scope->getParent() && scope->getParent()->getNodeType() == ASTNode::CAPSULE) return false;
+
+    if (scope->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+      for (auto &parameter : dynamic_pointer_cast<FunctionDeclarationNode>(scope)->getParameters()->getElements()) {
+        if (dynamic_pointer_cast<IdentifierNode>(parameter)->getIdentifier() == identifier) return true;
+      }
+    } else if (scope->getNodeType() == ASTNode::BLOCK) {
+      for (auto &element : dynamic_pointer_cast<ASTNodeList>(scope)->getElements()) {
+        if (element->getNodeType() != ASTNode::ASSIGNMENT) continue;
+
+        if (dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier() == identifier) return true;
+      }
+    }
+  }
+
+  return false;
+}
@@ -1,7 +1,14 @@
 #pragma once
 
 #include "parser/ast/ASTNode.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
 #include "compiler/SymbolTableStack.hpp"
+#include "compiler/CompilationSession.hpp"
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 /**
  * @brief Abstract base class for optimization passes in the Theta compiler.
@@ -12,6 +19,13 @@
 namespace Theta {
   class OptimizationPass {
   public:
+    /**
+     * @param compilationSession The compilation session that any errors encountered by this pass are reported to
+     */
+    OptimizationPass(shared_ptr<CompilationSession> compilationSession) : session(compilationSession) {}
+
+    virtual ~OptimizationPass() = default;
+
     /**
      * @brief Initiates the optimization process on an AST node.
      *
@@ -24,18 +38,118 @@ namespace Theta {
      */
     void optimize(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild = false);
 
+    /**
+     * @brief Prepares the pass to optimize the top-level elements of a capsule one at a time with
+     * optimizeCapsuleElement, instead of optimizing the whole capsule at once. Declarations are hoisted from every
+     * element of the capsule, exactly as optimize would.
+     *
+     * @param capsule The capsule node whose elements will be optimized
+     */
+    void enterCapsule(shared_ptr<ASTNode> &capsule) {
+      localScope.enterScope();
+      hoistNecessary(capsule);
+    }
+
+    /**
+     * @brief Optimizes a single top-level element of the capsule passed to enterCapsule. This lets the language server
+     * re-optimize only the elements of a capsule that changed.
+     *
+     * @param element The element to optimize
+     */
+    void optimizeCapsuleElement(shared_ptr<ASTNode> &element) { optimize(element, true); }
+
     /**
      * @brief Cleans up and resets scope variables for the pass. Should always be called after the optimization pass finishes
      */
     void cleanup() {
         localScope = SymbolTableStack<shared_ptr<ASTNode>>();
         hoistedScope = SymbolTableStack<shared_ptr<ASTNode>>();
+        changed = false;
     }
 
+    /**
+     * @brief Returns whether the pass changed the AST since it was last cleaned up. The pass manager uses this to decide
+     * whether running the pipeline again could find anything more to optimize
+     */
+    bool hasChanged() { return changed; }
+
+    /**
+     * @brief Returns the counters the pass kept while it ran, like how many nodes it removed, by description. Unlike
+     * hasChanged, these add up over every run of the pass, and are printed with --stats
+     */
+    const map<string, int> &getStatistics() { return statistics; }
+
+    /**
+     * @brief Calls visit on every node in the tree rooted at the given node, parents before their children. This
+     * includes the parts of nodes that optimize doesn't descend into, like the function of an invocation
+     *
+     * @param visit Returns whether to visit the children of the node it was called with
+     */
+    static void forEachNode(shared_ptr<ASTNode> node, const function<bool(shared_ptr<ASTNode>)> &visit);
+
   protected:
+    shared_ptr<CompilationSession> session;
     SymbolTableStack<shared_ptr<ASTNode>> localScope;
     SymbolTableStack<shared_ptr<ASTNode>> hoistedScope;
 
+    /**
+     * @brief Records that the pass changed the AST. Passes should call this whenever they rewrite or remove a node
+     */
+    void markChanged() { changed = true; }
+
+    /**
+     * @brief Adds to one of the counters reported by getStatistics
+     * @param description What the counter counts, as shown by --stats, such as "nodes removed"
+     */
+    void addToStatistic(string description, int amount = 1) { statistics[description] += amount; }
+
+    /**
+     * @brief Removes the branches of a control flow whose conditions are the literal false, and the branches after one
+     * whose condition is the literal true. If that leaves only an else branch, the control flow is replaced by it.
+     *
+     * Without an else, a control flow has no value when none of its conditions hold, as far as the type checker is
+     * concerned, so the condition of an always-taken branch only goes away when there is an else to take its place.
+     *
+     * @return The node to replace the control flow with, or nullptr to keep the (possibly modified) control flow
+     */
+    shared_ptr<ASTNode> removeUntakenBranches(shared_ptr<ControlFlowNode> node);
+
+    /**
+     * @brief Counts the nodes in the tree rooted at the given node
+     */
+    static int countNodes(shared_ptr<ASTNode> node);
+
+    /**
+     * @brief Whether evaluating the expression can have no effect other than producing its value. Function calls might
+     * never return, and division by anything but a literal other than 0 and -1 might trap, so they count as effects
+     * @param pureFunctions The qualified identifiers of capsule functions known to always return, whose calls don't
+     * count as effects
+     */
+    static bool isPure(shared_ptr<ASTNode> node, const set<string> &pureFunctions = {});
+
+    /**
+     * @brief Finds the capsule functions that always return without trapping: those whose bodies only call functions
+     * that do, which rules out recursion. Functions that return functions are left out, since calling one makes a
+     * closure rather than a value that could be shared
+     */
+    static set<string> findPureFunctions(vector<shared_ptr<ASTNode>> &capsuleElements);
+
+    /**
+     * @brief Calls rewrite on the expressions a statement always evaluates, parents before their children, replacing
+     * each with the node rewrite returns. When rewrite returns nullptr the expression is kept and its children visited
+     * @return The statement, or the node that replaces it
+     */
+    static shared_ptr<ASTNode> rewriteEvaluatedExpressions(
+      shared_ptr<ASTNode> node,
+      const function<shared_ptr<ASTNode>(shared_ptr<ASTNode>)> &rewrite
+    );
+
+    /**
+     * @brief Whether an identifier is declared by a block or function enclosing the node, which would hide the capsule
+     * value of the same name from it
+     */
+    static bool isShadowed(string identifier, shared_ptr<ASTNode> node);
+
     /**
      * @brief Retrieves an AST node based on an identifier from the available scopes.
      *
@@ -47,6 +161,9 @@ namespace Theta {
     shared_ptr<ASTNode> lookupInScope(string identifier);
 
   private:
+    bool changed = false;
+    map<string, int> statistics;
+
     /**
      * @brief Pure virtual function to be implemented by derived classes for performing specific optimizations on the AST.
      *
@@ -0,0 +1,241 @@
+#include "PassManager.hpp"
+#include "LiteralInlinerPass.hpp"
+#include "ConstantFoldingPass.hpp"
+#include "DeadCodeEliminationPass.hpp"
+#include "FunctionInlinerPass.hpp"
+#include "CommonSubexpressionEliminationPass.hpp"
+#include "CompileTimeEvaluationPass.hpp"
+#include "PipelineFusionPass.hpp"
+#include "TailCallEliminationPass.hpp"
+#include "ClosureEscapeAnalysisPass.hpp"
+#include "TreeShakingPass.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace Theta;
+
+const vector<PassRegistration> &PassManager::getRegisteredPasses() {
+  static const set<OptimizationLevel> allLevels = { O0, O1, O2, O3, Os };
+
+  static const vector<PassRegistration> registeredPasses = {
+    // Enums only exist until this pass unpacks them into constants, so code generation can't do without it
+    {
+      "literal-inliner",
+      {},
+      allLevels,
+      true,
+      BEFORE_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<LiteralInlinerPass>(session); }
+    },
+    // Runs before type checking so the linked elements the program never uses aren't checked or generated
+    {
+      "tree-shaking",
+      {},
+      { O1, O2, O3, Os },
+      false,
+      BEFORE_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<TreeShakingPass>(session); }
+    },
+    {
+      "constant-folding",
+      { "literal-inliner" },
+      { O1, O2, O3, Os },
+      false,
+      BEFORE_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<ConstantFoldingPass>(session); }
+    },
+    // Calls are only resolved to the functions they call, across overloads, once their arguments have types. Calls with
+    // literal arguments are evaluated before the inliner gets to them, since their value beats an inlined body
+    {
+      "compile-time-evaluation",
+      {},
+      { O2, O3, Os },
+      false,
+      AFTER_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<CompileTimeEvaluationPass>(session); }
+    },
+    // Binds the values piped between pipeline stages to locals, which is what lets the inliner inline the stages
+    {
+      "pipeline-fusion",
+      {},
+      { O2, O3, Os },
+      false,
+      AFTER_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<PipelineFusionPass>(session); }
+    },
+    {
+      "function-inliner",
+      {},
+      { O2, O3, Os },
+      false,
+      AFTER_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<FunctionInlinerPass>(session); }
+    },
+    // Runs after inlining, which is what tends to leave the same expression in a block twice
+    {
+      "common-subexpression-elimination",
+      {},
+      { O2, O3, Os },
+      false,
+      AFTER_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<CommonSubexpressionEliminationPass>(session); }
+    },
+    // Removing code before type checking could hide the type errors in it
+    {
+      "dead-code-elimination",
+      {},
+      { O1, O2, O3, Os },
+      false,
+      AFTER_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<DeadCodeEliminationPass>(session); }
+    },
+    // Only marks calls for code generation, so it goes last, once the other passes are done moving code around
+    {
+      "tail-call-elimination",
+      {},
+      { O1, O2, O3, Os },
+      false,
+      AFTER_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<TailCallEliminationPass>(session); }
+    },
+    // Also only marks nodes, and inlining or removing code can change whether a function escapes
+    {
+      "closure-escape-analysis",
+      {},
+      { O1, O2, O3, Os },
+      false,
+      AFTER_TYPE_CHECKING,
+      [](shared_ptr<CompilationSession> session) { return make_shared<ClosureEscapeAnalysisPass>(session); }
+    }
+  };
+
+  return registeredPasses;
+}
+
+const PassRegistration* PassManager::findRegistration(string name) {
+  for (auto &registration : getRegisteredPasses()) {
+    if (registration.name == name) return &registration;
+  }
+
+  return nullptr;
+}
+
+int PassManager::getMaxIterations(OptimizationLevel level) {
+  if (level == O0 || level == O1) return 1;
+  if (level == O3) return 16;
+
+  return 4;
+}
+
+vector<string> PassManager::getPipeline() {
+  const OptimizationOptions &options = session->optimization;
+  set<string> enabled;
+
+  for (auto &registration : getRegisteredPasses()) {
+    if (registration.stage != stage) continue;
+
+    auto override = options.passOverrides.find(registration.name);
+    bool isEnabled = override != options.passOverrides.end() ? override->second : registration.levels.count(options.level) > 0;
+
+    if (isEnabled || registration.isRequired) enabled.insert(registration.name);
+  }
+
+  // Each pass is scheduled after its prerequisites, which are enabled along with it even if they were disabled
+  vector<string> pipeline;
+  set<string> scheduled;
+
+  function<void(string)> schedule = [&](string name) {
+    if (!scheduled.insert(name).second) return;
+
+    const PassRegistration* registration = findRegistration(name);
+    if (!registration || registration->stage != stage) return;
+
+    for (auto &prerequisite : registration->prerequisites) {
+      schedule(prerequisite);
+    }
+
+    pipeline.push_back(name);
+  };
+
+  for (auto &registration : getRegisteredPasses()) {
+    if (enabled.count(registration.name)) schedule(registration.name);
+  }
+
+  return pipeline;
+}
+
+bool PassManager::run(shared_ptr<ASTNode> &ast) {
+  vector<string> pipeline = getPipeline();
+  vector<shared_ptr<OptimizationPass>> passes;
+
+  timings.clear();
+  statistics.clear();
+  iterationCount = 0;
+
+  for (auto &name : pipeline) {
+    passes.push_back(findRegistration(name)->create(session));
+    timings.push_back({ name });
+  }
+
+  int maxIterations = getMaxIterations(session->optimization.level);
+  bool hasChanged = true;
+  bool isSuccessful = true;
+
+  while (hasChanged && isSuccessful && iterationCount < maxIterations) {
+    hasChanged = false;
+    iterationCount++;
+
+    for (int i = 0; i < passes.size() && isSuccessful; i++) {
+      auto start = chrono::steady_clock::now();
+
+      passes[i]->optimize(ast);
+
+      timings[i].milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+      timings[i].runs++;
+
+      if (passes[i]->hasChanged()) {
+        timings[i].changedRuns++;
+        hasChanged = true;
+      }
+
+      passes[i]->cleanup();
+
+      isSuccessful = session->getEncounteredExceptions().empty();
+    }
+  }
+
+  for (int i = 0; i < passes.size(); i++) {
+    if (!passes[i]->getStatistics().empty()) statistics[pipeline[i]] = passes[i]->getStatistics();
+  }
+
+  return isSuccessful;
+}
+
+void PassManager::displayTimings(ostream &out) {
+  double total = 0;
+
+  out << "Pass timings (" << iterationCount << (iterationCount == 1 ? " iteration" : " iterations") << "):\n";
+
+  for (auto &timing : timings) {
+    out << "  " << left << setw(24) << timing.name << right << fixed << setprecision(3) << setw(10) << timing.milliseconds
+      << " ms  " << timing.runs << (timing.runs == 1 ? " run" : " runs") << ", changed the AST in " << timing.changedRuns
+      << "\n";
+
+    total += timing.milliseconds;
+  }
+
+  out << "  " << left << setw(24) << "total" << right << fixed << setprecision(3) << setw(10) << total << " ms\n";
+  out << defaultfloat;
+}
+
+void PassManager::displayStatistics(ostream &out) {
+  out << "Pass statistics:\n";
+
+  for (auto &passStatistics : statistics) {
+    for (auto &statistic : passStatistics.second) {
+      out << "  " << left << setw(24) << passStatistics.first << right << setw(10) << statistic.second << "  "
+        << statistic.first << "\n";
+    }
+  }
+}
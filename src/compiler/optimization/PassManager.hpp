@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <functional>
+#include "OptimizationPass.hpp"
+#include "OptimizationOptions.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "compiler/CompilationSession.hpp"
+
+using namespace std;
+
+namespace Theta {
+  /**
+   * @brief When in compilation a pass runs. Passes that run after type checking only ever see programs that type
+   * checked, and can rely on every node having a resolved type, but they have to give a resolved type to any node they
+   * create, since code generation needs one. Errors a pass could hide, by removing code, can't be hidden after type
+   * checking.
+   */
+  enum PassStage { BEFORE_TYPE_CHECKING, AFTER_TYPE_CHECKING };
+
+  /**
+   * @brief Describes an optimization pass to the PassManager: what it's called on the command line, which passes have
+   * to run before it, and which optimization levels include it.
+   */
+  struct PassRegistration {
+    string name;
+
+    /**
+     * @brief Passes that have to run before this one, within the same iteration. Enabling a pass enables these too
+     */
+    vector<string> prerequisites;
+
+    /**
+     * @brief The optimization levels whose pipeline includes the pass
+     */
+    set<OptimizationLevel> levels;
+
+    /**
+     * @brief Whether the rest of the compiler relies on the pass having run, in which case it can't be disabled
+     */
+    bool isRequired = false;
+
+    PassStage stage = BEFORE_TYPE_CHECKING;
+
+    function<shared_ptr<OptimizationPass>(shared_ptr<CompilationSession>)> create;
+  };
+
+  /**
+   * @brief How long a pass took, summed over every time the pipeline ran it
+   */
+  struct PassTiming {
+    string name;
+    int runs = 0;
+    int changedRuns = 0;
+    double milliseconds = 0;
+  };
+
+  /**
+   * @brief Builds the pipeline of AST optimization passes for a session's optimization level and --passes= overrides,
+   * and runs it. Passes run in registration order, but always after their prerequisites. At levels that allow it, the
+   * pipeline is run again for as long as some pass reports that it changed the AST, since one pass can open up
+   * opportunities for another, up to a fixed number of iterations.
+   */
+  class PassManager {
+  public:
+    /**
+     * @param stage Which of the registered passes the pipeline is built from
+     */
+    PassManager(shared_ptr<CompilationSession> compilationSession, PassStage stage = BEFORE_TYPE_CHECKING)
+      : session(compilationSession), stage(stage) {}
+
+    /**
+     * @brief Returns every pass the compiler knows about, in the order they run
+     */
+    static const vector<PassRegistration> &getRegisteredPasses();
+
+    /**
+     * @brief Returns the names of the passes the session's options select for this stage, in the order they will run.
+     * Prerequisites that belong to an earlier stage have already run by the time this stage does, so they're left out
+     */
+    vector<string> getPipeline();
+
+    /**
+     * @brief Runs the pipeline over the AST, stopping at the first pass that reports an error to the session
+     * @param ast The AST to optimize in place
+     * @return false If a pass reported an error
+     */
+    bool run(shared_ptr<ASTNode> &ast);
+
+    /**
+     * @brief Returns how many times the whole pipeline ran during the last call to run
+     */
+    int getIterationCount() { return iterationCount; }
+
+    vector<PassTiming> getTimings() { return timings; }
+
+    /**
+     * @brief Writes the time each pass took to the given stream, as requested with --time-passes
+     */
+    void displayTimings(ostream &out);
+
+    /**
+     * @brief Returns the counters each pass kept during the last call to run, by pass name
+     */
+    map<string, map<string, int>> getStatistics() { return statistics; }
+
+    /**
+     * @brief Writes the counters each pass kept to the given stream, as requested with --stats
+     */
+    void displayStatistics(ostream &out);
+
+    /**
+     * @brief Returns the most times the pipeline runs for the given level before giving up on reaching a fixpoint
+     */
+    static int getMaxIterations(OptimizationLevel level);
+
+  private:
+    shared_ptr<CompilationSession> session;
+    PassStage stage;
+    vector<PassTiming> timings;
+    map<string, map<string, int>> statistics;
+    int iterationCount = 0;
+
+    /**
+     * @brief Finds the registration of the pass with the given name, or returns nullptr if there is none
+     */
+    static const PassRegistration* findRegistration(string name);
+  };
+}
@@ -0,0 +1,91 @@
+#include "PipelineFusionPass.hpp"
+#include "compiler/DataTypes.hpp"
+#include "parser/ast/AssignmentNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+#include <memory>
+
+using namespace Theta;
+
+void PipelineFusionPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() != ASTNode::BLOCK) return;
+
+  shared_ptr<ASTNodeList> block = dynamic_pointer_cast<ASTNodeList>(ast);
+
+  // Each local is declared at the index of the statement it was bound for, so the stages piped into its value are
+  // bound next, before moving on to the statement itself
+  for (int i = 0; i < block->getElements().size(); i++) {
+    while (bindPipedValue(block, i));
+  }
+}
+
+void PipelineFusionPass::hoistNecessary(shared_ptr<ASTNode> &ast) {
+  vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<ASTNodeList>(ast->getValue())->getElements();
+
+  pureFunctions = findPureFunctions(elements);
+}
+
+bool PipelineFusionPass::bindPipedValue(shared_ptr<ASTNodeList> block, int statementIdx) {
+  vector<shared_ptr<ASTNode>> elements = block->getElements();
+  shared_ptr<ASTNode> pipedValue;
+  string localName;
+
+  rewriteEvaluatedExpressions(elements[statementIdx], [this, &pipedValue, &localName](shared_ptr<ASTNode> node) {
+    // Once a value is bound, nothing else in the statement is
+    if (pipedValue) return node;
+
+    if (node->getNodeType() != ASTNode::FUNCTION_INVOCATION) return shared_ptr<ASTNode>();
+
+    shared_ptr<FunctionInvocationNode> stage = dynamic_pointer_cast<FunctionInvocationNode>(node);
+    if (!stage->isPipelineStage()) return shared_ptr<ASTNode>();
+
+    vector<shared_ptr<ASTNode>> arguments = stage->getParameters()->getElements();
+    shared_ptr<ASTNode> value = arguments.front();
+    shared_ptr<TypeDeclarationNode> type = dynamic_pointer_cast<TypeDeclarationNode>(value->getResolvedType());
+
+    ASTNode::Types valueType = value->getNodeType();
+    bool isNamed = (
+      valueType == ASTNode::IDENTIFIER ||
+      valueType == ASTNode::NUMBER_LITERAL ||
+      valueType == ASTNode::STRING_LITERAL ||
+      valueType == ASTNode::BOOLEAN_LITERAL
+    );
+
+    // A function value is a closure, which code generation keeps track of by the name it's bound to
+    if (isNamed || !type || type->getType() == DataTypes::FUNCTION || !isPure(value, pureFunctions)) {
+      return shared_ptr<ASTNode>();
+    }
+
+    localName = "ThetaLang.internal.pipeline" + to_string(introducedLocalCount++);
+
+    shared_ptr<IdentifierNode> reference = make_shared<IdentifierNode>(localName, stage->getParameters());
+    reference->setResolvedType(value->getResolvedType());
+
+    arguments.front() = reference;
+    stage->getParameters()->setElements(arguments);
+
+    pipedValue = value;
+
+    return node;
+  });
+
+  if (!pipedValue) return false;
+
+  shared_ptr<AssignmentNode> assignment = make_shared<AssignmentNode>(block);
+  shared_ptr<IdentifierNode> local = make_shared<IdentifierNode>(localName, assignment);
+
+  local->setValue(pipedValue->getResolvedType());
+  assignment->setLeft(local);
+  assignment->setRight(pipedValue);
+  assignment->setResolvedType(pipedValue->getResolvedType());
+  pipedValue->setParent(assignment);
+
+  elements.insert(elements.begin() + statementIdx, assignment);
+  block->setElements(elements);
+
+  addToStatistic("piped values bound");
+  markChanged();
+
+  return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include <memory>
+#include <set>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that lets a pipeline like `n => scale(3) => square() => offset(7)` run as one straight
+ * line of arithmetic rather than a call per stage. The parser turns a pipeline into nested calls, each stage taking
+ * the value of the one before it as its first argument, which keeps the function inliner from inlining any stage that
+ * uses its first parameter more than once, since that would evaluate the stages before it again for every use.
+ *
+ * The pass binds the value piped into each such stage to a local just before the statement the pipeline is in, so the
+ * stage is passed a name instead, and the inliner can then replace every stage with its body. Only values whose
+ * evaluation can't have effects are moved, and only out of parts of the statement that are always evaluated.
+ */
+namespace Theta {
+  class PipelineFusionPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    /**
+     * @brief The capsule functions whose calls are pure, by qualified function identifier
+     */
+    set<string> pureFunctions;
+
+    /**
+     * @brief How many locals the pass has introduced, which keeps their names unique
+     */
+    int introducedLocalCount = 0;
+
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Finds the capsule functions whose calls are pure, before its elements are traversed
+     */
+    void hoistNecessary(shared_ptr<ASTNode> &ast) override;
+
+    /**
+     * @brief Binds the value piped into the outermost stage of a pipeline in the statement at the given index of a
+     * block that isn't already passed a name, to a local declared just before the statement
+     * @return Whether a value was bound
+     */
+    bool bindPipedValue(shared_ptr<ASTNodeList> block, int statementIdx);
+  };
+}
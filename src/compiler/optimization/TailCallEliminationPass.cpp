@@ -0,0 +1,63 @@
+#include "TailCallEliminationPass.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include <memory>
+
+using namespace Theta;
+
+void TailCallEliminationPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() != ASTNode::FUNCTION_DECLARATION) return;
+
+  shared_ptr<ASTNode> definition = dynamic_pointer_cast<FunctionDeclarationNode>(ast)->getDefinition();
+  set<shared_ptr<ASTNode>> tailCalls;
+
+  collectTailCalls(definition, tailCalls);
+
+  // Functions declared inside this one are marked on their own, and their returns don't return from this function
+  forEachNode(definition, [&tailCalls](shared_ptr<ASTNode> node) {
+    if (node->getNodeType() == ASTNode::FUNCTION_DECLARATION) return false;
+
+    if (node->getNodeType() == ASTNode::RETURN) collectTailCalls(node->getValue(), tailCalls);
+
+    return true;
+  });
+
+  // Calls are marked again from scratch, since inlining may have moved one out of tail position since the last run
+  forEachNode(definition, [this, &tailCalls](shared_ptr<ASTNode> node) {
+    if (node->getNodeType() == ASTNode::FUNCTION_DECLARATION) return false;
+
+    if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+      shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(node);
+      bool isTailCall = tailCalls.find(node) != tailCalls.end();
+
+      if (isTailCall && !invocation->isTailCall()) addToStatistic("tail calls found");
+
+      invocation->setTailCall(isTailCall);
+    }
+
+    return true;
+  });
+}
+
+void TailCallEliminationPass::collectTailCalls(shared_ptr<ASTNode> node, set<shared_ptr<ASTNode>> &tailCalls) {
+  if (!node) return;
+
+  if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+    tailCalls.insert(node);
+  } else if (node->getNodeType() == ASTNode::BLOCK) {
+    vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<ASTNodeList>(node)->getElements();
+
+    if (!elements.empty()) collectTailCalls(elements.back(), tailCalls);
+  } else if (node->getNodeType() == ASTNode::RETURN) {
+    collectTailCalls(node->getValue(), tailCalls);
+  } else if (node->getNodeType() == ASTNode::CONTROL_FLOW) {
+    for (auto &conditionExpressionPair : dynamic_pointer_cast<ControlFlowNode>(node)->getConditionExpressionPairs()) {
+      collectTailCalls(conditionExpressionPair.second, tailCalls);
+    }
+  } else if (node->getNodeType() == ASTNode::ASSIGNMENT) {
+    // An assignment at the end of a block is generated as just its value
+    collectTailCalls(node->getRight(), tailCalls);
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include <memory>
+#include <set>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that finds the calls in tail position, whose value is returned from the function making
+ * them as is, and marks them so code generation can avoid growing the stack for them. A function calling itself in
+ * tail position jumps back to the start of its body with its parameters reassigned, so recursion like the README's
+ * factorial runs in constant stack space. Other tail calls become return calls when the tail call feature is enabled
+ * with --enable-tail-call.
+ *
+ * The pass runs after type checking and the other AST passes, since inlining and removing code both change which calls
+ * end up in tail position.
+ */
+namespace Theta {
+  class TailCallEliminationPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    /**
+     * @brief Collects the calls in tail position within an expression whose value is returned from its function
+     */
+    static void collectTailCalls(shared_ptr<ASTNode> node, set<shared_ptr<ASTNode>> &tailCalls);
+  };
+}
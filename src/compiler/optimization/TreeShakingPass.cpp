@@ -0,0 +1,157 @@
+#include "TreeShakingPass.hpp"
+#include "parser/ast/ASTNodeList.hpp"
+#include "parser/ast/BlockNode.hpp"
+#include "parser/ast/CapsuleNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/SourceNode.hpp"
+#include <memory>
+
+using namespace Theta;
+
+/**
+ * @brief The elements of the capsule a link links, or nullptr if it didn't resolve to a capsule
+ */
+static shared_ptr<ASTNodeList> linkedCapsuleElements(shared_ptr<LinkNode> link) {
+  shared_ptr<ASTNode> linkedSource = link->getValue();
+  if (!linkedSource || !linkedSource->getValue() || linkedSource->getValue()->getNodeType() != ASTNode::CAPSULE) {
+    return nullptr;
+  }
+
+  return dynamic_pointer_cast<ASTNodeList>(linkedSource->getValue()->getValue());
+}
+
+/**
+ * @brief The name an element of a capsule declares, or an empty string if it isn't a declaration, like a struct
+ * definition is
+ */
+static string declaredName(shared_ptr<ASTNode> element) {
+  if (element->getNodeType() != ASTNode::ASSIGNMENT) return "";
+
+  shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(element->getLeft());
+
+  return identifier ? identifier->getIdentifier() : "";
+}
+
+void TreeShakingPass::optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) {
+  if (ast->getNodeType() != ASTNode::SOURCE) return;
+
+  shared_ptr<SourceNode> source = dynamic_pointer_cast<SourceNode>(ast);
+  vector<shared_ptr<ASTNode>> links = source->getLinks();
+
+  if (links.empty()) return;
+
+  linksByCapsule.clear();
+  reachableElements.clear();
+
+  findLinks(links);
+  markReachable(source->getValue(), "");
+
+  map<string, shared_ptr<ASTNode>> pruned;
+  vector<shared_ptr<ASTNode>> prunedLinks = pruneLinks(links, pruned);
+
+  if (prunedLinks == links) return;
+
+  source->setLinks(prunedLinks);
+  markChanged();
+}
+
+void TreeShakingPass::findLinks(vector<shared_ptr<ASTNode>> links) {
+  for (auto &node : links) {
+    shared_ptr<LinkNode> link = dynamic_pointer_cast<LinkNode>(node);
+    if (!link || !linksByCapsule.insert(make_pair(link->capsule, link)).second) continue;
+
+    shared_ptr<SourceNode> linkedSource = dynamic_pointer_cast<SourceNode>(link->getValue());
+    if (linkedSource) findLinks(linkedSource->getLinks());
+  }
+}
+
+void TreeShakingPass::markReachable(shared_ptr<ASTNode> node, string owner) {
+  forEachNode(node, [this, &owner](shared_ptr<ASTNode> descendant) {
+    if (descendant->getNodeType() != ASTNode::IDENTIFIER) return true;
+
+    // Linked elements are referenced by their capsule's name followed by their own, except from inside their capsule
+    string identifier = dynamic_pointer_cast<IdentifierNode>(descendant)->getIdentifier();
+    size_t separatorIdx = identifier.rfind('.');
+    string capsule = separatorIdx != string::npos ? identifier.substr(0, separatorIdx) : owner;
+    string element = separatorIdx != string::npos ? identifier.substr(separatorIdx + 1) : identifier;
+
+    auto link = linksByCapsule.find(capsule);
+    if (link == linksByCapsule.end() || !reachableElements[capsule].insert(element).second) return true;
+
+    shared_ptr<ASTNodeList> elements = linkedCapsuleElements(link->second);
+    if (!elements) return true;
+
+    for (auto &declaration : elements->getElements()) {
+      if (declaredName(declaration) == element) markReachable(declaration->getRight(), capsule);
+    }
+
+    return true;
+  });
+}
+
+vector<shared_ptr<ASTNode>> TreeShakingPass::pruneLinks(
+  vector<shared_ptr<ASTNode>> links,
+  map<string, shared_ptr<ASTNode>> &pruned
+) {
+  vector<shared_ptr<ASTNode>> prunedLinks;
+
+  for (auto &node : links) {
+    shared_ptr<LinkNode> link = dynamic_pointer_cast<LinkNode>(node);
+    shared_ptr<ASTNode> prunedLink = link ? pruneLink(link, pruned) : node;
+
+    if (prunedLink) prunedLinks.push_back(prunedLink);
+  }
+
+  return prunedLinks;
+}
+
+shared_ptr<ASTNode> TreeShakingPass::pruneLink(shared_ptr<LinkNode> link, map<string, shared_ptr<ASTNode>> &pruned) {
+  auto found = pruned.find(link->capsule);
+  if (found != pruned.end()) return found->second;
+
+  // Also stops capsules that link each other from being pruned forever
+  pruned[link->capsule] = link;
+
+  shared_ptr<ASTNodeList> elements = linkedCapsuleElements(link);
+  if (!elements) return link;
+
+  shared_ptr<SourceNode> linkedSource = dynamic_pointer_cast<SourceNode>(link->getValue());
+  vector<shared_ptr<ASTNode>> innerLinks = linkedSource->getLinks();
+  vector<shared_ptr<ASTNode>> prunedInnerLinks = pruneLinks(innerLinks, pruned);
+
+  const set<string> &reachable = reachableElements[link->capsule];
+  vector<shared_ptr<ASTNode>> keptElements;
+
+  for (auto &element : elements->getElements()) {
+    string name = declaredName(element);
+
+    if (name.empty() || reachable.count(name)) keptElements.push_back(element);
+  }
+
+  int removedCount = elements->getElements().size() - keptElements.size();
+
+  if (removedCount == 0 && prunedInnerLinks == innerLinks) return link;
+
+  addToStatistic("linked elements removed", removedCount);
+
+  if (keptElements.empty() && prunedInnerLinks.empty()) {
+    addToStatistic("links removed");
+
+    return pruned[link->capsule] = nullptr;
+  }
+
+  // The kept elements are shared with the original, so their parents are left pointing into it
+  shared_ptr<LinkNode> prunedLink = make_shared<LinkNode>(link->capsule, link->getParent());
+  shared_ptr<SourceNode> prunedSource = make_shared<SourceNode>();
+  shared_ptr<CapsuleNode> capsule = dynamic_pointer_cast<CapsuleNode>(linkedSource->getValue());
+  shared_ptr<CapsuleNode> prunedCapsule = make_shared<CapsuleNode>(capsule->getName(), prunedSource);
+  shared_ptr<BlockNode> prunedBlock = make_shared<BlockNode>(prunedCapsule);
+
+  prunedBlock->setElements(keptElements);
+  prunedCapsule->setValue(prunedBlock);
+  prunedSource->setLinks(prunedInnerLinks);
+  prunedSource->setValue(prunedCapsule);
+  prunedLink->setValue(prunedSource);
+
+  return pruned[link->capsule] = prunedLink;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "OptimizationPass.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/LinkNode.hpp"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief An optimization pass that removes the elements of linked capsules that the program never uses, before they
+ * get to the type checker or code generation. Everything the source being compiled declares is exported, as is main,
+ * so reachability starts from all of it, and follows every reference to a linked element, whether it is called or only
+ * taken as a value, into that element and on to the elements it references in turn.
+ *
+ * Elements are matched by name, since types aren't resolved yet, which keeps every overload of a referenced function.
+ * Linked capsules are parsed once and shared between compilations, so rather than changing them, the pass gives the
+ * source copies of its links that only hold what it reaches.
+ */
+namespace Theta {
+  class TreeShakingPass : public OptimizationPass {
+  public:
+    using OptimizationPass::OptimizationPass;
+
+  private:
+    /**
+     * @brief The links of the source, and the links of the capsules they link, by the name of the capsule they link
+     */
+    map<string, shared_ptr<LinkNode>> linksByCapsule;
+
+    /**
+     * @brief The names of the reachable elements of each linked capsule, by capsule name
+     */
+    map<string, set<string>> reachableElements;
+
+    void optimizeAST(shared_ptr<ASTNode> &ast, bool isCapsuleDirectChild) override;
+
+    void findLinks(vector<shared_ptr<ASTNode>> links);
+
+    /**
+     * @brief Marks the linked elements referenced from the given node as reachable, along with everything they reference
+     * @param owner The name of the linked capsule the node is in, or an empty string for the source being compiled
+     */
+    void markReachable(shared_ptr<ASTNode> node, string owner);
+
+    /**
+     * @brief Returns the links with their unreachable elements left out, dropping those left with nothing at all
+     * @param pruned The links already pruned, by capsule name, so a capsule linked from several places is copied once
+     */
+    vector<shared_ptr<ASTNode>> pruneLinks(vector<shared_ptr<ASTNode>> links, map<string, shared_ptr<ASTNode>> &pruned);
+
+    /**
+     * @return The link, a copy of it holding only its reachable elements, or nullptr if nothing in it is reachable
+     */
+    shared_ptr<ASTNode> pruneLink(shared_ptr<LinkNode> link, map<string, shared_ptr<ASTNode>> &pruned);
+  };
+}
@@ -2,8 +2,10 @@
 
 #include <string>
 #include <iostream>
+#include <memory>
 #include "Error.hpp"
 #include "lexer/Token.hpp"
+#include "lexer/SourceBuffer.hpp"
 
 using namespace std;
 
@@ -13,68 +15,46 @@ namespace Theta {
     string errorType;
     string message;
     Token token;
-    string source;
-    string fileName;
+    shared_ptr<SourceBuffer> source;
 
   public:
-    CompilationError(string type, string msg, Token tok, string &src, string file) : errorType(type), message(msg), token(tok), source(src), fileName(file) {};
+    CompilationError(string type, string msg, Token tok, shared_ptr<SourceBuffer> src) : errorType(type), message(msg), token(tok), source(src) {};
 
     string what() {
       return message + " at line " + to_string(token.getStartLocation()[0]) + ", column " + to_string(token.getStartLocation()[1]);
     }
 
-    void display() override {
-      cout << "\n" + fileName << endl;
-      cout << "  \033[1;31m" + errorType + "\033[0m: " << what() << ':' << endl;
+    string getErrorType() override { return errorType; }
 
-      string contextPrevLine;
-      string contextErrorLine;
-      string contextNextLine;
-      int line = 1;
-      int charIdx = 0;
+    string getMessage() override { return message; }
 
-      // If the error isn't on the first line of the file, we want to add a prevLine to the log output, for context.
-      if (token.getStartLocation()[0] > 1) {
-        for (; line < token.getStartLocation()[0] - 1; charIdx++) {
-          if (source[charIdx] == '\n') line++;
-        }
+    /**
+     * @brief Returns the token the error was encountered at, which locates the error in the source
+     */
+    Token getToken() { return token; }
 
-        while (source[charIdx] != '\n') {
-          contextPrevLine += source[charIdx];
-          charIdx++;
-        }
-      }
+    void display(ostream &out) override {
+      int line = token.getStartLocation()[0];
 
-      // Skip to the line where the error is
-      for (; line < token.getStartLocation()[0]; charIdx++) {
-        if (source[charIdx] == '\n') line++;
-      }
+      out << "\n" + source->getFileName() + "\n";
+      out << "  \033[1;31m" + errorType + "\033[0m: " << what() << ":\n";
 
-      while (source[charIdx] != '\n' && charIdx <= source.length()) {
-        contextErrorLine += source[charIdx];
-        charIdx++;
-      }
-
-      // If there's another line after this one, add its contents to the nextLine for logging output
-      if (charIdx++ < source.length()) {
-        while (source[charIdx] != '\n') {
-          contextNextLine += source[charIdx];
-          charIdx++;
-        }
-      }
+      // Show the lines around the error, for context
+      string contextPrevLine = source->getLine(line - 1);
+      string contextNextLine = source->getLine(line + 1);
 
-      string errorMarker(token.getStartLocation()[1] + to_string(token.getStartLocation()[0]).length() + 1, ' ');
+      string errorMarker(token.getStartLocation()[1] + to_string(line).length() + 1, ' ');
       string errorPoint(token.getLexeme().length(), '^');
 
       if (contextPrevLine != "") {
-        cout << "    " + to_string(token.getStartLocation()[0] - 1) + ": " + contextPrevLine << endl;
+        out << "    " + to_string(line - 1) + ": " + contextPrevLine + "\n";
       }
 
-      cout << "    " + to_string(token.getStartLocation()[0]) + ": " +  contextErrorLine << endl;
-      cout << "    " + errorMarker + "\033[31m" + errorPoint + "\033[0m" << endl;
+      out << "    " + to_string(line) + ": " + source->getLine(line) + "\n";
+      out << "    " + errorMarker + "\033[31m" + errorPoint + "\033[0m\n";
 
       if (contextNextLine != "") {
-        cout << "    " + to_string(token.getStartLocation()[0] + 1) + ": " + contextNextLine << endl;
+        out << "    " + to_string(line + 1) + ": " + contextNextLine + "\n";
       }
     }
   };
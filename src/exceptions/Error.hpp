@@ -1,9 +1,49 @@
 #pragma once
 
+#include <exception>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <memory>
+
+using namespace std;
+
 namespace Theta {
   class Error : public exception {
   public:
-    virtual void display() = 0;
+    /**
+     * @brief Writes the error to the given stream, formatted for the console
+     */
+    virtual void display(ostream &out) = 0;
+
+    void display() { display(cout); }
+
+    /**
+     * @brief Returns the kind of error this is, such as "TypeError"
+     */
+    virtual string getErrorType() = 0;
+
+    /**
+     * @brief Returns a plain description of the error, without any terminal formatting, for tools that report errors
+     * somewhere other than the console
+     */
+    virtual string getMessage() = 0;
+
+    /**
+     * @brief Writes all the given errors to the console at once. The errors are rendered into a single buffer first, so
+     * that a file with many errors is written out in one go instead of flushing the console after every line
+     */
+    static void displayAll(const vector<shared_ptr<Error>> &errors) {
+      if (errors.empty()) return;
+
+      ostringstream buffer;
+
+      for (auto &error : errors) {
+        error->display(buffer);
+      }
+
+      cout << buffer.str() << flush;
+    }
   };
 }
-
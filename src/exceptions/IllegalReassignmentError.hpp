@@ -13,10 +13,14 @@ namespace Theta {
 
     string identifier;
 
-    void display() override {
-      cout << "  \033[1;31mIllegalReassignmentError\033[0m: '" +
-        identifier +
-        "' can not be reassigned once it has been defined" << endl;
+    void display(ostream &out) override {
+      out << "  \033[1;31m" + getErrorType() + "\033[0m: " + getMessage() << "\n";
+    }
+
+    string getErrorType() override { return "IllegalReassignmentError"; }
+
+    string getMessage() override {
+      return "'" + identifier + "' can not be reassigned once it has been defined";
     }
   };
 }
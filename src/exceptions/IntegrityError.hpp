@@ -14,9 +14,13 @@ namespace Theta {
     string line1;
     string line2;
 
-    void display() override {
-      cout << "  \033[1;31mIntegrityError\033[0m: " + line1 << endl;
-      cout << "    " + line2 << endl;
+    void display(ostream &out) override {
+      out << "  \033[1;31m" + getErrorType() + "\033[0m: " + line1 << "\n";
+      out << "    " + line2 << "\n";
     }
+
+    string getErrorType() override { return "IntegrityError"; }
+
+    string getMessage() override { return line1 + " " + line2; }
   };
 }
@@ -13,10 +13,14 @@ namespace Theta {
 
     string identifier;
 
-    void display() override {
-      cout << "  \033[1;31mReferenceError\033[0m: '" +
-        identifier +
-        "' does not exist in the scope where it was referenced." << endl;
+    void display(ostream &out) override {
+      out << "  \033[1;31m" + getErrorType() + "\033[0m: " + getMessage() << "\n";
+    }
+
+    string getErrorType() override { return "ReferenceError"; }
+
+    string getMessage() override {
+      return "'" + identifier + "' does not exist in the scope where it was referenced.";
     }
   };
 }
@@ -16,8 +16,14 @@ namespace Theta {
     shared_ptr<ASTNode> type1;
     shared_ptr<ASTNode> type2;
 
-    void display() override {
-      string errText = "  \033[1;31mTypeError\033[0m: " + message + ": "; 
+    void display(ostream &out) override {
+      out << "  \033[1;31m" + getErrorType() + "\033[0m: " + getMessage() << "\n";
+    }
+
+    string getErrorType() override { return "TypeError"; }
+
+    string getMessage() override {
+      string errText = message + ": ";
 
       pair<string, string> typeDiff = getTypeDiff(
         dynamic_pointer_cast<TypeDeclarationNode>(type1),
@@ -30,7 +36,7 @@ namespace Theta {
         errText += typeDiff.first + " is not equivalent to " + typeDiff.second;
       }
 
-      cout << errText << endl;
+      return errText;
     }
   
   private:
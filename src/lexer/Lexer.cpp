@@ -23,7 +23,7 @@ namespace Theta {
      * @brief Tokenizes the given source code string.
      * @param source The source code to lex.
      */
-    void lex(string source) {
+    void lex(const string &source) {
       int i = 0;
 
       // Iterate over the whole source
@@ -102,7 +102,7 @@ namespace Theta {
      * @param i The current index in the source string.
      * @return The generated Token object.
      */
-    Token makeToken(char currentChar, char nextChar, string source, int &i) {
+    Token makeToken(char currentChar, char nextChar, const string &source, int &i) {
       Token token;
 
       // Order matters here to ensure correct tokenization precedence.
@@ -160,7 +160,7 @@ namespace Theta {
       } else if (isdigit(currentChar)) {
         int countDecimals = 0;
         return accumulateUntilCondition(
-          [source, &countDecimals](int idx) {
+          [&source, &countDecimals](int idx) {
             if (source[idx] == '.') {
               countDecimals++;
             }
@@ -260,9 +260,9 @@ namespace Theta {
      * @param incrementAfter Whether to increment the index after accumulation (default is true).
      * @return The updated Token object after accumulation.
      */
-    Token accumulateUntilNext(string endChars, string source, int &i, Token token, string append = "", bool incrementAfter = true) {
+    Token accumulateUntilNext(const string &endChars, const string &source, int &i, Token token, string append = "", bool incrementAfter = true) {
       return accumulateUntilCondition(
-        [endChars, source](int i) { return source.substr(i, endChars.length()) != endChars; },
+        [&endChars, &source](int i) { return source.compare(i, endChars.length(), endChars) != 0; },
         source,
         i,
         token,
@@ -281,9 +281,9 @@ namespace Theta {
      * @param incrementAfter Whether to increment the index after accumulation (default is true).
      * @return The updated Token object after accumulation.
      */
-    Token accumulateUntilAnyOf(string endChars, string source, int &i, Token token, string append = "", bool incrementAfter = true) {
+    Token accumulateUntilAnyOf(const string &endChars, const string &source, int &i, Token token, string append = "", bool incrementAfter = true) {
       return accumulateUntilCondition(
-        [endChars, source](int i) { return find(endChars.begin(), endChars.end(), source[i]) == endChars.end(); },
+        [&endChars, &source](int i) { return endChars.find(source[i]) == string::npos; },
         source,
         i,
         token,
@@ -302,7 +302,7 @@ namespace Theta {
      * @param incrementAfter Whether to increment the index after accumulation (default is true).
      * @return The updated Token object after accumulation.
      */
-    Token accumulateUntilCondition(function<bool(int)> shouldContinue, string source, int &i, Token token, string append = "", bool incrementAfter = true) {
+    Token accumulateUntilCondition(function<bool(int)> shouldContinue, const string &source, int &i, Token token, string append = "", bool incrementAfter = true) {
       // We need to jump forward one index because we're already on the start char
       i++;
       currentColumn++;
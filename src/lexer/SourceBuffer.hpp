@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace Theta {
+  /**
+   * @brief The source code of a single file, shared by everything that needs to refer back to it, such as the errors
+   * found while parsing the file. The offsets at which each line starts are indexed once up front, so that looking up a
+   * line doesn't require scanning the file from the beginning.
+   */
+  class SourceBuffer {
+  public:
+    SourceBuffer(string src, string file) : source(move(src)), fileName(move(file)) {
+      lineStarts.push_back(0);
+
+      for (size_t i = 0; i < source.length(); i++) {
+        if (source[i] == '\n') lineStarts.push_back(i + 1);
+      }
+    }
+
+    const string &getSource() { return source; }
+
+    const string &getFileName() { return fileName; }
+
+    int getLineCount() { return lineStarts.size(); }
+
+    /**
+     * @brief Returns the contents of a line, without its line break
+     * @param line The line number, starting from 1
+     * @return The line, or an empty string if the source has no such line
+     */
+    string getLine(int line) {
+      if (line < 1 || line > getLineCount()) return "";
+
+      size_t start = lineStarts[line - 1];
+      size_t end = line < getLineCount() ? lineStarts[line] - 1 : source.length();
+
+      // Leave out the carriage return of files with Windows line endings
+      if (end > start && source[end - 1] == '\r') end--;
+
+      return source.substr(start, end - start);
+    }
+
+  private:
+    string source;
+    string fileName;
+    vector<size_t> lineStarts;
+  };
+}
@@ -0,0 +1,389 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <stdexcept>
+#include <cctype>
+
+using namespace std;
+
+/**
+ * @brief A JSON value, with just enough of a parser and serializer for the language server to speak JSON-RPC. Objects
+ * keep their keys in insertion order, which keeps the messages we send readable when debugging.
+ */
+namespace Theta {
+  class JsonValue {
+  public:
+    enum Types {
+      NULL_VALUE,
+      BOOLEAN,
+      NUMBER,
+      STRING,
+      ARRAY,
+      OBJECT
+    };
+
+    JsonValue() : type(NULL_VALUE) {}
+    JsonValue(bool value) : type(BOOLEAN), booleanValue(value) {}
+    JsonValue(int value) : type(NUMBER), numberValue(value) {}
+    JsonValue(long value) : type(NUMBER), numberValue(value) {}
+    JsonValue(double value) : type(NUMBER), numberValue(value) {}
+    JsonValue(string value) : type(STRING), stringValue(value) {}
+    JsonValue(const char* value) : type(STRING), stringValue(value) {}
+
+    static JsonValue array(vector<JsonValue> elements = {}) {
+      JsonValue value;
+      value.type = ARRAY;
+      value.elements = elements;
+
+      return value;
+    }
+
+    static JsonValue object() {
+      JsonValue value;
+      value.type = OBJECT;
+
+      return value;
+    }
+
+    JsonValue::Types getType() const { return type; }
+
+    bool isNull() const { return type == NULL_VALUE; }
+
+    bool asBoolean() const { return type == BOOLEAN && booleanValue; }
+
+    double asNumber() const { return type == NUMBER ? numberValue : 0; }
+
+    long asInteger() const { return (long) asNumber(); }
+
+    string asString() const { return type == STRING ? stringValue : ""; }
+
+    const vector<JsonValue>& getElements() const { return elements; }
+
+    /**
+     * @brief Appends a value to an array
+     */
+    void push(JsonValue value) { elements.push_back(value); }
+
+    /**
+     * @brief Returns whether an object has a member with the given key
+     */
+    bool has(const string &key) const { return find(key) != nullptr; }
+
+    /**
+     * @brief Returns the member of an object with the given key, or null if there is no such member. Lookups can be
+     * chained without checking each level, since looking a key up on anything other than an object also returns null.
+     */
+    const JsonValue& operator[](const string &key) const {
+      static const JsonValue nullValue;
+
+      const JsonValue* member = find(key);
+
+      return member ? *member : nullValue;
+    }
+
+    /**
+     * @brief Sets the member of an object with the given key, replacing it if it already exists
+     */
+    void set(const string &key, JsonValue value) {
+      for (auto &member : members) {
+        if (member.first == key) {
+          member.second = value;
+          return;
+        }
+      }
+
+      members.push_back(make_pair(key, value));
+    }
+
+    string toJSON() const {
+      ostringstream oss;
+      write(oss);
+
+      return oss.str();
+    }
+
+    /**
+     * @brief Parses a JSON document
+     * @param text The text to parse
+     * @return The parsed value
+     * @throws runtime_error If the text is not valid JSON
+     */
+    static JsonValue parse(const string &text) {
+      size_t i = 0;
+      JsonValue value = parseValue(text, i);
+
+      skipWhitespace(text, i);
+      if (i != text.length()) throw runtime_error("Unexpected trailing characters in JSON at offset " + to_string(i));
+
+      return value;
+    }
+
+  private:
+    JsonValue::Types type;
+    bool booleanValue = false;
+    double numberValue = 0;
+    string stringValue;
+    vector<JsonValue> elements;
+    vector<pair<string, JsonValue>> members;
+
+    const JsonValue* find(const string &key) const {
+      for (auto &member : members) {
+        if (member.first == key) return &member.second;
+      }
+
+      return nullptr;
+    }
+
+    void write(ostringstream &oss) const {
+      if (type == NULL_VALUE) {
+        oss << "null";
+      } else if (type == BOOLEAN) {
+        oss << (booleanValue ? "true" : "false");
+      } else if (type == NUMBER) {
+        if (numberValue == floor(numberValue) && fabs(numberValue) < 1e15) {
+          oss << (long long) numberValue;
+        } else {
+          oss << setprecision(17) << numberValue;
+        }
+      } else if (type == STRING) {
+        writeString(oss, stringValue);
+      } else if (type == ARRAY) {
+        oss << "[";
+
+        for (int i = 0; i < elements.size(); i++) {
+          if (i > 0) oss << ",";
+
+          elements[i].write(oss);
+        }
+
+        oss << "]";
+      } else {
+        oss << "{";
+
+        for (int i = 0; i < members.size(); i++) {
+          if (i > 0) oss << ",";
+
+          writeString(oss, members[i].first);
+          oss << ":";
+          members[i].second.write(oss);
+        }
+
+        oss << "}";
+      }
+    }
+
+    static void writeString(ostringstream &oss, const string &str) {
+      oss << '"';
+
+      for (unsigned char c : str) {
+        if (c == '"') oss << "\\\"";
+        else if (c == '\\') oss << "\\\\";
+        else if (c == '\n') oss << "\\n";
+        else if (c == '\r') oss << "\\r";
+        else if (c == '\t') oss << "\\t";
+        else if (c < 0x20) oss << "\\u" << hex << setw(4) << setfill('0') << (int) c << dec;
+        else oss << c;
+      }
+
+      oss << '"';
+    }
+
+    static void skipWhitespace(const string &text, size_t &i) {
+      while (i < text.length() && (text[i] == ' ' || text[i] == '\t' || text[i] == '\n' || text[i] == '\r')) i++;
+    }
+
+    static void expect(const string &text, size_t &i, const string &literal) {
+      if (text.compare(i, literal.length(), literal) != 0) {
+        throw runtime_error("Expected '" + literal + "' in JSON at offset " + to_string(i));
+      }
+
+      i += literal.length();
+    }
+
+    static JsonValue parseValue(const string &text, size_t &i) {
+      skipWhitespace(text, i);
+
+      if (i >= text.length()) throw runtime_error("Unexpected end of JSON");
+
+      char c = text[i];
+
+      if (c == '{') return parseObject(text, i);
+      if (c == '[') return parseArray(text, i);
+      if (c == '"') return JsonValue(parseString(text, i));
+
+      if (c == 't') {
+        expect(text, i, "true");
+        return JsonValue(true);
+      }
+
+      if (c == 'f') {
+        expect(text, i, "false");
+        return JsonValue(false);
+      }
+
+      if (c == 'n') {
+        expect(text, i, "null");
+        return JsonValue();
+      }
+
+      return parseNumber(text, i);
+    }
+
+    static JsonValue parseObject(const string &text, size_t &i) {
+      JsonValue object = JsonValue::object();
+
+      i++;
+      skipWhitespace(text, i);
+
+      if (i < text.length() && text[i] == '}') {
+        i++;
+        return object;
+      }
+
+      while (true) {
+        skipWhitespace(text, i);
+        if (i >= text.length() || text[i] != '"') throw runtime_error("Expected object key in JSON at offset " + to_string(i));
+
+        string key = parseString(text, i);
+
+        skipWhitespace(text, i);
+        expect(text, i, ":");
+
+        object.members.push_back(make_pair(key, parseValue(text, i)));
+
+        skipWhitespace(text, i);
+
+        if (i < text.length() && text[i] == ',') {
+          i++;
+          continue;
+        }
+
+        expect(text, i, "}");
+
+        return object;
+      }
+    }
+
+    static JsonValue parseArray(const string &text, size_t &i) {
+      JsonValue array = JsonValue::array();
+
+      i++;
+      skipWhitespace(text, i);
+
+      if (i < text.length() && text[i] == ']') {
+        i++;
+        return array;
+      }
+
+      while (true) {
+        array.elements.push_back(parseValue(text, i));
+
+        skipWhitespace(text, i);
+
+        if (i < text.length() && text[i] == ',') {
+          i++;
+          continue;
+        }
+
+        expect(text, i, "]");
+
+        return array;
+      }
+    }
+
+    static string parseString(const string &text, size_t &i) {
+      string str;
+
+      // Skip the opening quote
+      i++;
+
+      while (i < text.length() && text[i] != '"') {
+        char c = text[i++];
+
+        if (c != '\\') {
+          str += c;
+          continue;
+        }
+
+        if (i >= text.length()) break;
+
+        char escaped = text[i++];
+
+        if (escaped == 'n') str += '\n';
+        else if (escaped == 't') str += '\t';
+        else if (escaped == 'r') str += '\r';
+        else if (escaped == 'b') str += '\b';
+        else if (escaped == 'f') str += '\f';
+        else if (escaped == 'u') appendCodePoint(str, parseUnicodeEscape(text, i));
+        else str += escaped;
+      }
+
+      expect(text, i, "\"");
+
+      return str;
+    }
+
+    static unsigned int parseHex(const string &text, size_t &i) {
+      if (i + 4 > text.length()) throw runtime_error("Invalid unicode escape in JSON at offset " + to_string(i));
+
+      unsigned int value = stoul(text.substr(i, 4), nullptr, 16);
+      i += 4;
+
+      return value;
+    }
+
+    static unsigned int parseUnicodeEscape(const string &text, size_t &i) {
+      unsigned int codePoint = parseHex(text, i);
+
+      // Characters outside the basic multilingual plane are escaped as a UTF-16 surrogate pair
+      if (codePoint >= 0xD800 && codePoint <= 0xDBFF && text.compare(i, 2, "\\u") == 0) {
+        i += 2;
+        unsigned int low = parseHex(text, i);
+
+        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+      }
+
+      return codePoint;
+    }
+
+    static void appendCodePoint(string &str, unsigned int codePoint) {
+      if (codePoint < 0x80) {
+        str += (char) codePoint;
+      } else if (codePoint < 0x800) {
+        str += (char) (0xC0 | (codePoint >> 6));
+        str += (char) (0x80 | (codePoint & 0x3F));
+      } else if (codePoint < 0x10000) {
+        str += (char) (0xE0 | (codePoint >> 12));
+        str += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        str += (char) (0x80 | (codePoint & 0x3F));
+      } else {
+        str += (char) (0xF0 | (codePoint >> 18));
+        str += (char) (0x80 | ((codePoint >> 12) & 0x3F));
+        str += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        str += (char) (0x80 | (codePoint & 0x3F));
+      }
+    }
+
+    static JsonValue parseNumber(const string &text, size_t &i) {
+      size_t start = i;
+
+      if (i < text.length() && text[i] == '-') i++;
+
+      while (i < text.length() && (isdigit(text[i]) || text[i] == '.' || text[i] == 'e' || text[i] == 'E' || text[i] == '+' || text[i] == '-')) i++;
+
+      if (start == i) throw runtime_error("Unexpected character in JSON at offset " + to_string(i));
+
+      try {
+        return JsonValue(stod(text.substr(start, i - start)));
+      } catch (const exception &e) {
+        throw runtime_error("Invalid number in JSON at offset " + to_string(start));
+      }
+    }
+  };
+}
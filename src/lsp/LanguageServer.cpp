@@ -0,0 +1,287 @@
+#include "LanguageServer.hpp"
+#include <cctype>
+#include <filesystem>
+#include "../../version.h"
+
+using namespace std;
+using namespace Theta;
+
+// Error codes defined by JSON-RPC
+static const int PARSE_ERROR = -32700;
+static const int INVALID_REQUEST = -32600;
+static const int METHOD_NOT_FOUND = -32601;
+static const int INTERNAL_ERROR = -32603;
+
+// Documents are synced by sending only the ranges that changed
+static const int TEXT_DOCUMENT_SYNC_INCREMENTAL = 2;
+
+static const int DIAGNOSTIC_SEVERITY_ERROR = 1;
+
+int LanguageServer::run() {
+  string content;
+
+  while (!isExited && readMessage(content)) {
+    JsonValue message;
+
+    try {
+      message = JsonValue::parse(content);
+    } catch (const runtime_error &e) {
+      respondWithError(JsonValue(), PARSE_ERROR, e.what());
+      continue;
+    }
+
+    handleMessage(message);
+  }
+
+  return isShutdownRequested ? 0 : 1;
+}
+
+void LanguageServer::handleMessage(const JsonValue &message) {
+  if (message.getType() != JsonValue::OBJECT) return respondWithError(JsonValue(), INVALID_REQUEST, "Expected an object");
+
+  // A message the server fails to handle shouldn't take down the server, and with it every other open document
+  try {
+    dispatchMessage(message);
+  } catch (const exception &e) {
+    respondWithError(message["id"], INTERNAL_ERROR, e.what());
+  }
+}
+
+void LanguageServer::dispatchMessage(const JsonValue &message) {
+  string method = message["method"].asString();
+  const JsonValue &id = message["id"];
+  const JsonValue &params = message["params"];
+  bool isRequest = message.has("id");
+
+  if (method == "initialize") return handleInitialize(id, params);
+  if (method == "initialized") return;
+  if (method == "textDocument/didOpen") return handleDidOpen(params);
+  if (method == "textDocument/didChange") return handleDidChange(params);
+  if (method == "textDocument/didClose") return handleDidClose(params);
+
+  if (method == "shutdown") {
+    isShutdownRequested = true;
+
+    return respond(id, JsonValue());
+  }
+
+  if (method == "exit") {
+    isExited = true;
+    return;
+  }
+
+  // Notifications we don't support can be ignored, but requests always need a response
+  if (isRequest) respondWithError(id, METHOD_NOT_FOUND, "Unsupported method " + method);
+}
+
+shared_ptr<TextDocument> LanguageServer::getDocument(string uri) {
+  auto it = documents.find(uri);
+
+  if (it == documents.end()) return nullptr;
+
+  return it->second;
+}
+
+bool LanguageServer::readMessage(string &content) {
+  string line;
+  long contentLength = -1;
+
+  // Headers are terminated by an empty line. We only care about Content-Length
+  while (getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    if (line.empty()) {
+      if (contentLength >= 0) break;
+
+      continue;
+    }
+
+    string header = "Content-Length:";
+    if (line.compare(0, header.length(), header) == 0) contentLength = atol(line.substr(header.length()).c_str());
+  }
+
+  if (contentLength < 0) return false;
+
+  content.resize(contentLength);
+  in.read(&content[0], contentLength);
+
+  return in.gcount() == contentLength;
+}
+
+void LanguageServer::writeMessage(const JsonValue &message) {
+  string content = message.toJSON();
+
+  out << "Content-Length: " << content.length() << "\r\n\r\n" << content;
+  out.flush();
+}
+
+void LanguageServer::respond(const JsonValue &id, JsonValue result) {
+  JsonValue response = JsonValue::object();
+  response.set("jsonrpc", "2.0");
+  response.set("id", id);
+  response.set("result", result);
+
+  writeMessage(response);
+}
+
+void LanguageServer::respondWithError(const JsonValue &id, int code, string message) {
+  JsonValue error = JsonValue::object();
+  error.set("code", code);
+  error.set("message", message);
+
+  JsonValue response = JsonValue::object();
+  response.set("jsonrpc", "2.0");
+  response.set("id", id);
+  response.set("error", error);
+
+  writeMessage(response);
+}
+
+void LanguageServer::handleInitialize(const JsonValue &id, const JsonValue &params) {
+  // Links are resolved against the capsules in the workspace, the same way the compiler resolves them against the
+  // capsules in the directory it runs in
+  string rootPath = params["rootUri"].isNull() ? params["rootPath"].asString() : uriToPath(params["rootUri"].asString());
+
+  if (rootPath != "" && filesystem::is_directory(rootPath)) {
+    filesByCapsuleName = CompilationSession::discoverCapsules(rootPath);
+  }
+
+  JsonValue textDocumentSync = JsonValue::object();
+  textDocumentSync.set("openClose", true);
+  textDocumentSync.set("change", TEXT_DOCUMENT_SYNC_INCREMENTAL);
+
+  JsonValue capabilities = JsonValue::object();
+  capabilities.set("textDocumentSync", textDocumentSync);
+
+  JsonValue serverInfo = JsonValue::object();
+  serverInfo.set("name", "theta");
+  serverInfo.set("version", to_string(VERSION_MAJOR) + "." + to_string(VERSION_MINOR) + "." + to_string(VERSION_PATCH));
+
+  JsonValue result = JsonValue::object();
+  result.set("capabilities", capabilities);
+  result.set("serverInfo", serverInfo);
+
+  respond(id, result);
+}
+
+void LanguageServer::handleDidOpen(const JsonValue &params) {
+  string uri = params["textDocument"]["uri"].asString();
+
+  shared_ptr<TextDocument> document = make_shared<TextDocument>(
+    uri,
+    params["textDocument"]["text"].asString(),
+    filesByCapsuleName
+  );
+
+  documents[uri] = document;
+
+  publishDiagnostics(document);
+}
+
+void LanguageServer::handleDidChange(const JsonValue &params) {
+  shared_ptr<TextDocument> document = getDocument(params["textDocument"]["uri"].asString());
+
+  if (!document) return;
+
+  // Changes are applied in order, each to the text the previous one produced
+  for (auto &change : params["contentChanges"].getElements()) {
+    if (!change.has("range")) {
+      document->replaceText(change["text"].asString());
+      continue;
+    }
+
+    const JsonValue &range = change["range"];
+
+    document->applyChange(
+      range["start"]["line"].asInteger(),
+      range["start"]["character"].asInteger(),
+      range["end"]["line"].asInteger(),
+      range["end"]["character"].asInteger(),
+      change["text"].asString()
+    );
+  }
+
+  publishDiagnostics(document);
+}
+
+void LanguageServer::handleDidClose(const JsonValue &params) {
+  string uri = params["textDocument"]["uri"].asString();
+
+  documents.erase(uri);
+
+  // Clear out the closed document's diagnostics, otherwise the editor keeps showing them
+  JsonValue diagnosticsParams = JsonValue::object();
+  diagnosticsParams.set("uri", uri);
+  diagnosticsParams.set("diagnostics", JsonValue::array());
+
+  JsonValue notification = JsonValue::object();
+  notification.set("jsonrpc", "2.0");
+  notification.set("method", "textDocument/publishDiagnostics");
+  notification.set("params", diagnosticsParams);
+
+  writeMessage(notification);
+}
+
+void LanguageServer::publishDiagnostics(shared_ptr<TextDocument> document) {
+  JsonValue diagnostics = JsonValue::array();
+
+  auto makePosition = [&document](size_t offset) {
+    pair<int, int> position = document->getPosition(offset);
+
+    JsonValue json = JsonValue::object();
+    json.set("line", position.first);
+    json.set("character", position.second);
+
+    return json;
+  };
+
+  for (auto &diagnostic : document->getDiagnostics()) {
+    JsonValue range = JsonValue::object();
+    range.set("start", makePosition(diagnostic.start));
+    range.set("end", makePosition(diagnostic.end));
+
+    JsonValue json = JsonValue::object();
+    json.set("range", range);
+    json.set("severity", DIAGNOSTIC_SEVERITY_ERROR);
+    json.set("source", "theta");
+    json.set("message", diagnostic.message);
+
+    diagnostics.push(json);
+  }
+
+  JsonValue params = JsonValue::object();
+  params.set("uri", document->getUri());
+  params.set("diagnostics", diagnostics);
+
+  JsonValue notification = JsonValue::object();
+  notification.set("jsonrpc", "2.0");
+  notification.set("method", "textDocument/publishDiagnostics");
+  notification.set("params", params);
+
+  writeMessage(notification);
+}
+
+string LanguageServer::uriToPath(string uri) {
+  string scheme = "file://";
+
+  if (uri.compare(0, scheme.length(), scheme) != 0) return uri;
+
+  string path;
+
+  // Decode percent-encoded characters, such as spaces. A % that isn't followed by two hex digits is kept as it is
+  for (size_t i = scheme.length(); i < uri.length(); i++) {
+    if (
+      uri[i] == '%' &&
+      i + 2 < uri.length() &&
+      isxdigit((unsigned char) uri[i + 1]) &&
+      isxdigit((unsigned char) uri[i + 2])
+    ) {
+      path += (char) stoi(uri.substr(i + 1, 2), nullptr, 16);
+      i += 2;
+    } else {
+      path += uri[i];
+    }
+  }
+
+  return path;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <memory>
+#include "Json.hpp"
+#include "TextDocument.hpp"
+
+using namespace std;
+
+/**
+ * @brief A language server for Theta, speaking the language server protocol over a pair of streams (stdin and stdout
+ * when run through `theta lsp`). Open documents are kept in memory as TextDocuments, and each change is re-analyzed
+ * incrementally, so that diagnostics can be published back to the editor on every keystroke.
+ */
+namespace Theta {
+  class LanguageServer {
+  public:
+    /**
+     * @param input The stream messages from the client are read from
+     * @param output The stream messages to the client are written to
+     */
+    LanguageServer(istream &input, ostream &output) : in(input), out(output) {}
+
+    /**
+     * @brief Reads and handles messages until the client sends an exit notification or closes the input stream
+     * @return The exit code the server should exit with: 0 if the client asked the server to shut down before exiting,
+     * 1 otherwise
+     */
+    int run();
+
+    /**
+     * @brief Handles a single JSON-RPC message, writing any responses and notifications it produces to the output
+     * stream
+     * @param message The message to handle
+     */
+    void handleMessage(const JsonValue &message);
+
+    /**
+     * @brief Returns the open document with the given URI, or nullptr if there is none
+     */
+    shared_ptr<TextDocument> getDocument(string uri);
+
+    bool hasExited() { return isExited; }
+
+  private:
+    istream &in;
+    ostream &out;
+
+    map<string, shared_ptr<TextDocument>> documents;
+    shared_ptr<map<string, string>> filesByCapsuleName = make_shared<map<string, string>>();
+
+    bool isShutdownRequested = false;
+    bool isExited = false;
+
+    /**
+     * @brief Reads the next message, framed by a Content-Length header
+     * @param content Receives the content of the message
+     * @return false If the input stream ended before a whole message could be read
+     */
+    bool readMessage(string &content);
+
+    void writeMessage(const JsonValue &message);
+
+    void respond(const JsonValue &id, JsonValue result);
+
+    void respondWithError(const JsonValue &id, int code, string message);
+
+    /**
+     * @brief Passes a message on to the handler for its method
+     */
+    void dispatchMessage(const JsonValue &message);
+
+    void handleInitialize(const JsonValue &id, const JsonValue &params);
+
+    void handleDidOpen(const JsonValue &params);
+
+    void handleDidChange(const JsonValue &params);
+
+    void handleDidClose(const JsonValue &params);
+
+    /**
+     * @brief Sends the current diagnostics of a document to the client
+     */
+    void publishDiagnostics(shared_ptr<TextDocument> document);
+
+    /**
+     * @brief Converts a file:// URI to a path on disk
+     */
+    static string uriToPath(string uri);
+  };
+}
@@ -0,0 +1,881 @@
+#include "TextDocument.hpp"
+#include <algorithm>
+#include <cctype>
+#include "lexer/Lexer.cpp"
+#include "lexer/Lexemes.hpp"
+#include "parser/Parser.cpp"
+#include "compiler/Compiler.hpp"
+#include "compiler/TypeChecker.hpp"
+#include "compiler/optimization/LiteralInlinerPass.hpp"
+#include "exceptions/CompilationError.hpp"
+#include "exceptions/ParseError.hpp"
+#include "exceptions/ReferenceError.hpp"
+#include "exceptions/IllegalReassignmentError.hpp"
+#include "parser/ast/ControlFlowNode.hpp"
+#include "parser/ast/EnumNode.hpp"
+#include "parser/ast/FunctionDeclarationNode.hpp"
+#include "parser/ast/FunctionInvocationNode.hpp"
+#include "parser/ast/IdentifierNode.hpp"
+#include "parser/ast/StructDeclarationNode.hpp"
+#include "parser/ast/StructDefinitionNode.hpp"
+#include "parser/ast/TypeDeclarationNode.hpp"
+
+using namespace std;
+using namespace Theta;
+
+TextDocument::TextDocument(string documentUri, string documentText, shared_ptr<map<string, string>> capsuleFiles)
+  : uri(documentUri), text(documentText), filesByCapsuleName(capsuleFiles) {
+  lineStarts = computeLineStarts(text);
+
+  analyzeFully();
+}
+
+void TextDocument::applyChange(int startLine, int startCharacter, int endLine, int endCharacter, string newText) {
+  size_t changeStart = getOffset(startLine, startCharacter);
+  size_t changeEnd = max(changeStart, getOffset(endLine, endCharacter));
+
+  text.replace(changeStart, changeEnd - changeStart, newText);
+  lineStarts = computeLineStarts(text);
+
+  if (isSplitIntoElements && reanalyzeChange(changeStart, changeEnd, newText.length())) {
+    lastAnalysisIncremental = true;
+    return;
+  }
+
+  analyzeFully();
+}
+
+void TextDocument::replaceText(string newText) {
+  text = newText;
+  lineStarts = computeLineStarts(text);
+
+  analyzeFully();
+}
+
+vector<Diagnostic> TextDocument::getDiagnostics() {
+  if (!isSplitIntoElements) return documentDiagnostics;
+
+  vector<Diagnostic> diagnostics = headerDiagnostics;
+  diagnostics.insert(diagnostics.end(), hoistDiagnostics.begin(), hoistDiagnostics.end());
+
+  for (auto &element : elements) {
+    for (auto elementDiagnostics : { &element->parseDiagnostics, &element->hoistDiagnostics, &element->checkDiagnostics }) {
+      for (auto &diagnostic : *elementDiagnostics) {
+        diagnostics.push_back({
+          element->start + min(diagnostic.start, element->length),
+          element->start + min(diagnostic.end, element->length),
+          diagnostic.message
+        });
+      }
+    }
+  }
+
+  for (auto &diagnostic : footerDiagnostics) {
+    diagnostics.push_back({ bodyEnd + diagnostic.start, bodyEnd + diagnostic.end, diagnostic.message });
+  }
+
+  return diagnostics;
+}
+
+pair<int, int> TextDocument::getPosition(size_t offset) {
+  offset = min(offset, text.length());
+
+  size_t line = upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin() - 1;
+  int character = 0;
+
+  // The protocol counts characters in UTF-16 code units. Characters that take 4 bytes in UTF-8 take 2 code units in
+  // UTF-16, every other character takes 1
+  for (size_t i = lineStarts[line]; i < offset; i++) {
+    unsigned char c = text[i];
+
+    if ((c & 0xC0) == 0x80) continue;
+
+    character += c >= 0xF0 ? 2 : 1;
+  }
+
+  return make_pair(line, character);
+}
+
+size_t TextDocument::getOffset(int line, int character) {
+  if (line < 0) return 0;
+  if (line >= lineStarts.size()) return text.length();
+
+  size_t lineEnd = line + 1 < lineStarts.size() ? lineStarts[line + 1] - 1 : text.length();
+  size_t i = lineStarts[line];
+  int codeUnits = 0;
+
+  while (i < lineEnd && codeUnits < character) {
+    unsigned char c = text[i];
+    codeUnits += c >= 0xF0 ? 2 : 1;
+
+    i++;
+    while (i < lineEnd && (text[i] & 0xC0) == 0x80) i++;
+  }
+
+  return i;
+}
+
+void TextDocument::analyzeFully() {
+  lastAnalysisIncremental = false;
+  isSplitIntoElements = false;
+  elements.clear();
+  declaringElements.clear();
+  referencingElements.clear();
+  headerDiagnostics.clear();
+  footerDiagnostics.clear();
+  hoistDiagnostics.clear();
+  documentDiagnostics.clear();
+
+  Lexer lexer;
+  lexer.lex(text);
+
+  deque<Token> &tokens = lexer.tokens;
+
+  // Links don't take part in type checking yet, so all that matters about them here is that they can be resolved
+  while (!tokens.empty() && tokens.front().getType() == Token::KEYWORD && tokens.front().getLexeme() == Lexemes::LINK) {
+    tokens.pop_front();
+
+    if (tokens.empty() || tokens.front().getType() != Token::IDENTIFIER) return analyzeWithoutElements();
+
+    Token linkToken = tokens.front();
+    tokens.pop_front();
+
+    if (filesByCapsuleName->find(linkToken.getLexeme()) == filesByCapsuleName->end()) {
+      size_t linkStart = offsetOfToken(linkToken, lineStarts);
+
+      headerDiagnostics.push_back({
+        linkStart,
+        linkStart + linkToken.getLexeme().length(),
+        "LinkageError: Could not find capsule " + linkToken.getLexeme() + " referenced"
+      });
+    }
+  }
+
+  bool isCapsule = tokens.size() >= 3 &&
+    tokens[0].getType() == Token::KEYWORD &&
+    tokens[0].getLexeme() == Lexemes::CAPSULE &&
+    tokens[1].getType() == Token::IDENTIFIER &&
+    tokens[2].getType() == Token::BRACE_OPEN;
+
+  if (!isCapsule) {
+    analyzeWithoutElements();
+
+    // The parser accepts elements outside of a capsule, but nothing after the parser does
+    if (documentDiagnostics.empty() && !tokens.empty()) {
+      size_t tokenStart = offsetOfToken(tokens.front(), lineStarts);
+
+      documentDiagnostics.push_back({
+        tokenStart,
+        tokenStart + tokens.front().getLexeme().length(),
+        "SyntaxError: Expected a capsule declaration"
+      });
+    }
+
+    return;
+  }
+
+  capsuleNameStart = offsetOfToken(tokens[1], lineStarts);
+  capsuleNameEnd = capsuleNameStart + tokens[1].getLexeme().length();
+  bodyStart = offsetOfToken(tokens[2], lineStarts) + 1;
+
+  Token capsuleBrace = tokens[2];
+
+  capsule = make_shared<CapsuleNode>(tokens[1].getLexeme(), nullptr);
+  block = make_shared<BlockNode>(capsule);
+  capsule->setValue(block);
+
+  tokens.erase(tokens.begin(), tokens.begin() + 3);
+
+  vector<size_t> elementStarts;
+  splitIntoElements(tokens, lineStarts, 0, true, elementStarts);
+
+  // Whatever wasn't parsed as part of the body should be the brace that closes the capsule, and nothing after it
+  bodyEnd = tokens.empty() ? text.length() : offsetOfToken(tokens.front(), lineStarts);
+
+  if (!tokens.empty() && tokens.front().getType() == Token::BRACE_CLOSE) {
+    tokens.pop_front();
+  } else if (tokens.empty()) {
+    // The elements ran all the way to the end of the document, so the capsule was never closed
+    headerDiagnostics.push_back({ bodyStart - 1, bodyStart, "SyntaxError: Unmatched bracket " + capsuleBrace.getLexeme() });
+  }
+
+  for (auto &token : tokens) {
+    size_t tokenStart = offsetOfToken(token, lineStarts) - bodyEnd;
+
+    footerDiagnostics.push_back({
+      tokenStart,
+      tokenStart + token.getLexeme().length(),
+      "ParseError: Unparsed token " + token.getLexeme()
+    });
+  }
+
+  // The first element also owns any whitespace and comments between the opening brace and its first token, so that
+  // together the elements cover the whole body
+  if (!elementStarts.empty()) elementStarts[0] = bodyStart;
+
+  elements = makeElements(elementStarts, bodyEnd);
+  isSplitIntoElements = true;
+  lastReparsedElementCount = elements.size();
+
+  checkElements(elements, {});
+}
+
+void TextDocument::analyzeWithoutElements() {
+  isSplitIntoElements = false;
+  documentDiagnostics.clear();
+  lastReparsedElementCount = 0;
+  lastCheckedElementCount = 0;
+
+  // Only the parser is run, since the later stages expect to be given a well formed capsule, and there's no capsule to
+  // check here
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>(filesByCapsuleName);
+
+  try {
+    Compiler::buildAST(session, text, uri);
+  } catch (ParseError &e) {
+    // The error that caused this has already been recorded in the session
+  }
+
+  size_t firstLineEnd = lineStarts.size() > 1 ? lineStarts[1] - 1 : text.length();
+
+  for (auto &error : session->getEncounteredExceptions()) {
+    if (dynamic_pointer_cast<CompilationError>(error)) {
+      documentDiagnostics.push_back(locateCompilationError(error, lineStarts, 0));
+    } else {
+      documentDiagnostics.push_back({ 0, firstLineEnd, formatMessage(error) });
+    }
+  }
+}
+
+bool TextDocument::reanalyzeChange(size_t changeStart, size_t changeEnd, size_t insertedLength) {
+  // Changes to the header or after the body can change how everything in the body is parsed
+  if (elements.empty() || changeStart < bodyStart || changeEnd > bodyEnd) return false;
+
+  // If the body stopped short of the closing brace, the change could let it carry on into the tokens after it
+  if (!footerDiagnostics.empty()) return false;
+
+  // Find the elements whose spans the change touched. The first element's span starts at the beginning of the body,
+  // so there is always one that contains the start of the change
+  auto startsAfter = [](size_t offset, const shared_ptr<CapsuleElement> &element) { return offset < element->start; };
+
+  int first = upper_bound(elements.begin(), elements.end(), changeStart, startsAfter) - elements.begin() - 1;
+  int last = changeEnd > changeStart
+    ? upper_bound(elements.begin(), elements.end(), changeEnd - 1, startsAfter) - elements.begin() - 1
+    : first;
+
+  bool isLastElement = last == elements.size() - 1;
+  long delta = (long) insertedLength - (long) (changeEnd - changeStart);
+
+  size_t regionStart = elements[first]->start;
+  size_t regionEnd = (size_t) ((long) (elements[last]->start + elements[last]->length) + delta);
+
+  // The region has to be separated from the elements around it by whitespace. Otherwise, lexing it on its own could
+  // split a token that runs across its boundary
+  if (first > 0 && !isspace(text[regionStart - 1])) return false;
+  if (!isLastElement && regionEnd > regionStart && !isspace(text[regionEnd - 1])) return false;
+
+  string regionText = text.substr(regionStart, regionEnd - regionStart);
+
+  // An unterminated string or comment would swallow the elements after the region
+  if (endsInsideStringOrComment(regionText)) return false;
+
+  Lexer lexer;
+  lexer.lex(regionText);
+
+  // If the brackets in the region don't balance, the change moved where its elements end
+  if (findUnbalancedBracket(lexer.tokens) >= 0) return false;
+
+  // The region can't be parsed on its own if the expression before it could continue into it, or if it could continue
+  // into the element after it
+  if (!lexer.tokens.empty() && canContinueExpression(lexer.tokens.back())) return false;
+  if (first > 0 && !elements[first - 1]->tokens.empty() && canContinueExpression(elements[first - 1]->tokens.back())) return false;
+  if (!isLastElement && (elements[last + 1]->tokens.empty() || !canStartElement(elements[last + 1]->tokens.front()))) return false;
+
+  vector<size_t> elementStarts;
+  if (!splitIntoElements(lexer.tokens, computeLineStarts(regionText), regionStart, false, elementStarts)) return false;
+
+  set<string> changedNames;
+  for (int i = first; i <= last; i++) {
+    changedNames.insert(elements[i]->declaredNames.begin(), elements[i]->declaredNames.end());
+  }
+
+  vector<shared_ptr<CapsuleElement>> newElements;
+
+  if (elementStarts.empty()) {
+    // Only whitespace and comments are left in the region. The element before it can take them over, since they only
+    // extend its span and don't move any of its tokens. The first element has nothing before it to take them over
+    if (first == 0) return false;
+
+    elements[first - 1]->length += regionEnd - regionStart;
+  } else {
+    elementStarts[0] = regionStart;
+    newElements = makeElements(elementStarts, regionEnd);
+  }
+
+  for (auto &element : newElements) {
+    changedNames.insert(element->declaredNames.begin(), element->declaredNames.end());
+  }
+
+  for (int i = first; i <= last; i++) {
+    indexNames(elements[i].get(), false);
+  }
+
+  elements.erase(elements.begin() + first, elements.begin() + last + 1);
+  elements.insert(elements.begin() + first, newElements.begin(), newElements.end());
+
+  for (int i = first + newElements.size(); i < elements.size(); i++) {
+    elements[i]->start = (size_t) ((long) elements[i]->start + delta);
+  }
+
+  bodyEnd = (size_t) ((long) bodyEnd + delta);
+  lastReparsedElementCount = newElements.size();
+
+  checkElements(newElements, changedNames);
+
+  return true;
+}
+
+bool TextDocument::splitIntoElements(
+  deque<Token> &tokens,
+  const vector<size_t> &tokenLineStarts,
+  size_t base,
+  bool isWholeBody,
+  vector<size_t> &elementStarts
+) {
+  // Errors don't matter yet, each element is parsed again on its own once we know where it is
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>(filesByCapsuleName);
+  string noSource;
+  Parser parser;
+
+  while (!tokens.empty()) {
+    // A closing brace between elements closes the capsule
+    if (tokens.front().getType() == Token::BRACE_CLOSE) return isWholeBody;
+
+    Token firstToken = tokens.front();
+    size_t tokenCountBefore = tokens.size();
+
+    parser.parseCapsuleElement(tokens, noSource, uri, session, block);
+
+    // The parser made no progress, so the rest of the tokens can't be part of the body
+    if (tokens.size() == tokenCountBefore) return isWholeBody;
+
+    if (!isWholeBody && !canStartElement(firstToken)) return false;
+
+    elementStarts.push_back(base + offsetOfToken(firstToken, tokenLineStarts));
+  }
+
+  return true;
+}
+
+vector<shared_ptr<CapsuleElement>> TextDocument::makeElements(vector<size_t> starts, size_t end) {
+  vector<shared_ptr<CapsuleElement>> madeElements;
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>(filesByCapsuleName);
+
+  for (int i = 0; i < starts.size(); i++) {
+    shared_ptr<CapsuleElement> element = make_shared<CapsuleElement>();
+    element->start = starts[i];
+    element->length = (i + 1 < starts.size() ? starts[i + 1] : end) - starts[i];
+
+    Lexer lexer;
+    lexer.lex(text.substr(element->start, element->length));
+    element->tokens = lexer.tokens;
+
+    parseElement(element, session);
+
+    madeElements.push_back(element);
+  }
+
+  return madeElements;
+}
+
+void TextDocument::parseElement(shared_ptr<CapsuleElement> element, shared_ptr<CompilationSession> session) {
+  string elementText = text.substr(element->start, element->length);
+  vector<size_t> elementLineStarts = computeLineStarts(elementText);
+
+  indexNames(element.get(), false);
+
+  element->ast = nullptr;
+  element->parseDiagnostics.clear();
+  element->declaredNames.clear();
+  element->referencedNames.clear();
+
+  auto reportAtToken = [&element, &elementLineStarts](Token &token, string message) {
+    size_t tokenStart = offsetOfToken(token, elementLineStarts);
+
+    element->parseDiagnostics.push_back({ tokenStart, tokenStart + token.getLexeme().length(), message });
+  };
+
+  // Where the parser would have moved on to the next element in the middle of an unfinished expression, parsing the
+  // element on its own runs out of tokens instead. The parser doesn't report running out of tokens, and leaves holes in
+  // the AST where the missing parts should be, so elements that are cut off like this are reported without parsing them
+  int unbalancedBracket = findUnbalancedBracket(element->tokens);
+
+  if (unbalancedBracket >= 0) {
+    Token &bracket = element->tokens[unbalancedBracket];
+
+    return reportAtToken(bracket, "SyntaxError: Unmatched bracket " + bracket.getLexeme());
+  }
+
+  if (!element->tokens.empty() && canContinueExpression(element->tokens.back())) {
+    return reportAtToken(element->tokens.back(), "SyntaxError: Unexpected end of expression after " + element->tokens.back().getLexeme());
+  }
+
+  // Parsing consumes the tokens, and the element needs to keep them around to be parsed again later
+  deque<Token> tokens = element->tokens;
+  size_t errorCountBefore = session->getEncounteredExceptions().size();
+
+  Parser parser;
+  element->ast = parser.parseCapsuleElement(tokens, elementText, uri, session, block);
+
+  vector<shared_ptr<Error>> errors = session->getEncounteredExceptions();
+  for (size_t i = errorCountBefore; i < errors.size(); i++) {
+    element->parseDiagnostics.push_back(locateCompilationError(errors[i], elementLineStarts, 0));
+  }
+
+  for (auto &token : tokens) {
+    reportAtToken(token, "ParseError: Unparsed token " + token.getLexeme());
+  }
+
+  collectDeclaredNames(element->ast, element->declaredNames);
+  collectReferencedNames(element->ast, element->referencedNames);
+
+  indexNames(element.get(), true);
+}
+
+void TextDocument::checkElements(vector<shared_ptr<CapsuleElement>> changedElements, set<string> changedNames) {
+  shared_ptr<CompilationSession> session = make_shared<CompilationSession>(filesByCapsuleName);
+
+  set<CapsuleElement*> changed;
+  for (auto &element : changedElements) {
+    changed.insert(element.get());
+  }
+
+  // Hoisting errors, such as duplicate declarations, can only change if a changed name is declared more than once, now
+  // or as of the last time everything was hoisted. Otherwise, only the declarations the checked elements use are hoisted
+  bool isHoistingEverything = changed.size() == elements.size() || any_of(
+    changedNames.begin(),
+    changedNames.end(),
+    [this](const string &name) { return duplicatedNames.count(name) > 0 || getDeclaringElements(name).size() > 1; }
+  );
+
+  // Capsule-level declarations spell out their types, but a function's type is still refined by checking its body, so
+  // re-checking an element can change the meaning of what it declares. Dependents are followed transitively, by
+  // treating the names a dependent declares as changed too, until no more elements depend on the changed names.
+  set<CapsuleElement*> dependents;
+  set<string> followedNames = changedNames;
+  vector<string> namesToFollow(changedNames.begin(), changedNames.end());
+
+  while (!namesToFollow.empty()) {
+    string name = namesToFollow.back();
+    namesToFollow.pop_back();
+
+    // Elements that declare a changed name are re-checked too, since whether they redeclare it depends on what the
+    // elements before them declare
+    for (auto index : { &referencingElements, &declaringElements }) {
+      auto it = index->find(name);
+
+      if (it == index->end()) continue;
+
+      for (CapsuleElement *element : it->second) {
+        if (changed.count(element) || !dependents.insert(element).second) continue;
+
+        for (auto &declaredName : element->declaredNames) {
+          if (followedNames.insert(declaredName).second) namesToFollow.push_back(declaredName);
+        }
+      }
+    }
+  }
+
+  vector<shared_ptr<CapsuleElement>> elementsToCheck;
+
+  for (auto &element : elements) {
+    bool isDependent = dependents.count(element.get()) > 0;
+
+    if (!changed.count(element.get()) && !isDependent) continue;
+
+    // A dependent's AST has already been rewritten by the literal inliner using the declarations it depended on back
+    // then, so it needs to be parsed again from its cached tokens before it can be checked against the new ones
+    if (isDependent) {
+      parseElement(element, session);
+      lastReparsedElementCount++;
+    }
+
+    elementsToCheck.push_back(element);
+  }
+
+  // Checking an element only looks up the declarations of the names it references or declares, so those are the only
+  // elements that need to be hoisted and declared around it
+  set<CapsuleElement*> inScope;
+
+  for (auto &element : elementsToCheck) {
+    inScope.insert(element.get());
+
+    for (auto names : { &element->referencedNames, &element->declaredNames }) {
+      for (auto &name : *names) {
+        const set<CapsuleElement*> &declaring = getDeclaringElements(name);
+        inScope.insert(declaring.begin(), declaring.end());
+      }
+    }
+  }
+
+  vector<shared_ptr<CapsuleElement>> scopeElements;
+  for (auto &element : elements) {
+    if (isHoistingEverything || inScope.count(element.get())) scopeElements.push_back(element);
+  }
+
+  // Elements that failed to parse could be missing parts that checking them would rely on
+  auto isCheckable = [](const shared_ptr<CapsuleElement> &element) {
+    return element->ast && element->parseDiagnostics.empty();
+  };
+
+  vector<shared_ptr<ASTNode>> capsuleElements;
+  for (auto &element : scopeElements) {
+    if (isCheckable(element)) capsuleElements.push_back(element->ast);
+  }
+
+  block->setElements(capsuleElements);
+
+  set<string> hoistMessages;
+
+  if (isHoistingEverything) {
+    hoistDiagnostics.clear();
+
+    for (auto &element : elements) {
+      element->hoistDiagnostics.clear();
+    }
+  }
+
+  auto recordHoistErrors = [this, &session, &hoistMessages, isHoistingEverything](size_t errorCountBefore) {
+    // Hoisting only some of the declarations would report a subset of the errors we already have
+    if (!isHoistingEverything) return;
+
+    vector<shared_ptr<Error>> errors = session->getEncounteredExceptions();
+
+    for (size_t i = errorCountBefore; i < errors.size(); i++) {
+      string message = formatMessage(errors[i]);
+
+      // The inliner and type checker both hoist declarations, and report the same duplicates
+      if (!hoistMessages.insert(message).second) continue;
+
+      // Blame the last element that declares the duplicated name, since it's the one doing the redeclaring
+      shared_ptr<IllegalReassignmentError> reassignment = dynamic_pointer_cast<IllegalReassignmentError>(errors[i]);
+      shared_ptr<CapsuleElement> redeclaringElement;
+
+      for (auto &element : elements) {
+        if (reassignment && element->declaredNames.count(reassignment->identifier.substr(0, reassignment->identifier.find('.')))) {
+          redeclaringElement = element;
+        }
+      }
+
+      if (redeclaringElement) {
+        Diagnostic diagnostic = locateError(redeclaringElement, errors[i]);
+
+        redeclaringElement->hoistDiagnostics.push_back({ diagnostic.start, diagnostic.end, message });
+      } else {
+        hoistDiagnostics.push_back({ capsuleNameStart, capsuleNameEnd, message });
+      }
+    }
+  };
+
+  shared_ptr<ASTNode> capsuleNode = capsule;
+  set<CapsuleElement*> failedOptimization;
+
+  LiteralInlinerPass literalInliner(session);
+
+  size_t errorCount = session->getEncounteredExceptions().size();
+  literalInliner.enterCapsule(capsuleNode);
+  recordHoistErrors(errorCount);
+
+  for (auto &element : elementsToCheck) {
+    element->checkDiagnostics.clear();
+
+    // Enums are unpacked into constants while hoisting, and don't need optimizing or checking themselves
+    if (!isCheckable(element) || element->ast->getNodeType() == ASTNode::ENUM) continue;
+
+    errorCount = session->getEncounteredExceptions().size();
+    literalInliner.optimizeCapsuleElement(element->ast);
+
+    vector<shared_ptr<Error>> errors = session->getEncounteredExceptions();
+    for (size_t i = errorCount; i < errors.size(); i++) {
+      element->checkDiagnostics.push_back(locateError(element, errors[i]));
+      failedOptimization.insert(element.get());
+    }
+  }
+
+  literalInliner.cleanup();
+
+  // The inliner removes enums from the capsule, and may have replaced the ASTs of the elements it optimized
+  capsuleElements.clear();
+  for (auto &element : scopeElements) {
+    if (isCheckable(element) && element->ast->getNodeType() != ASTNode::ENUM) capsuleElements.push_back(element->ast);
+  }
+
+  block->setElements(capsuleElements);
+
+  TypeChecker typeChecker(session);
+
+  errorCount = session->getEncounteredExceptions().size();
+  typeChecker.enterCapsule(capsule);
+  recordHoistErrors(errorCount);
+
+  set<CapsuleElement*> toCheck;
+  for (auto &element : elementsToCheck) {
+    toCheck.insert(element.get());
+  }
+
+  // Elements are checked in order, and each sees the declarations of the elements before it, so the elements that
+  // aren't being re-checked still need to declare themselves as they did the last time they were checked
+  for (auto &element : scopeElements) {
+    if (!toCheck.count(element.get())) {
+      // Hoisting reset the function's type to its declared type, and checking it would have refined it again by now
+      if (element->checkedType) element->ast->getRight()->setResolvedType(element->checkedType);
+      if (element->isDeclared) typeChecker.declareCapsuleElement(element->ast);
+
+      continue;
+    }
+
+    element->isDeclared = false;
+    element->checkedType = nullptr;
+
+    if (!isCheckable(element) || element->ast->getNodeType() == ASTNode::ENUM) continue;
+    if (failedOptimization.count(element.get())) continue;
+
+    errorCount = session->getEncounteredExceptions().size();
+    element->isDeclared = typeChecker.checkCapsuleElement(element->ast);
+
+    if (element->ast->getNodeType() == ASTNode::ASSIGNMENT && element->ast->getRight()) {
+      element->checkedType = element->ast->getRight()->getResolvedType();
+    }
+
+    vector<shared_ptr<Error>> errors = session->getEncounteredExceptions();
+    for (size_t i = errorCount; i < errors.size(); i++) {
+      element->checkDiagnostics.push_back(locateError(element, errors[i]));
+    }
+  }
+
+  if (isHoistingEverything) {
+    duplicatedNames.clear();
+
+    for (auto &declaring : declaringElements) {
+      if (declaring.second.size() > 1) duplicatedNames.insert(declaring.first);
+    }
+  }
+
+  lastCheckedElementCount = elementsToCheck.size();
+}
+
+const set<CapsuleElement*> &TextDocument::getDeclaringElements(const string &name) {
+  static const set<CapsuleElement*> none;
+
+  auto it = declaringElements.find(name);
+
+  return it == declaringElements.end() ? none : it->second;
+}
+
+void TextDocument::indexNames(CapsuleElement *element, bool isIndexing) {
+  for (auto [names, index] : { make_pair(&element->declaredNames, &declaringElements), make_pair(&element->referencedNames, &referencingElements) }) {
+    for (auto &name : *names) {
+      if (isIndexing) {
+        (*index)[name].insert(element);
+        continue;
+      }
+
+      auto it = index->find(name);
+      if (it == index->end()) continue;
+
+      it->second.erase(element);
+      if (it->second.empty()) index->erase(it);
+    }
+  }
+}
+
+Diagnostic TextDocument::locateError(shared_ptr<CapsuleElement> element, shared_ptr<Error> error) {
+  vector<size_t> elementLineStarts = computeLineStarts(text.substr(element->start, element->length));
+
+  if (dynamic_pointer_cast<CompilationError>(error)) return locateCompilationError(error, elementLineStarts, 0);
+
+  string identifier;
+
+  if (shared_ptr<ReferenceError> referenceError = dynamic_pointer_cast<ReferenceError>(error)) {
+    identifier = referenceError->identifier;
+  } else if (shared_ptr<IllegalReassignmentError> reassignment = dynamic_pointer_cast<IllegalReassignmentError>(error)) {
+    identifier = reassignment->identifier;
+  }
+
+  // Point at the identifier the error is about if it appears in the element, otherwise at the start of the element
+  Token* locatedToken = element->tokens.empty() ? nullptr : &element->tokens.front();
+
+  for (auto &token : element->tokens) {
+    if (identifier != "" && token.getLexeme() == identifier) {
+      locatedToken = &token;
+      break;
+    }
+  }
+
+  if (!locatedToken) return { 0, 0, formatMessage(error) };
+
+  size_t tokenStart = offsetOfToken(*locatedToken, elementLineStarts);
+
+  return { tokenStart, tokenStart + locatedToken->getLexeme().length(), formatMessage(error) };
+}
+
+Diagnostic TextDocument::locateCompilationError(shared_ptr<Error> error, const vector<size_t> &errorLineStarts, size_t base) {
+  shared_ptr<CompilationError> compilationError = dynamic_pointer_cast<CompilationError>(error);
+
+  if (!compilationError) return { 0, 0, formatMessage(error) };
+
+  Token token = compilationError->getToken();
+  size_t tokenStart = offsetOfToken(token, errorLineStarts) - base;
+
+  return { tokenStart, tokenStart + max((size_t) 1, token.getLexeme().length()), formatMessage(error) };
+}
+
+vector<size_t> TextDocument::computeLineStarts(const string &source) {
+  vector<size_t> starts = { 0 };
+
+  for (size_t i = 0; i < source.length(); i++) {
+    if (source[i] == '\n') starts.push_back(i + 1);
+  }
+
+  return starts;
+}
+
+size_t TextDocument::offsetOfToken(Token &token, const vector<size_t> &tokenLineStarts) {
+  vector<int> location = token.getStartLocation();
+
+  // Lines and columns from the lexer start at 1
+  int line = max(1, min(location[0], (int) tokenLineStarts.size()));
+  int column = max(1, location[1]);
+
+  return tokenLineStarts[line - 1] + column - 1;
+}
+
+bool TextDocument::endsInsideStringOrComment(const string &source) {
+  size_t i = 0;
+
+  // Mirrors the order in which the lexer tries these, so that a delimiter inside a string or comment is skipped over
+  // the same way the lexer would skip it
+  while (i < source.length()) {
+    size_t end;
+
+    if (source.compare(i, Lexemes::STRING_DELIMITER.length(), Lexemes::STRING_DELIMITER) == 0) {
+      end = source.find(Lexemes::STRING_DELIMITER, i + 1);
+      if (end == string::npos) return true;
+
+      i = end + Lexemes::STRING_DELIMITER.length();
+    } else if (source.compare(i, Lexemes::COMMENT.length(), Lexemes::COMMENT) == 0) {
+      end = source.find(Lexemes::NEWLINE, i);
+      if (end == string::npos) return true;
+
+      i = end + Lexemes::NEWLINE.length();
+    } else if (source.compare(i, Lexemes::MULTILINE_COMMENT_DELIMITER_START.length(), Lexemes::MULTILINE_COMMENT_DELIMITER_START) == 0) {
+      end = source.find(Lexemes::MULTILINE_COMMENT_DELIMITER_END, i + 1);
+      if (end == string::npos) return true;
+
+      i = end + Lexemes::MULTILINE_COMMENT_DELIMITER_END.length();
+    } else {
+      i++;
+    }
+  }
+
+  return false;
+}
+
+int TextDocument::findUnbalancedBracket(deque<Token> &tokens) {
+  vector<int> openBrackets;
+
+  for (int i = 0; i < tokens.size(); i++) {
+    Token::Types type = tokens[i].getType();
+
+    if (type == Token::BRACE_OPEN || type == Token::PAREN_OPEN || type == Token::BRACKET_OPEN) {
+      openBrackets.push_back(i);
+    } else if (type == Token::BRACE_CLOSE || type == Token::PAREN_CLOSE || type == Token::BRACKET_CLOSE) {
+      if (openBrackets.empty()) return i;
+
+      openBrackets.pop_back();
+    }
+  }
+
+  return openBrackets.empty() ? -1 : openBrackets.back();
+}
+
+bool TextDocument::canStartElement(Token &token) {
+  if (token.getType() == Token::IDENTIFIER) return true;
+
+  // An else always continues the if before it
+  return token.getType() == Token::KEYWORD && token.getLexeme() != Lexemes::ELSE;
+}
+
+bool TextDocument::canContinueExpression(Token &token) {
+  Token::Types type = token.getType();
+
+  // Every keyword, like struct or return, needs something after it
+  return type == Token::OPERATOR ||
+    type == Token::KEYWORD ||
+    type == Token::ASSIGNMENT ||
+    type == Token::FUNC_DECLARATION ||
+    type == Token::COMMA ||
+    type == Token::COLON ||
+    type == Token::AT;
+}
+
+void TextDocument::collectDeclaredNames(shared_ptr<ASTNode> node, set<string> &names) {
+  if (!node) return;
+
+  if (node->getNodeType() == ASTNode::ASSIGNMENT && node->getLeft() && node->getLeft()->getNodeType() == ASTNode::IDENTIFIER) {
+    names.insert(dynamic_pointer_cast<IdentifierNode>(node->getLeft())->getIdentifier());
+  } else if (node->getNodeType() == ASTNode::STRUCT_DEFINITION) {
+    names.insert(dynamic_pointer_cast<StructDefinitionNode>(node)->getName());
+  } else if (node->getNodeType() == ASTNode::ENUM) {
+    shared_ptr<IdentifierNode> enumIdentifier = dynamic_pointer_cast<IdentifierNode>(dynamic_pointer_cast<EnumNode>(node)->getIdentifier());
+
+    if (enumIdentifier) names.insert(enumIdentifier->getIdentifier());
+  }
+}
+
+void TextDocument::collectReferencedNames(shared_ptr<ASTNode> node, set<string> &names) {
+  if (!node) return;
+
+  if (node->getNodeType() == ASTNode::IDENTIFIER) {
+    string identifier = dynamic_pointer_cast<IdentifierNode>(node)->getIdentifier();
+
+    // Enum members are referenced as Enum.Member, and depend on the enum's declaration
+    names.insert(identifier);
+    names.insert(identifier.substr(0, identifier.find('.')));
+  } else if (node->getNodeType() == ASTNode::TYPE_DECLARATION) {
+    names.insert(dynamic_pointer_cast<TypeDeclarationNode>(node)->getType());
+  } else if (node->getNodeType() == ASTNode::STRUCT_DECLARATION) {
+    names.insert(dynamic_pointer_cast<StructDeclarationNode>(node)->getStructType());
+  } else if (node->getNodeType() == ASTNode::CONTROL_FLOW) {
+    for (auto &conditionExpressionPair : dynamic_pointer_cast<ControlFlowNode>(node)->getConditionExpressionPairs()) {
+      collectReferencedNames(conditionExpressionPair.first, names);
+      collectReferencedNames(conditionExpressionPair.second, names);
+    }
+  } else if (node->getNodeType() == ASTNode::FUNCTION_DECLARATION) {
+    shared_ptr<FunctionDeclarationNode> declaration = dynamic_pointer_cast<FunctionDeclarationNode>(node);
+
+    collectReferencedNames(declaration->getParameters(), names);
+    collectReferencedNames(declaration->getDefinition(), names);
+  } else if (node->getNodeType() == ASTNode::FUNCTION_INVOCATION) {
+    shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(node);
+
+    collectReferencedNames(invocation->getIdentifier(), names);
+    collectReferencedNames(invocation->getParameters(), names);
+  } else if (node->getNodeType() == ASTNode::ENUM) {
+    collectReferencedNames(dynamic_pointer_cast<EnumNode>(node)->getIdentifier(), names);
+  }
+
+  collectReferencedNames(node->getValue(), names);
+  collectReferencedNames(node->getLeft(), names);
+  collectReferencedNames(node->getRight(), names);
+
+  if (node->hasMany()) {
+    for (auto &element : dynamic_pointer_cast<ASTNodeList>(node)->getElements()) {
+      collectReferencedNames(element, names);
+    }
+  }
+}
+
+string TextDocument::formatMessage(shared_ptr<Error> error) {
+  return error->getErrorType() + ": " + error->getMessage();
+}
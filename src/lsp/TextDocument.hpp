@@ -0,0 +1,290 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <map>
+#include <memory>
+#include <utility>
+#include "lexer/Token.hpp"
+#include "parser/ast/ASTNode.hpp"
+#include "parser/ast/BlockNode.hpp"
+#include "parser/ast/CapsuleNode.hpp"
+#include "exceptions/Error.hpp"
+#include "compiler/CompilationSession.hpp"
+
+using namespace std;
+
+namespace Theta {
+  /**
+   * @brief A problem found while analyzing a document, located by byte offsets into the text it was found in
+   */
+  struct Diagnostic {
+    size_t start;
+    size_t end;
+    string message;
+  };
+
+  /**
+   * @brief A top-level element of a capsule (an assignment, struct definition or enum), along with everything the
+   * language server has cached about it. Each element owns the span of text from its first token up to the first token
+   * of the next element, so the spans of all the elements together cover the capsule's body.
+   *
+   * Tokens and diagnostics are positioned relative to the start of the element's span rather than to the document, so
+   * an edit to an earlier element only shifts the span instead of invalidating everything after it. isDeclared records
+   * whether the element's declaration made it into scope the last time it was checked, which only happens when it
+   * checks successfully, and checkedType is the type checking resolved for the value it assigns. hoistDiagnostics are
+   * the errors hoisting reported for the element's declarations, like declaring a name that's already declared.
+   */
+  struct CapsuleElement {
+    size_t start = 0;
+    size_t length = 0;
+    deque<Token> tokens;
+    shared_ptr<ASTNode> ast;
+    set<string> declaredNames;
+    set<string> referencedNames;
+    vector<Diagnostic> parseDiagnostics;
+    vector<Diagnostic> hoistDiagnostics;
+    vector<Diagnostic> checkDiagnostics;
+    bool isDeclared = false;
+    shared_ptr<ASTNode> checkedType;
+  };
+
+  /**
+   * @brief A document opened in the language server. The document's tokens, ASTs and type checking results are kept
+   * in memory between edits, so an edit only re-lexes and re-parses the capsule elements it touched, and only re-checks
+   * those elements and the elements that reference a name they declare.
+   *
+   * Edits the incremental path can't handle safely, such as edits to the capsule header, unbalanced brackets or an
+   * unterminated string, fall back to analyzing the whole document again. Documents that aren't made up of a single
+   * capsule are only parsed, as a whole.
+   */
+  class TextDocument {
+  public:
+    /**
+     * @param documentUri The URI the editor identifies the document by
+     * @param documentText The initial text of the document
+     * @param capsuleFiles A map of capsule names to the files that contain them, used to resolve links
+     */
+    TextDocument(string documentUri, string documentText, shared_ptr<map<string, string>> capsuleFiles);
+
+    /**
+     * @brief Replaces a range of the document's text and re-analyzes whatever the edit affected. Positions are zero
+     * based lines and UTF-16 code unit offsets within the line, as in the language server protocol.
+     * @param startLine The line the replaced range starts on
+     * @param startCharacter The character within the start line where the replaced range starts
+     * @param endLine The line the replaced range ends on
+     * @param endCharacter The character within the end line where the replaced range ends
+     * @param newText The text to replace the range with
+     */
+    void applyChange(int startLine, int startCharacter, int endLine, int endCharacter, string newText);
+
+    /**
+     * @brief Replaces the whole text of the document and re-analyzes all of it
+     * @param newText The new text of the document
+     */
+    void replaceText(string newText);
+
+    /**
+     * @brief Returns every diagnostic in the document, located by byte offsets into the document's text
+     */
+    vector<Diagnostic> getDiagnostics();
+
+    /**
+     * @brief Converts a byte offset into the document to a zero based line and UTF-16 character, as used by the
+     * language server protocol
+     */
+    pair<int, int> getPosition(size_t offset);
+
+    /**
+     * @brief Converts a zero based line and UTF-16 character to a byte offset into the document. Positions past the end
+     * of a line or of the document are clamped to it.
+     */
+    size_t getOffset(int line, int character);
+
+    string getUri() { return uri; }
+
+    string getText() { return text; }
+
+    /**
+     * @brief Returns the number of top-level capsule elements the document was split into, or 0 if the document could
+     * not be split into elements
+     */
+    int getElementCount() { return elements.size(); }
+
+    /**
+     * @brief Returns whether the most recent change was handled without analyzing the whole document again
+     */
+    bool wasLastAnalysisIncremental() { return lastAnalysisIncremental; }
+
+    /**
+     * @brief Returns how many elements were re-parsed by the most recent analysis
+     */
+    int getLastReparsedElementCount() { return lastReparsedElementCount; }
+
+    /**
+     * @brief Returns how many elements were type checked by the most recent analysis
+     */
+    int getLastCheckedElementCount() { return lastCheckedElementCount; }
+
+  private:
+    string uri;
+    string text;
+    vector<size_t> lineStarts;
+    shared_ptr<map<string, string>> filesByCapsuleName;
+
+    /**
+     * @brief Whether the document was recognized as a single capsule and split into elements. If not, it's analyzed
+     * as a whole every time it changes.
+     */
+    bool isSplitIntoElements = false;
+
+    size_t bodyStart = 0;
+    size_t bodyEnd = 0;
+    size_t capsuleNameStart = 0;
+    size_t capsuleNameEnd = 0;
+
+    shared_ptr<CapsuleNode> capsule;
+    shared_ptr<BlockNode> block;
+    vector<shared_ptr<CapsuleElement>> elements;
+
+    /**
+     * @brief Diagnostics located before the capsule's body, such as links to capsules that don't exist
+     */
+    vector<Diagnostic> headerDiagnostics;
+
+    /**
+     * @brief Diagnostics for tokens left over after the capsule's body, relative to the end of the body
+     */
+    vector<Diagnostic> footerDiagnostics;
+
+    /**
+     * @brief Diagnostics that come from hoisting the capsule's declarations that can't be blamed on a single element.
+     * Like the hoisting diagnostics of each element, these are only recomputed when a name declared more than once
+     * changes, since nothing else can add or remove them
+     */
+    vector<Diagnostic> hoistDiagnostics;
+
+    /**
+     * @brief The elements declaring and referencing each name, kept up to date as elements are parsed, so that an edit
+     * can find the elements it affects without going through every element in the capsule
+     */
+    map<string, set<CapsuleElement*>> declaringElements;
+    map<string, set<CapsuleElement*>> referencingElements;
+
+    /**
+     * @brief Names that were declared by more than one element the last time every declaration was hoisted
+     */
+    set<string> duplicatedNames;
+
+    /**
+     * @brief Diagnostics for documents that aren't split into elements
+     */
+    vector<Diagnostic> documentDiagnostics;
+
+    bool lastAnalysisIncremental = false;
+    int lastReparsedElementCount = 0;
+    int lastCheckedElementCount = 0;
+
+    /**
+     * @brief Lexes, parses and checks the whole document from scratch
+     */
+    void analyzeFully();
+
+    /**
+     * @brief Reports the parse errors in a document that isn't a single capsule
+     */
+    void analyzeWithoutElements();
+
+    /**
+     * @brief Re-analyzes the document after the text between changeStart and changeEnd was replaced with text of the
+     * given length, by re-lexing and re-parsing only the elements whose spans the change touched.
+     * @return true If the change could be handled incrementally, false if the whole document needs to be re-analyzed
+     */
+    bool reanalyzeChange(size_t changeStart, size_t changeEnd, size_t insertedLength);
+
+    /**
+     * @brief Splits a run of tokens from a capsule's body into elements by parsing them, recording the offset at which
+     * each element's first token starts.
+     * @param tokens The tokens to split. Consumed as they are parsed
+     * @param tokenLineStarts The offsets at which the lines the tokens were lexed from start
+     * @param base The offset of the text the tokens were lexed from, within the document
+     * @param isWholeBody Whether the tokens run to the end of the document, in which case splitting stops at the brace
+     * closing the capsule. Otherwise, the tokens must split cleanly into elements
+     * @param elementStarts Receives the document offset of each element's first token
+     * @return false If the tokens could not be split cleanly
+     */
+    bool splitIntoElements(
+      deque<Token> &tokens,
+      const vector<size_t> &tokenLineStarts,
+      size_t base,
+      bool isWholeBody,
+      vector<size_t> &elementStarts
+    );
+
+    /**
+     * @brief Creates the elements spanning the given starts, up to the given end, and lexes and parses each of them
+     */
+    vector<shared_ptr<CapsuleElement>> makeElements(vector<size_t> starts, size_t end);
+
+    /**
+     * @brief Parses an element from its cached tokens, replacing its AST and parse diagnostics
+     * @param session The session to record parse errors into
+     */
+    void parseElement(shared_ptr<CapsuleElement> element, shared_ptr<CompilationSession> session);
+
+    /**
+     * @brief Type checks the given elements, along with every element that depends on a name in changedNames, directly or
+     * through other elements, with the declarations of all the elements in scope
+     * @param changedElements Elements that were just parsed
+     * @param changedNames Names whose declarations were added, removed or changed
+     */
+    void checkElements(vector<shared_ptr<CapsuleElement>> changedElements, set<string> changedNames);
+
+    /**
+     * @brief Returns the elements that declare the given name, without adding it to the index
+     */
+    const set<CapsuleElement*> &getDeclaringElements(const string &name);
+
+    /**
+     * @brief Adds the names an element declares and references to the name indexes, or removes them
+     */
+    void indexNames(CapsuleElement *element, bool isIndexing);
+
+    /**
+     * @brief Works out where in an element an error that doesn't carry its own location most likely comes from
+     */
+    Diagnostic locateError(shared_ptr<CapsuleElement> element, shared_ptr<Error> error);
+
+    /**
+     * @brief Converts an error that carries the token it was found at into a diagnostic
+     * @param error The error
+     * @param errorLineStarts The offsets at which the lines of the text the token was lexed from start
+     * @param base The offset to subtract from the token's offset
+     */
+    static Diagnostic locateCompilationError(shared_ptr<Error> error, const vector<size_t> &errorLineStarts, size_t base);
+
+    static vector<size_t> computeLineStarts(const string &source);
+
+    static size_t offsetOfToken(Token &token, const vector<size_t> &tokenLineStarts);
+
+    static bool endsInsideStringOrComment(const string &source);
+
+    /**
+     * @brief Returns the index of a closing bracket that closes nothing, or of the innermost bracket left open, or -1 if
+     * the brackets in the tokens balance
+     */
+    static int findUnbalancedBracket(deque<Token> &tokens);
+
+    static bool canStartElement(Token &token);
+
+    static bool canContinueExpression(Token &token);
+
+    static void collectDeclaredNames(shared_ptr<ASTNode> node, set<string> &names);
+
+    static void collectReferencedNames(shared_ptr<ASTNode> node, set<string> &names);
+
+    static string formatMessage(shared_ptr<Error> error);
+  };
+}
@@ -39,23 +39,22 @@ using namespace std;
 namespace Theta {
   class Parser {
   public:
-    shared_ptr<ASTNode> parse(deque<Token> &tokens, string &src, string file, shared_ptr<map<string, string>> filesByCapsuleName) {
-      source = src;
-      fileName = file;
+    shared_ptr<ASTNode> parse(deque<Token> &tokens, string &src, string file, shared_ptr<CompilationSession> compilationSession) {
+      source = make_shared<SourceBuffer>(src, file);
       remainingTokens = &tokens;
-      filesByCapsule = filesByCapsuleName;
+      session = compilationSession;
+      filesByCapsule = session->filesByCapsuleName;
 
       shared_ptr<ASTNode> parsedSource = parseSource();
 
       // Throw parse errors for any remaining tokens after we've finished our parser run
       for (int i = 0; i < tokens.size(); i++) {
-        Theta::Compiler::getInstance().addException(
+        session->addException(
           make_shared<Theta::CompilationError>(
             "ParseError",
             "Unparsed token " + tokens[i].getLexeme(),
             tokens[i],
-            source,
-            fileName
+            source
           )
         );
       }
@@ -63,11 +62,42 @@ namespace Theta {
       return parsedSource;
     }
 
+    /**
+     * @brief Parses a single top-level element of a capsule's block, the same way it would be parsed as part of the
+     * whole capsule. Only the tokens belonging to the element are consumed from the front of the given tokens, so the
+     * language server can call this repeatedly to split a capsule into its elements and re-parse them individually.
+     * @param tokens The tokens to parse from. Consumed tokens are removed
+     * @param src The source the tokens were lexed from, used to display errors
+     * @param file The file name errors should be attributed to
+     * @param compilationSession The session to record errors into
+     * @param parent The capsule's block node, which becomes the element's parent
+     * @return The parsed element, or nullptr if no element could be parsed
+     */
+    shared_ptr<ASTNode> parseCapsuleElement(
+      deque<Token> &tokens,
+      string &src,
+      string file,
+      shared_ptr<CompilationSession> compilationSession,
+      shared_ptr<ASTNode> parent
+    ) {
+      source = make_shared<SourceBuffer>(src, file);
+      remainingTokens = &tokens;
+      session = compilationSession;
+      filesByCapsule = session->filesByCapsuleName;
+
+      try {
+        return parseReturn(parent);
+      } catch (ParseError &e) {
+        // The error has already been recorded in the session by the time a ParseError is thrown
+        return nullptr;
+      }
+    }
+
   private:
-    string source;
-    string fileName;
+    shared_ptr<SourceBuffer> source;
     deque<Token> *remainingTokens;
 
+    shared_ptr<CompilationSession> session;
     shared_ptr<map<string, string>> filesByCapsule;
     Token currentToken;
 
@@ -87,31 +117,45 @@ namespace Theta {
 
     shared_ptr<ASTNode> parseLink(shared_ptr<ASTNode> parent) {
       match(Token::IDENTIFIER);
-      shared_ptr<LinkNode> linkNode = Theta::Compiler::getInstance().getIfExistsParsedLinkAST(currentToken.getLexeme());
 
-      if (linkNode) return linkNode;
+      Token linkToken = currentToken;
+      shared_ptr<LinkNode> linkNode = make_shared<LinkNode>(linkToken.getLexeme(), parent);
 
-      linkNode = make_shared<LinkNode>(currentToken.getLexeme(), parent);
-
-      auto fileContainingLinkedCapsule = filesByCapsule->find(currentToken.getLexeme());
+      // Errors in linking are reported against the file doing the linking, so they aren't part of the linked AST, which
+      // other files may share
+      auto fileContainingLinkedCapsule = filesByCapsule->find(linkToken.getLexeme());
 
       if (fileContainingLinkedCapsule == filesByCapsule->end()) {
-        Theta::Compiler::getInstance().addException(
+        session->addException(
+          make_shared<Theta::CompilationError>(
+            "LinkageError",
+            "Could not find capsule " + linkToken.getLexeme() + " referenced",
+            linkToken,
+            source
+          )
+        );
+
+        return linkNode;
+      }
+
+      shared_ptr<ASTNode> linkedAST = session->resolveParsedLinkAST(linkToken.getLexeme(), [this, &fileContainingLinkedCapsule]() {
+        return Theta::Compiler::buildAST(session, fileContainingLinkedCapsule->second);
+      });
+
+      if (!linkedAST) {
+        session->addException(
           make_shared<Theta::CompilationError>(
             "LinkageError",
-            "Could not find capsule " + currentToken.getLexeme() + " referenced",
-            currentToken,
-            source,
-            fileName
+            "Capsule " + linkToken.getLexeme() + " links itself, through the capsules it links",
+            linkToken,
+            source
           )
         );
-      } else {
-        shared_ptr<ASTNode> linkedAST = Theta::Compiler::getInstance().buildAST(fileContainingLinkedCapsule->second);
 
-        linkNode->setValue(linkedAST);
+        return linkNode;
       }
 
-      Theta::Compiler::getInstance().addParsedLinkAST(currentToken.getLexeme(), linkNode);
+      linkNode->setValue(linkedAST);
 
       return linkNode;
     }
@@ -131,9 +175,21 @@ namespace Theta {
 
     shared_ptr<ASTNode> parseReturn(shared_ptr<ASTNode> parent) {
       if (match(Token::KEYWORD, Lexemes::RETURN)) {
+        Token returnToken = currentToken;
         shared_ptr<ASTNode> ret = make_shared<ReturnNode>(parent);
         ret->setValue(parseAssignment(ret));
 
+        if (!ret->getValue()) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              "Expected an expression after return",
+              returnToken,
+              source
+            )
+          );
+        }
+
         return ret;
       }
 
@@ -147,25 +203,40 @@ namespace Theta {
         shared_ptr<StructDefinitionNode> str = make_shared<StructDefinitionNode>(currentToken.getLexeme(), parent);
 
         if (!match(Token::BRACE_OPEN)) {
-          Theta::Compiler::getInstance().addException(
+          session->addException(
             make_shared<Theta::CompilationError>(
               "SyntaxError",
               "Expected open brace during struct definition",
               currentToken,
-              source,
-              fileName
+              source
             )
           );
         }
 
         vector<shared_ptr<ASTNode>> items;
 
-        while (!match(Token::BRACE_CLOSE)) {
-          match(Token::IDENTIFIER);
+        // Stop if we run out of tokens before the closing brace, otherwise an unterminated struct would loop forever
+        while (!remainingTokens->empty() && !match(Token::BRACE_CLOSE)) {
+          // Stop if the next token isn't one that can start a field, since nothing would consume it
+          if (!match(Token::IDENTIFIER)) break;
+
           shared_ptr<ASTNode> el = parseIdentifier(str);
 
           if (el == nullptr) break;
 
+          if (!el->getValue()) {
+            session->addException(
+              make_shared<Theta::CompilationError>(
+                "SyntaxError",
+                "Expected a type for field " + currentToken.getLexeme(),
+                currentToken,
+                source
+              )
+            );
+
+            continue;
+          }
+
           items.push_back(el);
         }
 
@@ -182,13 +253,34 @@ namespace Theta {
 
       if (match(Token::ASSIGNMENT)) {
         shared_ptr<ASTNode> left = expr;
+        Token assignmentToken = currentToken;
 
         expr = make_shared<AssignmentNode>(parent);
 
-        left->setParent(expr);
+        if (left) left->setParent(expr);
 
         expr->setLeft(left);
         expr->setRight(parseFunctionDeclaration(expr));
+
+        // Later stages assume both sides of an assignment are there, which isn't the case in half-written code. A
+        // line left unfinished after an = is parsed as chained with the assignment on the next line, so that's caught too
+        string missingSideMessage;
+
+        if (!left || left->getNodeType() != ASTNode::IDENTIFIER) missingSideMessage = "Expected an identifier before assignment";
+        else if (!left->getValue()) missingSideMessage = "Expected a type for " + dynamic_pointer_cast<IdentifierNode>(left)->getIdentifier() + " before assignment";
+        else if (!expr->getRight()) missingSideMessage = "Expected an expression after assignment";
+        else if (expr->getRight()->getNodeType() == ASTNode::ASSIGNMENT) missingSideMessage = "Expected an expression after assignment, but found another assignment";
+
+        if (missingSideMessage != "") {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              missingSideMessage,
+              assignmentToken,
+              source
+            )
+          );
+        }
       }
 
       return expr;
@@ -199,7 +291,9 @@ namespace Theta {
         vector<shared_ptr<ASTNode>> blockExpr;
         shared_ptr<BlockNode> block = make_shared<BlockNode>(parent);
 
-        while (!match(Token::BRACE_CLOSE)) {
+        bool isClosed = false;
+
+        while (!(isClosed = match(Token::BRACE_CLOSE))) {
           shared_ptr<ASTNode> expr = parseReturn(block);
 
           if (expr == nullptr) break;
@@ -207,6 +301,18 @@ namespace Theta {
           blockExpr.push_back(expr);
         }
 
+        // The elements parsed so far are kept, so everything before the missing brace can still be checked
+        if (!isClosed) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              "Expected closing brace after block",
+              nextTokenForError(),
+              source
+            )
+          );
+        }
+
         block->setElements(blockExpr);
 
         return block;
@@ -232,15 +338,44 @@ namespace Theta {
           expr = make_shared<ASTNodeList>(func_def);
         }
 
+        Token arrowToken = currentToken;
+
         shared_ptr<ASTNodeList> params = dynamic_pointer_cast<ASTNodeList>(expr); 
         for (auto param : params->getElements()) {
           param->setParent(params);
+
+          // Parameters are the only place a function's argument types come from
+          if (param->getNodeType() != ASTNode::IDENTIFIER || !param->getValue()) {
+            session->addException(
+              make_shared<Theta::CompilationError>(
+                "SyntaxError",
+                "Expected typed parameters before " + arrowToken.getLexeme(),
+                arrowToken,
+                source
+              )
+            );
+
+            break;
+          }
         } 
 
         func_def->setParameters(params);
 
         shared_ptr<ASTNode> definitionBlock = parseBlock(func_def);
 
+        if (!definitionBlock) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              "Expected a function body",
+              arrowToken,
+              source
+            )
+          );
+
+          definitionBlock = make_shared<BlockNode>(func_def);
+        }
+
         // In the case of shorthand single-line function bodies, we still want to wrap them in a block within the ast
         // for scoping reasons
         if (definitionBlock->getNodeType() != ASTNode::BLOCK) {
@@ -266,14 +401,45 @@ namespace Theta {
 
     shared_ptr<ASTNode> parseStructDeclaration(shared_ptr<ASTNode> parent) {
       if (match(Token::AT)) {
-        match(Token::IDENTIFIER);
+        if (!match(Token::IDENTIFIER)) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              "Expected a struct name after @",
+              currentToken,
+              source
+            )
+          );
+        }
 
         shared_ptr<StructDeclarationNode> str = make_shared<StructDeclarationNode>(currentToken.getLexeme(), parent);
 
-        match(Token::BRACE_OPEN);
+        if (!match(Token::BRACE_OPEN)) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              "Expected opening brace during struct declaration",
+              currentToken,
+              source
+            )
+          );
+
+          return str;
+        }
 
         str->setValue(parseDict(str));
 
+        if (!str->getValue() || str->getValue()->getNodeType() != ASTNode::DICTIONARY) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              "Expected key-value pairs during struct declaration",
+              currentToken,
+              source
+            )
+          );
+        }
+
         return str;
       }
 
@@ -288,13 +454,12 @@ namespace Theta {
         root->setIdentifier(parseIdentifier(root));
 
         if (!match(Token::BRACE_OPEN)) {
-          Theta::Compiler::getInstance().addException(
+          session->addException(
             make_shared<Theta::CompilationError>(
               "SyntaxError",
               "Expected opening brace during enum declaration",
               currentToken,
-              source,
-              fileName
+              source
             )
           );
 
@@ -303,15 +468,14 @@ namespace Theta {
 
         vector<shared_ptr<ASTNode>> enumVals;
 
-        while (!match(Token::BRACE_CLOSE)) {
+        while (!remainingTokens->empty() && !match(Token::BRACE_CLOSE)) {
           if (!match(Token::COLON)) {
-            Theta::Compiler::getInstance().addException(
+            session->addException(
               make_shared<Theta::CompilationError>(
                 "SyntaxError",
                 "Enum must only contain symbols",
-                remainingTokens->front(),
-                source,
-                fileName
+                nextTokenForError(),
+                source
               )
             );
 
@@ -339,22 +503,32 @@ namespace Theta {
       if (match(Token::KEYWORD, Lexemes::IF)) {
         shared_ptr<ControlFlowNode> cfNode = make_shared<ControlFlowNode>(parent);
 
+        Token keywordToken = currentToken;
         shared_ptr<ASTNode> cnd = parseExpression(cfNode);
         shared_ptr<ASTNode> expr = parseBlock(cfNode);
 
+        validateBranch(cnd, expr, keywordToken);
+
         vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> conditionExpressionPairs = {
           make_pair(cnd, expr)
         };
 
         while (match(Token::KEYWORD, Lexemes::ELSE) && match(Token::KEYWORD, Lexemes::IF)) {
+          keywordToken = currentToken;
           cnd = parseExpression(cfNode);
           expr = parseBlock(cfNode);
+
+          validateBranch(cnd, expr, keywordToken);
           conditionExpressionPairs.push_back(make_pair(cnd, expr));
         }
 
         // If we just matched an else but no if afterwards. This way it only matches one else block per control flow
         if (currentToken.getType() == Token::KEYWORD && currentToken.getLexeme() == Lexemes::ELSE) {
-          conditionExpressionPairs.push_back(make_pair(nullptr, parseBlock(cfNode)));
+          keywordToken = currentToken;
+          expr = parseBlock(cfNode);
+
+          validateBranch(nullptr, expr, keywordToken, true);
+          conditionExpressionPairs.push_back(make_pair(nullptr, expr));
         }
 
         cfNode->setConditionExpressionPairs(conditionExpressionPairs);
@@ -380,12 +554,15 @@ namespace Theta {
 
       while (match(Token::OPERATOR, Lexemes::OR) || match(Token::OPERATOR, Lexemes::AND)) {
         shared_ptr<ASTNode> left = expr;
+        Token operatorToken = currentToken;
 
         expr = make_shared<BinaryOperationNode>(currentToken.getLexeme(), parent);
-        left->setParent(expr);
+        if (left) left->setParent(expr);
 
         expr->setLeft(left);
         expr->setRight(parseExpression(expr));
+
+        validateOperands(expr, operatorToken);
       }
 
       return expr;
@@ -396,12 +573,15 @@ namespace Theta {
 
       while (match(Token::OPERATOR, Lexemes::EQUALITY) || match(Token::OPERATOR, Lexemes::INEQUALITY)) {
         shared_ptr<ASTNode> left = expr;
+        Token operatorToken = currentToken;
 
         expr = make_shared<BinaryOperationNode>(currentToken.getLexeme(), parent);
-        left->setParent(expr);
-    
+        if (left) left->setParent(expr);
+
         expr->setLeft(left);
         expr->setRight(parseComparison(expr));
+
+        validateOperands(expr, operatorToken);
       }
 
       return expr;
@@ -417,12 +597,15 @@ namespace Theta {
         match(Token::OPERATOR, Lexemes::LTEQ)
       ) {
         shared_ptr<ASTNode> left = expr;
+        Token operatorToken = currentToken;
 
         expr = make_shared<BinaryOperationNode>(currentToken.getLexeme(), parent);
-        left->setParent(expr);
+        if (left) left->setParent(expr);
 
         expr->setLeft(left);
         expr->setRight(parseTerm(expr));
+
+        validateOperands(expr, operatorToken);
       }
 
       return expr;
@@ -433,12 +616,15 @@ namespace Theta {
 
       while (match(Token::OPERATOR, Lexemes::MINUS) || match(Token::OPERATOR, Lexemes::PLUS)) {
         shared_ptr<ASTNode> left = expr;
+        Token operatorToken = currentToken;
 
         expr = make_shared<BinaryOperationNode>(currentToken.getLexeme(), parent);
-        left->setParent(expr);
+        if (left) left->setParent(expr);
 
         expr->setLeft(left);
         expr->setRight(parseFactor(expr));
+
+        validateOperands(expr, operatorToken);
       }
 
       return expr;
@@ -453,12 +639,15 @@ namespace Theta {
         match(Token::OPERATOR, Lexemes::MODULO)
       ) {
         shared_ptr<ASTNode> left = expr;
+        Token operatorToken = currentToken;
 
         expr = make_shared<BinaryOperationNode>(currentToken.getLexeme(), parent);
-        left->setParent(expr);
+        if (left) left->setParent(expr);
 
         expr->setLeft(left);
         expr->setRight(parseExponent(expr));
+
+        validateOperands(expr, operatorToken);
       }
 
       return expr;
@@ -469,12 +658,15 @@ namespace Theta {
 
       while (match(Token::OPERATOR, Lexemes::EXPONENT)) {
         shared_ptr<ASTNode> left = expr;
+        Token operatorToken = currentToken;
 
         expr = make_shared<BinaryOperationNode>(currentToken.getLexeme(), parent);
-        left->setParent(expr);
+        if (left) left->setParent(expr);
 
         expr->setLeft(left);
         expr->setRight(parseUnary(expr));
+
+        validateOperands(expr, operatorToken);
       }
 
       return expr;
@@ -483,9 +675,12 @@ namespace Theta {
     shared_ptr<ASTNode> parseUnary(shared_ptr<ASTNode> parent, shared_ptr<ASTNode> passedLeftArg = nullptr) {
       // Unary cant have a left arg, so if we get one passed in we can skip straight to primary
       if (!passedLeftArg && (match(Token::OPERATOR, Lexemes::NOT) || match(Token::OPERATOR, Lexemes::MINUS))) {
+        Token operatorToken = currentToken;
         shared_ptr<ASTNode> un = make_shared<UnaryOperationNode>(currentToken.getLexeme(), parent);
         un->setValue(parseUnary(un, passedLeftArg));
 
+        validateOperands(un, operatorToken);
+
         return un;
       }
 
@@ -550,7 +745,8 @@ namespace Theta {
         }
 
         while (match(Token::COMMA)) {
-          expressions.push_back(parseFunctionDeclaration(nodeList));
+          Token commaToken = currentToken;
+          addElement(expressions, parseFunctionDeclaration(nodeList), commaToken, "Expected an expression after ,");
         }
 
         nodeList->setElements(expressions);
@@ -558,7 +754,16 @@ namespace Theta {
         expr = nodeList;
       }
 
-      match(Token::PAREN_CLOSE);
+      if (!match(Token::PAREN_CLOSE)) {
+        session->addException(
+          make_shared<Theta::CompilationError>(
+            "SyntaxError",
+            "Expected closing parenthesis",
+            nextTokenForError(),
+            source
+          )
+        );
+      }
 
       return expr;
     }
@@ -570,10 +775,32 @@ namespace Theta {
       if (p.first == "kv" && expr && expr->getNodeType() == ASTNode::TUPLE) {
         vector<shared_ptr<ASTNode>> el;
 
-        if (expr->getLeft()) el.push_back(expr);
+        if (expr->getLeft() && expr->getRight()) el.push_back(expr);
 
         while (match(Token::COMMA)) {
-          el.push_back(parseKvPair(parent).second);
+          Token commaToken = currentToken;
+          pair<string, shared_ptr<ASTNode>> kvPair = parseKvPair(parent);
+
+          shared_ptr<ASTNode> kv = kvPair.first == "kv" ? kvPair.second : nullptr;
+
+          // parseKvPair already reports pairs that are missing one side, but a trailing comma or a value without a
+          // key would otherwise leave a hole in the dict
+          if (!kv || (!kv->getLeft() && !kv->getRight())) {
+            session->addException(
+              make_shared<Theta::CompilationError>(
+                "SyntaxError",
+                "Expected a key-value pair after ,",
+                commaToken,
+                source
+              )
+            );
+
+            continue;
+          }
+
+          if (!kv->getLeft() || !kv->getRight()) continue;
+
+          el.push_back(kvPair.second);
         }
 
         expr = make_shared<DictionaryNode>(parent);
@@ -600,16 +827,28 @@ namespace Theta {
       if (match(Token::COLON)) {
         type = "kv";
         shared_ptr<ASTNode> left = expr;
+        Token colonToken = currentToken;
 
-        if (left->getNodeType() == ASTNode::IDENTIFIER) {
+        if (left && left->getNodeType() == ASTNode::IDENTIFIER) {
           left = make_shared<SymbolNode>(dynamic_pointer_cast<IdentifierNode>(left)->getIdentifier(), expr);
         }
 
         expr = make_shared<TupleNode>(parent);
-        left->setParent(expr);
+        if (left) left->setParent(expr);
     
         expr->setLeft(left);
         expr->setRight(parseExpression(expr));
+
+        if (!left || !expr->getRight()) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              !left ? "Expected a key before :" : "Expected a value after :",
+              colonToken,
+              source
+            )
+          );
+        }
       } else if (expr == nullptr) {
         // parseTuplen will return a nullptr if it just immediately encounters a BRACE_CLOSE. We can treat this
         // as a dict since a valid tuple must have 2 values in it.
@@ -623,35 +862,47 @@ namespace Theta {
     shared_ptr<ASTNode> parseTuple(shared_ptr<ASTNode> parent) {
       shared_ptr<ASTNode> expr;
 
-      if (match(Token::BRACE_CLOSE)) return nullptr;
+      // The brace is left for parseDict to close the dict with
+      if (check(Token::BRACE_CLOSE)) return nullptr;
 
       try {
         expr = parseExpression(parent);
       } catch (ParseError e) {
-        if (e.getErrorParseType() == "symbol") remainingTokens->pop_front();
+        if (e.getErrorParseType() == "symbol" && !remainingTokens->empty()) remainingTokens->pop_front();
       }
 
       if (match(Token::COMMA)) {
         shared_ptr<ASTNode> first = expr;
+        Token commaToken = currentToken;
 
         expr = make_shared<TupleNode>(parent);
-        first->setParent(expr);
+        if (first) first->setParent(expr);
         expr->setLeft(first);
 
         try {
           expr->setRight(parseExpression(expr));
         } catch (ParseError e) {
-          if (e.getErrorParseType() == "symbol") remainingTokens->pop_front();
+          if (e.getErrorParseType() == "symbol" && !remainingTokens->empty()) remainingTokens->pop_front();
+        }
+
+        if (!first || !expr->getRight()) {
+          session->addException(
+            make_shared<Theta::CompilationError>(
+              "SyntaxError",
+              !first ? "Expected an expression before ," : "Expected an expression after ,",
+              commaToken,
+              source
+            )
+          );
         }
 
         if (!match(Token::BRACE_CLOSE)) {
-          Theta::Compiler::getInstance().addException(
+          session->addException(
             make_shared<Theta::CompilationError>(
               "SyntaxError",
               "Expected closing brace after tuple definition",
-              remainingTokens->front(),
-              source,
-              fileName
+              nextTokenForError(),
+              source
             )
           );
         }
@@ -665,10 +916,12 @@ namespace Theta {
       vector<shared_ptr<ASTNode>> el;
 
       if (!match(Token::BRACKET_CLOSE)) {
-        el.push_back(parseExpression(listNode));
+        Token firstToken = nextTokenForError();
+        addElement(el, parseExpression(listNode), firstToken, "Expected an expression before ,");
 
         while(match(Token::COMMA)) {
-          el.push_back(parseExpression(listNode));
+          Token commaToken = currentToken;
+          addElement(el, parseExpression(listNode), commaToken, "Expected an expression after ,");
         }
 
         listNode->setElements(el);
@@ -691,7 +944,9 @@ namespace Theta {
         // This is used for pipeline operators pointing to function invocations. It takes the passed
         // left arg and sets it as the first argument to the function call
         if (passedLeftArg) {
+          passedLeftArg->setParent(funcInvNode);
           arguments->getElements().insert(arguments->getElements().begin(), passedLeftArg);
+          funcInvNode->setPipelineStage(true);
         }
 
         funcInvNode->setParameters(arguments);
@@ -749,13 +1004,12 @@ namespace Theta {
         return make_shared<SymbolNode>(currentToken.getLexeme(), parent);
       }
 
-      Theta::Compiler::getInstance().addException(
+      session->addException(
         make_shared<Theta::CompilationError>(
           "SyntaxError",
           "Expected identifier as part of symbol declaration",
-          remainingTokens->front(),
-          source,
-          fileName
+          nextTokenForError(),
+          source
         )
       );
 
@@ -764,6 +1018,75 @@ namespace Theta {
       return nullptr;
     }
 
+    /**
+     * @brief Returns the next token to be parsed, for attributing an error to it. If every token has already been
+     * consumed, which happens when the source ends in the middle of an expression, the last parsed token is used instead
+     */
+    Token nextTokenForError() {
+      return remainingTokens->empty() ? currentToken : remainingTokens->front();
+    }
+
+    /**
+     * @brief Reports an error if a branch of an if is missing its condition or its body, as happens in code that's still
+     * being written
+     * @param condition The branch's condition
+     * @param body The branch's body
+     * @param keywordToken The if or else token that starts the branch
+     * @param isElse Whether the branch is an else, which has no condition
+     */
+    void validateBranch(shared_ptr<ASTNode> condition, shared_ptr<ASTNode> body, Token keywordToken, bool isElse = false) {
+      if ((condition || isElse) && body) return;
+
+      session->addException(
+        make_shared<Theta::CompilationError>(
+          "SyntaxError",
+          !condition && !isElse ? "Expected a condition after " + keywordToken.getLexeme() : "Expected a body after " + keywordToken.getLexeme(),
+          keywordToken,
+          source
+        )
+      );
+    }
+
+    /**
+     * @brief Adds an element of a comma separated list to the elements parsed so far, or reports an error if it's missing,
+     * as happens with stray commas. Later stages assume lists have no holes in them
+     * @param elements The elements parsed so far
+     * @param element The element that was just parsed
+     * @param token The token to report the error at
+     * @param message The error to report if the element is missing
+     */
+    void addElement(vector<shared_ptr<ASTNode>> &elements, shared_ptr<ASTNode> element, Token token, string message) {
+      if (element) {
+        elements.push_back(element);
+        return;
+      }
+
+      session->addException(make_shared<Theta::CompilationError>("SyntaxError", message, token, source));
+    }
+
+    /**
+     * @brief Reports an error if a unary or binary operation is missing one of its operands, as happens in code that's
+     * still being written. Later stages assume every operation has all of its operands
+     * @param operation The operation node that was just parsed
+     * @param operatorToken The token of the operation's operator
+     */
+    void validateOperands(shared_ptr<ASTNode> operation, Token operatorToken) {
+      bool isMissingOperand = operation->getNodeType() == ASTNode::UNARY_OPERATION
+        ? !operation->getValue()
+        : !operation->getLeft() || !operation->getRight();
+
+      if (!isMissingOperand) return;
+
+      session->addException(
+        make_shared<Theta::CompilationError>(
+          "SyntaxError",
+          "Expected an operand for " + operatorToken.getLexeme(),
+          operatorToken,
+          source
+        )
+      );
+    }
+
     bool match(Token::Types type, string lexeme = "") {
       if (check(type, lexeme)) {
         currentToken = remainingTokens->front();
@@ -800,13 +1123,12 @@ namespace Theta {
         bool isStartsWithDigit = i == 0 && isdigit(identChar);
 
         if (isStartsWithDigit || isDisallowedChar) {
-          Theta::Compiler::getInstance().addException(
+          session->addException(
             make_shared<Theta::CompilationError>(
               "SyntaxError",
               "Invalid identifier \"" + token.getLexeme() + "\"",
               token,
-              source,
-              fileName
+              source
             )
           );
         }
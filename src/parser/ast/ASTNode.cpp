@@ -1,3 +1,3 @@
 #include "ASTNode.hpp"
 
-int Theta::ASTNode::nextId = 0;
+atomic<int> Theta::ASTNode::nextId(0);
@@ -3,6 +3,7 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <atomic>
 
 using namespace std;
 
@@ -44,7 +45,7 @@ namespace Theta {
       UNARY_OPERATION
     };
 
-    static int nextId;
+    static atomic<int> nextId;
     virtual ASTNode::Types getNodeType() { return nodeType; }
     virtual string getNodeTypePretty() const { return nodeTypeToString(nodeType); }
     virtual string toJSON() const = 0;
@@ -58,8 +59,7 @@ namespace Theta {
     int mappedBinaryenIndex;
 
     ASTNode(ASTNode::Types type, shared_ptr<ASTNode> par) : nodeType(type), parent(par), value(nullptr) {
-      id = nextId;
-      nextId++;
+      id = nextId++;
     };
 
     virtual int getId() { return id; }
@@ -16,6 +16,9 @@ namespace Theta {
     ControlFlowNode(shared_ptr<ASTNode> parent) : ASTNode(ASTNode::CONTROL_FLOW, parent) {};
 
     void setConditionExpressionPairs(vector<pair<shared_ptr<ASTNode>, shared_ptr<ASTNode>>> cnd) {
+      // Once branches are added or removed, the profiled counts no longer line up with them
+      if (cnd.size() != conditionExpressionPairs.size()) profiledBranchCounts.clear();
+
       conditionExpressionPairs = cnd;
     }
 
@@ -23,6 +26,17 @@ namespace Theta {
       return conditionExpressionPairs;
     }
 
+    /**
+     * @brief Sets how many times each branch was taken in the profile given to --profile-use=, in the order of the
+     * condition expression pairs
+     */
+    void setProfiledBranchCounts(vector<long long> counts) { profiledBranchCounts = counts; }
+
+    /**
+     * @brief The times each branch was taken when the program was profiled, or nothing if it wasn't
+     */
+    vector<long long> getProfiledBranchCounts() { return profiledBranchCounts; }
+
     string toJSON() const override {
       ostringstream oss;
 
@@ -47,5 +61,8 @@ namespace Theta {
 
       return oss.str();
     }
+
+  private:
+    vector<long long> profiledBranchCounts;
   };
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <sstream>
 #include "ASTNode.hpp"
@@ -24,6 +25,24 @@ namespace Theta {
 
     shared_ptr<ASTNode>& getDefinition() { return definition; }
 
+    /**
+     * @brief Marks whether the function can be referenced from outside the block declaring it, in which case code
+     * generation has to build a closure for it. Set by the closure escape analysis pass
+     */
+    void setEscaping(bool isEscape) { escaping = isEscape; }
+
+    bool isEscaping() { return escaping; }
+
+    /**
+     * @brief Sets how many times the function was called in the profile given to --profile-use=
+     */
+    void setProfiledCallCount(long long count) { profiledCallCount = count; }
+
+    /**
+     * @brief How many times the function was called when the program was profiled, if the profile has a count for it
+     */
+    optional<long long> getProfiledCallCount() { return profiledCallCount; }
+
     string toJSON() const override {
       ostringstream oss;
 
@@ -47,5 +66,9 @@ namespace Theta {
 
       return oss.str();
       }
+
+  private:
+    bool escaping = true;
+    optional<long long> profiledCallCount;
   };
 }
@@ -25,6 +25,30 @@ namespace Theta {
 
     shared_ptr<ASTNodeList> getParameters() { return arguments; }
 
+    /**
+     * @brief Marks whether the value of this call is the value of the function making it, so that code generation can
+     * reuse the caller's frame for it. Set by the tail call elimination pass
+     */
+    void setTailCall(bool isTail) { tailCall = isTail; }
+
+    bool isTailCall() { return tailCall; }
+
+    /**
+     * @brief Marks whether the closure this call returns, if it returns one, can be referenced from outside the block
+     * binding it. Set by the closure escape analysis pass
+     */
+    void setEscaping(bool isEscape) { escaping = isEscape; }
+
+    bool isEscaping() { return escaping; }
+
+    /**
+     * @brief Marks whether this call is a stage of a pipeline, like `f()` in `x => f()`, whose first argument is the
+     * value piped into it. Set by the parser
+     */
+    void setPipelineStage(bool isStage) { pipelineStage = isStage; }
+
+    bool isPipelineStage() { return pipelineStage; }
+
     string toJSON() const override {
       std::ostringstream oss;
       oss << "{";
@@ -43,5 +67,10 @@ namespace Theta {
       oss << "}";
       return oss.str();
     }
+
+  private:
+    bool tailCall = false;
+    bool escaping = true;
+    bool pipelineStage = false;
   };
 }
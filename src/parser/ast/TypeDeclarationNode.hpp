@@ -27,17 +27,17 @@ namespace Theta {
       typeString += type;
 
       if (value) {
-        typeString += "<" + dynamic_pointer_cast<TypeDeclarationNode>(value)->toString(true) + ">";
+        typeString += "<" + toBareString(value) + ">";
       } else if (left) {
-        typeString += "<" + dynamic_pointer_cast<TypeDeclarationNode>(left)->toString(true) + ", ";
-        typeString += dynamic_pointer_cast<TypeDeclarationNode>(right)->toString(true) + ">";
+        typeString += "<" + toBareString(left) + ", ";
+        typeString += toBareString(right) + ">";
       } else if (elements.size() > 0) {
         typeString += "<";
 
         for (int i = 0; i < elements.size(); i++) {
           if (i > 0) typeString += ", ";
 
-          typeString += dynamic_pointer_cast<TypeDeclarationNode>(elements.at(i))->toString(true);
+          typeString += toBareString(elements.at(i));
         }
 
         typeString += ">";
@@ -78,5 +78,16 @@ namespace Theta {
 
       return oss.str();
     }
+
+  private:
+    /**
+     * @brief Stringifies a nested type. Types that couldn't be resolved, like the return type of a function that's still
+     * being written, are shown as Nothing
+     */
+    static string toBareString(shared_ptr<ASTNode> nestedType) {
+      shared_ptr<TypeDeclarationNode> typeDeclaration = dynamic_pointer_cast<TypeDeclarationNode>(nestedType);
+
+      return typeDeclaration ? typeDeclaration->toString(true) : "Nothing";
+    }
   };
 }
@@ -9,22 +9,48 @@
 
 using namespace std;
 
+/**
+ * @brief Executes compiled Theta WASM modules. Each Runtime owns its own store, so separate Runtimes can be used from
+ * separate threads, while the underlying engine is shared by the whole process.
+ */
 namespace Theta {
   class Runtime {
   public:
-    wasm::own<wasm::Engine> engine;
     wasm::own<wasm::Store> store;
 
-    static Runtime& getInstance() {
-      static Runtime instance;
-      return instance;
+    Runtime() {
+      store = wasm::Store::make(getEngine());
     }
 
+    Runtime(const Runtime&) = delete;
+    Runtime& operator=(const Runtime&) = delete;
+
     wasm::Store* getStore() { return store.get(); }
 
-    wasm::Engine* getEngine() { return engine.get(); }
+    /**
+     * @brief Returns the engine shared by every Runtime in the process, creating it on first use. V8 only supports
+     * a single engine per process, so this must never be owned by an individual Runtime.
+     * @return A pointer to the process-wide engine
+     */
+    static wasm::Engine* getEngine() {
+      static wasm::own<wasm::Engine> engine = []() {
+        v8::V8::SetFlagsFromString("--experimental-wasm-stringref");
+        return wasm::Engine::make();
+      }();
+
+      return engine.get();
+    }
   
-    ExecutionContext execute(vector<char> wasmBinary, string functionName) {
+    /**
+     * @brief Instantiates a compiled module and calls one of its exported functions
+     * @param wasmBinary The compiled WASM module
+     * @param functionName The name of the exported function to call. This can either be the exact export name, or the
+     * unqualified name of the Theta function, in which case it is resolved by the number of arguments given
+     * @param args The arguments to call the function with. They are converted to the types of the function's
+     * parameters, so numbers should be given as integer strings and booleans as "true" or "false"
+     * @return The result of the function call, along with the names of all of the module's exports
+     */
+    ExecutionContext execute(vector<char> wasmBinary, string functionName, vector<string> args = {}) {
       auto binary = wasm::vec<byte_t>::make_uninitialized(wasmBinary.size());
       memcpy(binary.get(), wasmBinary.data(), wasmBinary.size());
 
@@ -41,6 +67,8 @@ namespace Theta {
       auto instanceExports = instance->exports();
       vector<string> exportNames;
       wasm::Func* func = nullptr;
+      wasm::Func* qualifiedFunc = nullptr;
+      string qualifiedPrefix = functionName + to_string(args.size());
       for (size_t i = 0; i < exportTypes.size(); i++) {
         wasm::ExportType *exportType = exportTypes[i].get();
 
@@ -49,33 +77,76 @@ namespace Theta {
         // Save the idx of the function so we can call it later
         if (exportType->type()->kind() == wasm::EXTERN_FUNC && exportName == functionName) {
           func = instanceExports[i]->func();
+        } else if (exportType->type()->kind() == wasm::EXTERN_FUNC && isQualifiedNameOf(exportName, qualifiedPrefix)) {
+          qualifiedFunc = instanceExports[i]->func();
         }
       
         exportNames.push_back(exportName);
       }
 
+      if (!func) func = qualifiedFunc;
       if (!func) throw runtime_error("Exported function not found");
 
-      // Call the function with no arguments
-      wasm::Val args[0];  // No arguments for this test
+      wasm::own<wasm::FuncType> funcType = func->type();
+      const wasm::ownvec<wasm::ValType> &paramTypes = funcType->params();
+      if (paramTypes.size() != args.size()) {
+        throw runtime_error(
+          "Function " + functionName + " expects " + to_string(paramTypes.size()) + " arguments, but got " + to_string(args.size())
+        );
+      }
+
+      vector<wasm::Val> params;
+      for (size_t i = 0; i < args.size(); i++) {
+        params.push_back(toVal(args[i], paramTypes[i]->kind()));
+      }
+
+      if (func->result_arity() != 1) throw runtime_error("Function " + functionName + " must return exactly one value");
+
       wasm::Val results[1];  // A single result (the number returned by the function)
-      auto trap = func->call(args, results);
+      auto trap = func->call(params.data(), results);
 
 
       if (trap) throw runtime_error("Error calling function");
 
       return ExecutionContext(std::move(results[0]), exportNames);
     }
-  
+
+    /**
+     * @brief Checks whether an export name is the qualified identifier of a function, which is the function name
+     * followed by its arity and then its parameter types, each of which start with an uppercase letter
+     * @param exportName The export name to check
+     * @param qualifiedPrefix The function name followed by its arity
+     * @return true If the export is the qualified identifier of the function
+     */
+    static bool isQualifiedNameOf(string exportName, string qualifiedPrefix) {
+      if (exportName.rfind(qualifiedPrefix, 0) != 0) return false;
+
+      return exportName.size() == qualifiedPrefix.size() || isupper(exportName[qualifiedPrefix.size()]);
+    }
+
   private:
-    Runtime() {
-      v8::V8::SetFlagsFromString("--experimental-wasm-stringref");
-      engine = wasm::Engine::make();
-      store = wasm::Store::make(engine.get());
-    } 
 
-    Runtime(const Runtime&) = delete;
-    Runtime& operator=(const Runtime&) = delete;
+    /**
+     * @brief Converts a string argument into a WASM value of the given kind
+     * @param arg The argument to convert
+     * @param kind The kind of value the argument should be converted into
+     * @return The converted value
+     */
+    static wasm::Val toVal(string arg, wasm::ValKind kind) {
+      try {
+        if (kind == wasm::I64) return wasm::Val(static_cast<int64_t>(stoll(arg)));
+        if (kind == wasm::I32) {
+          if (arg == "true") return wasm::Val(static_cast<int32_t>(1));
+          if (arg == "false") return wasm::Val(static_cast<int32_t>(0));
+
+          return wasm::Val(static_cast<int32_t>(stoi(arg)));
+        }
+      } catch (const logic_error&) {
+        throw runtime_error("Invalid argument: " + arg);
+      }
+
+      throw runtime_error("Unsupported parameter type for argument: " + arg);
+    }
   };
 }
 
@@ -28,4 +28,34 @@
       (local.get $param_addr)
     )
   )
+  ;; FIXME: This won't work for negative values of an exponent like 10**-5. We need to check the sign and do division
+  ;; instead if the exponent is negative. It also won't work for negative base values. If the base is negative we need to
+  ;; multiply times the absolute value of the base in order to get the correct answer. It also wont work for floating
+  ;; point exponents.
+  (func $Theta.Math.pow (param $base i64) (param $exp i64) (result i64) (local $res i64)
+    (local.set $res
+      (i64.const 1)
+    )
+    (loop $powLoop ;; Multiply the base times itself as many times as needed
+      (local.set $res
+        (i64.mul
+          (local.get $base)
+          (local.get $res)
+        )
+      )
+      (local.set $exp
+        (i64.sub
+          (local.get $exp)
+          (i64.const 1)
+        )
+      )
+      (br_if $powLoop ;; Loop again until the exponent is 0
+        (i64.ne
+          (local.get $exp)
+          (i64.const 0)
+        )
+      )
+    )
+    (local.get $res)
+  )
 )
@@ -5,6 +5,8 @@
 #include "../src/compiler/Compiler.hpp"
 #include "../src/compiler/TypeChecker.hpp"
 #include "../src/compiler/CodeGen.hpp"
+#include "../src/compiler/DirectCodeGen.hpp"
+#include "../src/compiler/optimization/ExecutionProfile.hpp"
 #include "runtime/Runtime.hpp"
 #include "binaryen-c.h"
 #include "wasm.hh"
@@ -19,16 +21,21 @@ class CodeGenTest {
 public:
     Lexer lexer;
     Parser parser;
+    shared_ptr<CompilationSession> session;
     TypeChecker typeChecker;
     CodeGen codeGen;
-    shared_ptr<map<string, string>> filesByCapsuleName;
+    Runtime runtime;
+    bool fastEmit = false;
 
-    CodeGenTest() {
-        filesByCapsuleName = Compiler::getInstance().filesByCapsuleName;
+    CodeGenTest() : session(make_shared<CompilationSession>(discoveredCapsules())), typeChecker(session), codeGen(session) {}
+
+    static shared_ptr<map<string, string>> discoveredCapsules() {
+        static shared_ptr<map<string, string>> filesByCapsuleName = CompilationSession::discoverCapsules();
+        return filesByCapsuleName;
     }
 
-    ExecutionContext setup(string source, string functionName = "main0") {
-        Compiler::getInstance().clearExceptions();
+    ExecutionContext setup(string source, string functionName = "main0", vector<string> args = {}) {
+        session->clearExceptions();
 
         BinaryenSetColorsEnabled(false);
         lexer.lex(source);
@@ -37,28 +44,45 @@ public:
             lexer.tokens,
             source,
             "fakeFile.th",
-            filesByCapsuleName
+            session
         );
 
-        Compiler::getInstance().optimizeAST(parsedAST, true);
+        // Only the Binaryen backend generates code for what the passes after type checking mark, like tail calls
+        if (!fastEmit) session->optimization.level = O2;
+
+        Compiler::optimizeAST(session, parsedAST, true);
         bool isTypeValid = typeChecker.checkAST(parsedAST);
 
-        for (int i = 0; i < Compiler::getInstance().getEncounteredExceptions().size(); i++) {
-            Compiler::getInstance().getEncounteredExceptions()[i]->display();
+        for (int i = 0; i < session->getEncounteredExceptions().size(); i++) {
+            session->getEncounteredExceptions()[i]->display();
         }
 
         if (!isTypeValid) FAIL("Typechecking failed");
 
-        BinaryenModuleRef module = codeGen.generateWasmFromAST(parsedAST);
+        if (!fastEmit) REQUIRE(Compiler::optimizeTypedAST(session, parsedAST));
 
-        vector<char> buffer = Compiler::writeModuleToBuffer(module);
+        vector<char> buffer;
+        if (fastEmit) {
+            DirectCodeGen directCodeGen(session);
+            buffer = directCodeGen.generateWasmFromAST(parsedAST);
+        } else {
+            BinaryenModuleRef module = codeGen.generateWasmFromAST(parsedAST);
+            buffer = Compiler::writeModuleToBuffer(module);
+        }
 
-        return Runtime::getInstance().execute(buffer, functionName);
+        return runtime.execute(buffer, functionName, args);
     }
 };
 
 TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
+    // Every program must behave identically whether it goes through Binaryen or the direct emitter
+    fastEmit = GENERATE(false, true);
+
+    // The arithmetic on literals would be folded to its result before code generation, so these sections turn constant
+    // folding off to get the operations themselves generated
     SECTION("Can codegen multiplication") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> 10 * 5
@@ -71,6 +95,8 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
     }
 
     SECTION("Can codegen addition") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> 9 + 27
@@ -83,6 +109,8 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
     }
 
     SECTION("Can codegen division") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> 10 / 2
@@ -95,6 +123,8 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
     }
 
     SECTION("Can codegen subtraction") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> 47 - 10
@@ -139,6 +169,8 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
     //}
 
     SECTION("Correctly codegens negative numbers") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> -10 + 20
@@ -151,6 +183,8 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
     }
 
     SECTION("Negative multiplication outputs correct result") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> 5 * -7
@@ -163,6 +197,8 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
     }
 
     SECTION("Negative division outputs correct result") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> -90 / 30
@@ -175,6 +211,8 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
     }
 
     SECTION("More complex arithmetic outputs correct result") {
+        session->optimization.passOverrides["constant-folding"] = false;
+
         ExecutionContext context = setup(R"(
             capsule Test {
                 main<Function<Number>> = () -> 10 * (5 - 1) + (8 / (23 - 5))
@@ -188,6 +226,30 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
         REQUIRE(context.result.i64() == 40);
     }
 
+    SECTION("Can codegen arithmetic on literals that was folded to its result") {
+        ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number>> = () -> 10 * (5 - 1) + (8 / (23 - 5))
+            }
+        )");
+
+        REQUIRE(context.exportNames.size() == 2);
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 40);
+    }
+
+    SECTION("Can codegen negative arithmetic on literals that was folded to its result") {
+        ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number>> = () -> -90 / 30 + 5 * -7 - 10
+            }
+        )");
+
+        REQUIRE(context.exportNames.size() == 2);
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == -48);
+    }
+
     SECTION("Can codegen conditionals") {
          ExecutionContext context = setup(R"(
             capsule Test {
@@ -260,6 +322,20 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
         REQUIRE(context.result.i64() == 2);
     }
 
+    SECTION("Can call exported functions with arguments") {
+         ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number>> = () -> double(5)
+
+                double<Function<Number, Number>> = (x<Number>) -> x * 2
+            }
+        )", "double", { "21" });
+
+        REQUIRE(context.exportNames.size() == 3);
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 42);
+    }
+
     SECTION("Can call capsule functions") {
          ExecutionContext context = setup(R"(
             capsule Test {
@@ -311,6 +387,23 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
         REQUIRE(context.result.i64() == 500);
     }
 
+    SECTION("Can call the closure a curried function returns in the block that applied it") {
+         ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number>> = () -> {
+                    add<Function<Number, Number>> = curriedAdd(1)
+
+                    add(2)
+                }
+
+                curriedAdd<Function<Number, Function<Number, Number>>> = (x<Number>) -> (y<Number>) -> x + y
+            }
+        )");
+
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 3);
+    }
+
     SECTION("Can call functions that have an internal function as part of its result") {
          ExecutionContext context = setup(R"(
             capsule Test {
@@ -331,6 +424,24 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
         REQUIRE(context.result.i64() == 1005);
     }
 
+    SECTION("Can call functions that capture locals of the block declaring them") {
+         ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number, Number>> = (n<Number>) -> {
+                    offset<Number> = n + 1
+                    scale<Number> = n * 2
+
+                    transform<Function<Number, Number>> = (x<Number>) -> x * scale + offset
+
+                    transform(3) + transform(n)
+                }
+            }
+        )", "main", { "4" });
+
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 66);
+    }
+
     SECTION("Correctly return value if an assignment is the last expression in a block") {
          ExecutionContext context = setup(R"(
             capsule Test {
@@ -366,5 +477,243 @@ TEST_CASE_METHOD(CodeGenTest, "CodeGen") {
         REQUIRE(context.result.kind() == wasm::I64);
         REQUIRE(context.result.i64() == 55);
     }
-}
 
+    SECTION("Runs self-recursive tail calls in constant stack space") {
+        if (fastEmit) SKIP("The direct emitter doesn't eliminate tail calls");
+
+        ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number, Number>> = (n<Number>) -> countDown(n, 0)
+
+                countDown<Function<Number, Number, Number>> = (n<Number>, total<Number>) -> {
+                    if (n == 0) {
+                        return total
+                    }
+
+                    countDown(n - 1, total + 2)
+                }
+            }
+        )", "main", { "1000000" });
+
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 2000000);
+    }
+
+    SECTION("Emits tail calls to other functions as return calls when enabled") {
+        if (fastEmit) SKIP("The direct emitter doesn't eliminate tail calls");
+
+        session->optimization.isTailCallEnabled = true;
+
+        ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number, Boolean>> = (n<Number>) -> isEven(n)
+
+                isEven<Function<Number, Boolean>> = (n<Number>) -> {
+                    if (n == 0) {
+                        return true
+                    }
+
+                    isOdd(n - 1)
+                }
+
+                isOdd<Function<Number, Boolean>> = (n<Number>) -> {
+                    if (n == 0) {
+                        return false
+                    }
+
+                    isEven(n - 1)
+                }
+            }
+        )", "main", { "1000001" });
+
+        REQUIRE(context.result.kind() == wasm::I32);
+        REQUIRE(context.result.i32() == 0);
+    }
+
+    SECTION("Can codegen else-if chains on a number as a jump table") {
+         ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number>> = () -> {
+                    daysIn(1) + daysIn(3) + daysIn(5) + daysIn(9)
+                }
+
+                daysIn<Function<Number, Number>> = (month<Number>) -> {
+                    if (month == 0) {
+                        return 31
+                    } else if (month == 1) {
+                        return 28
+                    } else if (month == 3) {
+                        return 30
+                    } else if (2 == month) {
+                        return 31
+                    } else if (month == 5) {
+                        return 30
+                    } else {
+                        return 0
+                    }
+                }
+            }
+        )");
+
+        REQUIRE(context.exportNames.size() == 3);
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 88);
+    }
+
+    SECTION("Can codegen else-if chains on sparse numbers as a decision tree") {
+         ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number>> = () -> {
+                    status(404) + status(500) + status(301) + status(-1) + status(200)
+                }
+
+                status<Function<Number, Number>> = (code<Number>) -> {
+                    if (code == 200) {
+                        return 1
+                    } else if (code == 301) {
+                        return 2
+                    } else if (code == 404) {
+                        return 4
+                    } else if (code == 500) {
+                        return 8
+                    } else if (code == 503) {
+                        return 16
+                    } else {
+                        return 32
+                    }
+                }
+            }
+        )");
+
+        REQUIRE(context.exportNames.size() == 3);
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 47);
+    }
+
+    SECTION("Keeps the locals of else-if chains that repeat a case in order") {
+         ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number, Number>> = (x<Number>) -> {
+                    if (x == 1) {
+                        a<Number> = x + 10
+                        a
+                    } else if (x == 2) {
+                        b<Number> = x * 3
+                        b
+                    } else if (x == 1) {
+                        c<Number> = x + 100
+                        c
+                    } else if (x == 3) {
+                        d<Number> = x + 1
+                        d * 2
+                    } else if (x == 4) {
+                        f<Number> = x * x
+                        f
+                    } else {
+                        e<Number> = x - 1
+                        e
+                    }
+                }
+            }
+        )", "main", { "4" });
+
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 16);
+    }
+
+    SECTION("Can codegen else-if chains on keys from both ends of the number range") {
+         ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number, Number>> = (x<Number>) -> {
+                    if (x == -9223372036854775807 - 1) {
+                        return 1
+                    } else if (x == 0) {
+                        return 2
+                    } else if (x == 1) {
+                        return 3
+                    } else if (x == 9223372036854775807) {
+                        return 4
+                    } else {
+                        return 5
+                    }
+                }
+            }
+        )", "main", { "-9223372036854775808" });
+
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 1);
+    }
+
+    SECTION("Tests the branches taken most first, with a profile") {
+        string source = R"(
+            capsule Test {
+                main<Function<Number>> = () -> {
+                    grade(3) + grade(2) + grade(9) + parity(4) + parity(7)
+                }
+
+                grade<Function<Number, Number>> = (n<Number>) -> {
+                    if (n == 1) {
+                        return 100
+                    } else if (n == 2) {
+                        return 200
+                    } else if (n == 3) {
+                        return 300
+                    } else {
+                        return 0
+                    }
+                }
+
+                parity<Function<Number, Number>> = (n<Number>) -> {
+                    if (n % 2 == 0) {
+                        return 10
+                    } else {
+                        return 1
+                    }
+                }
+            }
+        )";
+
+        lexer.lex(source);
+        shared_ptr<ASTNode> parsedAST = parser.parse(lexer.tokens, source, "fakeFile.th", session);
+
+        map<string, string> hashes;
+        for (auto &element : dynamic_pointer_cast<ASTNodeList>(parsedAST->getValue()->getValue())->getElements()) {
+            hashes[dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier()] = CodeGen::generateFunctionHash(
+                dynamic_pointer_cast<FunctionDeclarationNode>(element->getRight())
+            );
+        }
+
+        istringstream profile(
+            "branch " + hashes["grade"] + " 0 2 90\n" +
+            "branch " + hashes["grade"] + " 0 0 10\n" +
+            "branch " + hashes["parity"] + " 0 1 50\n"
+        );
+
+        session->optimization.profile = make_shared<ExecutionProfile>();
+        session->optimization.profile->parse(profile);
+
+        ExecutionContext context = setup(source);
+
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 511);
+    }
+
+    SECTION("Can call closures of the same signature through their dispatcher") {
+        ExecutionContext context = setup(R"(
+            capsule Test {
+                main<Function<Number, Number>> = (n<Number>) -> {
+                    multiplyBy<Function<Number, Number>> = curriedMultiply(n + 1)
+                    addTo<Function<Number, Number>> = curriedAdd(n - 3)
+
+                    multiplyBy(50) + addTo(4)
+                }
+
+                curriedMultiply<Function<Number, Function<Number, Number>>> = (x<Number>) -> (y<Number>) -> x * y
+                curriedAdd<Function<Number, Function<Number, Number>>> = (x<Number>) -> (y<Number>) -> x + y
+            }
+        )", "main", { "9" });
+
+        REQUIRE(context.result.kind() == wasm::I64);
+        REQUIRE(context.result.i64() == 510);
+    }
+}
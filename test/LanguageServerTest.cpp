@@ -0,0 +1,284 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch_amalgamated.hpp"
+#include "../src/lsp/LanguageServer.hpp"
+#include <sstream>
+
+using namespace std;
+using namespace Theta;
+
+class LanguageServerTest {
+public:
+    shared_ptr<map<string, string>> filesByCapsuleName = make_shared<map<string, string>>();
+
+    shared_ptr<TextDocument> open(string source) {
+        return make_shared<TextDocument>("file:///fakeFile.th", source, filesByCapsuleName);
+    }
+
+    /**
+     * Checks that the diagnostics of a document that has been edited are the same as the diagnostics we'd get by
+     * analyzing its current text from scratch
+     */
+    void requireSameAsFullAnalysis(shared_ptr<TextDocument> document) {
+        vector<Diagnostic> incremental = document->getDiagnostics();
+        vector<Diagnostic> full = open(document->getText())->getDiagnostics();
+
+        REQUIRE(incremental.size() == full.size());
+
+        for (int i = 0; i < full.size(); i++) {
+            REQUIRE(incremental[i].message == full[i].message);
+            REQUIRE(incremental[i].start == full[i].start);
+            REQUIRE(incremental[i].end == full[i].end);
+        }
+    }
+
+    static JsonValue makeMessage(string method, JsonValue params, int id = -1) {
+        JsonValue message = JsonValue::object();
+        message.set("jsonrpc", "2.0");
+        if (id >= 0) message.set("id", id);
+        message.set("method", method);
+        message.set("params", params);
+
+        return message;
+    }
+
+    static string frame(JsonValue message) {
+        string content = message.toJSON();
+
+        return "Content-Length: " + to_string(content.length()) + "\r\n\r\n" + content;
+    }
+};
+
+TEST_CASE_METHOD(LanguageServerTest, "LanguageServer") {
+    SECTION("Can parse and serialize JSON") {
+        string json = R"({"id":1,"params":{"text":"a\nb \"c\" é😀","list":[true,false,null,-1.5,2e3]}})";
+
+        JsonValue value = JsonValue::parse(json);
+
+        REQUIRE(value["id"].asInteger() == 1);
+        REQUIRE(value["params"]["text"].asString() == "a\nb \"c\" \xc3\xa9\xf0\x9f\x98\x80");
+        REQUIRE(value["params"]["list"].getElements().size() == 5);
+        REQUIRE(value["params"]["list"].getElements()[2].isNull());
+        REQUIRE(value["params"]["list"].getElements()[3].asNumber() == -1.5);
+        REQUIRE(value["params"]["missing"]["nested"].isNull());
+
+        REQUIRE(JsonValue::parse(value.toJSON()).toJSON() == value.toJSON());
+        REQUIRE_THROWS(JsonValue::parse("{\"unterminated\": "));
+    }
+
+    SECTION("Reports type errors at the element they are in") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    x<Number> = 5
+    y<Number> = 'not a number'
+})");
+
+        vector<Diagnostic> diagnostics = document->getDiagnostics();
+
+        REQUIRE(document->getElementCount() == 2);
+        REQUIRE(diagnostics.size() == 1);
+        REQUIRE(diagnostics[0].message.find("TypeError") == 0);
+        REQUIRE(document->getPosition(diagnostics[0].start).first == 2);
+    }
+
+    SECTION("Only re-parses and re-checks the element that was edited") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    x<Number> = 5
+    y<String> = 'hello'
+    z<Boolean> = true
+})");
+
+        REQUIRE(document->getDiagnostics().size() == 0);
+
+        // Change the 5 to a string
+        document->applyChange(1, 16, 1, 17, "'five'");
+
+        REQUIRE(document->wasLastAnalysisIncremental());
+        REQUIRE(document->getLastReparsedElementCount() == 1);
+        REQUIRE(document->getLastCheckedElementCount() == 1);
+        REQUIRE(document->getDiagnostics().size() == 1);
+        requireSameAsFullAnalysis(document);
+
+        // And back again
+        document->applyChange(1, 16, 1, 22, "5");
+
+        REQUIRE(document->wasLastAnalysisIncremental());
+        REQUIRE(document->getDiagnostics().size() == 0);
+        requireSameAsFullAnalysis(document);
+    }
+
+    SECTION("Re-checks the elements that reference a changed declaration") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    a<Number> = 5
+    b<Number> = a + 1
+    c<String> = 'unrelated'
+})");
+
+        REQUIRE(document->getDiagnostics().size() == 0);
+
+        document->applyChange(1, 4, 1, 17, "a<String> = 'five'");
+
+        REQUIRE(document->wasLastAnalysisIncremental());
+        REQUIRE(document->getLastCheckedElementCount() == 2);
+        REQUIRE(document->getDiagnostics().size() > 0);
+        requireSameAsFullAnalysis(document);
+    }
+
+    SECTION("Reports and clears duplicate declarations incrementally") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    a<Number> = 5
+    b<Number> = 6
+    c<Number> = b + 1
+})");
+
+        REQUIRE(document->getDiagnostics().size() == 0);
+
+        // Rename b to a, which declares a twice
+        document->applyChange(2, 4, 2, 5, "a");
+
+        REQUIRE(document->wasLastAnalysisIncremental());
+        REQUIRE(document->getDiagnostics().size() > 0);
+        requireSameAsFullAnalysis(document);
+
+        document->applyChange(2, 4, 2, 5, "b");
+
+        REQUIRE(document->wasLastAnalysisIncremental());
+        REQUIRE(document->getDiagnostics().size() == 0);
+        requireSameAsFullAnalysis(document);
+    }
+
+    SECTION("Keeps diagnostics in the right place after edits that move elements") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    x<Number> = 5
+    y<Number> = 'oops'
+})");
+
+        document->applyChange(1, 17, 1, 17, "\n    w<Number> = 6\n    v<Number> = 7");
+
+        REQUIRE(document->wasLastAnalysisIncremental());
+        REQUIRE(document->getElementCount() == 4);
+        REQUIRE(document->getPosition(document->getDiagnostics()[0].start).first == 4);
+        requireSameAsFullAnalysis(document);
+
+        // Deleting an element entirely leaves its whitespace with the element before it
+        document->applyChange(2, 0, 4, 0, "");
+
+        REQUIRE(document->wasLastAnalysisIncremental());
+        REQUIRE(document->getElementCount() == 2);
+        requireSameAsFullAnalysis(document);
+    }
+
+    SECTION("Gives the same diagnostics as a full analysis while typing") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    x<Number> = 5
+    f<Function<Number, Number>> = (n<Number>) -> n * x
+})");
+
+        string typed = "g<Number> = f(x) + 1";
+
+        document->applyChange(2, 54, 2, 54, "\n    ");
+
+        for (int i = 0; i < typed.length(); i++) {
+            document->applyChange(3, 4 + i, 3, 4 + i, string(1, typed[i]));
+            requireSameAsFullAnalysis(document);
+        }
+
+        REQUIRE(document->getDiagnostics().size() == 0);
+    }
+
+    SECTION("Falls back to a full analysis when an edit unbalances the brackets") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    f<Function<Number, Number>> = (n<Number>) -> {
+        return n
+    }
+    x<Number> = 5
+})");
+
+        REQUIRE(document->getDiagnostics().size() == 0);
+
+        document->applyChange(3, 4, 3, 5, "");
+
+        REQUIRE(!document->wasLastAnalysisIncremental());
+        REQUIRE(document->getDiagnostics().size() > 0);
+        requireSameAsFullAnalysis(document);
+
+        document->applyChange(3, 4, 3, 4, "}");
+
+        REQUIRE(document->getDiagnostics().size() == 0);
+    }
+
+    SECTION("Falls back to a full analysis when an edit leaves a string unterminated") {
+        shared_ptr<TextDocument> document = open(R"(capsule Test {
+    x<String> = 'a'
+    y<String> = 'b'
+})");
+
+        document->applyChange(1, 18, 1, 19, "");
+
+        REQUIRE(!document->wasLastAnalysisIncremental());
+        requireSameAsFullAnalysis(document);
+    }
+
+    SECTION("Publishes diagnostics over the protocol") {
+        istringstream in;
+        ostringstream out;
+        LanguageServer server(in, out);
+
+        server.handleMessage(makeMessage("initialize", JsonValue::object(), 1));
+        REQUIRE(out.str().find("\"textDocumentSync\":{\"openClose\":true,\"change\":2}") != string::npos);
+
+        JsonValue textDocument = JsonValue::object();
+        textDocument.set("uri", "file:///fakeFile.th");
+        textDocument.set("text", "capsule Test {\n    x<Number> = 'a'\n}");
+
+        JsonValue params = JsonValue::object();
+        params.set("textDocument", textDocument);
+
+        out.str("");
+        server.handleMessage(makeMessage("textDocument/didOpen", params));
+
+        string published = out.str();
+        JsonValue notification = JsonValue::parse(published.substr(published.find("\r\n\r\n") + 4));
+
+        REQUIRE(notification["method"].asString() == "textDocument/publishDiagnostics");
+        REQUIRE(notification["params"]["diagnostics"].getElements().size() == 1);
+
+        JsonValue diagnostic = notification["params"]["diagnostics"].getElements()[0];
+        REQUIRE(diagnostic["range"]["start"]["line"].asInteger() == 1);
+        REQUIRE(diagnostic["severity"].asInteger() == 1);
+
+        out.str("");
+        server.handleMessage(makeMessage("unknown/request", JsonValue::object(), 2));
+        REQUIRE(out.str().find("-32601") != string::npos);
+    }
+
+    SECTION("Keeps a % in a URI that doesn't start an escape") {
+        istringstream in;
+        ostringstream out;
+        LanguageServer server(in, out);
+
+        JsonValue params = JsonValue::object();
+        params.set("rootUri", "file:///no%zzsuch%2/workspace%");
+
+        server.handleMessage(makeMessage("initialize", params, 1));
+
+        string response = out.str();
+        JsonValue result = JsonValue::parse(response.substr(response.find("\r\n\r\n") + 4));
+
+        REQUIRE(result["id"].asInteger() == 1);
+        REQUIRE(result.has("result"));
+        REQUIRE(!result.has("error"));
+    }
+
+    SECTION("Exits cleanly after being shut down") {
+        istringstream in(
+            frame(makeMessage("initialize", JsonValue::object(), 1)) +
+            frame(makeMessage("shutdown", JsonValue(), 2)) +
+            frame(makeMessage("exit", JsonValue()))
+        );
+        ostringstream out;
+
+        LanguageServer server(in, out);
+
+        REQUIRE(server.run() == 0);
+        REQUIRE(server.hasExited());
+    }
+}
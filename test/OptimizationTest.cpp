@@ -0,0 +1,948 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch_amalgamated.hpp"
+#include "../src/lexer/Lexer.cpp"
+#include "../src/parser/Parser.cpp"
+#include "../src/compiler/Compiler.hpp"
+#include "../src/compiler/optimization/PassManager.hpp"
+#include "../src/compiler/optimization/ExecutionProfile.hpp"
+
+using namespace std;
+using namespace Theta;
+
+class OptimizationTest {
+public:
+    Lexer lexer;
+    Parser parser;
+    shared_ptr<CompilationSession> session;
+
+    OptimizationTest() : session(make_shared<CompilationSession>(discoveredCapsules())) {}
+
+    static shared_ptr<map<string, string>> discoveredCapsules() {
+        static shared_ptr<map<string, string>> filesByCapsuleName = CompilationSession::discoverCapsules();
+        return filesByCapsuleName;
+    }
+
+    shared_ptr<ASTNode> parse(string source) {
+        session->clearExceptions();
+
+        lexer.lex(source);
+
+        return parser.parse(lexer.tokens, source, "fakeFile.th", session);
+    }
+
+    /**
+     * Optimizes the given capsule at -O2, and returns the values assigned by its top-level elements, by name
+     */
+    map<string, shared_ptr<ASTNode>> optimize(string source) {
+        shared_ptr<ASTNode> ast = parse(source);
+
+        session->optimization.level = O2;
+        REQUIRE(PassManager(session).run(ast));
+
+        return capsuleValues(ast);
+    }
+
+    /**
+     * @brief Optimizes the given capsule at -O2 both before and after type checking, as a compilation would
+     */
+    shared_ptr<ASTNode> optimizeTyped(string source, PassManager &typedPassManager) {
+        shared_ptr<ASTNode> ast = parse(source);
+
+        if (session->optimization.profile) session->optimization.profile->apply(ast);
+
+        session->optimization.level = O2;
+        REQUIRE(PassManager(session).run(ast));
+
+        TypeChecker typeChecker(session);
+        REQUIRE(typeChecker.checkAST(ast));
+
+        REQUIRE(typedPassManager.run(ast));
+
+        return ast;
+    }
+
+    static map<string, shared_ptr<ASTNode>> capsuleValues(shared_ptr<ASTNode> ast) {
+        map<string, shared_ptr<ASTNode>> valuesByName;
+        for (auto &element : dynamic_pointer_cast<ASTNodeList>(ast->getValue()->getValue())->getElements()) {
+            valuesByName[dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier()] = element->getRight();
+        }
+
+        return valuesByName;
+    }
+
+    static vector<shared_ptr<ASTNode>> functionBody(shared_ptr<ASTNode> function) {
+        return dynamic_pointer_cast<ASTNodeList>(dynamic_pointer_cast<FunctionDeclarationNode>(function)->getDefinition())->getElements();
+    }
+
+    static string literalValue(shared_ptr<ASTNode> node) {
+        shared_ptr<LiteralNode> literal = dynamic_pointer_cast<LiteralNode>(node);
+
+        return literal ? literal->getLiteralValue() : "<not a literal>";
+    }
+};
+
+TEST_CASE_METHOD(OptimizationTest, "PassManager") {
+    SECTION("Always runs the required passes, even at -O0") {
+        session->optimization.level = O0;
+
+        vector<string> pipeline = PassManager(session).getPipeline();
+
+        REQUIRE(find(pipeline.begin(), pipeline.end(), "literal-inliner") != pipeline.end());
+    }
+
+    SECTION("Required passes can't be disabled with --passes=") {
+        session->optimization.parsePassOverrides("-literal-inliner");
+
+        REQUIRE(session->optimization.passOverrides["literal-inliner"] == false);
+
+        vector<string> pipeline = PassManager(session).getPipeline();
+
+        REQUIRE(find(pipeline.begin(), pipeline.end(), "literal-inliner") != pipeline.end());
+    }
+
+    SECTION("Parses optimization levels and pass overrides") {
+        OptimizationLevel level = O1;
+
+        REQUIRE(OptimizationOptions::parseLevel("-O3", level));
+        REQUIRE(level == O3);
+        REQUIRE(OptimizationOptions::parseLevel("-Os", level));
+        REQUIRE(level == Os);
+        REQUIRE(!OptimizationOptions::parseLevel("-O9", level));
+
+        OptimizationOptions options;
+        options.parsePassOverrides("first,-second,,third");
+
+        REQUIRE(options.passOverrides.size() == 3);
+        REQUIRE(options.passOverrides["first"] == true);
+        REQUIRE(options.passOverrides["second"] == false);
+        REQUIRE(options.passOverrides["third"] == true);
+    }
+
+    SECTION("Picks Binaryen's settings from the level, and parses --wasm-passes=") {
+        OptimizationOptions options;
+
+        options.level = O3;
+        REQUIRE(options.getWasmOptimizeLevel() == 3);
+        REQUIRE(options.getWasmShrinkLevel() == 0);
+
+        options.level = Os;
+        REQUIRE(options.getWasmOptimizeLevel() == 2);
+        REQUIRE(options.getWasmShrinkLevel() == 1);
+
+        options.parseWasmPasses("inlining-optimizing,dae,,coalesce-locals");
+
+        REQUIRE(options.wasmPasses == vector<string>{ "inlining-optimizing", "dae", "coalesce-locals" });
+    }
+
+    SECTION("Runs the pipeline once at -O1") {
+        shared_ptr<ASTNode> ast = parse(R"(
+            capsule Test {
+                x<Number> = 5
+                y<Number> = x + 1
+            }
+        )");
+
+        PassManager passManager(session);
+
+        REQUIRE(passManager.run(ast));
+        REQUIRE(passManager.getIterationCount() == 1);
+        REQUIRE(passManager.getTimings().size() == passManager.getPipeline().size());
+        REQUIRE(passManager.getTimings()[0].runs == 1);
+        REQUIRE(passManager.getTimings()[0].changedRuns == 1);
+    }
+
+    SECTION("Iterates until no pass changes the AST at -O2") {
+        shared_ptr<ASTNode> ast = parse(R"(
+            capsule Test {
+                x<Number> = 5
+                y<Number> = x + 1
+            }
+        )");
+
+        session->optimization.level = O2;
+        PassManager passManager(session);
+
+        REQUIRE(passManager.run(ast));
+
+        // The first iteration inlines x, and the second finds nothing left to do
+        REQUIRE(passManager.getIterationCount() == 2);
+        REQUIRE(passManager.getTimings()[0].runs == 2);
+        REQUIRE(passManager.getTimings()[0].changedRuns == 1);
+
+        ostringstream timings;
+        passManager.displayTimings(timings);
+
+        REQUIRE(timings.str().find("literal-inliner") != string::npos);
+    }
+
+    SECTION("Stops at the first pass that reports an error") {
+        shared_ptr<ASTNode> ast = parse(R"(
+            capsule Test {
+                x<Number> = 5
+                x<Number> = 6
+            }
+        )");
+
+        session->optimization.level = O3;
+        PassManager passManager(session);
+
+        REQUIRE(!passManager.run(ast));
+        REQUIRE(passManager.getIterationCount() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() > 0);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "ConstantFoldingPass") {
+    SECTION("Folds arithmetic on inlined literals") {
+        map<string, shared_ptr<ASTNode>> values = optimize(R"(
+            capsule Test {
+                x<Number> = 3
+                y<Number> = x * 4 + 1
+                z<Number> = 2 ** 10
+                w<Number> = -(7 % 4) - 10 / 3
+                big<Number> = 2 ** 40
+            }
+        )");
+
+        REQUIRE(literalValue(values["y"]) == "13");
+        REQUIRE(literalValue(values["z"]) == "1024");
+        REQUIRE(literalValue(values["w"]) == "-6");
+        REQUIRE(literalValue(values["big"]) == "1099511627776");
+    }
+
+    SECTION("Folds comparisons, booleans and string concatenation") {
+        map<string, shared_ptr<ASTNode>> values = optimize(R"(
+            capsule Test {
+                a<Boolean> = 3 > 2 && !(1 == 2)
+                b<Boolean> = 'a' + 'b' == 'ab'
+                c<String> = 'hello' + ', ' + 'world'
+                d<Boolean> = true != false
+            }
+        )");
+
+        REQUIRE(literalValue(values["a"]) == "true");
+        REQUIRE(literalValue(values["b"]) == "true");
+        REQUIRE(literalValue(values["c"]) == "hello, world");
+        REQUIRE(literalValue(values["d"]) == "true");
+    }
+
+    SECTION("Joins string literals separated by the grouping of a concatenation chain") {
+        map<string, shared_ptr<ASTNode>> values = optimize(R"(
+            capsule Test {
+                greet<Function<String, String, String>> = (name<String>, place<String>) -> {
+                    'Hello' + ', ' + name + ', ' + 'welcome ' + 'to ' + place + '!'
+                }
+            }
+        )");
+
+        // ((('Hello, ' + name) + ', welcome to ') + place) + '!'
+        shared_ptr<ASTNode> greeting = functionBody(values["greet"])[0];
+
+        REQUIRE(literalValue(greeting->getRight()) == "!");
+        REQUIRE(literalValue(greeting->getLeft()->getLeft()->getRight()) == ", welcome to ");
+        REQUIRE(literalValue(greeting->getLeft()->getLeft()->getLeft()->getLeft()) == "Hello, ");
+    }
+
+    SECTION("Leaves operations that would trap at runtime alone") {
+        map<string, shared_ptr<ASTNode>> values = optimize(R"(
+            capsule Test {
+                x<Number> = 1 / 0
+                y<Number> = 5 % 0
+            }
+        )");
+
+        REQUIRE(values["x"]->getNodeType() == ASTNode::BINARY_OPERATION);
+        REQUIRE(values["y"]->getNodeType() == ASTNode::BINARY_OPERATION);
+    }
+
+    SECTION("Applies algebraic identities when the operand's type is known") {
+        map<string, shared_ptr<ASTNode>> values = optimize(R"(
+            capsule Test {
+                f<Function<Number, Number>> = (n<Number>) -> n * 1 + 0
+                g<Function<Number, Number>> = (n<Number>) -> n ** 2
+                h<Function<String, String>> = (s<String>) -> s + 0
+            }
+        )");
+
+        shared_ptr<ASTNode> f = functionBody(values["f"])[0];
+        shared_ptr<ASTNode> g = functionBody(values["g"])[0];
+        shared_ptr<ASTNode> h = functionBody(values["h"])[0];
+
+        REQUIRE(f->getNodeType() == ASTNode::IDENTIFIER);
+
+        REQUIRE(g->getNodeType() == ASTNode::BINARY_OPERATION);
+        REQUIRE(dynamic_pointer_cast<BinaryOperationNode>(g)->getOperator() == "*");
+
+        // Adding 0 to a String is a type error, which has to be left for the type checker to find
+        REQUIRE(h->getNodeType() == ASTNode::BINARY_OPERATION);
+    }
+
+    SECTION("Removes control flow branches that can't be taken") {
+        map<string, shared_ptr<ASTNode>> values = optimize(R"(
+            capsule Test {
+                debug<Boolean> = false
+                x<Number> = if (debug) { 1 } else if (true) { 2 } else { 3 }
+                f<Function<Number, Number>> = (n<Number>) -> {
+                    if (n > 0) {
+                        return 1
+                    } else if (1 > 2) {
+                        return 2
+                    }
+
+                    return 3
+                }
+            }
+        )");
+
+        REQUIRE(values["x"]->getNodeType() == ASTNode::BLOCK);
+
+        shared_ptr<ControlFlowNode> controlFlow = dynamic_pointer_cast<ControlFlowNode>(functionBody(values["f"])[0]);
+
+        REQUIRE(controlFlow->getConditionExpressionPairs().size() == 1);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "DeadCodeEliminationPass") {
+    PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+    SECTION("Only runs after type checking") {
+        vector<string> pipeline = PassManager(session).getPipeline();
+
+        REQUIRE(find(pipeline.begin(), pipeline.end(), "dead-code-elimination") == pipeline.end());
+        REQUIRE(typedPassManager.getPipeline() == vector<string>{ "dead-code-elimination", "tail-call-elimination", "closure-escape-analysis" });
+    }
+
+    SECTION("Removes unused values from capsules, but keeps every function") {
+        // The call would otherwise be evaluated at compile time, leaving no call to keep
+        session->optimization.parsePassOverrides("-compile-time-evaluation");
+
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+            capsule Test {
+                scale<Number> = 10
+                offset<Number> = scale * 2 + 1
+                unusedHelper<Function<Number, Number>> = (n<Number>) -> {
+                    scaled<Number> = n * offset
+                    return scaled + 1
+                }
+                called<Number> = unusedHelper(2)
+            }
+        )", typedPassManager));
+
+        // offset was folded to a literal and inlined into unusedHelper, leaving scale and offset unreferenced
+        REQUIRE(values.count("scale") == 0);
+        REQUIRE(values.count("offset") == 0);
+        REQUIRE(values.count("unusedHelper") == 1);
+
+        // Calling a function could have effects, so its result is kept even if it's never used
+        REQUIRE(values.count("called") == 1);
+
+        REQUIRE(typedPassManager.getStatistics()["dead-code-elimination"]["unused bindings removed"] == 2);
+    }
+
+    SECTION("Removes unused local bindings, and statements after a return") {
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+            capsule Test {
+                f<Function<Number, Number>> = (n<Number>) -> {
+                    doubled<Number> = n * 2
+                    quadrupled<Number> = doubled * 2
+                    halved<Number> = n / 2
+                    helper<Function<Number, Number>> = (a<Number>) -> a + 1
+                    kept<Number> = n + 1
+                    if (1 > 2) {
+                        return 5
+                    }
+                    return kept
+                    n * 100
+                }
+            }
+        )", typedPassManager));
+
+        vector<shared_ptr<ASTNode>> body = functionBody(values["f"]);
+
+        // Nothing uses the bindings before kept, and dividing by 2 can't trap, so they all go
+        REQUIRE(body.size() == 2);
+        REQUIRE(dynamic_pointer_cast<IdentifierNode>(body[0]->getLeft())->getIdentifier() == "kept");
+        REQUIRE(body[1]->getNodeType() == ASTNode::RETURN);
+
+        map<string, int> statistics = typedPassManager.getStatistics()["dead-code-elimination"];
+
+        REQUIRE(statistics["unused bindings removed"] == 4);
+        REQUIRE(statistics["unreachable statements removed"] == 1);
+        REQUIRE(statistics["untaken branches removed"] == 1);
+        REQUIRE(statistics["nodes removed"] > 5);
+
+        ostringstream output;
+        typedPassManager.displayStatistics(output);
+
+        REQUIRE(output.str().find("unreachable statements removed") != string::npos);
+    }
+
+    SECTION("Keeps unused bindings whose values might trap") {
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+            capsule Test {
+                f<Function<Number, Number>> = (n<Number>) -> {
+                    ratio<Number> = 100 / n
+                    return n
+                }
+            }
+        )", typedPassManager));
+
+        REQUIRE(functionBody(values["f"]).size() == 2);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "FunctionInlinerPass") {
+    PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+    // Calls with literal arguments would otherwise be evaluated before they could be inlined
+    session->optimization.parsePassOverrides("-compile-time-evaluation");
+
+    string source = R"(
+        capsule Test {
+            add<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> a + b
+            square<Function<Number, Number>> = (x<Number>) -> x * x
+            factorial<Function<Number, Number>> = (n<Number>) -> {
+                if (n <= 1) {
+                    return 1
+                }
+
+                return n * factorial(n - 1)
+            }
+            f<Function<Number, Number>> = (n<Number>) -> add(n, 1) + square(n)
+            g<Function<Number, Number>> = (n<Number>) -> square(add(n, 1))
+            h<Function<Number, Number>> = (n<Number>) -> factorial(n)
+        }
+    )";
+
+    SECTION("Inlines calls to small functions, substituting their arguments") {
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(source, typedPassManager));
+
+        shared_ptr<ASTNode> f = functionBody(values["f"])[0];
+
+        REQUIRE(f->getNodeType() == ASTNode::BINARY_OPERATION);
+        REQUIRE(f->getLeft()->getNodeType() == ASTNode::BINARY_OPERATION);
+        REQUIRE(dynamic_pointer_cast<BinaryOperationNode>(f->getLeft())->getOperator() == "+");
+        REQUIRE(dynamic_pointer_cast<IdentifierNode>(f->getLeft()->getLeft())->getIdentifier() == "n");
+        REQUIRE(dynamic_pointer_cast<BinaryOperationNode>(f->getRight())->getOperator() == "*");
+        REQUIRE(f->getResolvedType() != nullptr);
+        REQUIRE(f->getRight()->getLeft()->getResolvedType() != nullptr);
+
+        REQUIRE(typedPassManager.getStatistics()["function-inliner"]["calls inlined"] == 3);
+    }
+
+    SECTION("Doesn't evaluate an argument more than once") {
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(source, typedPassManager));
+
+        // add is inlined, but its result is used twice by square, so square stays a call
+        shared_ptr<ASTNode> g = functionBody(values["g"])[0];
+
+        REQUIRE(g->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+        REQUIRE(dynamic_pointer_cast<FunctionInvocationNode>(g)->getParameters()->getElements()[0]->getNodeType() == ASTNode::BINARY_OPERATION);
+    }
+
+    SECTION("Doesn't inline recursive functions") {
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(source, typedPassManager));
+
+        REQUIRE(functionBody(values["h"])[0]->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+    }
+
+    SECTION("Respects the inline threshold") {
+        session->optimization.inlineThreshold = -10;
+
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(source, typedPassManager));
+
+        REQUIRE(functionBody(values["f"])[0]->getLeft()->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+        REQUIRE(typedPassManager.getStatistics()["function-inliner"].empty());
+    }
+
+    SECTION("Doesn't inline a body whose names mean something else at the call") {
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+            capsule Test {
+                twice<Function<Number, Number>> = (n<Number>) -> n * 2
+                base<Number> = twice(5)
+                offset<Function<Number, Number>> = (n<Number>) -> n + base
+                f<Function<Number, Number>> = (base<Number>) -> offset(base)
+            }
+        )", typedPassManager));
+
+        REQUIRE(functionBody(values["f"])[0]->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+        REQUIRE(values["base"]->getNodeType() == ASTNode::BINARY_OPERATION);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "TailCallEliminationPass") {
+    PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+    map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+        capsule Test {
+            factorial<Function<Number, Number, Number>> = (n<Number>, total<Number>) -> {
+                if (n <= 1) {
+                    return total
+                }
+
+                factorial(n - 1, n * total)
+            }
+            naiveFactorial<Function<Number, Number>> = (n<Number>) -> {
+                if (n <= 1) {
+                    return 1
+                }
+
+                return n * naiveFactorial(n - 1)
+            }
+            twiceFactorial<Function<Number, Number>> = (n<Number>) -> factorial(factorial(n, 1), 1)
+            isEven<Function<Number, Boolean>> = (n<Number>) -> {
+                if (n == 0) {
+                    return true
+                }
+
+                return isOdd(n - 1)
+            }
+            isOdd<Function<Number, Boolean>> = (n<Number>) -> {
+                if (n == 0) {
+                    return false
+                } else {
+                    isEven(n - 1)
+                }
+            }
+        }
+    )", typedPassManager));
+
+    auto isTailCall = [](shared_ptr<ASTNode> node) {
+        shared_ptr<FunctionInvocationNode> invocation = dynamic_pointer_cast<FunctionInvocationNode>(node);
+
+        return invocation && invocation->isTailCall();
+    };
+
+    SECTION("Marks the calls whose value the function returns") {
+        REQUIRE(isTailCall(functionBody(values["factorial"]).back()));
+        REQUIRE(isTailCall(functionBody(values["isEven"]).back()->getValue()));
+
+        shared_ptr<ControlFlowNode> isOddBranches = dynamic_pointer_cast<ControlFlowNode>(functionBody(values["isOdd"])[0]);
+        shared_ptr<ASTNode> elseBranch = isOddBranches->getConditionExpressionPairs().back().second;
+
+        REQUIRE(isTailCall(dynamic_pointer_cast<ASTNodeList>(elseBranch)->getElements()[0]));
+
+        REQUIRE(typedPassManager.getStatistics()["tail-call-elimination"]["tail calls found"] == 4);
+    }
+
+    SECTION("Doesn't mark calls whose result is used by the function") {
+        shared_ptr<ASTNode> naiveReturn = functionBody(values["naiveFactorial"]).back()->getValue();
+
+        REQUIRE(naiveReturn->getRight()->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+        REQUIRE(!isTailCall(naiveReturn->getRight()));
+
+        shared_ptr<FunctionInvocationNode> outerCall = dynamic_pointer_cast<FunctionInvocationNode>(functionBody(values["twiceFactorial"])[0]);
+
+        REQUIRE(isTailCall(outerCall));
+        REQUIRE(!isTailCall(outerCall->getParameters()->getElements()[0]));
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "ClosureEscapeAnalysisPass") {
+    PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+    map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+        capsule Test {
+            sumOfSquares<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> {
+                square<Function<Number, Number>> = (n<Number>) -> n * n
+                offset<Function<Number, Number>> = (n<Number>) -> n + a
+                total<Number> = square(a) + square(b)
+                offset(total)
+            }
+            adder<Function<Number, Function<Number, Number>>> = (a<Number>) -> {
+                add<Function<Number, Number>> = (n<Number>) -> n + a
+                add
+            }
+            passed<Function<Number, Number>> = (a<Number>) -> {
+                add<Function<Number, Number>> = (n<Number>) -> n + a
+                apply(add, 1)
+            }
+            captured<Function<Number, Number>> = (a<Number>) -> {
+                add<Function<Number, Number>> = (n<Number>) -> n + a
+                twice<Function<Number, Number>> = (n<Number>) -> add(add(n))
+                twice(1)
+            }
+            multiplier<Function<Number, Function<Number, Number>>> = (x<Number>) -> (y<Number>) -> x * y
+            scaled<Function<Number, Number>> = (a<Number>) -> {
+                triple<Function<Number, Number>> = multiplier(3)
+                triple(a) + triple(1)
+            }
+            multiplierOf<Function<Number, Function<Number, Number>>> = (a<Number>) -> {
+                times<Function<Number, Number>> = multiplier(a)
+                times
+            }
+            apply<Function<Function<Number, Number>, Number, Number>> = (f<Function<Number, Number>>, n<Number>) -> {
+                if (n <= 0) {
+                    return n
+                }
+
+                apply(f, n - 1)
+            }
+        }
+    )", typedPassManager));
+
+    auto isEscaping = [](shared_ptr<ASTNode> statement) {
+        return dynamic_pointer_cast<FunctionDeclarationNode>(statement->getRight())->isEscaping();
+    };
+
+    SECTION("Finds the functions that are only called in the block declaring them") {
+        vector<shared_ptr<ASTNode>> body = functionBody(values["sumOfSquares"]);
+
+        REQUIRE(!isEscaping(body[0]));
+        REQUIRE(!isEscaping(body[1]));
+
+        REQUIRE(typedPassManager.getStatistics()["closure-escape-analysis"]["closures kept out of memory"] == 4);
+    }
+
+    SECTION("Finds the closures returned by calls that are only called in the block binding them") {
+        auto isCallEscaping = [](shared_ptr<ASTNode> statement) {
+            return dynamic_pointer_cast<FunctionInvocationNode>(statement->getRight())->isEscaping();
+        };
+
+        REQUIRE(!isCallEscaping(functionBody(values["scaled"])[0]));
+        REQUIRE(isCallEscaping(functionBody(values["multiplierOf"])[0]));
+    }
+
+    SECTION("Keeps functions that are returned, passed along or captured as escaping") {
+        REQUIRE(isEscaping(functionBody(values["adder"])[0]));
+        REQUIRE(isEscaping(functionBody(values["passed"])[0]));
+        REQUIRE(isEscaping(functionBody(values["captured"])[0]));
+        REQUIRE(!isEscaping(functionBody(values["captured"])[1]));
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "CommonSubexpressionEliminationPass") {
+    PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+    map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+        capsule Test {
+            spread<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> {
+                difference<Number> = b - a
+                return (b - a) * (b - a)
+            }
+            area<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> (a + b) * (a + b) - a * b
+            cube<Function<Number, Number>> = (n<Number>) -> {
+                squared<Number> = n * n
+                squared * n
+            }
+            sumOfCubes<Function<Number, Number>> = (n<Number>) -> cube(n + 1) + cube(n + 1)
+            countdown<Function<Number, Number>> = (n<Number>) -> {
+                if (n <= 0) {
+                    return 0
+                }
+
+                countdown(n - 1)
+            }
+            twiceCountdown<Function<Number, Number>> = (n<Number>) -> countdown(n) + countdown(n)
+            ratios<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> a / b + a / b
+            branches<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> {
+                if (a > b) {
+                    return (a - b) * 2
+                }
+
+                (a - b) * 3
+            }
+        }
+    )", typedPassManager));
+
+    auto identifierName = [](shared_ptr<ASTNode> node) {
+        shared_ptr<IdentifierNode> identifier = dynamic_pointer_cast<IdentifierNode>(node);
+
+        return identifier ? identifier->getIdentifier() : "<not an identifier>";
+    };
+
+    SECTION("Reuses a binding that already holds the expression") {
+        vector<shared_ptr<ASTNode>> spread = functionBody(values["spread"]);
+        shared_ptr<ASTNode> product = spread.back()->getValue();
+
+        REQUIRE(spread.size() == 2);
+        REQUIRE(identifierName(product->getLeft()) == "difference");
+        REQUIRE(identifierName(product->getRight()) == "difference");
+        REQUIRE(product->getLeft()->getResolvedType() != nullptr);
+    }
+
+    SECTION("Introduces a local for an expression evaluated more than once") {
+        vector<shared_ptr<ASTNode>> area = functionBody(values["area"]);
+
+        REQUIRE(area.size() == 2);
+        REQUIRE(area[0]->getNodeType() == ASTNode::ASSIGNMENT);
+        REQUIRE(dynamic_pointer_cast<BinaryOperationNode>(area[0]->getRight())->getOperator() == "+");
+        REQUIRE(area[0]->getResolvedType() != nullptr);
+
+        string local = identifierName(area[0]->getLeft());
+
+        REQUIRE(identifierName(area[1]->getLeft()->getLeft()) == local);
+        REQUIRE(identifierName(area[1]->getLeft()->getRight()) == local);
+    }
+
+    SECTION("Shares the result of calls to pure functions, but not to ones that might not return") {
+        vector<shared_ptr<ASTNode>> sumOfCubes = functionBody(values["sumOfCubes"]);
+
+        REQUIRE(sumOfCubes.size() == 2);
+        REQUIRE(sumOfCubes[0]->getRight()->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+        REQUIRE(identifierName(sumOfCubes[1]->getLeft()) == identifierName(sumOfCubes[0]->getLeft()));
+
+        REQUIRE(functionBody(values["twiceCountdown"]).size() == 1);
+        REQUIRE(functionBody(values["ratios"]).size() == 1);
+    }
+
+    SECTION("Doesn't move expressions out of the branches of control flow") {
+        REQUIRE(functionBody(values["branches"]).size() == 2);
+
+        REQUIRE(typedPassManager.getStatistics()["common-subexpression-elimination"]["expressions eliminated"] == 4);
+        REQUIRE(typedPassManager.getStatistics()["common-subexpression-elimination"]["locals introduced"] == 2);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "CompileTimeEvaluationPass") {
+    PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+    map<string, shared_ptr<ASTNode>> values = capsuleValues(optimizeTyped(R"(
+        capsule Test {
+            fibonacci<Function<Number, Number>> = (n<Number>) -> {
+                if (n <= 1) {
+                    return n
+                }
+
+                fibonacci(n - 1) + fibonacci(n - 2)
+            }
+            label<Function<Number, String>> = (n<Number>) -> {
+                if (n > 1000) {
+                    return 'large'
+                }
+
+                'small'
+            }
+            isEven<Function<Number, Boolean>> = (n<Number>) -> n % 2 == 0
+            forever<Function<Number, Number>> = (n<Number>) -> forever(n + 1)
+            ratio<Function<Number, Number>> = (n<Number>) -> 100 / n
+            fib<Function<Number>> = () -> fibonacci(20)
+            size<Function<String>> = () -> label(fibonacci(20))
+            even<Function<Boolean>> = () -> isEven(fibonacci(20))
+            never<Function<Number>> = () -> forever(1)
+            undefined<Function<Number>> = () -> ratio(0)
+            twenty<Function<Number>> = () -> ratio(5)
+            unknown<Function<Number, Number>> = (n<Number>) -> fibonacci(n)
+        }
+    )", typedPassManager));
+
+    SECTION("Replaces calls with literal arguments by the literal they return") {
+        shared_ptr<ASTNode> fib = functionBody(values["fib"])[0];
+
+        REQUIRE(literalValue(fib) == "6765");
+        REQUIRE(fib->getResolvedType() != nullptr);
+        REQUIRE(literalValue(functionBody(values["size"])[0]) == "large");
+        REQUIRE(literalValue(functionBody(values["even"])[0]) == "false");
+        REQUIRE(literalValue(functionBody(values["twenty"])[0]) == "20");
+
+        REQUIRE(typedPassManager.getStatistics()["compile-time-evaluation"]["calls evaluated"] == 6);
+    }
+
+    SECTION("Leaves calls that don't return, would trap, or whose arguments aren't known for the runtime") {
+        REQUIRE(functionBody(values["never"])[0]->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+        REQUIRE(functionBody(values["undefined"])[0]->getNodeType() != ASTNode::NUMBER_LITERAL);
+        REQUIRE(functionBody(values["unknown"])[0]->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "PipelineFusionPass") {
+    PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+    string source = R"(
+        capsule Test {
+            scale<Function<Number, Number, Number>> = (n<Number>, factor<Number>) -> n * factor
+            square<Function<Number, Number>> = (n<Number>) -> n * n
+            offset<Function<Number, Number, Number>> = (n<Number>, amount<Number>) -> n + amount
+            transform<Function<Number, Number>> = (x<Number>) -> x => scale(3) => square() => offset(7)
+        }
+    )";
+
+    SECTION("Binds the values piped between stages, so every stage can be inlined") {
+        vector<shared_ptr<ASTNode>> transform = functionBody(capsuleValues(optimizeTyped(source, typedPassManager))["transform"]);
+
+        // scaled = x * 3, squared = scaled * scaled, squared + 7
+        REQUIRE(transform.size() == 3);
+        REQUIRE(dynamic_pointer_cast<BinaryOperationNode>(transform[0]->getRight())->getOperator() == "*");
+        REQUIRE(dynamic_pointer_cast<BinaryOperationNode>(transform[1]->getRight())->getOperator() == "*");
+        REQUIRE(dynamic_pointer_cast<BinaryOperationNode>(transform[2])->getOperator() == "+");
+        REQUIRE(transform[1]->getRight()->getLeft()->getNodeType() == ASTNode::IDENTIFIER);
+        REQUIRE(transform[2]->getLeft()->getNodeType() == ASTNode::IDENTIFIER);
+
+        REQUIRE(typedPassManager.getStatistics()["pipeline-fusion"]["piped values bound"] == 2);
+    }
+
+    SECTION("Leaves a stage that uses its piped value twice as a call without it") {
+        session->optimization.parsePassOverrides("-pipeline-fusion");
+
+        vector<shared_ptr<ASTNode>> transform = functionBody(capsuleValues(optimizeTyped(source, typedPassManager))["transform"]);
+
+        REQUIRE(transform.size() == 1);
+        REQUIRE(transform[0]->getLeft()->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "ExecutionProfile") {
+    string source = R"(
+        capsule Test {
+            poly<Function<Number, Number>> = (x<Number>) -> x * 3 + x * 5 + x * 7 + 1
+            classify<Function<Number, Number>> = (n<Number>) -> {
+                if (n == 1) {
+                    return 10
+                } else if (n == 2) {
+                    return 20
+                }
+
+                return 30
+            }
+            f<Function<Number, Number>> = (n<Number>) -> poly(n) + classify(n)
+        }
+    )";
+
+    map<string, shared_ptr<ASTNode>> parsed = capsuleValues(parse(source));
+    string polyHash = CodeGen::generateFunctionHash(dynamic_pointer_cast<FunctionDeclarationNode>(parsed["poly"]));
+    string classifyHash = CodeGen::generateFunctionHash(dynamic_pointer_cast<FunctionDeclarationNode>(parsed["classify"]));
+
+    shared_ptr<ExecutionProfile> profile = make_shared<ExecutionProfile>();
+
+    SECTION("Merges the counts of profiles, skipping lines it can't read") {
+        istringstream firstRun("# first run\nfunction " + polyHash + " 30\nfunction 0123 5\nbranch " + classifyHash + " 0 1 7\n");
+        istringstream secondRun("function " + polyHash + " 70\nfunction\nfunction " + polyHash + " lots\nbranch " + classifyHash + " 0 1 3\n");
+
+        profile->parse(firstRun);
+        profile->parse(secondRun);
+
+        REQUIRE(profile->getCallCount(polyHash) == 100);
+        REQUIRE(profile->getCallCount("0123") == 5);
+        REQUIRE(profile->getCallCount(classifyHash) == -1);
+        REQUIRE(profile->isHot(10));
+        REQUIRE(!profile->isHot(5));
+
+        shared_ptr<ASTNode> ast = parse(source);
+        profile->apply(ast);
+
+        map<string, shared_ptr<ASTNode>> values = capsuleValues(ast);
+        shared_ptr<ControlFlowNode> branches = dynamic_pointer_cast<ControlFlowNode>(functionBody(values["classify"])[0]);
+
+        REQUIRE(*dynamic_pointer_cast<FunctionDeclarationNode>(values["poly"])->getProfiledCallCount() == 100);
+        REQUIRE(!dynamic_pointer_cast<FunctionDeclarationNode>(values["f"])->getProfiledCallCount());
+        REQUIRE(branches->getProfiledBranchCounts() == vector<long long>{ 0, 10 });
+    }
+
+    SECTION("Ignores counts for functions that changed since they were profiled") {
+        istringstream stale("function " + polyHash + " 100\n");
+        profile->parse(stale);
+
+        shared_ptr<ASTNode> ast = parse(R"(
+            capsule Test {
+                poly<Function<Number, Number>> = (x<Number>) -> x * x + 1
+            }
+        )");
+        profile->apply(ast);
+
+        REQUIRE(!dynamic_pointer_cast<FunctionDeclarationNode>(capsuleValues(ast)["poly"])->getProfiledCallCount());
+    }
+
+    SECTION("Inlines hot functions past the threshold") {
+        PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+        session->optimization.inlineThreshold = 4;
+
+        shared_ptr<ASTNode> unprofiled = functionBody(capsuleValues(optimizeTyped(source, typedPassManager))["f"])[0];
+
+        REQUIRE(unprofiled->getLeft()->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+
+        istringstream hot("function " + polyHash + " 100\n");
+        profile->parse(hot);
+        session->optimization.profile = profile;
+
+        shared_ptr<ASTNode> f = functionBody(capsuleValues(optimizeTyped(source, typedPassManager))["f"])[0];
+
+        REQUIRE(f->getLeft()->getNodeType() == ASTNode::BINARY_OPERATION);
+    }
+
+    SECTION("Doesn't grow the code to inline functions that were never called") {
+        PassManager typedPassManager(session, AFTER_TYPE_CHECKING);
+
+        istringstream cold("function " + polyHash + " 0\nfunction " + classifyHash + " 100\n");
+        profile->parse(cold);
+        session->optimization.profile = profile;
+
+        shared_ptr<ASTNode> f = functionBody(capsuleValues(optimizeTyped(source, typedPassManager))["f"])[0];
+
+        REQUIRE(f->getLeft()->getNodeType() == ASTNode::FUNCTION_INVOCATION);
+    }
+}
+
+TEST_CASE_METHOD(OptimizationTest, "TreeShakingPass") {
+    map<string, string> linkedSources = {
+        { "ShakenStrings", "link ShakenMath\ncapsule ShakenStrings {\n  greeting<String> = 'hi'\n  shout<Function<String, String>> = (s<String>) -> s\n  describe<Function<Number, Number>> = (n<Number>) -> ShakenMath.double(n)\n}\n" },
+        { "ShakenMath", "capsule ShakenMath {\n  double<Function<Number, Number>> = (n<Number>) -> twice(n)\n  twice<Function<Number, Number>> = (n<Number>) -> n * 2\n  triple<Function<Number, Number>> = (n<Number>) -> n * 3\n}\n" },
+        { "ShakenUnused", "capsule ShakenUnused {\n  x<Number> = 1\n}\n" }
+    };
+
+    shared_ptr<map<string, string>> linkedFiles = make_shared<map<string, string>>();
+    for (auto &linkedSource : linkedSources) {
+        string linkedFile = (std::filesystem::temp_directory_path() / ("ThetaOptimizationTest" + linkedSource.first + ".th")).string();
+        ofstream(linkedFile) << linkedSource.second;
+
+        linkedFiles->insert(make_pair(linkedSource.first, linkedFile));
+    }
+
+    session = make_shared<CompilationSession>(linkedFiles);
+    session->optimization.level = O1;
+
+    shared_ptr<ASTNode> ast = parse(R"(
+        link ShakenStrings
+        link ShakenUnused
+        capsule Main {
+            f<Function<Number, Number>> = (n<Number>) -> ShakenStrings.describe(n)
+            g<Function<String, String>> = ShakenStrings.shout
+        }
+    )");
+
+    for (auto &linkedFile : *linkedFiles) {
+        std::filesystem::remove(linkedFile.second);
+    }
+
+    REQUIRE(session->getEncounteredExceptions().size() == 0);
+
+    auto linkedElementNames = [](shared_ptr<ASTNode> link) {
+        vector<string> names;
+        for (auto &element : dynamic_pointer_cast<ASTNodeList>(link->getValue()->getValue()->getValue())->getElements()) {
+            names.push_back(dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier());
+        }
+
+        return names;
+    };
+
+    shared_ptr<ASTNode> originalStrings = dynamic_pointer_cast<SourceNode>(ast)->getLinks()[0];
+
+    SECTION("Keeps only the linked functions reachable from the capsule, called or not") {
+        REQUIRE(PassManager(session).run(ast));
+
+        vector<shared_ptr<ASTNode>> links = dynamic_pointer_cast<SourceNode>(ast)->getLinks();
+
+        REQUIRE(links.size() == 1);
+        REQUIRE(linkedElementNames(links[0]) == vector<string>{ "shout", "describe" });
+
+        vector<shared_ptr<ASTNode>> mathLinks = dynamic_pointer_cast<SourceNode>(links[0]->getValue())->getLinks();
+
+        REQUIRE(mathLinks.size() == 1);
+        REQUIRE(linkedElementNames(mathLinks[0]) == vector<string>{ "double", "twice" });
+    }
+
+    SECTION("Leaves the linked capsules shared between compilations as they were") {
+        REQUIRE(PassManager(session).run(ast));
+
+        REQUIRE(dynamic_pointer_cast<SourceNode>(ast)->getLinks()[0] != originalStrings);
+        REQUIRE(linkedElementNames(originalStrings) == vector<string>{ "greeting", "shout", "describe" });
+    }
+
+    SECTION("Keeps every link when disabled") {
+        session->optimization.parsePassOverrides("-tree-shaking");
+
+        REQUIRE(PassManager(session).run(ast));
+
+        REQUIRE(dynamic_pointer_cast<SourceNode>(ast)->getLinks().size() == 2);
+        REQUIRE(dynamic_pointer_cast<SourceNode>(ast)->getLinks()[0] == originalStrings);
+    }
+}
@@ -11,7 +11,8 @@ TEST_CASE("Parser") {
     Theta::Lexer lexer;
     Theta::Parser parser;
 
-    shared_ptr<map<string, string>> filesByCapsuleName = Theta::Compiler::getInstance().filesByCapsuleName;
+    static shared_ptr<map<string, string>> filesByCapsuleName = CompilationSession::discoverCapsules();
+    shared_ptr<CompilationSession> session = make_shared<CompilationSession>(filesByCapsuleName);
 
     // --------- PRIMITIVES ----------
     SECTION("Can parse numbers with decimals") {
@@ -19,7 +20,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -42,7 +43,7 @@ TEST_CASE("Parser") {
         string source = "5100 / 10.23.4.";
         lexer.lex(source);
 
-        parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName);
+        parser.parse(lexer.tokens, source, "fakeFile.th", session);
 
         REQUIRE(lexer.tokens.size() == 1);
         REQUIRE(lexer.tokens[0].getType() == Token::IDENTIFIER);
@@ -54,7 +55,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -71,7 +72,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -89,7 +90,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -115,7 +116,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -171,7 +172,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -199,7 +200,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -220,7 +221,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -241,7 +242,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -262,7 +263,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -283,7 +284,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -304,7 +305,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -325,7 +326,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -349,7 +350,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -398,7 +399,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -419,7 +420,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -441,7 +442,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -463,7 +464,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -484,7 +485,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -507,7 +508,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -534,7 +535,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -554,7 +555,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -574,7 +575,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -603,7 +604,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -630,7 +631,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -659,7 +660,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -714,7 +715,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -780,7 +781,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -812,7 +813,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         cout << "THE PARSED AST IS: " << endl;
@@ -884,7 +885,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -937,7 +938,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -992,7 +993,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1046,7 +1047,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1092,7 +1093,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1131,7 +1132,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1272,7 +1273,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1316,7 +1317,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1350,7 +1351,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1384,7 +1385,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1423,7 +1424,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1452,7 +1453,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1481,7 +1482,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1527,7 +1528,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1575,7 +1576,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1620,7 +1621,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1645,7 +1646,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1673,7 +1674,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1704,7 +1705,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1744,7 +1745,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1798,7 +1799,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1841,7 +1842,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1898,7 +1899,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -1972,7 +1973,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -2023,7 +2024,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -2126,7 +2127,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -2169,7 +2170,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -2225,7 +2226,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -2273,7 +2274,7 @@ TEST_CASE("Parser") {
         lexer.lex(source);
 
         shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
-            parser.parse(lexer.tokens, source, "fakeFile.th", filesByCapsuleName)
+            parser.parse(lexer.tokens, source, "fakeFile.th", session)
         );
 
         REQUIRE(parsedAST->getNodeType() == ASTNode::SOURCE);
@@ -2311,4 +2312,188 @@ TEST_CASE("Parser") {
         REQUIRE(returnValueNode->getNodeType() == ASTNode::BOOLEAN_LITERAL);
         REQUIRE(returnValueNode->getLiteralValue() == "true");
     }
+
+    SECTION("Parses a linked capsule only once when sessions share a link cache") {
+        string linkedFile = (std::filesystem::temp_directory_path() / "ThetaParserTestSharedMath.th").string();
+        ofstream(linkedFile) << "capsule SharedMath {\n  x<Number> = 5\n}\n";
+
+        shared_ptr<map<string, string>> linkedFiles = make_shared<map<string, string>>();
+        linkedFiles->insert(make_pair("SharedMath", linkedFile));
+
+        shared_ptr<LinkedCapsuleCache> linkCache = make_shared<LinkedCapsuleCache>();
+        shared_ptr<CompilationSession> firstSession = make_shared<CompilationSession>(linkedFiles, linkCache);
+        shared_ptr<CompilationSession> secondSession = make_shared<CompilationSession>(linkedFiles, linkCache);
+
+        string firstSource = "link SharedMath\ncapsule First {\n  y<Number> = 1\n}";
+        lexer.lex(firstSource);
+        shared_ptr<SourceNode> firstAST = dynamic_pointer_cast<SourceNode>(
+            parser.parse(lexer.tokens, firstSource, "first.th", firstSession)
+        );
+
+        string secondSource = "link SharedMath\ncapsule Second {\n  z<Number> = 2\n}";
+        Lexer secondLexer;
+        secondLexer.lex(secondSource);
+        Parser secondParser;
+        shared_ptr<SourceNode> secondAST = dynamic_pointer_cast<SourceNode>(
+            secondParser.parse(secondLexer.tokens, secondSource, "second.th", secondSession)
+        );
+
+        std::filesystem::remove(linkedFile);
+
+        REQUIRE(firstSession->getEncounteredExceptions().size() == 0);
+        REQUIRE(secondSession->getEncounteredExceptions().size() == 0);
+        REQUIRE(firstAST->getLinks().size() == 1);
+        REQUIRE(secondAST->getLinks().size() == 1);
+        REQUIRE(firstAST->getLinks()[0] != secondAST->getLinks()[0]);
+        REQUIRE(firstAST->getLinks()[0]->getValue() != nullptr);
+        REQUIRE(firstAST->getLinks()[0]->getValue() == secondAST->getLinks()[0]->getValue());
+        REQUIRE(secondAST->getLinks()[0]->getParent() == secondAST);
+    }
+
+    SECTION("Reports capsules that link each other instead of parsing them forever") {
+        string firstFile = (std::filesystem::temp_directory_path() / "ThetaParserTestCycleFirst.th").string();
+        string secondFile = (std::filesystem::temp_directory_path() / "ThetaParserTestCycleSecond.th").string();
+        ofstream(firstFile) << "link CycleSecond\ncapsule CycleFirst {\n  x<Number> = 5\n}\n";
+        ofstream(secondFile) << "link CycleFirst\ncapsule CycleSecond {\n  y<Number> = 6\n}\n";
+
+        shared_ptr<map<string, string>> linkedFiles = make_shared<map<string, string>>();
+        linkedFiles->insert(make_pair("CycleFirst", firstFile));
+        linkedFiles->insert(make_pair("CycleSecond", secondFile));
+
+        string source = "link CycleFirst\ncapsule Main {\n  z<Number> = 1\n}";
+
+        for (auto linkCache : { shared_ptr<LinkedCapsuleCache>(), make_shared<LinkedCapsuleCache>() }) {
+            shared_ptr<CompilationSession> cycleSession = make_shared<CompilationSession>(linkedFiles, linkCache);
+
+            Lexer cycleLexer;
+            cycleLexer.lex(source);
+            Parser cycleParser;
+            shared_ptr<SourceNode> parsedAST = dynamic_pointer_cast<SourceNode>(
+                cycleParser.parse(cycleLexer.tokens, source, "main.th", cycleSession)
+            );
+
+            REQUIRE(cycleSession->getEncounteredExceptions().size() == 1);
+            REQUIRE(cycleSession->getEncounteredExceptions()[0]->getErrorType() == "LinkageError");
+            REQUIRE(cycleSession->getEncounteredExceptions()[0]->getMessage() == "Capsule CycleFirst links itself, through the capsules it links");
+
+            shared_ptr<ASTNode> secondLink = dynamic_pointer_cast<SourceNode>(parsedAST->getLinks()[0]->getValue())->getLinks()[0];
+
+            REQUIRE(secondLink->getValue() != nullptr);
+            REQUIRE(dynamic_pointer_cast<SourceNode>(secondLink->getValue())->getLinks()[0]->getValue() == nullptr);
+        }
+
+        std::filesystem::remove(firstFile);
+        std::filesystem::remove(secondFile);
+    }
+
+    SECTION("Reports a missing capsule against each file that links it, when sessions share a link cache") {
+        shared_ptr<LinkedCapsuleCache> linkCache = make_shared<LinkedCapsuleCache>();
+        shared_ptr<map<string, string>> noFiles = make_shared<map<string, string>>();
+        vector<string> fileNames = { "first.th", "second.th" };
+
+        for (auto &fileName : fileNames) {
+            shared_ptr<CompilationSession> linkingSession = make_shared<CompilationSession>(noFiles, linkCache);
+
+            string linkingSource = "link Missing\ncapsule Linking {\n  y<Number> = 1\n}";
+            Lexer linkingLexer;
+            linkingLexer.lex(linkingSource);
+            Parser linkingParser;
+            linkingParser.parse(linkingLexer.tokens, linkingSource, fileName, linkingSession);
+
+            REQUIRE(linkingSession->getEncounteredExceptions().size() == 1);
+
+            ostringstream rendered;
+            linkingSession->getEncounteredExceptions()[0]->display(rendered);
+
+            REQUIRE(rendered.str().find(fileName) != string::npos);
+        }
+    }
+
+    SECTION("Renders syntax errors with the lines around them") {
+        string source = "capsule Test {\n  x<Number> = 5\n  y<List<Number>> = [1, , 2]\n  z<Number> = 3\n}";
+        lexer.lex(source);
+
+        parser.parse(lexer.tokens, source, "fakeFile.th", session);
+
+        REQUIRE(session->getEncounteredExceptions().size() > 0);
+
+        ostringstream rendered;
+        session->getEncounteredExceptions()[0]->display(rendered);
+
+        REQUIRE(rendered.str().find("fakeFile.th") != string::npos);
+        REQUIRE(rendered.str().find("2:   x<Number> = 5\n") != string::npos);
+        REQUIRE(rendered.str().find("3:   y<List<Number>> = [1, , 2]\n") != string::npos);
+        REQUIRE(rendered.str().find("4:   z<Number> = 3\n") != string::npos);
+    }
+
+    SECTION("Keeps the elements of a capsule whose closing brace is missing") {
+        string source = "capsule Test {\n  x<Number> = 5\n  y<Number> = 6\n";
+        lexer.lex(source);
+
+        shared_ptr<ASTNode> parsedAST = parser.parse(lexer.tokens, source, "fakeFile.th", session);
+
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions()[0]->getMessage() == "Expected closing brace after block");
+        REQUIRE(dynamic_pointer_cast<CompilationError>(session->getEncounteredExceptions()[0])->getToken().getStartLocation()[0] == 3);
+
+        vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<BlockNode>(parsedAST->getValue()->getValue())->getElements();
+
+        REQUIRE(elements.size() == 2);
+        REQUIRE(dynamic_pointer_cast<IdentifierNode>(elements[1]->getLeft())->getIdentifier() == "y");
+        REQUIRE(dynamic_pointer_cast<LiteralNode>(elements[1]->getRight())->getLiteralValue() == "6");
+    }
+
+    SECTION("Parses the capsule elements after one with a syntax error") {
+        string source = "capsule Test {\n  x = 5\n  y<Number> = 6\n}";
+        lexer.lex(source);
+
+        shared_ptr<ASTNode> parsedAST = parser.parse(lexer.tokens, source, "fakeFile.th", session);
+
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions()[0]->getMessage() == "Expected a type for x before assignment");
+        REQUIRE(dynamic_pointer_cast<CompilationError>(session->getEncounteredExceptions()[0])->getToken().getStartLocation()[0] == 2);
+
+        vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<BlockNode>(parsedAST->getValue()->getValue())->getElements();
+
+        REQUIRE(elements.size() == 2);
+        REQUIRE(elements[1]->getNodeType() == ASTNode::ASSIGNMENT);
+        REQUIRE(dynamic_pointer_cast<IdentifierNode>(elements[1]->getLeft())->getIdentifier() == "y");
+        REQUIRE(dynamic_pointer_cast<TypeDeclarationNode>(elements[1]->getLeft()->getValue())->getType() == "Number");
+    }
+
+    SECTION("Reports a parameter list that is never closed") {
+        string source = "capsule Test {\n  f<Function<Number, Number>> = (a<Number>, b<Number> -> a\n  y<Number> = 6\n}";
+        lexer.lex(source);
+
+        shared_ptr<ASTNode> parsedAST = parser.parse(lexer.tokens, source, "fakeFile.th", session);
+
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions()[0]->getMessage() == "Expected closing parenthesis");
+
+        vector<shared_ptr<ASTNode>> elements = dynamic_pointer_cast<BlockNode>(parsedAST->getValue()->getValue())->getElements();
+
+        REQUIRE(elements.size() == 2);
+        REQUIRE(dynamic_pointer_cast<IdentifierNode>(elements[1]->getLeft())->getIdentifier() == "y");
+    }
+
+    SECTION("Parses capsule elements one at a time") {
+        string source = "x<Number> = 5\ny = 6\nz<Number> = 7";
+        lexer.lex(source);
+
+        shared_ptr<BlockNode> block = make_shared<BlockNode>(nullptr);
+        vector<string> names;
+
+        while (!lexer.tokens.empty()) {
+            shared_ptr<ASTNode> element = parser.parseCapsuleElement(lexer.tokens, source, "fakeFile.th", session, block);
+
+            REQUIRE(element != nullptr);
+            REQUIRE(element->getParent() == block);
+
+            names.push_back(dynamic_pointer_cast<IdentifierNode>(element->getLeft())->getIdentifier());
+        }
+
+        REQUIRE(names == vector<string>{ "x", "y", "z" });
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions()[0]->getMessage() == "Expected a type for y before assignment");
+    }
 }
@@ -0,0 +1,97 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch_amalgamated.hpp"
+#include "../src/api/ThetaAPI.h"
+#include <string>
+
+using namespace std;
+
+class ThetaAPITest {
+public:
+    theta_compiler* compiler = theta_compiler_new(0);
+    theta_module* module = nullptr;
+    theta_instance* instance = nullptr;
+
+    ~ThetaAPITest() {
+        theta_instance_free(instance);
+        theta_module_free(module);
+        theta_compiler_free(compiler);
+    }
+
+    theta_status compile(string source) {
+        return theta_compile(compiler, source.data(), source.size(), "fakeFile.th", &module);
+    }
+};
+
+TEST_CASE_METHOD(ThetaAPITest, "ThetaAPI") {
+    SECTION("Can compile, instantiate and call a function") {
+        REQUIRE(compile(R"(
+            capsule Test {
+                add<Function<Number, Number, Number>> = (a<Number>, b<Number>) -> a + b
+            }
+        )") == THETA_OK);
+
+        size_t size = 0;
+        REQUIRE(theta_module_data(module, &size) != nullptr);
+        REQUIRE(size > 0);
+
+        REQUIRE(theta_instantiate(module, &instance) == THETA_OK);
+
+        theta_function* add = nullptr;
+        REQUIRE(theta_instance_get_function(instance, "add", 2, &add) == THETA_OK);
+        REQUIRE(theta_function_param_count(add) == 2);
+        REQUIRE(theta_function_param_kind(add, 0) == THETA_I64);
+        REQUIRE(theta_function_result_kind(add) == THETA_I64);
+
+        theta_value args[2];
+        args[0].kind = THETA_I64;
+        args[0].of.i64 = 40;
+        args[1].kind = THETA_I64;
+        args[1].of.i64 = 2;
+
+        theta_value result;
+
+        // The function only needs to be looked up once, and can then be called repeatedly
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(theta_call(add, args, 2, &result) == THETA_OK);
+            REQUIRE(result.kind == THETA_I64);
+            REQUIRE(result.of.i64 == 42);
+        }
+    }
+
+    SECTION("Reports compilation errors") {
+        REQUIRE(compile(R"(
+            capsule Test {
+                main<Function<Number>> = () -> 'not a number'
+            }
+        )") == THETA_ERROR_COMPILATION);
+
+        REQUIRE(module == nullptr);
+    }
+
+    SECTION("Rejects lookups and calls that don't match the function") {
+        REQUIRE(compile(R"(
+            capsule Test {
+                isPositive<Function<Number, Boolean>> = (a<Number>) -> a > 0
+            }
+        )") == THETA_OK);
+
+        REQUIRE(theta_instantiate(module, &instance) == THETA_OK);
+
+        theta_function* isPositive = nullptr;
+        REQUIRE(theta_instance_get_function(instance, "isPositive", 2, &isPositive) == THETA_ERROR_NOT_FOUND);
+        REQUIRE(theta_instance_get_function(instance, "isPositive", 1, &isPositive) == THETA_OK);
+        REQUIRE(theta_function_result_kind(isPositive) == THETA_I32);
+
+        theta_value arg;
+        arg.kind = THETA_I32;
+        arg.of.i32 = 5;
+
+        theta_value result;
+        REQUIRE(theta_call(isPositive, &arg, 1, &result) == THETA_ERROR_SIGNATURE_MISMATCH);
+
+        arg.kind = THETA_I64;
+        arg.of.i64 = 5;
+        REQUIRE(theta_call(isPositive, &arg, 1, &result) == THETA_OK);
+        REQUIRE(result.of.i32 == 1);
+    }
+}
@@ -12,15 +12,18 @@ class TypeCheckerTest {
 public:
     Lexer lexer;
     Parser parser;
+    shared_ptr<CompilationSession> session;
     TypeChecker typeChecker;
-    shared_ptr<map<string, string>> filesByCapsuleName;
 
-    TypeCheckerTest() {
-        filesByCapsuleName = Compiler::getInstance().filesByCapsuleName;
+    TypeCheckerTest() : session(make_shared<CompilationSession>(discoveredCapsules())), typeChecker(session) {}
+
+    static shared_ptr<map<string, string>> discoveredCapsules() {
+        static shared_ptr<map<string, string>> filesByCapsuleName = CompilationSession::discoverCapsules();
+        return filesByCapsuleName;
     }
 
     shared_ptr<ASTNode> setup(string source) {
-        Compiler::getInstance().clearExceptions();
+        session->clearExceptions();
 
         lexer.lex(source);
 
@@ -28,10 +31,10 @@ public:
             lexer.tokens,
             source,
             "fakeFile.th",
-            filesByCapsuleName
+            session
         );
 
-        Compiler::getInstance().optimizeAST(parsedAST, true);
+        Compiler::optimizeAST(session, parsedAST, true);
 
         return parsedAST;
     }
@@ -48,7 +51,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck whole number assignments correctly") {
@@ -61,7 +64,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck decimal number assignments correctly") {
@@ -74,7 +77,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck boolean assignments correctly") {
@@ -87,7 +90,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck list assignments correctly") {
@@ -100,7 +103,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
     
     SECTION("Can typecheck empty list assignments correctly") {
@@ -113,7 +116,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws if list is not homogenous") {
@@ -126,7 +129,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck dictionary assignments correctly") {
@@ -139,7 +142,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck empty dictionary assignments correctly") {
@@ -152,7 +155,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws if dictionary keys are not the same type as declared") {
@@ -165,7 +168,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck symbol assignments correctly") {
@@ -178,7 +181,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck tuple assignments correctly") {
@@ -191,7 +194,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws if tuple doesnt match type spec") {
@@ -204,7 +207,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck function assignments correctly") {
@@ -217,7 +220,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck function assignents with parameters correctly") {
@@ -230,7 +233,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
     
     SECTION("Can typecheck variadic function assignments correctly") {
@@ -247,7 +250,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
         
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws when variadic function body is not assigned to variadic identifier") {
@@ -264,7 +267,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck curried functions correctly") {
@@ -277,7 +280,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     } 
 
     SECTION("Can typecheck enum definition and usage correctly") {
@@ -298,7 +301,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck control flow correctly") {
@@ -319,7 +322,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws if control flow condition is not a boolean") {
@@ -336,7 +339,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck recursive functions correctly") {
@@ -355,7 +358,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws if function arguments dont match parameter types") {
@@ -370,7 +373,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Throws if function is called with too many arguments") {
@@ -385,7 +388,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Throws if function is called with too few arguments") {
@@ -400,7 +403,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck function overloads correctly") {
@@ -421,7 +424,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws if trying to access a variable before defining it") {
@@ -438,7 +441,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Throws if trying to reassign a literal variable") {
@@ -454,7 +457,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
 
         // It wouldnt even get to checkAST in this case, because the optimizer pass should
         // add a compiler exception
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Throws if trying to reassign a complex variable") {
@@ -471,7 +474,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
 
         // It wouldnt even get to checkAST in this case, because the optimizer pass should
         // add a compiler exception
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck capsule hoisted elements correctly") {
@@ -490,7 +493,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Can typecheck struct definition and declaration correctly") {
@@ -513,7 +516,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws if struct declaration is missing fields from definition") {
@@ -535,7 +538,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
 
@@ -560,7 +563,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Throws if struct declaration field types dont match") {
@@ -583,7 +586,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck references to outer-scoped variables from within inner scope") {
@@ -600,7 +603,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Curried functions retain scope of parent functions") {
@@ -615,7 +618,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 0);
+        REQUIRE(session->getEncounteredExceptions().size() == 0);
     }
 
     SECTION("Throws error when variable assignment doesnt pass typechecking") {
@@ -628,7 +631,7 @@ TEST_CASE_METHOD(TypeCheckerTest, "TypeChecker") {
         bool isValid = typeChecker.checkAST(ast);
 
         REQUIRE(!isValid);
-        REQUIRE(Compiler::getInstance().getEncounteredExceptions().size() == 1);
+        REQUIRE(session->getEncounteredExceptions().size() == 1);
     }
 
     SECTION("Can typecheck Binary operations with numbers") {